@@ -0,0 +1,326 @@
+/*****************************************************************************/
+/**
+ * @file    geAsyncLog.h
+ * @author  Samuel Prince (samuel.prince.quezada@gmail.com)
+ * @date    2018/07/20
+ * @brief   Asynchronous backend for the Debug log.
+ *
+ * Logging threads write compact records (a format string ID and its raw
+ * arguments) to a lock-free ring buffer of their own. A background thread
+ * formats the records and writes them in batches to the console, a file and
+ * the Debug log, so threads that log never wait on I/O.
+ *
+ * @bug     No known bugs.
+ */
+/*****************************************************************************/
+#pragma once
+
+/*****************************************************************************/
+/**
+ * Includes
+ */
+/*****************************************************************************/
+#include "gePrerequisitesUtil.h"
+#include "geDebug.h"
+#include "geModule.h"
+
+namespace geEngineSDK {
+  /**
+   * @brief What a thread does when its log buffer is full.
+   */
+  namespace ASYNC_LOG_OVERFLOW {
+    enum E {
+      kDrop,  //The record is lost and counted as dropped
+      kBlock  //The thread waits until the writer makes room
+    };
+  }
+
+  /**
+   * @brief Types of arguments a log record can store.
+   */
+  namespace ASYNC_LOG_ARG {
+    enum E {
+      kInt = 0,
+      kUInt,
+      kFloat,
+      kBool,
+      kString
+    };
+  }
+
+  /**
+   * @brief A single argument of a log record. Numbers are stored as they are
+   *        and only converted to text by the writer thread. Strings are
+   *        referenced here and copied into the record.
+   */
+  class AsyncLogArg
+  {
+   public:
+    template<class T,
+             typename std::enable_if<std::is_integral<T>::value>::type* = nullptr>
+    AsyncLogArg(T value) {
+      if (std::is_same<T, bool>::value) {
+        m_type = ASYNC_LOG_ARG::kBool;
+        m_uint = value ? 1 : 0;
+      }
+      else if (std::is_signed<T>::value) {
+        m_type = ASYNC_LOG_ARG::kInt;
+        m_int = static_cast<int64>(value);
+      }
+      else {
+        m_type = ASYNC_LOG_ARG::kUInt;
+        m_uint = static_cast<uint64>(value);
+      }
+    }
+
+    template<class T,
+             typename std::enable_if<std::is_enum<T>::value>::type* = nullptr>
+    AsyncLogArg(T value)
+      : AsyncLogArg(static_cast<typename std::underlying_type<T>::type>(value))
+    {}
+
+    AsyncLogArg(double value)
+      : m_type(ASYNC_LOG_ARG::kFloat),
+        m_float(value)
+    {}
+
+    AsyncLogArg(const char* value)
+      : m_type(ASYNC_LOG_ARG::kString),
+        m_string(value ? value : ""),
+        m_stringSize(value ? static_cast<uint32>(strlen(value)) : 0)
+    {}
+
+    AsyncLogArg(const String& value)
+      : m_type(ASYNC_LOG_ARG::kString),
+        m_string(value.c_str()),
+        m_stringSize(static_cast<uint32>(value.size()))
+    {}
+
+   private:
+    friend class AsyncLog;
+
+    ASYNC_LOG_ARG::E m_type;
+    union
+    {
+      int64 m_int;
+      uint64 m_uint;
+      double m_float;
+      const char* m_string;
+    };
+    uint32 m_stringSize = 0;
+  };
+
+  /**
+   * @brief Options of the asynchronous log.
+   */
+  struct AsyncLogDesc
+  {
+    /**
+     * @brief Bytes of the ring buffer given to each thread that logs. Rounded
+     *        up to a power of two. Records larger than a quarter of it have
+     *        their strings truncated.
+     */
+    uint32 bufferSize = 64 * 1024;
+
+    /**
+     * @brief What threads do when their buffer is full.
+     */
+    ASYNC_LOG_OVERFLOW::E overflow = ASYNC_LOG_OVERFLOW::kDrop;
+
+    /**
+     * @brief Time the writer thread sleeps between batches, in milliseconds.
+     */
+    uint32 flushIntervalMs = 5;
+
+    /**
+     * @brief Writes every record to the standard output.
+     */
+    bool writeToConsole = true;
+
+    /**
+     * @brief Adds every record to the Debug log, so it shows up in
+     *        Debug::saveLog() and in the log callbacks.
+     */
+    bool forwardToLog = true;
+
+    /**
+     * @brief File every record is appended to. No file is written if empty.
+     */
+    Path filePath;
+  };
+
+  /**
+   * @brief Counters of the asynchronous log, since it was started.
+   */
+  struct AsyncLogStats
+  {
+    /**
+     * @brief Records written by the writer thread.
+     */
+    uint64 numWritten = 0;
+
+    /**
+     * @brief Records lost because the buffer of their thread was full.
+     */
+    uint64 numDropped = 0;
+
+    /**
+     * @brief Times a thread had to wait for room in its buffer.
+     */
+    uint64 numBlocked = 0;
+
+    /**
+     * @brief Batches of records written by the writer thread.
+     */
+    uint64 numBatches = 0;
+
+    /**
+     * @brief Number of threads that got a buffer.
+     */
+    uint32 numThreadBuffers = 0;
+  };
+
+  /**
+   * @brief Asynchronous backend for the Debug log. While started, the Debug
+   *        class sends its messages here instead of writing them itself.
+   * @note  Thread safe. Each thread writes to its own buffer without locking.
+   */
+  class GE_UTILITY_EXPORT AsyncLog : public Module<AsyncLog>
+  {
+    struct ThreadBuffer;
+    struct ThreadBufferHolder;
+
+   public:
+    explicit AsyncLog(const AsyncLogDesc& desc = AsyncLogDesc());
+
+    /**
+     * @brief Registers a format string and returns its ID. The string must
+     *        outlive the log (a string literal) and may reference the record
+     *        arguments with "{0}", "{1}"... same as StringUtil::format().
+     * @note  Meant to be called once per call site, see GE_LOG_ASYNC.
+     */
+    static uint32
+    registerFormat(const char* format);
+
+    /**
+     * @brief Adds a record to the buffer of the calling thread.
+     * @param[in] channel   Channel of the Debug log the record goes to.
+     * @param[in] formatId  Format string, as returned by registerFormat().
+     * @param[in] location  Place the record is logged from, or nullptr. Must
+     *            be a static constant.
+     * @param[in] args      Arguments referenced by the format string.
+     * @return false if the record was dropped.
+     */
+    template<class... Args>
+    bool
+    log(uint32 channel,
+        uint32 formatId,
+        const LogSourceLocation* location,
+        const Args&... args) {
+      const AsyncLogArg argArray[] = { AsyncLogArg(args)..., AsyncLogArg(0) };
+      return write(channel,
+                   formatId,
+                   location,
+                   argArray,
+                   static_cast<uint32>(sizeof...(Args)));
+    }
+
+    /**
+     * @brief Adds an already formatted message to the buffer of the calling
+     *        thread.
+     * @return false if the message was dropped.
+     */
+    bool
+    logMessage(const String& message,
+               uint32 channel,
+               const LogSourceLocation* location = nullptr);
+
+    /**
+     * @brief Blocks until every record added before this call is written.
+     */
+    void
+    flush();
+
+    /**
+     * @brief Returns the counters of the log.
+     */
+    AsyncLogStats
+    getStats() const;
+
+   private:
+    void
+    onStartUp() override;
+
+    void
+    onShutDown() override;
+
+    /**
+     * @brief Encodes a record into the buffer of the calling thread.
+     */
+    bool
+    write(uint32 channel,
+          uint32 formatId,
+          const LogSourceLocation* location,
+          const AsyncLogArg* args,
+          uint32 numArgs);
+
+    /**
+     * @brief Returns the buffer of the calling thread, creating it if needed.
+     */
+    ThreadBuffer*
+    getThreadBuffer();
+
+    /**
+     * @brief Entry point of the writer thread.
+     */
+    void
+    writerMain();
+
+    /**
+     * @brief Formats and writes every record in the thread buffers.
+     */
+    void
+    writeRecords();
+
+    AsyncLogDesc m_desc;
+    uint32 m_bufferSize;
+
+    Vector<SPtr<ThreadBuffer>> m_buffers;
+    mutable Mutex m_buffersMutex;
+
+    Thread m_writerThread;
+    ThreadId m_writerThreadId;
+    DataStreamPtr m_file;
+    Mutex m_writerMutex;
+    Signal m_writerSignal;
+    Signal m_flushSignal;
+    Signal m_spaceSignal;
+    uint64 m_flushRequested = 0;
+    uint64 m_flushCompleted = 0;
+    uint64 m_numDrains = 0;
+    bool m_spaceWanted = false;
+    bool m_stop = false;
+
+    std::atomic<uint64> m_numWritten{0};
+    std::atomic<uint64> m_numBatches{0};
+  };
+
+  /**
+   * @brief Logs a record on a channel of the Debug log through the
+   *        asynchronous log, if started and the channel is enabled. The format
+   *        string is registered once and the arguments are only converted to
+   *        text by the writer thread.
+   */
+#define GE_LOG_ASYNC(channel, format, ...)                                    \
+  do {                                                                        \
+    if (geEngineSDK::AsyncLog::isStarted() &&                                 \
+        geEngineSDK::g_Debug().isChannelEnabled(channel)) {                   \
+      static const geEngineSDK::uint32 geLogFormatId =                        \
+        geEngineSDK::AsyncLog::registerFormat(format);                        \
+      static const geEngineSDK::LogSourceLocation geLogLocation =             \
+        { __FILE__, __PRETTY_FUNCTION__, __LINE__ };                          \
+      geEngineSDK::AsyncLog::instance().log((channel), geLogFormatId,         \
+                                            &geLogLocation, ##__VA_ARGS__);   \
+    }                                                                         \
+  } while (false)
+}
@@ -0,0 +1,883 @@
+/*****************************************************************************/
+/**
+ * @file    geBakedOctree.h
+ * @author  Samuel Prince (samuel.prince.quezada@gmail.com)
+ * @date    2018/07/12
+ * @brief   Read-only, linearized copy of an Octree.
+ *
+ * Read-only copy of an Octree stored in a single contiguous block of memory.
+ * Nodes are laid out depth first with the children of each node stored
+ * next to each other in Morton order, referenced by index instead of by
+ * pointer, and the element bounds are stored as structures of arrays in
+ * groups of four, in the same order as the nodes. The block contains no
+ * pointers, so it can be written to disk as is and used straight from a
+ * memory mapped file.
+ *
+ * @bug     No known bugs.
+ */
+/*****************************************************************************/
+#pragma once
+
+/*****************************************************************************/
+/**
+ * Includes
+ */
+/*****************************************************************************/
+#include "gePrerequisitesUtil.h"
+#include "geOctree.h"
+#include "geDataStream.h"
+
+namespace geEngineSDK {
+  /**
+   * @brief Read-only version of an Octree meant for static geometry. Queries
+   *        walk a single block of memory instead of chasing node and element
+   *        group pointers across the heap.
+   * @tparam  ElemType  Type of the elements, must be trivially copyable since
+   *          they are stored in the block as raw bytes.
+   * @tparam  Options   Same options as the Octree it is baked from.
+   * @note    Thread safe for any number of concurrent readers.
+   */
+  template<class ElemType, class Options>
+  class BakedOctree
+  {
+    static_assert(std::is_trivially_copyable<ElemType>::value,
+                  "Baked octree elements must be trivially copyable.");
+
+    /**
+     * @brief Start of the data block.
+     */
+    struct Header
+    {
+      uint32 magic;
+      uint32 version;
+      uint32 elementSize;
+      uint32 numNodes;
+      uint32 numElements;
+      uint32 numQuads;
+      uint32 nodesOffset;
+      uint32 quadsOffset;
+      uint32 elementsOffset;
+      uint32 totalSize;
+      uint32 padding[2];
+    };
+
+    /**
+     * @brief A single node. The first four floats can be loaded as one SIMD
+     *        register.
+     */
+    struct Node
+    {
+      float centerX;
+      float centerY;
+      float centerZ;
+      float extent;
+
+      //Index of the first child, the rest follow in Morton order
+      uint32 firstChild;
+      uint32 numChildren;
+      uint32 firstQuad;
+      uint32 numElements;
+    };
+
+    /**
+     * @brief Bounds of four consecutive elements. Unused lanes repeat the
+     *        last element of the node.
+     */
+    struct BoundsQuad
+    {
+      float centerX[4];
+      float centerY[4];
+      float centerZ[4];
+      float extentX[4];
+      float extentY[4];
+      float extentZ[4];
+    };
+
+    static constexpr uint32 FILE_MAGIC = 0x4F424547; //"GEBO"
+    static constexpr uint32 FILE_VERSION = 1;
+
+    /**
+     * @brief Block owned by the baked octree. Plain allocations are only
+     *        8 byte aligned on some platforms, too little for the SIMD loads.
+     */
+    typedef UPtr<uint8, GenAlloc, decltype(&ge_free_aligned16)> AlignedBlock;
+
+   public:
+    typedef Octree<ElemType, Options> SourceOctree;
+    typedef typename SourceOctree::ConvexVolume ConvexVolume;
+
+    /**
+     * @brief Constructs an empty baked octree.
+     */
+    BakedOctree() = default;
+
+    /**
+     * @brief Bakes the current contents of @p octree.
+     */
+    explicit BakedOctree(const SourceOctree& octree) {
+      bake(octree);
+    }
+
+    /**
+     * @brief Replaces the contents with the current contents of @p octree.
+     */
+    void
+    bake(const SourceOctree& octree);
+
+    /**
+     * @brief Uses a block previously returned by getData() without copying
+     *        it, e.g. a memory mapped file. The block must stay alive while
+     *        this object uses it.
+     * @param[in] data  Block of memory, aligned to 16 bytes.
+     * @param[in] size  Size of the block in bytes.
+     * @return false if the block doesn't contain a valid baked octree of the
+     *         same element type, in which case the baked octree is empty.
+     */
+    bool
+    setData(const void* data, SIZE_T size) {
+      m_storage.reset();
+      m_external = nullptr;
+
+      if (0 != (reinterpret_cast<SIZE_T>(data) & 15) || !isValid(data, size)) {
+        return false;
+      }
+
+      m_external = reinterpret_cast<const uint8*>(data);
+      return true;
+    }
+
+    /**
+     * @brief Returns the block holding the baked octree, ready to be written
+     *        to disk as is. Null if empty.
+     */
+    const uint8*
+    getData() const {
+      return m_external ? m_external : m_storage.get();
+    }
+
+    /**
+     * @brief Returns the size in bytes of the block returned by getData().
+     */
+    SIZE_T
+    getDataSize() const {
+      return getData() ? getHeader().totalSize : 0;
+    }
+
+    /**
+     * @brief Writes the baked octree to a stream.
+     */
+    void
+    save(const SPtr<DataStream>& stream) const {
+      stream->write(getData(), getDataSize());
+    }
+
+    /**
+     * @brief Reads a baked octree written by save() into memory owned by
+     *        this object.
+     * @return false if the stream doesn't contain a valid baked octree of
+     *         the same element type, in which case the baked octree is empty.
+     */
+    bool
+    load(const SPtr<DataStream>& stream);
+
+    /**
+     * @brief Returns the number of nodes.
+     */
+    uint32
+    getNumNodes() const {
+      return getData() ? getHeader().numNodes : 0;
+    }
+
+    /**
+     * @brief Returns the number of elements.
+     */
+    uint32
+    getNumElements() const {
+      return getData() ? getHeader().numElements : 0;
+    }
+
+    /**
+     * @brief Calls @p func for each element whose bounds intersect
+     *        @p bounds. Reports the same elements as
+     *        Octree::BoxIntersectIterator.
+     */
+    template<class Func>
+    void
+    forEachIntersecting(const AABox& bounds, Func func) const;
+
+    /**
+     * @brief Finds the element whose bounds are entered first by the line
+     *        segment from @p start to @p end. Same as
+     *        Octree::findClosestHit().
+     */
+    bool
+    findClosestHit(const Vector3& start,
+                   const Vector3& end,
+                   ElemType& hitElem,
+                   float& hitTime) const;
+
+    /**
+     * @brief Calls @p func as func(element, time) for each element whose
+     *        bounds are intersected by the line segment from @p start to
+     *        @p end. Reports the same elements and times as
+     *        Octree::RayIntersectIterator.
+     */
+    template<class Func>
+    void
+    forEachHit(const Vector3& start, const Vector3& end, Func func) const;
+
+    /**
+     * @brief Finds all elements whose bounds intersect a convex volume. Same
+     *        as Octree::findInVolume().
+     */
+    SIZE_T
+    findInVolume(const ConvexVolume& volume,
+                 ElemType* output,
+                 SIZE_T capacity) const;
+
+    /**
+     * @brief Calls @p func for each element whose bounds intersect a convex
+     *        volume. Reports the same elements as findInVolume().
+     */
+    template<class Func>
+    void
+    forEachInVolume(const ConvexVolume& volume, Func func) const;
+
+   private:
+    /**
+     * @brief Maximum number of nodes waiting on a traversal stack.
+     */
+    static constexpr uint32 MAX_STACK_SIZE = (Options::maxDepth + 2) * 8;
+
+    const Header&
+    getHeader() const {
+      return *reinterpret_cast<const Header*>(getData());
+    }
+
+    const Node*
+    getNodes() const {
+      return reinterpret_cast<const Node*>(getData() + getHeader().nodesOffset);
+    }
+
+    const BoundsQuad*
+    getQuads() const {
+      return reinterpret_cast<const BoundsQuad*>(getData() + getHeader().quadsOffset);
+    }
+
+    const ElemType*
+    getElements() const {
+      return reinterpret_cast<const ElemType*>(getData() + getHeader().elementsOffset);
+    }
+
+    /**
+     * @brief Allocates an uninitialized block aligned to 16 bytes.
+     */
+    static AlignedBlock
+    allocateBlock(SIZE_T size) {
+      return AlignedBlock(reinterpret_cast<uint8*>(ge_alloc_aligned16(size)),
+                          &ge_free_aligned16);
+    }
+
+    /**
+     * @brief Checks that a block contains a baked octree this class can
+     *        traverse without reading outside of it. Every node is checked,
+     *        so this takes time proportional to the number of nodes.
+     */
+    static bool
+    isValid(const void* data, SIZE_T size);
+
+    /**
+     * @brief Walks the nodes intersected by a line segment, closest first.
+     *        @p onHit is called as onHit(element, time) for each element
+     *        entered at or before the current maximum time, and returns the
+     *        new maximum time.
+     */
+    template<class Func>
+    void
+    traceSegment(const Vector3& start, const Vector3& end, Func onHit) const;
+
+    /**
+     * @brief Loads the bounds of up to four consecutive nodes, one node per
+     *        lane. Missing lanes repeat the last node.
+     */
+    static void
+    loadNodeBounds(const Node* nodes,
+                   uint32 count,
+                   simd::float32x4& centerX,
+                   simd::float32x4& centerY,
+                   simd::float32x4& centerZ,
+                   simd::float32x4& extent) {
+      using simd::float32x4;
+
+      const uint32 last = count - 1;
+      centerX = simd::load<float32x4>(&nodes[0].centerX);
+      centerY = simd::load<float32x4>(&nodes[Math::min(1U, last)].centerX);
+      centerZ = simd::load<float32x4>(&nodes[Math::min(2U, last)].centerX);
+      extent = simd::load<float32x4>(&nodes[last].centerX);
+      simd::transpose4(centerX, centerY, centerZ, extent);
+    }
+
+    /**
+     * @brief Tests four boxes against a query box.
+     * @param[out] overlaps Receives non-zero for each box that overlaps the
+     *             query box.
+     */
+    static void
+    overlapBoxes(const simd::float32x4& centerX,
+                 const simd::float32x4& centerY,
+                 const simd::float32x4& centerZ,
+                 const simd::float32x4& extentX,
+                 const simd::float32x4& extentY,
+                 const simd::float32x4& extentZ,
+                 const simd::AABox& query,
+                 uint32 overlaps[4]) {
+      using simd::float32x4;
+      using simd::uint32x4;
+
+      float32x4 diffX = simd::abs(centerX - simd::splat<float32x4>(query.m_center.x));
+      float32x4 diffY = simd::abs(centerY - simd::splat<float32x4>(query.m_center.y));
+      float32x4 diffZ = simd::abs(centerZ - simd::splat<float32x4>(query.m_center.z));
+
+      uint32x4 outside = simd::bit_cast<uint32x4>(
+        simd::cmp_gt(diffX, extentX + simd::splat<float32x4>(query.m_extents.x)));
+      outside = simd::bit_or(outside, simd::bit_cast<uint32x4>(
+        simd::cmp_gt(diffY, extentY + simd::splat<float32x4>(query.m_extents.y))));
+      outside = simd::bit_or(outside, simd::bit_cast<uint32x4>(
+        simd::cmp_gt(diffZ, extentZ + simd::splat<float32x4>(query.m_extents.z))));
+
+      SIMDPP_ALIGN(16) uint32 outsideLanes[4];
+      simd::store(outsideLanes, outside);
+      for (uint32 i = 0; i < 4; ++i) {
+        overlaps[i] = ~outsideLanes[i];
+      }
+    }
+
+    AlignedBlock m_storage{nullptr, &ge_free_aligned16};
+    const uint8* m_external = nullptr;
+  };
+
+  template<class ElemType, class Options>
+  void
+  BakedOctree<ElemType, Options>::bake(const SourceOctree& octree) {
+    typedef typename SourceOctree::HNode SourceNode;
+    typedef typename SourceOctree::HChildNode HChildNode;
+
+    m_external = nullptr;
+
+    Vector<Node> nodes;
+    Vector<BoundsQuad> quads;
+    Vector<ElemType> elements;
+    uint32 numElements = 0;
+
+    //Lays out the children of a node next to each other, then recurses into
+    //each of them, so every subtree ends up in a contiguous range
+    std::function<void(const SourceNode&, uint32)> addNode;
+    addNode = [&](const SourceNode& source, uint32 nodeIdx) {
+      const simd::AABox& bounds = source.getBounds().getBounds();
+
+      Node node;
+      node.centerX = bounds.m_center.x;
+      node.centerY = bounds.m_center.y;
+      node.centerZ = bounds.m_center.z;
+      node.extent = bounds.m_extents.x;
+      node.firstQuad = static_cast<uint32>(quads.size());
+      node.numElements = 0;
+      node.numChildren = 0;
+
+      typename SourceOctree::ElementIterator elemIter(source.getNode());
+      while (elemIter.moveNext()) {
+        const uint32 lane = node.numElements & 3;
+        if (0 == lane) {
+          quads.emplace_back();
+        }
+
+        const simd::AABox& elemBounds = elemIter.getCurrentBounds();
+        BoundsQuad& quad = quads.back();
+        for (uint32 i = lane; i < 4; ++i) {
+          quad.centerX[i] = elemBounds.m_center.x;
+          quad.centerY[i] = elemBounds.m_center.y;
+          quad.centerZ[i] = elemBounds.m_center.z;
+          quad.extentX[i] = elemBounds.m_extents.x;
+          quad.extentY[i] = elemBounds.m_extents.y;
+          quad.extentZ[i] = elemBounds.m_extents.z;
+        }
+
+        elements.push_back(elemIter.getCurrentElem());
+        ++node.numElements;
+      }
+
+      //Padding keeps elements and bound quads in step
+      while (elements.size() < quads.size() * 4) {
+        elements.push_back(elements.back());
+      }
+
+      for (uint32 i = 0; i < 8; ++i) {
+        if (source.getNode()->hasChild(HChildNode(i))) {
+          ++node.numChildren;
+        }
+      }
+
+      node.firstChild = static_cast<uint32>(nodes.size());
+      nodes.resize(nodes.size() + node.numChildren);
+      nodes[nodeIdx] = node;
+      numElements += node.numElements;
+
+      uint32 childIdx = node.firstChild;
+      for (uint32 i = 0; i < 8; ++i) {
+        HChildNode child(i);
+        if (source.getNode()->hasChild(child)) {
+          addNode(SourceNode(source.getNode()->getChild(child),
+                             source.getBounds().getChild(child)),
+                  childIdx++);
+        }
+      }
+    };
+
+    typename SourceOctree::NodeIterator rootIter(octree);
+    rootIter.moveNext();
+
+    nodes.emplace_back();
+    addNode(rootIter.getCurrent(), 0);
+
+    auto alignOffset = [](SIZE_T offset) {
+      return static_cast<uint32>((offset + 15) & ~static_cast<SIZE_T>(15));
+    };
+
+    Header header;
+    memset(&header, 0, sizeof(header));
+    header.magic = FILE_MAGIC;
+    header.version = FILE_VERSION;
+    header.elementSize = sizeof(ElemType);
+    header.numNodes = static_cast<uint32>(nodes.size());
+    header.numElements = numElements;
+    header.numQuads = static_cast<uint32>(quads.size());
+    header.nodesOffset = alignOffset(sizeof(Header));
+    header.quadsOffset = alignOffset(header.nodesOffset + nodes.size() * sizeof(Node));
+    header.elementsOffset = alignOffset(header.quadsOffset +
+                                        quads.size() * sizeof(BoundsQuad));
+    header.totalSize = alignOffset(header.elementsOffset +
+                                   elements.size() * sizeof(ElemType));
+
+    m_storage = allocateBlock(header.totalSize);
+    uint8* block = m_storage.get();
+    memset(block, 0, header.totalSize);
+
+    memcpy(block, &header, sizeof(header));
+    memcpy(block + header.nodesOffset, nodes.data(), nodes.size() * sizeof(Node));
+    if (!quads.empty()) {
+      memcpy(block + header.quadsOffset,
+             quads.data(),
+             quads.size() * sizeof(BoundsQuad));
+      memcpy(block + header.elementsOffset,
+             elements.data(),
+             elements.size() * sizeof(ElemType));
+    }
+  }
+
+  template<class ElemType, class Options>
+  bool
+  BakedOctree<ElemType, Options>::load(const SPtr<DataStream>& stream) {
+    m_storage.reset();
+    m_external = nullptr;
+
+    Header header;
+    if (stream->read(&header, sizeof(header)) != sizeof(header) ||
+        header.totalSize < sizeof(header)) {
+      return false;
+    }
+
+    AlignedBlock storage = allocateBlock(header.totalSize);
+    memcpy(storage.get(), &header, sizeof(header));
+
+    const SIZE_T remaining = header.totalSize - sizeof(header);
+    if (stream->read(storage.get() + sizeof(header), remaining) != remaining ||
+        !isValid(storage.get(), header.totalSize)) {
+      return false;
+    }
+
+    m_storage = std::move(storage);
+    return true;
+  }
+
+  template<class ElemType, class Options>
+  bool
+  BakedOctree<ElemType, Options>::isValid(const void* data, SIZE_T size) {
+    if (nullptr == data || size < sizeof(Header)) {
+      return false;
+    }
+
+    const Header& header = *reinterpret_cast<const Header*>(data);
+    if (header.magic != FILE_MAGIC ||
+        header.version != FILE_VERSION ||
+        header.elementSize != sizeof(ElemType) ||
+        header.totalSize > size ||
+        0 == header.numNodes ||
+        0 != ((header.nodesOffset | header.quadsOffset | header.elementsOffset) & 15)) {
+      return false;
+    }
+
+    //Every section must fit in the block
+    const uint64 nodesEnd = header.nodesOffset +
+                            static_cast<uint64>(header.numNodes) * sizeof(Node);
+    const uint64 quadsEnd = header.quadsOffset +
+                            static_cast<uint64>(header.numQuads) * sizeof(BoundsQuad);
+    const uint64 elementsEnd = header.elementsOffset +
+                               static_cast<uint64>(header.numQuads) * 4 * sizeof(ElemType);
+
+    if (nodesEnd > header.totalSize ||
+        quadsEnd > header.totalSize ||
+        elementsEnd > header.totalSize) {
+      return false;
+    }
+
+    //Nodes must form a tree no deeper than the traversal stacks allow, with
+    //every child placed after its parent and referenced only once
+    const Node* nodes = reinterpret_cast<const Node*>(
+                          reinterpret_cast<const uint8*>(data) + header.nodesOffset);
+    Vector<uint32> depths(header.numNodes, 0);
+    depths[0] = 1;
+
+    uint64 numElements = 0;
+    for (uint32 i = 0; i < header.numNodes; ++i) {
+      const Node& node = nodes[i];
+      if (0 == depths[i] ||
+          node.numChildren > 8 ||
+          static_cast<uint64>(node.firstChild) + node.numChildren > header.numNodes ||
+          static_cast<uint64>(node.firstQuad) + (node.numElements + 3ULL) / 4 >
+            header.numQuads) {
+        return false;
+      }
+
+      if (node.numChildren > 0 &&
+          (node.firstChild <= i || depths[i] > Options::maxDepth)) {
+        return false;
+      }
+
+      for (uint32 j = 0; j < node.numChildren; ++j) {
+        uint32& childDepth = depths[node.firstChild + j];
+        if (0 != childDepth) {
+          return false;
+        }
+        childDepth = depths[i] + 1;
+      }
+
+      numElements += node.numElements;
+    }
+
+    return numElements == header.numElements;
+  }
+
+  template<class ElemType, class Options>
+  template<class Func>
+  void
+  BakedOctree<ElemType, Options>::forEachIntersecting(const AABox& bounds,
+                                                      Func func) const {
+    using simd::float32x4;
+
+    if (!getData()) {
+      return;
+    }
+
+    const Node* nodes = getNodes();
+    const BoundsQuad* quads = getQuads();
+    const ElemType* elements = getElements();
+
+    const simd::AABox query(bounds);
+
+    uint32 nodeStack[MAX_STACK_SIZE];
+    uint32 stackSize = 0;
+
+    //Elements in the root may lie outside of its bounds, always visit it
+    nodeStack[stackSize++] = 0;
+    while (stackSize > 0) {
+      const Node& node = nodes[nodeStack[--stackSize]];
+
+      for (uint32 i = 0; i < node.numElements; i += 4) {
+        const BoundsQuad& quad = quads[node.firstQuad + i / 4];
+
+        uint32 overlaps[4];
+        overlapBoxes(simd::load<float32x4>(quad.centerX),
+                     simd::load<float32x4>(quad.centerY),
+                     simd::load<float32x4>(quad.centerZ),
+                     simd::load<float32x4>(quad.extentX),
+                     simd::load<float32x4>(quad.extentY),
+                     simd::load<float32x4>(quad.extentZ),
+                     query,
+                     overlaps);
+
+        const uint32 laneCount = Math::min(node.numElements - i, 4U);
+        for (uint32 lane = 0; lane < laneCount; ++lane) {
+          if (0 != overlaps[lane]) {
+            func(elements[node.firstQuad * 4 + i + lane]);
+          }
+        }
+      }
+
+      for (uint32 i = 0; i < node.numChildren; i += 4) {
+        const uint32 laneCount = Math::min(node.numChildren - i, 4U);
+
+        float32x4 childX, childY, childZ, childExtent;
+        loadNodeBounds(&nodes[node.firstChild + i], laneCount,
+                       childX, childY, childZ, childExtent);
+
+        uint32 overlaps[4];
+        overlapBoxes(childX, childY, childZ,
+                     childExtent, childExtent, childExtent,
+                     query,
+                     overlaps);
+
+        for (uint32 lane = 0; lane < laneCount; ++lane) {
+          if (0 != overlaps[lane]) {
+            nodeStack[stackSize++] = node.firstChild + i + lane;
+          }
+        }
+      }
+    }
+  }
+
+  template<class ElemType, class Options>
+  bool
+  BakedOctree<ElemType, Options>::findClosestHit(const Vector3& start,
+                                                 const Vector3& end,
+                                                 ElemType& hitElem,
+                                                 float& hitTime) const {
+    bool anyHit = false;
+    traceSegment(start, end, [&](const ElemType& elem, float time) {
+      hitElem = elem;
+      hitTime = time;
+      anyHit = true;
+      return time;
+    });
+
+    return anyHit;
+  }
+
+  template<class ElemType, class Options>
+  template<class Func>
+  void
+  BakedOctree<ElemType, Options>::forEachHit(const Vector3& start,
+                                             const Vector3& end,
+                                             Func func) const {
+    traceSegment(start, end, [&](const ElemType& elem, float time) {
+      func(elem, time);
+      return 1.0f;
+    });
+  }
+
+  template<class ElemType, class Options>
+  template<class Func>
+  void
+  BakedOctree<ElemType, Options>::traceSegment(const Vector3& start,
+                                               const Vector3& end,
+                                               Func onHit) const {
+    using simd::float32x4;
+
+    if (!getData()) {
+      return;
+    }
+
+    const Node* nodes = getNodes();
+    const BoundsQuad* quads = getQuads();
+    const ElemType* elements = getElements();
+
+    const typename SourceOctree::RaySegment segment(start, end);
+
+    struct StackEntry
+    {
+      uint32 node;
+      float entryTime;
+    };
+
+    StackEntry nodeStack[MAX_STACK_SIZE];
+    uint32 stackSize = 0;
+
+    //Elements in the root may lie outside of its bounds, always visit it
+    nodeStack[stackSize++] = { 0, 0.0f };
+
+    float maxTime = 1.0f;
+    while (stackSize > 0) {
+      const StackEntry entry = nodeStack[--stackSize];
+      if (entry.entryTime > maxTime) {
+        continue;
+      }
+
+      const Node& node = nodes[entry.node];
+      for (uint32 i = 0; i < node.numElements; i += 4) {
+        const BoundsQuad& quad = quads[node.firstQuad + i / 4];
+
+        float32x4 entryTimes;
+        simd::mask_float32x4 mask = segment.intersect(simd::load<float32x4>(quad.centerX),
+                                                      simd::load<float32x4>(quad.centerY),
+                                                      simd::load<float32x4>(quad.centerZ),
+                                                      simd::load<float32x4>(quad.extentX),
+                                                      simd::load<float32x4>(quad.extentY),
+                                                      simd::load<float32x4>(quad.extentZ),
+                                                      maxTime,
+                                                      entryTimes);
+
+        if (!simd::test_bits_any(simd::bit_cast<simd::uint32x4>(mask))) {
+          continue;
+        }
+
+        SIMDPP_ALIGN(16) uint32 hits[4];
+        SIMDPP_ALIGN(16) float times[4];
+        simd::store(hits, simd::bit_cast<simd::uint32x4>(mask));
+        simd::store(times, entryTimes);
+
+        const uint32 laneCount = Math::min(node.numElements - i, 4U);
+        for (uint32 lane = 0; lane < laneCount; ++lane) {
+          if (0 != hits[lane] && times[lane] <= maxTime) {
+            maxTime = onHit(elements[node.firstQuad * 4 + i + lane], times[lane]);
+          }
+        }
+      }
+
+      //Push the children back to front, so the closest one is visited next
+      StackEntry children[8];
+      uint32 numHitChildren = 0;
+      for (uint32 i = 0; i < node.numChildren; i += 4) {
+        const uint32 laneCount = Math::min(node.numChildren - i, 4U);
+
+        float32x4 childX, childY, childZ, childExtent;
+        loadNodeBounds(&nodes[node.firstChild + i], laneCount,
+                       childX, childY, childZ, childExtent);
+
+        float32x4 entryTimes;
+        simd::mask_float32x4 mask = segment.intersect(childX, childY, childZ,
+                                                      childExtent, childExtent, childExtent,
+                                                      maxTime,
+                                                      entryTimes);
+
+        SIMDPP_ALIGN(16) uint32 hits[4];
+        SIMDPP_ALIGN(16) float times[4];
+        simd::store(hits, simd::bit_cast<simd::uint32x4>(mask));
+        simd::store(times, entryTimes);
+
+        for (uint32 lane = 0; lane < laneCount; ++lane) {
+          if (0 == hits[lane]) {
+            continue;
+          }
+
+          //Insertion sort, farthest first
+          StackEntry child = { node.firstChild + i + lane, times[lane] };
+          uint32 pos = numHitChildren++;
+          while (pos > 0 && children[pos - 1].entryTime < child.entryTime) {
+            children[pos] = children[pos - 1];
+            --pos;
+          }
+          children[pos] = child;
+        }
+      }
+
+      for (uint32 i = 0; i < numHitChildren; ++i) {
+        nodeStack[stackSize++] = children[i];
+      }
+    }
+  }
+
+  template<class ElemType, class Options>
+  SIZE_T
+  BakedOctree<ElemType, Options>::findInVolume(const ConvexVolume& volume,
+                                               ElemType* output,
+                                               SIZE_T capacity) const {
+    SIZE_T count = 0;
+    forEachInVolume(volume, [&](const ElemType& elem) {
+      if (count < capacity) {
+        output[count] = elem;
+      }
+      ++count;
+    });
+
+    return count;
+  }
+
+  template<class ElemType, class Options>
+  template<class Func>
+  void
+  BakedOctree<ElemType, Options>::forEachInVolume(const ConvexVolume& volume,
+                                                  Func func) const {
+    using simd::float32x4;
+
+    if (!getData()) {
+      return;
+    }
+
+    const Node* nodes = getNodes();
+    const BoundsQuad* quads = getQuads();
+    const ElemType* elements = getElements();
+
+    struct StackEntry
+    {
+      uint32 node;
+      uint32 planeMask;
+    };
+
+    StackEntry nodeStack[MAX_STACK_SIZE];
+    uint32 stackSize = 0;
+
+    //Elements in the root may lie outside of its bounds, always test them
+    nodeStack[stackSize++] = { 0, volume.getPlaneMask() };
+
+    while (stackSize > 0) {
+      const StackEntry entry = nodeStack[--stackSize];
+      const Node& node = nodes[entry.node];
+      if (0 == entry.planeMask) {
+        //Fully inside, output everything below this node
+        for (uint32 i = 0; i < node.numElements; ++i) {
+          func(elements[node.firstQuad * 4 + i]);
+        }
+
+        for (uint32 i = 0; i < node.numChildren; ++i) {
+          nodeStack[stackSize++] = { node.firstChild + i, 0 };
+        }
+
+        continue;
+      }
+
+      for (uint32 i = 0; i < node.numElements; i += 4) {
+        const BoundsQuad& quad = quads[node.firstQuad + i / 4];
+
+        simd::uint32x4 intersects;
+        SIMDPP_ALIGN(16) uint32 outside[4];
+        simd::store(outside, volume.classify(simd::load<float32x4>(quad.centerX),
+                                             simd::load<float32x4>(quad.centerY),
+                                             simd::load<float32x4>(quad.centerZ),
+                                             simd::load<float32x4>(quad.extentX),
+                                             simd::load<float32x4>(quad.extentY),
+                                             simd::load<float32x4>(quad.extentZ),
+                                             entry.planeMask,
+                                             intersects));
+
+        const uint32 laneCount = Math::min(node.numElements - i, 4U);
+        for (uint32 lane = 0; lane < laneCount; ++lane) {
+          if (0 == outside[lane]) {
+            func(elements[node.firstQuad * 4 + i + lane]);
+          }
+        }
+      }
+
+      for (uint32 i = 0; i < node.numChildren; i += 4) {
+        const uint32 laneCount = Math::min(node.numChildren - i, 4U);
+
+        float32x4 childX, childY, childZ, childExtent;
+        loadNodeBounds(&nodes[node.firstChild + i], laneCount,
+                       childX, childY, childZ, childExtent);
+
+        simd::uint32x4 intersects;
+        SIMDPP_ALIGN(16) uint32 outside[4];
+        SIMDPP_ALIGN(16) uint32 planeMasks[4];
+        simd::store(outside, volume.classify(childX, childY, childZ,
+                                             childExtent, childExtent, childExtent,
+                                             entry.planeMask,
+                                             intersects));
+        simd::store(planeMasks, intersects);
+
+        for (uint32 lane = 0; lane < laneCount; ++lane) {
+          if (0 == outside[lane]) {
+            nodeStack[stackSize++] = { node.firstChild + i + lane, planeMasks[lane] };
+          }
+        }
+      }
+    }
+  }
+}
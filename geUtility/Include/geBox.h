@@ -24,6 +24,8 @@
 #include "geTransform.h"
 
 namespace geEngineSDK {
+  class Vector3Stream;
+
   /**
    * @brief Implements an axis-aligned box.
    * Boxes describe an axis-aligned extent in three dimensions. They are used
@@ -71,6 +73,12 @@ namespace geEngineSDK {
      */
     GE_UTILITY_EXPORT AABox(const Vector<Vector3>& Points);
 
+    /**
+     * @brief Creates and initializes a new box from a stream of points.
+     * @param Points Stream of Points to create for the bounding volume.
+     */
+    GE_UTILITY_EXPORT explicit AABox(const Vector3Stream& Points);
+
    public:
     /**
      * @brief Compares two boxes for equality.
@@ -22,6 +22,7 @@
 #include "geVector3.h"
 #include "geSphere.h"
 #include "geBox.h"
+#include "geVector3Stream.h"
 #include "geDebug.h"
 
 namespace geEngineSDK {
@@ -303,22 +304,15 @@ namespace geEngineSDK {
   /***************************************************************************/
 
   FORCEINLINE BoxSphereBounds::BoxSphereBounds(const Vector3* Points, SIZE_T NumPoints) {
-    AABox BoundingBox(FORCE_INIT::kForceInit);
-
     //Find an axis aligned bounding box for the points.
-    for (SIZE_T PointIndex = 0; PointIndex < NumPoints; ++PointIndex) {
-      BoundingBox += Points[PointIndex];
-    }
-
+    AABox BoundingBox = Vector3Stream::getBounds(Points, NumPoints);
     BoundingBox.getCenterAndExtents(m_origin, m_boxExtent);
 
     //Using the center of the bounding box as the origin of the sphere, find
     //the radius of the bounding sphere.
-    m_sphereRadius = 0.0f;
-
-    for (SIZE_T PointIndex = 0; PointIndex < NumPoints; ++PointIndex) {
-      m_sphereRadius = Math::max(m_sphereRadius, (Points[PointIndex] - m_origin).size());
-    }
+    m_sphereRadius = Math::sqrt(Vector3Stream::getMaxDistSquared(Points,
+                                                                 NumPoints,
+                                                                 m_origin));
 
     diagnosticCheckNaN();
   }
@@ -34,6 +34,53 @@ namespace geEngineSDK {
     LinearColor
     evaluate(float t) const;
 
+    /**
+     * @brief Evaluates the gradient at multiple times. Evaluates four times
+     *        per iteration on SIMD registers.
+     * @param t       Array of times to evaluate.
+     * @param output  Array that receives one color per time.
+     * @param count   Number of times to evaluate.
+     */
+    void
+    evaluate(const float* t, LinearColor* output, SIZE_T count) const;
+
+    /**
+     * @brief Evaluates the gradient starting the key search at @p cursor,
+     *        and stores the key segment found back in @p cursor. Use this
+     *        when evaluating at increasing times (e.g. through the lifetime
+     *        of a particle), as the search then stops at the first key in
+     *        most cases. Decreasing times are supported but slower.
+     * @param t       Time to evaluate.
+     * @param cursor  Search start. Must be initialized to 0 and not shared
+     *                between gradients.
+     */
+    LinearColor
+    evaluate(float t, uint32& cursor) const;
+
+    /**
+     * @brief Bakes the gradient into a lookup table so it can be evaluated
+     *        in constant time with evaluateBaked(). The table is rebuilt
+     *        automatically when the keys change.
+     * @param resolution  Number of table segments. 0 releases the table.
+     */
+    void
+    bake(uint32 resolution);
+
+    /**
+     * @brief Evaluates the gradient using the baked lookup table. Falls back
+     *        to evaluate() if the gradient wasn't baked.
+     */
+    LinearColor
+    evaluateBaked(float t) const;
+
+    /**
+     * @brief Evaluates the gradient at multiple times using the baked
+     *        lookup table. Falls back to evaluate() if the gradient wasn't
+     *        baked.
+     */
+    void
+    evaluateBaked(const float* t, LinearColor* output, SIZE_T count) const;
+
     //TODO - Must be sorted, time must be normalized
     void
     setKeys(const Vector<ColorGradientKey>& keys, float duration = 1.0f);
@@ -42,9 +89,26 @@ namespace geEngineSDK {
     setConstant(const LinearColor& color);
 
    private:
+    /**
+     * @brief Updates the per segment data and the baked table after the keys
+     *        change.
+     */
+    void
+    update();
+
     LinearColor m_colors[MAX_KEYS];
     float m_times[MAX_KEYS];
     uint32 m_numKeys = 0;
     float m_duration = 0.0f;
+
+    /**
+     * Per segment data (indexed by the segment end key) used by the batch
+     * and incremental evaluation.
+     */
+    LinearColor m_deltas[MAX_KEYS];
+    float m_invLengths[MAX_KEYS];
+
+    Vector<LinearColor> m_baked;
+    float m_bakedScale = 0.0f;
   };
 }
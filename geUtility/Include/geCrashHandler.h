@@ -111,7 +111,8 @@ namespace geEngineSDK {
                           uint32 nLine) const;
 
     /**
-     * @brief Does what it says. Internal utility function used by reportCrash().
+     * @brief Saves the log and the last records of every thread kept by the
+     *        FlightRecorder. Internal utility function used by reportCrash().
      */
     void
     saveCrashLog() const;
@@ -140,6 +141,7 @@ namespace geEngineSDK {
 
     static const String s_crashReportFolder;
     static const String s_crashLogName;
+    static const String s_flightRecordName;
     static const String s_fatalErrorMsg;
 
 #if GE_PLATFORM == GE_PLATFORM_WIN32
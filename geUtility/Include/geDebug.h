@@ -20,6 +20,28 @@
 #include "gePrerequisitesUtil.h"
 #include "geLog.h"
 
+/**
+ * Log levels, usable in preprocessor conditions
+ */
+#define GE_LOG_LEVEL_VERBOSE  0
+#define GE_LOG_LEVEL_DEBUG    1
+#define GE_LOG_LEVEL_WARNING  2
+#define GE_LOG_LEVEL_ERROR    3
+#define GE_LOG_LEVEL_NONE     4
+
+/**
+ * Messages of a level below this one are compiled out. Define it in the
+ * project settings to override the default, e.g. to GE_LOG_LEVEL_WARNING in
+ * shipping builds.
+ */
+#ifndef GE_LOG_MIN_LEVEL
+# if GE_DEBUG_MODE
+#   define GE_LOG_MIN_LEVEL GE_LOG_LEVEL_VERBOSE
+# else
+#   define GE_LOG_MIN_LEVEL GE_LOG_LEVEL_DEBUG
+# endif
+#endif
+
 namespace geEngineSDK {
   class Log;
 
@@ -36,6 +58,19 @@ namespace geEngineSDK {
     };
   }
 
+  /**
+   * @brief Severity of the messages logged through the LOG macros. Messages
+   *        below the minimum level are skipped without evaluating them.
+   */
+  namespace LOG_LEVEL {
+    enum E {
+      kVerbose = GE_LOG_LEVEL_VERBOSE,
+      kDebug = GE_LOG_LEVEL_DEBUG,
+      kWarning = GE_LOG_LEVEL_WARNING,
+      kError = GE_LOG_LEVEL_ERROR
+    };
+  }
+
   /**
    * @brief Utility class providing various debug functionality.
    * @note  Thread safe.
@@ -66,9 +101,53 @@ namespace geEngineSDK {
     /**
      * @brief Adds a log entry in the specified channel.
               You may specify custom channels as needed.
+     * @param[in] location  Place the message is logged from, if known. Must
+     *            be a static constant.
      */
     void
-    logMessage(const String& msg, uint32 channel);
+    logMessage(const String& msg,
+               uint32 channel,
+               const LogSourceLocation* location = nullptr);
+
+    /**
+     * @brief Checks if messages of the level would be logged on the channel.
+     *        The LOG macros check this before evaluating their message.
+     * @note  Thread safe.
+     */
+    bool
+    isLogEnabled(LOG_LEVEL::E level, uint32 channel) const {
+      return level >= m_minLevel.load(std::memory_order_relaxed) &&
+             isChannelEnabled(channel);
+    }
+
+    /**
+     * @brief Checks if messages are logged on the channel.
+     * @note  Thread safe.
+     */
+    bool
+    isChannelEnabled(uint32 channel) const {
+      return channel >= 64 ||
+             0 != ((m_enabledChannels.load(std::memory_order_relaxed) >> channel) & 1);
+    }
+
+    /**
+     * @brief Sets the lowest level of the messages logged through the LOG
+     *        macros. Levels compiled out by GE_LOG_MIN_LEVEL stay disabled.
+     *        Verbose messages are disabled by default.
+     * @note  Thread safe.
+     */
+    void
+    setMinLogLevel(LOG_LEVEL::E level) {
+      m_minLevel.store(level, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Enables or disables logging on a channel. Channels 64 and above
+     *        are always enabled.
+     * @note  Thread safe.
+     */
+    void
+    setChannelEnabled(uint32 channel, bool enabled);
 
     /**
      * @brief Retrieves the Log used by the Debug instance.
@@ -97,6 +176,14 @@ namespace geEngineSDK {
     void
     saveLog(const Path& path) const;
 
+    /**
+     * @brief Saves the log entries in a compact binary form, as written by
+     *        LogArchive.
+     * @param path  Absolute path to the log filename.
+     */
+    void
+    saveLogBinary(const Path& path) const;
+
     /**
      * @brief Triggered when a new entry in the log is added.
      * @note  Sim thread only.
@@ -120,6 +207,8 @@ namespace geEngineSDK {
    private:
     uint64 m_logHash = 0;
     Log m_log;
+    std::atomic<int32> m_minLevel{LOG_LEVEL::kDebug};
+    std::atomic<uint64> m_enabledChannels{~0ULL};
   };
 
   /**
@@ -128,45 +217,68 @@ namespace geEngineSDK {
   GE_UTILITY_EXPORT Debug&
   g_Debug();
 
+  /**
+   * @brief Logs a message on a channel if its level is enabled. The message
+   *        is only evaluated when it is going to be logged.
+   */
+#define GE_LOG(level, channel, x)                                             \
+  do {                                                                        \
+    if (geEngineSDK::g_Debug().isLogEnabled((level), (channel))) {            \
+      static const geEngineSDK::LogSourceLocation geLogLocation =             \
+        { __FILE__, __PRETTY_FUNCTION__, __LINE__ };                          \
+      geEngineSDK::g_Debug().logMessage((x), (channel), &geLogLocation);      \
+    }                                                                         \
+  } while (false)
+
   /**
    * @brief Shortcut for logging a message in the debug channel.
    */
-#define LOGDBG(x) geEngineSDK::g_Debug().logDebug((x) +                       \
-                                                  String("\n\t\t in ") +      \
-                                                  __PRETTY_FUNCTION__ +       \
-                                                  " [" + __FILE__ + ":" +     \
-                                                  toString(__LINE__) +\
-                                                  "]\n");
+#if GE_LOG_MIN_LEVEL <= GE_LOG_LEVEL_DEBUG
+# define LOGDBG(x) GE_LOG(geEngineSDK::LOG_LEVEL::kDebug,                     \
+                          geEngineSDK::DEBUG_CHANNEL::kDebug, x)
+#else
+# define LOGDBG(x) ((void)0)
+#endif
 
   /**
    * @brief Shortcut for logging a message in the warning channel.
    */
-#define LOGWRN(x) geEngineSDK::g_Debug().logWarning((x) +                     \
-                                                  String("\n\t\t in ") +      \
-                                                  __PRETTY_FUNCTION__ +       \
-                                                  " [" + __FILE__ + ":" +     \
-                                                  toString(__LINE__) +\
-                                                  "]\n");
+#if GE_LOG_MIN_LEVEL <= GE_LOG_LEVEL_WARNING
+# define LOGWRN(x) GE_LOG(geEngineSDK::LOG_LEVEL::kWarning,                   \
+                          geEngineSDK::DEBUG_CHANNEL::kWarning, x)
+#else
+# define LOGWRN(x) ((void)0)
+#endif
 
   /**
    * @brief Shortcut for logging a message in the error channel.
    */
-#define LOGERR(x) geEngineSDK::g_Debug().logError((x) +                       \
-                                                  String("\n\t\t in ") +      \
-                                                  __PRETTY_FUNCTION__ +       \
-                                                  " [" + __FILE__ + ":" +     \
-                                                  toString(__LINE__) +\
-                                                  "]\n");
+#if GE_LOG_MIN_LEVEL <= GE_LOG_LEVEL_ERROR
+# define LOGERR(x) GE_LOG(geEngineSDK::LOG_LEVEL::kError,                     \
+                          geEngineSDK::DEBUG_CHANNEL::kError, x)
+#else
+# define LOGERR(x) ((void)0)
+#endif
 
   /**
    * @brief Shortcut for logging a verbose message in the debug channel.
    *        Verbose messages can be ignored unlike other log messages.
    */
-#define LOGDBG_VERBOSE(x) ((void)0)
+#if GE_LOG_MIN_LEVEL <= GE_LOG_LEVEL_VERBOSE
+# define LOGDBG_VERBOSE(x) GE_LOG(geEngineSDK::LOG_LEVEL::kVerbose,           \
+                                  geEngineSDK::DEBUG_CHANNEL::kDebug, x)
+#else
+# define LOGDBG_VERBOSE(x) ((void)0)
+#endif
 
   /**
    * @brief Shortcut for logging a verbose message in the warning channel.
    *        Verbose messages can be ignored unlike other log messages.
    */
-#define LOGWRN_VERBOSE(x) ((void)0)
+#if GE_LOG_MIN_LEVEL <= GE_LOG_LEVEL_VERBOSE
+# define LOGWRN_VERBOSE(x) GE_LOG(geEngineSDK::LOG_LEVEL::kVerbose,           \
+                                  geEngineSDK::DEBUG_CHANNEL::kWarning, x)
+#else
+# define LOGWRN_VERBOSE(x) ((void)0)
+#endif
 }
@@ -5,7 +5,9 @@
  * @date    2015/02/22
  * @brief   Templates and Classes for the creating on Event objects
  *
- * Thread safe Event object with callbacks for disconnection
+ * Thread safe Event object with callbacks for disconnection. Events are
+ * triggered without locking, changes to their connections are published as
+ * new connection arrays.
  *
  * @bug     No known bugs.
  */
@@ -32,68 +34,155 @@ namespace geEngineSDK {
     BaseConnectionData() = default;
 
     virtual ~BaseConnectionData() {
-      GE_ASSERT(!m_handleLinks && !m_isActive);
-    }
-
-    virtual void
-    deactivate() {
-      m_isActive = false;
+      GE_ASSERT(0 == m_handleLinks && !m_isActive);
     }
 
    public:
-    BaseConnectionData* m_prev = nullptr;
+    /**
+     * @brief Next connection in the retired or free connection lists.
+     */
     BaseConnectionData* m_next = nullptr;
-    bool m_isActive = true;
-    uint32 m_handleLinks = 0;
+    std::atomic<bool> m_isActive{true};
+    std::atomic<uint32> m_handleLinks{0};
+  };
+
+  /**
+   * @brief Immutable array of the connections of an event. Every change to
+   *        the connections publishes a new array, so the event can be
+   *        triggered while the connections are being changed.
+   */
+  struct EventConnectionList
+  {
+    BaseConnectionData**
+    data() {
+      return reinterpret_cast<BaseConnectionData**>(this + 1);
+    }
+
+    uint32 m_size = 0;
+    uint32 m_capacity = 0;
+
+    /**
+     * @brief Next array in the retired or free array lists.
+     */
+    EventConnectionList* m_next = nullptr;
   };
 
   /**
    * @brief Internal data for an Event, storing all connections.
+   * @note  Triggering the event takes no lock. It only counts the calls in
+   *        progress, under the parity of the epoch they started in. The
+   *        connection arrays and connections removed are kept until the
+   *        epoch moved on twice, each time once the calls counted under the
+   *        parity it moves to are done. Only the calls in progress when they
+   *        were removed can delay them, however busy the event is. They are
+   *        then pooled for the following connections.
    */
   struct EventInternalData
   {
+    /**
+     * @brief Connection arrays kept for reuse. More are freed.
+     */
+    static constexpr uint32 MAX_FREE_LISTS = 4;
+
+    /**
+     * @brief Calls in progress of each epoch parity, in the low and high
+     *        halves of the count of calls in progress.
+     */
+    static constexpr uint32 INVOKING_MASK = 0x7FFFFFFF;
+
+    /**
+     * @brief Set in the count of calls in progress once the event is
+     *        destroyed.
+     */
+    static constexpr uint64 DESTROYED_FLAG = 0x8000000000000000ULL;
+
+    /**
+     * @brief Marks a trigger of the event in progress while it exists.
+     */
+    class InvokeScope
+    {
+     public:
+      explicit InvokeScope(EventInternalData& data)
+        : m_data(data),
+          m_epoch(data.m_epoch.load()) {
+        m_data.m_numInvoking.fetch_add(getInvokingUnit(m_epoch));
+      }
+
+      ~InvokeScope() {
+        m_data.endInvoke(m_epoch);
+      }
+
+      InvokeScope(const InvokeScope&) = delete;
+      InvokeScope&
+      operator=(const InvokeScope&) = delete;
+
+      /**
+       * @brief Returns the connections to call. They can't be released until
+       *        the scope ends.
+       */
+      EventConnectionList*
+      getConnections() const {
+        return m_data.m_connections.load();
+      }
+
+     private:
+      EventInternalData& m_data;
+      uint32 m_epoch;
+    };
+
     EventInternalData() = default;
 
     ~EventInternalData() {
-      BaseConnectionData* conn = m_connections;
-      while (nullptr != conn) {
-        BaseConnectionData* next = conn->m_next;
-        ge_free(conn);
-        conn = next;
+      //Nothing can be triggering anymore, release everything
+      EventConnectionList* connections = m_connections.load();
+      if (nullptr != connections) {
+        for (uint32 i = 0; i < connections->m_size; ++i) {
+          BaseConnectionData* conn = connections->data()[i];
+          conn->m_isActive = false;
+          conn->m_handleLinks = 0;
+          conn->~BaseConnectionData();
+          ge_free(conn);
+        }
+        ge_free(connections);
       }
 
-      conn = m_freeConnections;
-      while (nullptr != conn) {
-        BaseConnectionData* next = conn->m_next;
-        ge_free(conn);
-        conn = next;
+      for (uint32 i = 0; i < 2; ++i) {
+        freeConnections(m_retiredConnections[i], true);
+        freeLists(m_retiredLists[i]);
       }
+      freeConnections(m_freeConnections, false);
+      freeLists(m_freeLists);
+    }
 
-      conn = m_newConnections;
-      while (nullptr != conn) {
-        BaseConnectionData* next = conn->m_next;
-        ge_free(conn);
-        conn = next;
+    /**
+     * @brief Called when the event is destroyed. If it's being triggered, the
+     *        data is kept alive until the last call ends.
+     */
+    void
+    releaseEvent(SPtr<EventInternalData> self) {
+      m_owner = std::move(self);
+      if (0 == m_numInvoking.fetch_or(DESTROYED_FLAG)) {
+        SPtr<EventInternalData> owner = std::move(m_owner);
       }
     }
 
     /**
-     * @brief Appends a new connection to the active connection array.
+     * @brief Appends a new connection to the active connections.
+     * @note  The mutex must be locked.
      */
     void
     connect(BaseConnectionData* conn) {
-      conn->m_prev = m_lastConnection;
+      EventConnectionList* connections = m_connections.load();
+      uint32 size = nullptr != connections ? connections->m_size : 0;
 
-      if (nullptr != m_lastConnection) {
-        m_lastConnection->m_next = conn;
+      EventConnectionList* newConnections = allocList(size + 1);
+      if (0 != size) {
+        memcpy(newConnections->data(), connections->data(), size * sizeof(conn));
       }
+      newConnections->data()[size] = conn;
+      newConnections->m_size = size + 1;
 
-      m_lastConnection = conn;
-
-      //First connection
-      if (nullptr == m_connections) {
-        m_connections = conn;
-      }
+      publish(newConnections);
     }
 
     /**
@@ -105,12 +194,16 @@ namespace geEngineSDK {
     disconnect(BaseConnectionData* conn) {
       RecursiveLock lock(m_mutex);
 
-      conn->deactivate();
-      --conn->m_handleLinks;
+      if (conn->m_isActive) {
+        conn->m_isActive = false;
+        remove(conn);
+      }
 
-      if (0 == conn->m_handleLinks) {
-        free(conn);
+      if (1 == conn->m_handleLinks.fetch_sub(1)) {
+        retire(conn);
       }
+
+      reclaim();
     }
 
     /**
@@ -120,20 +213,22 @@ namespace geEngineSDK {
     clear() {
       RecursiveLock lock(m_mutex);
 
-      BaseConnectionData* conn = m_connections;
-      while (nullptr  != conn) {
-        BaseConnectionData* next = conn->m_next;
-        conn->deactivate();
+      EventConnectionList* connections = m_connections.load();
+      if (nullptr == connections) {
+        return;
+      }
+
+      for (uint32 i = 0; i < connections->m_size; ++i) {
+        BaseConnectionData* conn = connections->data()[i];
+        conn->m_isActive = false;
 
         if (0 == conn->m_handleLinks) {
-          free(conn);
+          retire(conn);
         }
-
-        conn = next;
       }
 
-      m_connections = nullptr;
-      m_lastConnection = nullptr;
+      publish(nullptr);
+      reclaim();
     }
 
     /**
@@ -145,51 +240,260 @@ namespace geEngineSDK {
     freeHandle(BaseConnectionData* conn) {
       RecursiveLock lock(m_mutex);
 
-      --conn->m_handleLinks;
-      if (0 == conn->m_handleLinks&& !conn->m_isActive) {
-        free(conn);
+      if (1 == conn->m_handleLinks.fetch_sub(1) && !conn->m_isActive) {
+        retire(conn);
       }
+
+      reclaim();
     }
 
     /**
-     * @brief Releases connection data and makes it available for re-use when
-     *        next connection is formed.
+     * @brief Removes a connection from the active connections.
+     * @note  The mutex must be locked.
      */
     void
-    free(BaseConnectionData* conn) {
-      if (nullptr != conn->m_prev) {
-        conn->m_prev->m_next = conn->m_next;
+    remove(BaseConnectionData* conn) {
+      EventConnectionList* connections = m_connections.load();
+      if (nullptr == connections) {
+        return;
       }
-      else {
-        m_connections = conn->m_next;
+
+      EventConnectionList* newConnections = nullptr;
+      if (1 < connections->m_size) {
+        newConnections = allocList(connections->m_size - 1);
+        for (uint32 i = 0; i < connections->m_size; ++i) {
+          if (conn != connections->data()[i]) {
+            newConnections->data()[newConnections->m_size++] = connections->data()[i];
+          }
+        }
+      }
+
+      publish(newConnections);
+    }
+
+    /**
+     * @brief Returns a free connection array with room for @p size
+     *        connections.
+     * @note  The mutex must be locked.
+     */
+    EventConnectionList*
+    allocList(uint32 size) {
+      EventConnectionList** prev = &m_freeLists;
+      for (EventConnectionList* list = m_freeLists; nullptr != list; list = list->m_next) {
+        if (list->m_capacity >= size) {
+          *prev = list->m_next;
+          --m_numFreeLists;
+          list->m_size = 0;
+          list->m_next = nullptr;
+          return list;
+        }
+        prev = &list->m_next;
       }
 
-      if (nullptr != conn->m_next) {
-        conn->m_next->m_prev = conn->m_prev;
+      //Grow by powers of two so the free arrays fit most changes
+      uint32 capacity = 4;
+      while (capacity < size) {
+        capacity *= 2;
       }
-      else {
-        m_lastConnection = conn->m_prev;
+
+      void* memory = ge_alloc(sizeof(EventConnectionList) +
+                              capacity * sizeof(BaseConnectionData*));
+      EventConnectionList* list = new (memory) EventConnectionList();
+      list->m_capacity = capacity;
+      return list;
+    }
+
+    /**
+     * @brief Replaces the active connections. The previous array is kept
+     *        until the calls that might be using it are done.
+     * @note  The mutex must be locked.
+     */
+    void
+    publish(EventConnectionList* connections) {
+      EventConnectionList* oldConnections = m_connections.exchange(connections);
+      if (nullptr != oldConnections) {
+        oldConnections->m_next = m_retiredLists[0];
+        m_retiredLists[0] = oldConnections;
+        ++m_numRetired[0];
+        m_hasRetired = true;
       }
+    }
 
-      conn->m_prev = nullptr;
-      conn->m_next = nullptr;
+    /**
+     * @brief Queues a connection no longer used by the event or its handles,
+     *        to be reused once the calls that might be using it are done.
+     * @note  The mutex must be locked.
+     */
+    void
+    retire(BaseConnectionData* conn) {
+      conn->m_next = m_retiredConnections[0];
+      m_retiredConnections[0] = conn;
+      ++m_numRetired[0];
+      m_hasRetired = true;
+    }
+
+    /**
+     * @brief Moves the epoch on while the calls counted under the parity it
+     *        moves to are done, at most twice. What was retired two moves
+     *        ago is made reusable: calls that started before it was retired
+     *        were counted under one parity or the other, and both were seen
+     *        without calls since. Later calls start from the active
+     *        connections.
+     * @note  The mutex must be locked.
+     */
+    void
+    reclaim() {
+      for (uint32 i = 0; i < 2 && m_hasRetired; ++i) {
+        const uint32 epoch = m_epoch.load() + 1;
+        if (0 != getNumInvoking(m_numInvoking.load(), epoch)) {
+          return;
+        }
+        m_epoch.store(epoch);
+
+        //Destroying a callback might change the connections, detach the lists
+        BaseConnectionData* conn = m_retiredConnections[1];
+        EventConnectionList* list = m_retiredLists[1];
+        m_retiredConnections[1] = m_retiredConnections[0];
+        m_retiredLists[1] = m_retiredLists[0];
+        m_numRetired[1] = m_numRetired[0];
+        m_retiredConnections[0] = nullptr;
+        m_retiredLists[0] = nullptr;
+        m_numRetired[0] = 0;
+        m_hasRetired = 0 != m_numRetired[1];
+
+        makeReusable(list, conn);
+      }
+    }
+
+    /**
+     * @brief Pools or frees the retired connection arrays and connections.
+     * @note  The mutex must be locked.
+     */
+    void
+    makeReusable(EventConnectionList* list, BaseConnectionData* conn) {
+      while (nullptr != list) {
+        EventConnectionList* next = list->m_next;
+        if (m_numFreeLists < MAX_FREE_LISTS) {
+          list->m_next = m_freeLists;
+          m_freeLists = list;
+          ++m_numFreeLists;
+        }
+        else {
+          ge_free(list);
+        }
+        list = next;
+      }
 
-      if (nullptr != m_freeConnections) {
+      while (nullptr != conn) {
+        BaseConnectionData* next = conn->m_next;
+        conn->~BaseConnectionData();
         conn->m_next = m_freeConnections;
-        m_freeConnections->m_prev = conn;
+        m_freeConnections = conn;
+        conn = next;
+      }
+    }
+
+    /**
+     * @brief Called when a trigger of the event started in @p epoch is done.
+     *        Once no call is counted under the parity the epoch would move
+     *        to, moves it on, unless the mutex is busy, in which case the
+     *        next change to the connections or trigger does.
+     */
+    void
+    endInvoke(uint32 epoch) {
+      const uint64 numInvoking = m_numInvoking.fetch_sub(getInvokingUnit(epoch)) -
+                                 getInvokingUnit(epoch);
+
+      //A callback destroyed the event, the data goes away last
+      SPtr<EventInternalData> owner;
+      if (0 != (numInvoking & DESTROYED_FLAG)) {
+        if (DESTROYED_FLAG != numInvoking) {
+          return;
+        }
+        owner = std::move(m_owner);
+      }
+
+      if (m_hasRetired.load() &&
+          0 == getNumInvoking(numInvoking, m_epoch.load() + 1)) {
+        RecursiveLock lock(m_mutex, std::try_to_lock);
+        if (lock.owns_lock()) {
+          reclaim();
+        }
       }
+    }
 
-      m_freeConnections = conn;
-      m_freeConnections->~BaseConnectionData();
+    /**
+     * @brief Returns the number of connection arrays and connections removed
+     *        from the event and not reusable yet.
+     */
+    uint32
+    getNumRetired() {
+      RecursiveLock lock(m_mutex);
+      return m_numRetired[0] + m_numRetired[1];
     }
 
-    BaseConnectionData* m_connections = nullptr;
+    /**
+     * @brief Returns the value a call started in @p epoch adds to the count
+     *        of calls in progress.
+     */
+    static uint64
+    getInvokingUnit(uint32 epoch) {
+      return 1ULL << ((epoch & 1) * 32);
+    }
+
+    /**
+     * @brief Returns the calls in progress counted under the parity of
+     *        @p epoch.
+     */
+    static uint32
+    getNumInvoking(uint64 numInvoking, uint32 epoch) {
+      return static_cast<uint32>(numInvoking >> ((epoch & 1) * 32)) & INVOKING_MASK;
+    }
+
+    static void
+    freeConnections(BaseConnectionData* conn, bool destroy) {
+      while (nullptr != conn) {
+        BaseConnectionData* next = conn->m_next;
+        if (destroy) {
+          conn->~BaseConnectionData();
+        }
+        ge_free(conn);
+        conn = next;
+      }
+    }
+
+    static void
+    freeLists(EventConnectionList* list) {
+      while (nullptr != list) {
+        EventConnectionList* next = list->m_next;
+        ge_free(list);
+        list = next;
+      }
+    }
+
+    std::atomic<EventConnectionList*> m_connections{nullptr};
+    std::atomic<uint64> m_numInvoking{0};
+    std::atomic<uint32> m_epoch{0};
+    std::atomic<bool> m_hasRetired{false};
+
+    /**
+     * @brief What was retired since the epoch last moved, then what was
+     *        retired before it.
+     */
+    EventConnectionList* m_retiredLists[2] = {};
+    BaseConnectionData* m_retiredConnections[2] = {};
+    uint32 m_numRetired[2] = {};
+
+    EventConnectionList* m_freeLists = nullptr;
+    uint32 m_numFreeLists = 0;
     BaseConnectionData* m_freeConnections = nullptr;
-    BaseConnectionData* m_lastConnection = nullptr;
-    BaseConnectionData* m_newConnections = nullptr;
+
+    /**
+     * @brief Reference of the destroyed event, held by the calls in progress.
+     */
+    SPtr<EventInternalData> m_owner;
 
     RecursiveMutex m_mutex;
-    bool m_isCurrentlyTriggering = false;
   };
 
   /**
@@ -212,9 +516,7 @@ namespace geEngineSDK {
     }
 
     ~HEvent() {
-      if (nullptr != m_connection) {
-        m_eventData->freeHandle(m_connection);
-      }
+      release();
     }
 
     /**
@@ -245,16 +547,31 @@ namespace geEngineSDK {
     }
 
     HEvent& operator=(const HEvent& rhs) {
+      if (this == &rhs) {
+        return *this;
+      }
+
+      //Hold the new link before releasing the old one, both may be the same
+      if (nullptr != rhs.m_connection) {
+        ++rhs.m_connection->m_handleLinks;
+      }
+      release();
+
       m_connection = rhs.m_connection;
       m_eventData = rhs.m_eventData;
+      return *this;
+    }
 
+   private:
+    void
+    release() {
       if (nullptr != m_connection) {
-        ++m_connection->m_handleLinks;
+        m_eventData->freeHandle(m_connection);
+        m_connection = nullptr;
+        m_eventData = nullptr;
       }
-      return *this;
     }
 
-   private:
     BaseConnectionData* m_connection = nullptr;
     SPtr<EventInternalData> m_eventData;
   };
@@ -263,9 +580,10 @@ namespace geEngineSDK {
    * @brief Events allows you to register method callbacks that get notified
    *        when the event is triggered.
    * @note  Callback method return value is ignored.
+   * @note  Thread safe. Triggering the event takes no lock. Callbacks
+   *        connected while the event is being triggered are called from the
+   *        next trigger on, disconnected ones are not called anymore.
    */
-  //Note: I could create a policy template argument that allows creation of 
-  //lockable and non-lockable events in the case mutex is causing too much overhead.
   template <class RetType, class... Args>
   class TEvent
   {
@@ -273,12 +591,6 @@ namespace geEngineSDK {
     struct ConnectionData : BaseConnectionData
     {
      public:
-      void
-      deactivate() override {
-        m_func = nullptr;
-        BaseConnectionData::deactivate();
-      }
-      
       function<RetType(Args...)> m_func;
     };
 
@@ -287,6 +599,9 @@ namespace geEngineSDK {
 
     ~TEvent() {
       clear();
+
+      EventInternalData* internalData = m_internalData.get();
+      internalData->releaseEvent(std::move(m_internalData));
     }
 
     /**
@@ -300,35 +615,14 @@ namespace geEngineSDK {
       if (nullptr != m_internalData->m_freeConnections) {
         connData = static_cast<ConnectionData*>(m_internalData->m_freeConnections);
         m_internalData->m_freeConnections = connData->m_next;
-
-        new (connData)ConnectionData();
-        if (nullptr != connData->m_next) {
-          connData->m_next->m_prev = nullptr;
-        }
-
-        connData->m_isActive = true;
+        new (connData) ConnectionData();
       }
-
-      if (nullptr == connData) {
+      else {
         connData = ge_new<ConnectionData>();
       }
 
-      //If currently iterating over the connection list, delay modifying it until done
-      if (m_internalData->m_isCurrentlyTriggering) {
-        connData->m_prev = m_internalData->m_newConnections;
-
-        if (nullptr != m_internalData->m_newConnections) {
-          m_internalData->m_newConnections->m_next = connData;
-        }
-
-        m_internalData->m_newConnections = connData;
-      }
-      else
-      {
-        m_internalData->connect(connData);
-      }
-      
-      connData->m_func = func;
+      connData->m_func = std::move(func);
+      m_internalData->connect(connData);
 
       return HEvent(m_internalData, connData);
     }
@@ -338,46 +632,22 @@ namespace geEngineSDK {
      */
     void
     operator()(Args... args) {
-      //Increase ref count to ensure this event data isn't destroyed if one of
-      //the callbacks deletes the event itself.
-      SPtr<EventInternalData> internalData = m_internalData;
-
-      RecursiveLock lock(internalData->m_mutex);
-      internalData->m_isCurrentlyTriggering = true;
-
-      ConnectionData* conn = static_cast<ConnectionData*>(internalData->m_connections);
-      while (nullptr != conn) {
-        //Save next here in case the callback itself disconnects this connection
-        ConnectionData* next = static_cast<ConnectionData*>(conn->m_next);
-
-        if (nullptr != conn->m_func) {
-          conn->m_func(forward<Args>(args)...);
-        }
+      //The scope keeps the event data alive if one of the callbacks deletes
+      //the event itself, nothing else of the event is used afterwards
+      EventInternalData::InvokeScope scope(*m_internalData);
 
-        conn = next;
+      EventConnectionList* connections = scope.getConnections();
+      if (nullptr == connections) {
+        return;
       }
 
-      internalData->m_isCurrentlyTriggering = false;
-
-      //If any new connections were added during the above calls,
-      //add them to the connection list
-      if (nullptr != internalData->m_newConnections) {
-        BaseConnectionData* lastNewConnection = internalData->m_newConnections;
-        while (nullptr != lastNewConnection) {
-          lastNewConnection = lastNewConnection->m_next;
-        }
-
-        BaseConnectionData* currentConnection = lastNewConnection;
-        while (nullptr != currentConnection) {
-          BaseConnectionData* prevConnection = currentConnection->m_prev;
-          currentConnection->m_next = nullptr;
-          currentConnection->m_prev = nullptr;
+      for (uint32 i = 0; i < connections->m_size; ++i) {
+        auto conn = static_cast<ConnectionData*>(connections->data()[i]);
 
-          m_internalData->connect(currentConnection);
-          currentConnection = prevConnection;
+        //Skip the connections disconnected since the array was published
+        if (conn->m_isActive.load(std::memory_order_acquire)) {
+          conn->m_func(forward<Args>(args)...);
         }
-
-        internalData->m_newConnections = nullptr;
       }
     }
 
@@ -395,8 +665,17 @@ namespace geEngineSDK {
      */
     bool
     empty() {
-      RecursiveLock lock(m_internalData->m_mutex);
-      return m_internalData->m_connections == nullptr;
+      return nullptr == m_internalData->m_connections.load();
+    }
+
+    /**
+     * @brief Returns the number of connection arrays and connections removed
+     *        from the event and not reusable yet, as triggers that started
+     *        before they were removed might still be using them.
+     */
+    uint32
+    getNumRetired() {
+      return m_internalData->getNumRetired();
     }
 
    private:
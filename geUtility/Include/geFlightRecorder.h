@@ -0,0 +1,215 @@
+/*****************************************************************************/
+/**
+ * @file    geFlightRecorder.h
+ * @author  Samuel Prince (samuel.prince.quezada@gmail.com)
+ * @date    2018/07/28
+ * @brief   Always-on recorder of the last events of every thread.
+ *
+ * Every thread writes small fixed-size binary records (log messages,
+ * profiler zones, tasks) to a ring buffer of its own, overwriting the oldest
+ * ones. Nothing is formatted until the records are saved, which the
+ * CrashHandler does when the application crashes.
+ *
+ * @bug     No known bugs.
+ */
+/*****************************************************************************/
+#pragma once
+
+/*****************************************************************************/
+/**
+ * Includes
+ */
+/*****************************************************************************/
+#include "gePrerequisitesUtil.h"
+
+namespace geEngineSDK {
+  struct LogSourceLocation;
+  struct ProfilerZone;
+
+  /**
+   * @brief Types of the records kept by the flight recorder.
+   */
+  namespace FLIGHT_RECORD {
+    enum E {
+      kLog = 0,     //A log message, value is its channel
+      kZoneBegin,   //A profiler zone started
+      kZoneEnd,     //A profiler zone ended
+      kTaskQueued,  //A task was added to the scheduler, value is its ID
+      kTaskBegin,   //A task started running
+      kTaskEnd,     //A task finished running
+      kMarker       //Added with FlightRecorder::addMarker()
+    };
+  }
+
+  /**
+   * @brief A single record of the flight recorder. Fills two cache lines
+   *        along with its position in the ring buffer.
+   */
+  struct FlightRecord
+  {
+    static constexpr uint32 MAX_TEXT_SIZE = 94;
+
+    /**
+     * @brief Time of the record, in CycleTimer counts. Zones recorded while
+     *        the profiler isn't running have the time of the previous record
+     *        of their thread.
+     */
+    uint64 time;
+
+    /**
+     * @brief Static description of the record source, depending on the type:
+     *        a LogSourceLocation, a ProfilerZone, or nullptr.
+     */
+    const void* source;
+    uint64 value;
+    uint8 type;
+    uint8 textSize;
+
+    /**
+     * @brief Start of the message or name of the record. Not null terminated.
+     */
+    char text[MAX_TEXT_SIZE];
+  };
+
+  /**
+   * @brief Records of a thread, oldest first.
+   */
+  struct FlightRecorderThread
+  {
+    uint32 threadIdx = 0;
+    uint64 threadId = 0;
+    Vector<FlightRecord> records;
+  };
+
+  /**
+   * @brief Keeps the last records of every thread, so crash reports show what
+   *        the application was doing. Adding a record takes a few nanoseconds
+   *        and never blocks or allocates, except for the first record of a
+   *        thread.
+   * @note  Thread safe. Always running, unless disabled with setEnabled() or
+   *        compiled out with GE_FLIGHT_RECORDER_ENABLED.
+   */
+  class GE_UTILITY_EXPORT FlightRecorder
+  {
+   public:
+    /**
+     * @brief Number of records kept by each thread, 128 KB worth.
+     */
+    static constexpr uint32 RECORDS_PER_THREAD = 1024;
+
+    /**
+     * @brief Time given to records that take the time of the previous record
+     *        of their thread, instead of reading the counter.
+     */
+    static constexpr uint64 UNTIMED = ~0ULL;
+
+    /**
+     * @brief Adds a record to the buffer of the calling thread.
+     * @param[in] type    Type of the record.
+     * @param[in] source  Static description of the record, see FlightRecord.
+     * @param[in] value   Value of the record, see FLIGHT_RECORD.
+     * @param[in] text    Text of the record. Only the start of it is kept.
+     * @param[in] size    Size of the text, in bytes.
+     */
+    static void
+    record(FLIGHT_RECORD::E type,
+           const void* source,
+           uint64 value,
+           const char* text,
+           SIZE_T size) {
+#if GE_FLIGHT_RECORDER_ENABLED
+      write(type, source, value, text, size, 0);
+#endif
+    }
+
+    /**
+     * @brief Records a message logged on a channel.
+     */
+    static void
+    recordLog(const String& message,
+              uint32 channel,
+              const LogSourceLocation* location) {
+      record(FLIGHT_RECORD::kLog, location, channel, message.c_str(), message.size());
+    }
+
+    /**
+     * @brief Records the start of a profiler zone.
+     * @param[in] time  Time of the start in CycleTimer counts, if already
+     *            read by the caller. Zones are too frequent to read the
+     *            counter for, so by default the record is UNTIMED.
+     */
+    static void
+    beginZone(const ProfilerZone* zone, uint64 time = UNTIMED) {
+#if GE_FLIGHT_RECORDER_ENABLED
+      write(FLIGHT_RECORD::kZoneBegin, zone, 0, nullptr, 0, time);
+#endif
+    }
+
+    /**
+     * @brief Records the end of a profiler zone.
+     * @param[in] time  Time of the end in CycleTimer counts, if already read
+     *            by the caller. UNTIMED by default, see beginZone().
+     */
+    static void
+    endZone(const ProfilerZone* zone, uint64 time = UNTIMED) {
+#if GE_FLIGHT_RECORDER_ENABLED
+      write(FLIGHT_RECORD::kZoneEnd, zone, 0, nullptr, 0, time);
+#endif
+    }
+
+    /**
+     * @brief Records a marker with a custom text and value.
+     */
+    static void
+    addMarker(const char* text, uint64 value = 0) {
+      record(FLIGHT_RECORD::kMarker, nullptr, value, text, text ? strlen(text) : 0);
+    }
+
+    /**
+     * @brief Enables or disables the recording on all threads.
+     */
+    static void
+    setEnabled(bool enabled);
+
+    /**
+     * @brief Checks if records are being added.
+     */
+    static bool
+    isEnabled();
+
+    /**
+     * @brief Returns a copy of the records of every thread. Records being
+     *        overwritten while they are read are skipped.
+     */
+    static Vector<FlightRecorderThread>
+    getRecords();
+
+    /**
+     * @brief Returns the records of every thread as text, with their time
+     *        relative to the call, newest last.
+     */
+    static String
+    getText();
+
+    /**
+     * @brief Saves the records of every thread as text.
+     * @param path  Absolute path to the file.
+     */
+    static void
+    save(const Path& path);
+
+   private:
+    /**
+     * @brief Adds a record to the buffer of the calling thread, at @p time,
+     *        at the current time if 0, or at the time of the previous record
+     *        if UNTIMED.
+     */
+    static void
+    write(FLIGHT_RECORD::E type,
+          const void* source,
+          uint64 value,
+          const char* text,
+          SIZE_T size,
+          uint64 time);
+  };
+}
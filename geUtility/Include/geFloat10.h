@@ -104,7 +104,7 @@ namespace geEngineSDK {
       Float32 Result;
 
       if (31 == components.exponent) { //INF or NAN
-        Result.integerValue = 0x7f800000 | (components.mantissa << 17);
+        Result.integerValue = 0x7f800000 | (components.mantissa << 18);
       }
       else {
         uint32 exponent;
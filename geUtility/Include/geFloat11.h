@@ -120,7 +120,7 @@ namespace geEngineSDK {
             mantissa <<= 1;
           } while (0 == (mantissa & 0x40));
 
-          mantissa &= 0x1F;
+          mantissa &= 0x3F;
         }
         else { //The value is zero
           exponent = static_cast<uint32>(-112);
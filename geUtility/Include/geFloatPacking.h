@@ -0,0 +1,77 @@
+/*****************************************************************************/
+/**
+ * @file    geFloatPacking.h
+ * @author  Samuel Prince (samuel.prince.quezada@gmail.com)
+ * @date    2018/07/03
+ * @brief   Bulk conversion between 32-bit floats and reduced precision floats.
+ *
+ * Bulk conversion between 32-bit floats and the reduced precision formats
+ * (Float16, Float11, Float10). The conversions run on SIMD registers and
+ * produce the exact same bit patterns as the scalar classes.
+ *
+ * @bug     No known bugs.
+ */
+/*****************************************************************************/
+#pragma once
+
+/*****************************************************************************/
+/**
+ * Includes
+ */
+/*****************************************************************************/
+#include "gePrerequisitesUtil.h"
+#include "geFloat16.h"
+#include "geFloat16Color.h"
+
+namespace geEngineSDK {
+  class LinearColor;
+  class Vector3;
+
+  /**
+   * @brief Converts arrays of floats to and from packed reduced precision
+   *        formats. Input and output arrays must not overlap.
+   */
+  class GE_UTILITY_EXPORT FloatPacking
+  {
+   public:
+    /**
+     * @brief Converts an array of floats into half precision floats.
+     *        Same rules as Float16::set().
+     */
+    static void
+    floatToHalf(const float* input, Float16* output, SIZE_T count);
+
+    /**
+     * @brief Converts an array of half precision floats into floats.
+     *        Same rules as Float16::getFloat().
+     */
+    static void
+    halfToFloat(const Float16* input, float* output, SIZE_T count);
+
+    /**
+     * @brief Converts an array of colors into half precision colors.
+     */
+    static void
+    colorToHalf(const LinearColor* input, Float16Color* output, SIZE_T count);
+
+    /**
+     * @brief Converts an array of half precision colors into colors.
+     */
+    static void
+    halfToColor(const Float16Color* input, LinearColor* output, SIZE_T count);
+
+    /**
+     * @brief Packs an array of vectors into the R11G11B10 float format
+     *        (x in the lowest 11 bits, then 11 bits of y and 10 bits of z).
+     *        Same rules as Float11::set() and Float10::set().
+     */
+    static void
+    vectorToR11G11B10(const Vector3* input, uint32* output, SIZE_T count);
+
+    /**
+     * @brief Unpacks an array of R11G11B10 float values into vectors.
+     */
+    static void
+    r11g11b10ToVector(const uint32* input, Vector3* output, SIZE_T count);
+  };
+}
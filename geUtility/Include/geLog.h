@@ -21,17 +21,37 @@
 #include "gePrerequisitesUtil.h"
 
 namespace geEngineSDK {
+  /**
+   * @brief Place in the source code a log entry was recorded from. Meant to
+   *        be a static constant of the call site, so entries only keep a
+   *        pointer to it.
+   */
+  struct LogSourceLocation
+  {
+    const char* file;
+    const char* function;
+    uint32 line;
+  };
+
   /**
    * @brief A single log entry, containing a message and a channel the message
-   *        was recorded on.
+   *        was recorded on, along with when, where and by which thread it was
+   *        recorded.
    */
   class GE_UTILITY_EXPORT LogEntry
   {
    public:
     LogEntry() = default;
-    LogEntry(String msg, uint32 channel)
+    LogEntry(String msg,
+             uint32 channel,
+             uint64 time = 0,
+             uint64 threadId = 0,
+             const LogSourceLocation* location = nullptr)
       : m_msg(std::move(msg)),
-        m_channel(channel)
+        m_channel(channel),
+        m_time(time),
+        m_threadId(threadId),
+        m_location(location)
     {}
 
     /**
@@ -50,9 +70,44 @@ namespace geEngineSDK {
       return m_msg;
     }
 
+    /**
+     * @brief Time the message was recorded at, in microseconds since the
+     *        application start. Zero if the Time module wasn't started.
+     */
+    uint64
+    getTime() const {
+      return m_time;
+    }
+
+    /**
+     * @brief Identifier of the thread that recorded the message.
+     */
+    uint64
+    getThreadId() const {
+      return m_threadId;
+    }
+
+    /**
+     * @brief Place the message was recorded from, or nullptr if unknown.
+     */
+    const LogSourceLocation*
+    getSourceLocation() const {
+      return m_location;
+    }
+
+    /**
+     * @brief Text of the message followed by its source location, as shown
+     *        in the console and in the saved logs.
+     */
+    String
+    getFormattedMessage() const;
+
    private:
     String m_msg;
-    uint32 m_channel;
+    uint32 m_channel = 0;
+    uint64 m_time = 0;
+    uint64 m_threadId = 0;
+    const LogSourceLocation* m_location = nullptr;
   };
 
   /**
@@ -71,9 +126,34 @@ namespace geEngineSDK {
      * @brief Logs a new message.
      * @param[in] message	The message describing the log entry.
      * @param[in] channel Channel in which to store the log entry.
+     * @param[in] location  Place the message is logged from, if known.
+     */
+    void
+    logMsg(const String& message,
+           uint32 channel,
+           const LogSourceLocation* location = nullptr);
+
+    /**
+     * @brief Adds an entry recorded somewhere else, keeping its time and
+     *        thread.
      */
     void
-    logMsg(const String& message, uint32 channel);
+    addEntry(LogEntry entry);
+
+    /**
+     * @brief Returns the current time, as stored in log entries.
+     * @note  Thread safe.
+     */
+    static uint64
+    getCurrentTime();
+
+    /**
+     * @brief Returns the identifier of the calling thread, as stored in log
+     *        entries.
+     * @note  Thread safe.
+     */
+    static uint64
+    getCurrentThreadId();
 
     /**
      * @brief Removes all log entries.
@@ -133,4 +213,48 @@ namespace geEngineSDK {
     uint64 m_hash = 0;
     mutable RecursiveMutex m_mutex;
   };
+
+  /**
+   * @brief Compact binary form of log entries, meant for logs that are kept
+   *        around or sent elsewhere. Each source location and thread is
+   *        written once and referenced by index from the entries, numbers are
+   *        variable length and times are stored as deltas.
+   */
+  class GE_UTILITY_EXPORT LogArchive
+  {
+   public:
+    LogArchive() = default;
+    LogArchive(const LogArchive&) = delete;
+    LogArchive&
+    operator=(const LogArchive&) = delete;
+
+    /**
+     * @brief Writes the entries to the stream.
+     */
+    static void
+    write(const Vector<LogEntry>& entries, DataStream& stream);
+
+    /**
+     * @brief Reads entries written with write(), from the current position
+     *        of the stream to its end.
+     * @return false if the data is not a valid log archive.
+     */
+    bool
+    read(DataStream& stream);
+
+    /**
+     * @brief Returns the entries that were read. Their source locations
+     *        point to this archive, which must outlive them.
+     */
+    const Vector<LogEntry>&
+    getEntries() const {
+      return m_entries;
+    }
+
+   private:
+    //Filled completely before the entries reference them
+    Vector<String> m_strings;
+    Vector<LogSourceLocation> m_locations;
+    Vector<LogEntry> m_entries;
+  };
 }
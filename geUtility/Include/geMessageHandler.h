@@ -6,7 +6,9 @@
  * @brief   Allows to transparently pass messages between different systems
  *
  * Message system that allows you to transparently pass messages between
- * different systems. Only usable in the Simulation thread
+ * different systems. Messages are sent right away on the Simulation thread,
+ * or posted from any thread and sent when the Simulation thread calls
+ * processQueued().
  *
  * @bug	    No known bugs.
  */
@@ -26,43 +28,234 @@ namespace geEngineSDK {
 
   /**
    * @brief Allows you to transparently pass messages between different systems.
-   * @note  Sim thread only.
+   * @note  send(), listen() and processQueued() are sim thread only. post()
+   *        can be called from any thread, messages posted by a thread are
+   *        sent in the order they were posted.
    */
   class GE_UTILITY_EXPORT MessageHandler : public Module<MessageHandler>
   {
    private:
     friend class HMessage;
 
-    struct MessageHandlerData
+    struct ThreadQueue;
+    struct ThreadQueueHolder;
+
+    /**
+     * @brief A message waiting in a ThreadQueue. Small payloads are stored
+     *        in place, the rest are allocated.
+     */
+    struct QueuedMessage
+    {
+      static constexpr SIZE_T INLINE_SIZE = 48;
+
+      uint32 messageId;
+
+      /**
+       * @brief Sends the message through @p handler, or only destroys its
+       *        payload if @p handler is null.
+       */
+      void (*process)(MessageHandler* handler, QueuedMessage& message);
+
+      void* payload;
+      alignas(16) uint8 storage[INLINE_SIZE];
+    };
+
+    struct Listener
     {
-      uint32 id;
-      function<void()> callback;
+      /**
+       * @brief Index of the subscription in m_handles, or INVALID_INDEX once
+       *        unsubscribed.
+       */
+      uint32 handleIdx;
+      function<void(const void*)> callback;
+    };
+
+    struct MessageListeners
+    {
+      Vector<Listener> listeners;
+      uint32 numRemoved = 0;
+      uint32 numTyped = 0;
+    };
+
+    struct Subscription
+    {
+      uint32 messageId = 0;
+      uint32 listenerIdx = 0;
+      uint32 generation = 0;
+      bool isPending = false;
+      bool isTyped = false;
     };
 
    public:
-    MessageHandler() = default;
+    MessageHandler();
+    ~MessageHandler();
 
     /**
      * @brief Sends a message to all subscribed listeners.
+     * @note  Messages with a payload type can only be sent this way if none
+     *        of their listeners reads the payload.
+     */
+    void
+    send(MessageId message) {
+      dispatch(message.m_msgIdentifier, nullptr);
+    }
+
+    /**
+     * @brief Sends a message and its payload to all subscribed listeners.
      */
+    template<class T>
     void
-    send(MessageId message);
+    send(const TMessageId<T>& message,
+         const typename TMessageId<T>::PayloadType& payload) {
+      dispatch(message.m_msgIdentifier, &payload);
+    }
 
     /**
      * @brief Subscribes a message listener for the specified message. Provided
      *        callback will be triggered whenever that message gets sent.
      * @return  A handle to the message subscription that you can use to
      *          unsubscribe from listening.
+     * @note    Listeners subscribed while a message is being sent start
+     *          receiving messages once it's done.
      */
     HMessage
-    listen(MessageId message, function<void()>& callback);
+    listen(MessageId message, function<void()> callback) {
+      return subscribe(message.m_msgIdentifier,
+                       [callback](const void*) { callback(); },
+                       false);
+    }
+
+    /**
+     * @copydoc MessageHandler::listen(MessageId, function<void()>)
+     */
+    template<class T>
+    HMessage
+    listen(const TMessageId<T>& message,
+           function<void(const typename TMessageId<T>::PayloadType&)> callback) {
+      return subscribe(message.m_msgIdentifier,
+                       [callback](const void* payload) {
+                         callback(*static_cast<const T*>(payload));
+                       },
+                       true);
+    }
+
+    /**
+     * @brief Queues a message, to be sent on the next processQueued().
+     * @note  Thread safe.
+     */
+    void
+    post(MessageId message);
+
+    /**
+     * @brief Queues a message and its payload, to be sent on the next
+     *        processQueued().
+     * @note  Thread safe.
+     */
+    template<class T>
+    void
+    post(const TMessageId<T>& message, typename TMessageId<T>::PayloadType payload) {
+      QueuedMessage& queued = beginPost(message.m_msgIdentifier);
+      if (sizeof(T) <= QueuedMessage::INLINE_SIZE && alignof(T) <= 16) {
+        queued.payload = new (queued.storage) T(std::move(payload));
+        queued.process = &processQueuedMessage<T, true>;
+      }
+      else {
+        //ge_new() wouldn't respect the alignment of SIMD types on Win32
+        void* memory = ge_alloc_aligned(sizeof(T), std::max(alignof(T), SIZE_T(16)));
+        queued.payload = new (memory) T(std::move(payload));
+        queued.process = &processQueuedMessage<T, false>;
+      }
+      endPost();
+    }
+
+    /**
+     * @brief Sends the messages posted by every thread until now. Messages
+     *        posted meanwhile are left for the next call.
+     * @return  The number of messages sent.
+     */
+    uint32
+    processQueued();
 
    private:
+    template<class T, bool IsInline>
+    static void
+    processQueuedMessage(MessageHandler* handler, QueuedMessage& queued) {
+      T* payload = static_cast<T*>(queued.payload);
+      if (nullptr != handler) {
+        handler->dispatch(queued.messageId, payload);
+      }
+
+      payload->~T();
+      if (!IsInline) {
+        ge_free_aligned(payload);
+      }
+    }
+
+    static void
+    processQueuedVoid(MessageHandler* handler, QueuedMessage& queued);
+
+    /**
+     * @brief Calls the listeners of a message. @p payload is null for
+     *        messages without payload.
+     */
+    void
+    dispatch(uint32 messageId, const void* payload);
+
+    HMessage
+    subscribe(uint32 messageId, function<void(const void*)> callback, bool isTyped);
+
     void
     unsubscribe(uint32 handleId);
 
-    Map<uint32, Vector<MessageHandlerData>> m_messageHandlers;
-    Map<uint32, uint32> m_handlerIdToMessageMap;
-    uint32 m_nextCallbackId = 1;
+    void
+    addListener(uint32 messageId, Listener&& listener);
+
+    /**
+     * @brief Adds the listeners subscribed while sending messages, and
+     *        removes the unsubscribed ones.
+     */
+    void
+    endDispatch();
+
+    void
+    compact(uint32 messageId);
+
+    /**
+     * @brief Returns a free slot at the end of the calling thread's queue.
+     */
+    QueuedMessage&
+    beginPost(uint32 messageId);
+
+    /**
+     * @brief Makes the slot returned by beginPost() visible to processQueued().
+     */
+    void
+    endPost();
+
+    ThreadQueue*
+    getThreadQueue();
+
+    /**
+     * @brief Listeners indexed by message identifier.
+     */
+    Vector<MessageListeners> m_listeners;
+
+    /**
+     * @brief Subscriptions indexed by handle, free ones are reused.
+     */
+    Vector<Subscription> m_handles;
+    Vector<uint32> m_freeHandles;
+
+    /**
+     * @brief Listeners subscribed while sending messages.
+     */
+    Vector<std::pair<uint32, Listener>> m_pendingListeners;
+    Vector<uint32> m_messagesToCompact;
+    uint32 m_dispatchDepth = 0;
+
+    Vector<SPtr<ThreadQueue>> m_queues;
+    Vector<ThreadQueue*> m_queuesToProcess;
+    Mutex m_queuesMutex;
+    bool m_isProcessing = false;
   };
 }
@@ -18,6 +18,7 @@
  * Includes
  */
 /*****************************************************************************/
+#include <typeinfo>
 
 namespace geEngineSDK {
   /**
@@ -26,8 +27,8 @@ namespace geEngineSDK {
    *        (i.e. button names), and instead use a unique message identifier
    *        for compare. Generally you want to create one of these using the
    *        message name, and then store it for later use.
-   * @note  This class is not thread safe and should only be used on the
-   *        simulation thread.
+   * @note  Thread safe. Identifiers are numbered from 1 in the order their
+   *        names are first used, 0 is the identifier of no message.
    */
   class GE_UTILITY_EXPORT MessageId
   {
@@ -40,15 +41,41 @@ namespace geEngineSDK {
       return (m_msgIdentifier == rhs.m_msgIdentifier);
     }
 
+    /**
+     * @brief Returns the unique number of the message.
+     */
+    uint32
+    getId() const {
+      return m_msgIdentifier;
+    }
+
+   protected:
+    /**
+     * @brief Registers a message carrying a payload of the given type. The
+     *        name can't be registered with another payload type.
+     */
+    MessageId(const String& name, const std::type_info& payloadType);
+
    private:
     friend class MessageHandler;
 
-    static Map<String, uint32> m_uniqueMessageIds;
-    static uint32 m_nextMessageId;
-
     uint32 m_msgIdentifier = 0;
   };
 
+  /**
+   * @brief Identifier of a message carrying a payload of type @p T, which
+   *        its listeners receive.
+   */
+  template<class T>
+  class TMessageId : public MessageId
+  {
+   public:
+    using PayloadType = T;
+
+    TMessageId() = default;
+    TMessageId(const String& name) : MessageId(name, typeid(T)) {}
+  };
+
   /**
    * @brief Handle to a subscription for a specific message in the global messaging system.
    */
@@ -64,6 +91,15 @@ namespace geEngineSDK {
     void
     disconnect();
 
+    /**
+     * @brief Returns true if the handle refers to a subscription, i.e. it
+     *        was returned by MessageHandler::listen() and not disconnected.
+     */
+    bool
+    isConnected() const {
+      return 0 != m_id;
+    }
+
    private:
     friend class MessageHandler;
     
@@ -79,5 +115,13 @@ namespace geEngineSDK {
   void GE_UTILITY_EXPORT
   sendMessage(MessageId message);
 
+  /**
+   * @brief Queues a message in the global messaging system, to be sent at the
+   *        next MessageHandler::processQueued().
+   * @note  Thread safe.
+   */
+  void GE_UTILITY_EXPORT
+  postMessage(MessageId message);
+
   class MessageHandler;
 }
@@ -19,14 +19,21 @@
 /*****************************************************************************/
 #include "gePrerequisitesUtil.h"
 #include "geMath.h"
+#include "geOctreeStats.h"
+#include "gePlane.h"
 #include "geSIMD.h"
 #include "gePoolAlloc.h"
+#include "geProfilerCPU.h"
+#include "geTaskScheduler.h"
 
 #if GE_COMPILER == GE_COMPILER_MSVC
 # pragma warning(disable: 4201)
 #endif
 
 namespace geEngineSDK {
+  template<class ElemType, class Options>
+  class BakedOctree;
+
   /**
    * @brief Identifier that may be used for finding an element in the octree.
    */
@@ -76,6 +83,13 @@ namespace geEngineSDK {
    *          - "static void setElementId(const Octree::ElementId&, void*)"
    *            Gets called when element's ID is first assigned or subsequently
    *            modified.
+   * @note    All const methods and the iterators only read from the tree, so
+   *          any number of threads may query it at once without locking, as
+   *          long as no thread modifies it at the same time. Threads that need
+   *          to modify the tree while others query it can use the stage*()
+   *          methods. queryBatch() reads an immutable snapshot of the tree
+   *          instead of the tree itself, so it may also run while
+   *          publishStagedWrites() applies those writes.
    */
   template<class ElemType, class Options>
   class Octree
@@ -111,7 +125,18 @@ namespace geEngineSDK {
       ElementBoundGroup* bounds = nullptr;
       uint32 count = 0;
     };
+
    public:
+    /**
+     * @brief Element found by a proximity query, along with the squared
+     *        distance from the query point to its bounds.
+     */
+    struct ElementDistance
+    {
+      ElemType element;
+      float distSquared;
+    };
+
     /**
      * @brief Contains a reference to one of the eight child nodes in an octree
      *        node.
@@ -203,6 +228,176 @@ namespace geEngineSDK {
       }
     };
 
+    /**
+     * @brief Line segment prepared for slab tests against groups of four
+     *        boxes at once. Positions along the segment are expressed as a
+     *        time in range [0, 1], same as Math::lineBoxIntersection().
+     */
+    struct RaySegment
+    {
+      RaySegment(const Vector3& start, const Vector3& end)
+        : m_start(start),
+          m_invDirection((end - start).reciprocal()) {
+        const Vector3 direction = end - start;
+        m_octantMask = (direction.x < 0.0f ? 1 : 0) |
+                       (direction.y < 0.0f ? 2 : 0) |
+                       (direction.z < 0.0f ? 4 : 0);
+      }
+
+      /**
+       * @brief Tests the segment against four boxes provided as separate
+       *        center and extent components.
+       * @param[out] entryTime  Time at which the segment enters each of the
+       *             boxes. Zero if the segment starts inside the box.
+       * @return Mask of the boxes entered at or before @p maxTime.
+       */
+      simd::mask_float32x4
+      intersect(const simd::float32x4& centerX,
+                const simd::float32x4& centerY,
+                const simd::float32x4& centerZ,
+                const simd::float32x4& extentX,
+                const simd::float32x4& extentY,
+                const simd::float32x4& extentZ,
+                float maxTime,
+                simd::float32x4& entryTime) const {
+        using simd::float32x4;
+
+        float32x4 start = simd::load_splat<float32x4>(&m_start.x);
+        float32x4 invDir = simd::load_splat<float32x4>(&m_invDirection.x);
+        float32x4 t0 = (centerX - extentX - start) * invDir;
+        float32x4 t1 = (centerX + extentX - start) * invDir;
+        float32x4 tNear = simd::min(t0, t1);
+        float32x4 tFar = simd::max(t0, t1);
+
+        start = simd::load_splat<float32x4>(&m_start.y);
+        invDir = simd::load_splat<float32x4>(&m_invDirection.y);
+        t0 = (centerY - extentY - start) * invDir;
+        t1 = (centerY + extentY - start) * invDir;
+        tNear = simd::max(tNear, simd::min(t0, t1));
+        tFar = simd::min(tFar, simd::max(t0, t1));
+
+        start = simd::load_splat<float32x4>(&m_start.z);
+        invDir = simd::load_splat<float32x4>(&m_invDirection.z);
+        t0 = (centerZ - extentZ - start) * invDir;
+        t1 = (centerZ + extentZ - start) * invDir;
+        tNear = simd::max(tNear, simd::min(t0, t1));
+        tFar = simd::min(tFar, simd::max(t0, t1));
+
+        tNear = simd::max(tNear, simd::splat<float32x4>(0.0f));
+        tFar = simd::min(tFar, simd::splat<float32x4>(maxTime));
+
+        entryTime = tNear;
+        return simd::cmp_le(tNear, tFar);
+      }
+
+      Vector3 m_start;
+      Vector3 m_invDirection;
+
+      /**
+       * @brief Index of the child node entered first by the segment. XOR-ing
+       *        it with indices 0 to 7 visits the children front to back.
+       */
+      uint32 m_octantMask;
+    };
+
+    /**
+     * @brief Set of planes bounding a convex volume (e.g. a view frustum),
+     *        prepared for testing groups of four boxes at once.
+     */
+    struct ConvexVolume
+    {
+      enum { MAX_PLANES = 32 };
+
+      /**
+       * @brief Constructs the volume from a set of planes.
+       * @param[in] planes    Planes with their normals pointing out of the
+       *            volume, as returned by the Matrix4::getFrustum*Plane()
+       *            methods.
+       * @param[in] numPlanes Number of planes, up to MAX_PLANES.
+       */
+      ConvexVolume(const Plane* planes, uint32 numPlanes)
+        : m_numPlanes(Math::min(numPlanes, static_cast<uint32>(MAX_PLANES))) {
+        GE_ASSERT(numPlanes <= MAX_PLANES);
+
+        for (uint32 i = 0; i < m_numPlanes; ++i) {
+          m_planes[i].normal = planes[i];
+          m_planes[i].absNormal = planes[i].getAbs();
+          m_planes[i].distance = planes[i].w;
+        }
+      }
+
+      /**
+       * @brief Returns a mask with a bit set for each plane of the volume.
+       */
+      uint32
+      getPlaneMask() const {
+        return m_numPlanes < 32 ? (1U << m_numPlanes) - 1 : 0xFFFFFFFF;
+      }
+
+      /**
+       * @brief Classifies four boxes against the planes in @p planeMask.
+       *        Boxes may be entirely in front of a plane (outside of the
+       *        volume), straddle it, or lie entirely behind it.
+       * @param[out] intersectMasks Receives, for each box, the planes from
+       *             @p planeMask the box straddles. A box with no bits set
+       *             is fully inside the volume.
+       * @return Mask of the boxes entirely outside of the volume.
+       */
+      simd::uint32x4
+      classify(const simd::float32x4& centerX,
+               const simd::float32x4& centerY,
+               const simd::float32x4& centerZ,
+               const simd::float32x4& extentX,
+               const simd::float32x4& extentY,
+               const simd::float32x4& extentZ,
+               uint32 planeMask,
+               simd::uint32x4& intersectMasks) const {
+        using simd::float32x4;
+        using simd::uint32x4;
+
+        const float32x4 zero = simd::splat<float32x4>(0.0f);
+        uint32x4 outside = simd::splat<uint32x4>(0U);
+        intersectMasks = simd::splat<uint32x4>(0U);
+
+        for (uint32 i = 0; i < m_numPlanes; ++i) {
+          const uint32 planeBit = 1U << i;
+          if (0 == (planeMask & planeBit)) {
+            continue;
+          }
+
+          const VolumePlane& plane = m_planes[i];
+          float32x4 dist = centerX * simd::splat<float32x4>(plane.normal.x) +
+                           centerY * simd::splat<float32x4>(plane.normal.y) +
+                           centerZ * simd::splat<float32x4>(plane.normal.z) -
+                           simd::splat<float32x4>(plane.distance);
+          float32x4 radius = extentX * simd::splat<float32x4>(plane.absNormal.x) +
+                             extentY * simd::splat<float32x4>(plane.absNormal.y) +
+                             extentZ * simd::splat<float32x4>(plane.absNormal.z);
+
+          uint32x4 inFront = simd::bit_cast<uint32x4>(simd::cmp_gt(dist - radius, zero));
+          uint32x4 straddles = simd::bit_cast<uint32x4>(simd::cmp_ge(dist + radius, zero));
+
+          outside = simd::bit_or(outside, inFront);
+          intersectMasks = simd::bit_or(intersectMasks,
+                                        simd::bit_and(straddles,
+                                                      simd::splat<uint32x4>(planeBit)));
+        }
+
+        return outside;
+      }
+
+     private:
+      struct VolumePlane
+      {
+        Vector3 normal;
+        Vector3 absNormal;
+        float distance;
+      };
+
+      VolumePlane m_planes[MAX_PLANES];
+      uint32 m_numPlanes;
+    };
+
     /**
      * @brief Represents a single octree node.
      */
@@ -236,6 +431,7 @@ namespace geEngineSDK {
 
      private:
       friend class ElementIterator;
+      friend class RayIntersectIterator;
       friend class Octree;
 
       /**
@@ -296,6 +492,28 @@ namespace geEngineSDK {
         return m_bounds;
       }
 
+      /**
+       * @brief Checks if the node bounds fully contain the provided bounds.
+       */
+      bool
+      contains(const simd::AABox& bounds) const {
+        using simd::float32x4;
+
+        float32x4 queryCenter = simd::load<float32x4>(&bounds.m_center);
+        float32x4 queryExtents = simd::load<float32x4>(&bounds.m_extents);
+        float32x4 nodeCenter = simd::load<float32x4>(&m_bounds.m_center);
+        float32x4 nodeExtents = simd::load<float32x4>(&m_bounds.m_extents);
+
+        float32x4 queryReach = simd::abs(queryCenter - nodeCenter) + queryExtents;
+        simd::mask_float32x4 mask = simd::cmp_gt(queryReach, nodeExtents);
+
+        SIMDPP_ALIGN(16) uint32 outside[4];
+        simd::store(outside, simd::bit_cast<simd::uint32x4>(mask));
+
+        //W isn't part of the bounds
+        return 0 == (outside[0] | outside[1] | outside[2]);
+      }
+
       /**
        * @brief Attempts to find a child node that can fully contain the
        *        provided bounds.
@@ -312,7 +530,8 @@ namespace geEngineSDK {
         auto positiveCenter = simd::add(nodeCenter, childOffset);
         auto positiveDiff = simd::sub(positiveCenter, queryCenter);
 
-        auto diff = simd::min(negativeDiff, positiveDiff);
+        //Bounds past the outer side of a child don't fit in it either
+        auto diff = simd::min(simd::abs(negativeDiff), simd::abs(positiveDiff));
 
         auto queryExtents = simd::load<simd::float32x4>(&bounds.m_extents);
         auto childExtent = simd::load_splat<simd::float32x4>(&m_childExtent);
@@ -402,7 +621,145 @@ namespace geEngineSDK {
                             m_childExtent));
       }
 
+      /**
+       * @brief Tests the provided segment against the bounds of all eight
+       *        child nodes at once.
+       * @param[out] entryTimes Time at which the segment enters each child,
+       *             indexed by child index.
+       * @return Bit mask of the children entered at or before @p maxTime.
+       */
+      uint32
+      intersectChildren(const RaySegment& segment,
+                        float maxTime,
+                        float entryTimes[8]) const {
+        using simd::float32x4;
+
+        float32x4 centerX, centerY, negativeZ, positiveZ;
+        getChildCenters(centerX, centerY, negativeZ, positiveZ);
+        float32x4 childExtent = simd::load_splat<float32x4>(&m_childExtent);
+
+        SIMDPP_ALIGN(16) uint32 hits[8];
+        float32x4 times;
+
+        simd::mask_float32x4 mask = segment.intersect(centerX, centerY, negativeZ,
+                                                      childExtent,
+                                                      childExtent,
+                                                      childExtent,
+                                                      maxTime,
+                                                      times);
+        simd::store(&hits[0], simd::bit_cast<simd::uint32x4>(mask));
+        simd::store_u(&entryTimes[0], times);
+
+        mask = segment.intersect(centerX, centerY, positiveZ,
+                                 childExtent,
+                                 childExtent,
+                                 childExtent,
+                                 maxTime,
+                                 times);
+        simd::store(&hits[4], simd::bit_cast<simd::uint32x4>(mask));
+        simd::store_u(&entryTimes[4], times);
+
+        uint32 output = 0;
+        for (uint32 i = 0; i < 8; ++i) {
+          output |= (hits[i] & 1) << i;
+        }
+
+        return output;
+      }
+
+      /**
+       * @brief Classifies all eight child nodes against the planes in
+       *        @p planeMask of the provided volume.
+       * @param[out] intersectMasks Receives, for each child, the planes from
+       *             @p planeMask the child bounds straddle. Zero if the child
+       *             is fully inside the volume.
+       * @return Bit mask of the children not entirely outside of the volume.
+       */
+      uint32
+      classifyChildren(const ConvexVolume& volume,
+                       uint32 planeMask,
+                       uint32 intersectMasks[8]) const {
+        using simd::float32x4;
+
+        float32x4 centerX, centerY, negativeZ, positiveZ;
+        getChildCenters(centerX, centerY, negativeZ, positiveZ);
+        float32x4 childExtent = simd::load_splat<float32x4>(&m_childExtent);
+
+        SIMDPP_ALIGN(16) uint32 outside[8];
+        simd::uint32x4 intersects;
+
+        simd::store(&outside[0], volume.classify(centerX, centerY, negativeZ,
+                                                 childExtent,
+                                                 childExtent,
+                                                 childExtent,
+                                                 planeMask,
+                                                 intersects));
+        simd::store_u(&intersectMasks[0], intersects);
+
+        simd::store(&outside[4], volume.classify(centerX, centerY, positiveZ,
+                                                 childExtent,
+                                                 childExtent,
+                                                 childExtent,
+                                                 planeMask,
+                                                 intersects));
+        simd::store_u(&intersectMasks[4], intersects);
+
+        uint32 output = 0;
+        for (uint32 i = 0; i < 8; ++i) {
+          output |= (~outside[i] & 1) << i;
+        }
+
+        return output;
+      }
+
+      /**
+       * @brief Calculates the squared distance from a point to the bounds of
+       *        all eight child nodes at once (zero if inside).
+       */
+      void
+      getChildDistSquared(const Vector3& point, float distSquared[8]) const {
+        using simd::float32x4;
+
+        float32x4 centerX, centerY, negativeZ, positiveZ;
+        getChildCenters(centerX, centerY, negativeZ, positiveZ);
+        float32x4 childExtent = simd::load_splat<float32x4>(&m_childExtent);
+
+        simd::store_u(&distSquared[0], getDistSquared(point,
+                                                      centerX, centerY, negativeZ,
+                                                      childExtent,
+                                                      childExtent,
+                                                      childExtent));
+        simd::store_u(&distSquared[4], getDistSquared(point,
+                                                      centerX, centerY, positiveZ,
+                                                      childExtent,
+                                                      childExtent,
+                                                      childExtent));
+      }
+
      private:
+      /**
+       * @brief Returns the centers of all eight child nodes. Children 0-3
+       *        differ in X and Y and use @p negativeZ, children 4-7 are the
+       *        same ones moved to @p positiveZ.
+       */
+      void
+      getChildCenters(simd::float32x4& centerX,
+                      simd::float32x4& centerY,
+                      simd::float32x4& negativeZ,
+                      simd::float32x4& positiveZ) const {
+        using simd::float32x4;
+
+        float32x4 childOffset = simd::load_splat<float32x4>(&m_childOffset);
+        float32x4 offsetX = simd::make_float<float32x4>(-1.0f, 1.0f, -1.0f, 1.0f);
+        float32x4 offsetY = simd::make_float<float32x4>(-1.0f, -1.0f, 1.0f, 1.0f);
+        float32x4 nodeCenterZ = simd::load_splat<float32x4>(&m_bounds.m_center.z);
+
+        centerX = simd::load_splat<float32x4>(&m_bounds.m_center.x) + offsetX * childOffset;
+        centerY = simd::load_splat<float32x4>(&m_bounds.m_center.y) + offsetY * childOffset;
+        negativeZ = nodeCenterZ - childOffset;
+        positiveZ = nodeCenterZ + childOffset;
+      }
+
       simd::AABox m_bounds;
       float m_childExtent;
       float m_childOffset;
@@ -601,6 +958,81 @@ namespace geEngineSDK {
       uint32 m_elemsInGroup = 0;
     };
 
+   private:
+#if GE_OCTREE_QUERY_STATS
+    /**
+     * @brief Query counters of a single query type, shared by all threads.
+     */
+    struct QueryCounters
+    {
+      atomic<uint64> numQueries{0};
+      atomic<uint64> numNodesVisited{0};
+      atomic<uint64> numElementsVisited{0};
+    };
+
+    /**
+     * @brief Counts the work done by a single query, and adds it to the
+     *        counters of the tree once the query is done. Copies only count
+     *        the work done after the copy.
+     */
+    class QueryRecorder
+    {
+     public:
+      QueryRecorder(const Octree& tree, OCTREE_QUERY::E type)
+        : m_counters(&tree.m_queryCounters[type]) {
+        m_counters->numQueries.fetch_add(1, std::memory_order_relaxed);
+      }
+
+      QueryRecorder(const QueryRecorder& other)
+        : m_counters(other.m_counters)
+      {}
+
+      QueryRecorder&
+      operator=(const QueryRecorder& other) {
+        flush();
+        m_counters = other.m_counters;
+        return *this;
+      }
+
+      ~QueryRecorder() {
+        flush();
+      }
+
+      void
+      visitNode(const Node* node) {
+        ++m_numNodesVisited;
+        m_numElementsVisited += node->m_elements.count;
+      }
+
+     private:
+      void
+      flush() {
+        m_counters->numNodesVisited.fetch_add(m_numNodesVisited, std::memory_order_relaxed);
+        m_counters->numElementsVisited.fetch_add(m_numElementsVisited,
+                                                 std::memory_order_relaxed);
+        m_numNodesVisited = 0;
+        m_numElementsVisited = 0;
+      }
+
+      QueryCounters* m_counters;
+      uint64 m_numNodesVisited = 0;
+      uint64 m_numElementsVisited = 0;
+    };
+#else
+    /**
+     * @brief Query counters are compiled out, see GE_OCTREE_QUERY_STATS.
+     */
+    class QueryRecorder
+    {
+     public:
+      QueryRecorder(const Octree&, OCTREE_QUERY::E) {}
+
+      void
+      visitNode(const Node*) {}
+    };
+#endif
+
+   public:
     /**
      * @brief Iterators that iterates over all elements intersecting the
      *        specified AABox.
@@ -614,7 +1046,8 @@ namespace geEngineSDK {
        */
       BoxIntersectIterator(const Octree& tree, const AABox& bounds)
         : m_nodeIter(tree),
-          m_bounds(simd::AABox(bounds))
+          m_bounds(simd::AABox(bounds)),
+          m_recorder(tree, OCTREE_QUERY::kBox)
       {}
 
       /**
@@ -653,6 +1086,7 @@ namespace geEngineSDK {
 
           const HNode& nodeRef = m_nodeIter.getCurrent();
           m_elemIter = ElementIterator(nodeRef.getNode());
+          m_recorder.visitNode(nodeRef.getNode());
 
           //Add all intersecting child nodes to the iterator
           NodeChildRange childRange = nodeRef.getBounds().findIntersectingChildren(m_bounds);
@@ -670,6 +1104,211 @@ namespace geEngineSDK {
       NodeIterator m_nodeIter;
       ElementIterator m_elemIter;
       simd::AABox m_bounds;
+      QueryRecorder m_recorder;
+    };
+
+    /**
+     * @brief Iterator that iterates over all elements whose bounds are
+     *        intersected by a line segment. Nodes are visited front to back
+     *        along the segment, and nodes entered past the maximum time are
+     *        skipped, so lowering the maximum time with setMaxTime() after
+     *        each confirmed hit finds the closest hit without visiting the
+     *        rest of the tree. Elements within a node are not sorted.
+     */
+    class RayIntersectIterator
+    {
+      /**
+       * @brief Node waiting to be visited, along with the time at which the
+       *        segment enters it.
+       */
+      struct RayNode
+      {
+        RayNode(const Node* node, const NodeBounds& bounds, float entryTime)
+          : m_node(node),
+            m_bounds(bounds),
+            m_entryTime(entryTime)
+        {}
+
+        const Node* m_node;
+        NodeBounds m_bounds;
+        float m_entryTime;
+      };
+
+     public:
+      /**
+       * @brief Constructs an iterator that iterates over all elements in the
+       *        specified tree whose bounds are intersected by the segment
+       *        from @p start to @p end.
+       */
+      RayIntersectIterator(const Octree& tree,
+                           const Vector3& start,
+                           const Vector3& end)
+        : m_segment(start, end),
+          m_stackAlloc(),
+          m_nodeStack(&m_stackAlloc),
+          m_recorder(tree, OCTREE_QUERY::kRay) {
+        m_nodeStack.reserve(Options::maxDepth * 8);
+
+        //Elements in the root may lie outside of its bounds, always visit it
+        m_nodeStack.emplace_back(&tree.m_root, tree.m_rootBounds, 0.0f);
+      }
+
+      /**
+       * @brief Returns the contents of the current element. moveNext() must be
+       *        called at least once and it must return true prior to
+       *        attempting to access this data.
+       */
+      const ElemType&
+      getElement() const {
+        return m_elemGroup->v[m_groupIdx + m_lane - 1];
+      }
+
+      /**
+       * @brief Returns the time in range [0, 1] at which the segment enters
+       *        the bounds of the current element. Zero if the segment starts
+       *        inside the bounds.
+       */
+      float
+      getTime() const {
+        return m_times[m_lane - 1];
+      }
+
+      /**
+       * @brief Limits the iteration to elements entered at or before the
+       *        provided time. Usually called with the time of the closest
+       *        confirmed hit so far.
+       */
+      void
+      setMaxTime(float maxTime) {
+        m_maxTime = maxTime;
+      }
+
+      /**
+       * @brief Moves to the next intersecting element. Iterator starts at a
+       *        position before the first element, therefore this method must
+       *        be called at least once before attempting to access the current
+       *        element data. If the method returns false it means iterator end
+       *        has been reached and attempting to access data will result in
+       *        an error.
+       */
+      bool
+      moveNext() {
+        while (true) {
+          //Report the remaining hits of the last tested elements
+          while (m_lane < m_laneCount) {
+            uint32 lane = m_lane++;
+            if (0 != m_hits[lane] && m_times[lane] <= m_maxTime) {
+              return true;
+            }
+          }
+
+          if (m_boundGroup) {
+            m_groupIdx += m_laneCount;
+            m_lane = 0;
+            m_laneCount = 0;
+
+            if (m_groupIdx >= m_elemsInGroup) { //Next group
+              m_elemGroup = m_elemGroup->next;
+              m_boundGroup = m_boundGroup->next;
+
+              //Following groups are always full
+              m_elemsInGroup = Options::maxElementsPerNode;
+              m_groupIdx = 0;
+            }
+            else {
+              testElements();
+            }
+
+            continue;
+          }
+
+          //No more elements in this node, move to the next one
+          if (m_nodeStack.empty()) {
+            return false; //No more nodes to check
+          }
+
+          RayNode nodeRef = m_nodeStack.back();
+          m_nodeStack.pop_back();
+
+          //A closer hit was found since the node was queued
+          if (nodeRef.m_entryTime > m_maxTime) {
+            continue;
+          }
+
+          const Node* node = nodeRef.m_node;
+          m_recorder.visitNode(node);
+
+          m_elemGroup = node->m_elements.values;
+          m_boundGroup = node->m_elements.bounds;
+          m_elemsInGroup = node->m_elements.count -
+            (Math::divideAndRoundUp(node->m_elements.count,
+                                    static_cast<uint32>(Options::maxElementsPerNode)) - 1) *
+            Options::maxElementsPerNode;
+          m_groupIdx = 0;
+
+          if (node->m_isLeaf) {
+            continue;
+          }
+
+          //Queue the intersected children, farthest first so the closest one
+          //gets visited next
+          float entryTimes[8];
+          uint32 childMask = nodeRef.m_bounds.intersectChildren(m_segment,
+                                                                m_maxTime,
+                                                                entryTimes);
+          for (int32 i = 7; i >= 0; --i) {
+            uint32 childIdx = static_cast<uint32>(i) ^ m_segment.m_octantMask;
+            if ((childMask & (1 << childIdx)) && node->hasChild(childIdx)) {
+              m_nodeStack.emplace_back(node->getChild(childIdx),
+                                       nodeRef.m_bounds.getChild(childIdx),
+                                       entryTimes[childIdx]);
+            }
+          }
+        }
+
+        return false;
+      }
+
+     private:
+      /**
+       * @brief Tests the segment against the next (up to) four elements of
+       *        the current group.
+       */
+      void
+      testElements() {
+        using simd::float32x4;
+
+        m_laneCount = Math::min(m_elemsInGroup - m_groupIdx, 4U);
+
+        float32x4 centerX, centerY, centerZ, extentX, extentY, extentZ;
+        loadBounds(&m_boundGroup->v[m_groupIdx], m_laneCount,
+                   centerX, centerY, centerZ,
+                   extentX, extentY, extentZ);
+
+        float32x4 times;
+        simd::mask_float32x4 mask = m_segment.intersect(centerX, centerY, centerZ,
+                                                        extentX, extentY, extentZ,
+                                                        m_maxTime,
+                                                        times);
+        simd::store(m_hits, simd::bit_cast<simd::uint32x4>(mask));
+        simd::store(m_times, times);
+      }
+
+      RaySegment m_segment;
+      float m_maxTime = 1.0f;
+
+      const ElementGroup* m_elemGroup = nullptr;
+      const ElementBoundGroup* m_boundGroup = nullptr;
+      uint32 m_elemsInGroup = 0;
+      uint32 m_groupIdx = 0;
+      uint32 m_lane = 0;
+      uint32 m_laneCount = 0;
+      SIMDPP_ALIGN(16) uint32 m_hits[4];
+      SIMDPP_ALIGN(16) float m_times[4];
+
+      StaticAlloc<Options::maxDepth * 8 * sizeof(RayNode), FreeAlloc> m_stackAlloc;
+      StaticVector<RayNode, Options::maxDepth * 8> m_nodeStack;
+      QueryRecorder m_recorder;
     };
 
     /**
@@ -699,6 +1338,57 @@ namespace geEngineSDK {
       addElementToNode(elem, &m_root, m_rootBounds);
     }
 
+    /**
+     * @brief Adds a set of elements to an empty octree in a single pass. The
+     *        resulting nodes are the same as when adding the elements one by
+     *        one with addElement(), but the element bounds are calculated only
+     *        once and every node distributes its elements among its children
+     *        with a counting sort, instead of re-inserting them each time the
+     *        node splits.
+     *        If the TaskScheduler is running the element bounds are calculated
+     *        and independent subtrees are partitioned on its worker threads,
+     *        so Options::getBounds() must be safe to call concurrently.
+     *        Options::setElementId() is only called from the calling thread.
+     * @param[in] elements  Elements to add.
+     * @param[in] count     Number of entries in @p elements.
+     */
+    void
+    build(const ElemType* elements, SIZE_T count) {
+      GE_PROFILE_SCOPE("Octree::build");
+      GE_ASSERT(0 == m_root.m_totalNumElements && "The octree must be empty.");
+      if (0 == count) {
+        return;
+      }
+
+      BuildData data;
+      data.elements = elements;
+      data.bounds.resize(count);
+      data.order.resize(count);
+      data.scratch.resize(count);
+      data.scratchBounds.resize(count);
+      data.slots.resize(count);
+
+      //Bounds are calculated once up front, the partitioning only reads them
+      parallelFor(count, BUILD_RANGE_ELEMENTS, [&](SIZE_T begin, SIZE_T end) {
+        for (SIZE_T i = begin; i < end; ++i) {
+          data.bounds[i] = Options::getBounds(elements[i], m_context);
+          data.order[i] = static_cast<uint32>(i);
+        }
+      });
+
+      List<SubtreeBuild> subtrees;
+      buildNode(&m_root, m_rootBounds, 0, static_cast<uint32>(count), data, subtrees);
+
+      //The workers only partition the elements, nodes and element groups are
+      //allocated here since the pools aren't thread safe
+      for (auto& subtree : subtrees) {
+        subtree.task->wait();
+
+        SIZE_T cursor = 0;
+        createSubtree(subtree.node, subtree.nodes, cursor, data);
+      }
+    }
+
     /**
      * @brief Removes an existing element from the octree.
      */
@@ -709,74 +1399,1306 @@ namespace geEngineSDK {
       popElement(node, elemId.m_elementIdx);
 
       //Reduce element counts in this and any parent nodes
-      //check if nodes need collapsing
-      Node* iterNode = node;
-      Node* nodeToCollapse = nullptr;
-      while (iterNode) {
+      for (Node* iterNode = node; iterNode; iterNode = iterNode->m_parent) {
         --iterNode->m_totalNumElements;
-
-        if (iterNode->m_totalNumElements < Options::minElementsPerNode) {
-          nodeToCollapse = iterNode;
-        }
-
-        iterNode = iterNode->m_parent;
       }
 
+      //Check if nodes need collapsing
+      Node* nodeToCollapse = findNodeToCollapse(node);
       if (nodeToCollapse) {
-        //Add all the child node elements to the current node
-        ge_frame_mark();
-        {
-          FrameStack<Node*> todo;
-          todo.push(node);
+        collapseNode(nodeToCollapse);
+      }
+    }
 
-          while (!todo.empty()) {
-            Node* curNode = todo.top();
-            todo.pop();
+    /**
+     * @brief Updates an element after its bounds changed. If the element
+     *        still fits in its node the stored bounds are refreshed in place,
+     *        otherwise the element is moved to the closest node it fits in.
+     *        The element ID may change (reported through
+     *        Options::setElementId() as usual).
+     */
+    void
+    updateElement(const OctreeElementId& elemId) {
+      Node* node = reinterpret_cast<Node*>(elemId.m_node);
 
-            for (uint32 i = 0; i < 8; ++i) {
-              if (curNode->hasChild(i)) {
-                Node* childNode = curNode->getChild(i);
+      ElementGroup* elemGroup;
+      ElementBoundGroup* boundGroup;
+      uint32 groupIdx = node->mapToGroup(elemId.m_elementIdx, &elemGroup, &boundGroup);
 
-                ElementIterator elemIter(childNode);
-                while (elemIter.moveNext()) {
-                  pushElement(node,
-                              elemIter.getCurrentElem(),
-                              elemIter.getCurrentBounds());
-                }
+      simd::AABox bounds = Options::getBounds(elemGroup->v[groupIdx], m_context);
 
-                todo.push(childNode);
-              }
-            }
-          }
-        }
-        ge_frame_clear();
+      NodeBounds ancestorBounds;
+      Node* ancestor = findContainingAncestor(node, bounds, ancestorBounds);
+      if (ancestor == node) {
+        boundGroup->v[groupIdx] = bounds;
+        return;
+      }
 
-        node->m_isLeaf = true;
+      ElemType elem = elemGroup->v[groupIdx];
+      popElement(node, elemId.m_elementIdx);
 
-        //Recursively delete all child nodes
-        for (uint32 i = 0; i < 8; ++i) {
-          if (node->m_children[i]) {
-            destroyNode(node->m_children[i]);
-            m_nodeAlloc.destruct(node->m_children[i]);
-            node->m_children[i] = nullptr;
-          }
-        }
+      //Counts from the ancestor up don't change
+      for (Node* iterNode = node; iterNode != ancestor; iterNode = iterNode->m_parent) {
+        --iterNode->m_totalNumElements;
+      }
+
+      --ancestor->m_totalNumElements;
+      addElementToNode(elem, ancestor, ancestorBounds);
+
+      Node* nodeToCollapse = findNodeToCollapse(node);
+      if (nodeToCollapse) {
+        collapseNode(nodeToCollapse);
       }
     }
 
-   private:
     /**
-     * @brief Adds a new element to the specified node.
-     *        Potentially also subdivides the node.
+     * @brief Updates a set of elements after their bounds changed, same as
+     *        calling updateElement() for each of them, except that nodes left
+     *        with too few elements are only collapsed once, at the end of the
+     *        batch. Avoids collapsing nodes that get elements moved back into
+     *        them by a later update of the same batch.
+     * @param[in] elemIds IDs of the elements to update, as last reported by
+     *            Options::setElementId(). Each element may only appear once.
+     * @param[in] count   Number of entries in @p elemIds.
      */
     void
-    addElementToNode(const ElemType& elem,
-                     Node* node,
-                     const NodeBounds& nodeBounds) {
-      simd::AABox elemBounds = Options::getBounds(elem, m_context);
+    updateElements(const OctreeElementId* elemIds, SIZE_T count) {
+      applyChanges(nullptr, 0, elemIds, count, nullptr, 0);
+    }
 
-      ++node->m_totalNumElements;
-      if (node->m_isLeaf) {
+    /**
+     * @brief Queues an element to be added by the next publishStagedWrites().
+     * @note  Thread safe. May be called while other threads query the octree.
+     */
+    void
+    stageAddElement(const ElemType& elem) {
+      Lock lock(m_stagingMutex);
+      m_stagedAdds.push_back(elem);
+    }
+
+    /**
+     * @brief Queues an element to be updated by the next
+     *        publishStagedWrites(), after its bounds changed.
+     * @note  Thread safe. May be called while other threads query the octree.
+     */
+    void
+    stageUpdateElement(const OctreeElementId& elemId) {
+      Lock lock(m_stagingMutex);
+      m_stagedUpdates.push_back(elemId);
+    }
+
+    /**
+     * @brief Queues an element to be removed by the next
+     *        publishStagedWrites().
+     * @note  Thread safe. May be called while other threads query the octree.
+     */
+    void
+    stageRemoveElement(const OctreeElementId& elemId) {
+      Lock lock(m_stagingMutex);
+      m_stagedRemoves.push_back(elemId);
+    }
+
+    /**
+     * @brief Applies all the staged writes in a single batch (see
+     *        updateElements()), then bakes a new snapshot of the tree for
+     *        queryBatch(). Updates of removed elements are ignored and an
+     *        element may be staged for update multiple times.
+     *        Meant to be called once per frame. queryBatch() may run during
+     *        the call, it keeps reading the previous snapshot until the new
+     *        one is swapped in at the end; no other method may. Writes staged
+     *        while this runs are kept for the next call.
+     * @note  Baking takes time proportional to the number of elements.
+     */
+    void
+    publishStagedWrites() {
+      GE_PROFILE_SCOPE("Octree::publishStagedWrites");
+      Vector<ElemType> adds;
+      Vector<OctreeElementId> updates;
+      Vector<OctreeElementId> removes;
+      {
+        Lock lock(m_stagingMutex);
+        std::swap(adds, m_stagedAdds);
+        std::swap(updates, m_stagedUpdates);
+        std::swap(removes, m_stagedRemoves);
+      }
+
+      auto idLess = [](const OctreeElementId& a, const OctreeElementId& b) {
+        return a.m_node != b.m_node ? a.m_node < b.m_node : a.m_elementIdx < b.m_elementIdx;
+      };
+      auto idEqual = [](const OctreeElementId& a, const OctreeElementId& b) {
+        return a.m_node == b.m_node && a.m_elementIdx == b.m_elementIdx;
+      };
+
+      std::sort(removes.begin(), removes.end(), idLess);
+      removes.erase(std::unique(removes.begin(), removes.end(), idEqual), removes.end());
+
+      std::sort(updates.begin(), updates.end(), idLess);
+      updates.erase(std::unique(updates.begin(), updates.end(), idEqual), updates.end());
+      updates.erase(std::remove_if(updates.begin(), updates.end(),
+                                   [&](const OctreeElementId& id) {
+                                     return std::binary_search(removes.begin(),
+                                                               removes.end(),
+                                                               id,
+                                                               idLess);
+                                   }),
+                    updates.end());
+
+      applyChanges(adds.data(), adds.size(),
+                   updates.data(), updates.size(),
+                   removes.data(), removes.size());
+
+      //Batches still running keep the old snapshot alive until they finish
+      SPtr<const Snapshot> snapshot = ge_shared_ptr_new<Snapshot>(*this);
+      Lock lock(m_snapshotMutex);
+      m_snapshot = std::move(snapshot);
+    }
+
+    /**
+     * @brief Runs a box intersection query for each of the provided bounds,
+     *        spread across the TaskScheduler workers if it's running.
+     *        @p callback is called as callback(queryIdx, element) for each
+     *        element intersecting the bounds of query @p queryIdx.
+     * @note  Queries the tree as it was at the end of the last
+     *        publishStagedWrites(), and finds nothing before the first one.
+     *        ElemType must be trivially copyable (see BakedOctree).
+     * @note  @p callback is called from multiple threads at once, but the
+     *        calls of a single query all come from the same thread.
+     */
+    template<class Func>
+    void
+    queryBatch(const AABox* queries, SIZE_T count, Func callback) const {
+      GE_PROFILE_SCOPE("Octree::queryBatch");
+      SPtr<const Snapshot> snapshot = getSnapshot();
+      if (!snapshot) {
+        return;
+      }
+
+      parallelFor(count, QUERY_RANGE_SIZE, [&](SIZE_T first, SIZE_T last) {
+        for (SIZE_T i = first; i < last; ++i) {
+          snapshot->forEachIntersecting(queries[i], [&](const ElemType& elem) {
+            callback(i, elem);
+          });
+        }
+      });
+    }
+
+    /**
+     * @brief Runs a segment intersection query for each of the provided
+     *        segments, spread across the TaskScheduler workers if it's
+     *        running. @p callback is called as callback(queryIdx, element,
+     *        time) for each element intersected by segment @p queryIdx, with
+     *        the time as reported by RayIntersectIterator::getTime().
+     * @note  Reads the same snapshot as the box queryBatch().
+     * @note  @p callback is called from multiple threads at once, but the
+     *        calls of a single query all come from the same thread.
+     */
+    template<class Func>
+    void
+    queryBatch(const Vector3* starts,
+               const Vector3* ends,
+               SIZE_T count,
+               Func callback) const {
+      GE_PROFILE_SCOPE("Octree::queryBatch");
+      SPtr<const Snapshot> snapshot = getSnapshot();
+      if (!snapshot) {
+        return;
+      }
+
+      parallelFor(count, QUERY_RANGE_SIZE, [&](SIZE_T first, SIZE_T last) {
+        for (SIZE_T i = first; i < last; ++i) {
+          snapshot->forEachHit(starts[i], ends[i], [&](const ElemType& elem, float time) {
+            callback(i, elem, time);
+          });
+        }
+      });
+    }
+
+    /**
+     * @brief Runs a convex volume query (see findInVolume()) for each of the
+     *        provided volumes, spread across the TaskScheduler workers if
+     *        it's running. @p callback is called as callback(queryIdx,
+     *        element) for each element intersecting volume @p queryIdx.
+     * @note  Reads the same snapshot as the box queryBatch().
+     * @note  @p callback is called from multiple threads at once, but the
+     *        calls of a single query all come from the same thread.
+     */
+    template<class Func>
+    void
+    queryBatch(const ConvexVolume* volumes, SIZE_T count, Func callback) const {
+      GE_PROFILE_SCOPE("Octree::queryBatch");
+      SPtr<const Snapshot> snapshot = getSnapshot();
+      if (!snapshot) {
+        return;
+      }
+
+      parallelFor(count, QUERY_RANGE_SIZE, [&](SIZE_T first, SIZE_T last) {
+        for (SIZE_T i = first; i < last; ++i) {
+          snapshot->forEachInVolume(volumes[i], [&](const ElemType& elem) {
+            callback(i, elem);
+          });
+        }
+      });
+    }
+
+    /**
+     * @brief Finds the element whose bounds are entered first by the line
+     *        segment from @p start to @p end.
+     * @param[out] hitElem  Closest element intersected by the segment.
+     * @param[out] hitTime  Time in range [0, 1] at which the segment enters
+     *             the bounds of @p hitElem.
+     * @return true if the segment intersects any element.
+     */
+    bool
+    findClosestHit(const Vector3& start,
+                   const Vector3& end,
+                   ElemType& hitElem,
+                   float& hitTime) const {
+      bool anyHit = false;
+
+      RayIntersectIterator iter(*this, start, end);
+      while (iter.moveNext()) {
+        //Only elements entered before this one are reported from now on
+        hitElem = iter.getElement();
+        hitTime = iter.getTime();
+        iter.setMaxTime(hitTime);
+        anyHit = true;
+      }
+
+      return anyHit;
+    }
+
+    /**
+     * @brief Finds all elements whose bounds intersect a convex volume, such
+     *        as a view frustum. Nodes fully inside the volume output their
+     *        elements (and those of all their children) without testing
+     *        them, the elements of nodes straddling the volume are tested
+     *        four at a time.
+     * @param[in]  volume   Volume to test against.
+     * @param[out] output   Buffer receiving the intersecting elements.
+     * @param[in]  capacity Number of elements @p output can hold.
+     * @return Number of intersecting elements. If larger than @p capacity
+     *         only the first @p capacity elements were written.
+     */
+    SIZE_T
+    findInVolume(const ConvexVolume& volume,
+                 ElemType* output,
+                 SIZE_T capacity) const {
+      SIZE_T count = 0;
+      forEachInVolume(volume, [&](const ElemType& elem) {
+        if (count < capacity) {
+          output[count] = elem;
+        }
+        ++count;
+      });
+
+      return count;
+    }
+
+    /**
+     * @brief Finds the elements closest to a point, measuring the distance
+     *        from the point to the element bounds. Nodes are visited in order
+     *        of their distance to the point, stopping once the closest
+     *        remaining node is farther than the farthest element found.
+     * @param[in]  point        Point to measure the distance from.
+     * @param[in]  count        Maximum number of elements to find.
+     * @param[out] output       Buffer of at least @p count entries receiving
+     *             the closest elements, sorted from closest to farthest.
+     * @param[in]  maxDistance  Elements farther away than this are ignored.
+     * @return Number of elements found, up to @p count.
+     */
+    SIZE_T
+    findNearest(const Vector3& point,
+                SIZE_T count,
+                ElementDistance* output,
+                float maxDistance = NumLimit::POS_INFINITY) const {
+      struct NearestNode
+      {
+        NearestNode(const Node* node, const NodeBounds& bounds, float distSquared)
+          : m_node(node),
+            m_bounds(bounds),
+            m_distSquared(distSquared)
+        {}
+
+        const Node* m_node;
+        NodeBounds m_bounds;
+        float m_distSquared;
+      };
+
+      //Orders the heap so the closest node is on top
+      auto fartherNode = [](const NearestNode& a, const NearestNode& b) {
+        return a.m_distSquared > b.m_distSquared;
+      };
+
+      if (0 == count) {
+        return 0;
+      }
+
+      StaticAlloc<Options::maxDepth * 16 * sizeof(NearestNode), FreeAlloc> queueAlloc;
+      StaticVector<NearestNode, Options::maxDepth * 16> nodeQueue(&queueAlloc);
+      nodeQueue.reserve(Options::maxDepth * 16);
+
+      //Elements in the root may lie outside of its bounds, always test them
+      nodeQueue.emplace_back(&m_root, m_rootBounds, 0.0f);
+
+      QueryRecorder recorder(*this, OCTREE_QUERY::kNearest);
+
+      float maxDistSquared = maxDistance * maxDistance;
+      SIZE_T numFound = 0;
+      while (!nodeQueue.empty()) {
+        std::pop_heap(nodeQueue.begin(), nodeQueue.end(), fartherNode);
+        NearestNode nodeRef = nodeQueue.back();
+        nodeQueue.pop_back();
+
+        //Every remaining node is farther than the elements found so far
+        if (nodeRef.m_distSquared > maxDistSquared) {
+          break;
+        }
+
+        const Node* node = nodeRef.m_node;
+        recorder.visitNode(node);
+
+        forEachElementQuad(node, [&](const ElemType* elems,
+                                     const simd::AABox* bounds,
+                                     uint32 laneCount) {
+          SIMDPP_ALIGN(16) float distSquared[4];
+          simd::store(distSquared, getDistSquared(point, bounds, laneCount));
+
+          for (uint32 lane = 0; lane < laneCount; ++lane) {
+            if (distSquared[lane] > maxDistSquared) {
+              continue;
+            }
+
+            //Insertion sort, the output is usually small
+            SIZE_T idx = numFound < count ? numFound++ : count - 1;
+            while (idx > 0 && output[idx - 1].distSquared > distSquared[lane]) {
+              output[idx] = output[idx - 1];
+              --idx;
+            }
+
+            output[idx].element = elems[lane];
+            output[idx].distSquared = distSquared[lane];
+
+            if (numFound == count) {
+              maxDistSquared = output[count - 1].distSquared;
+            }
+          }
+        });
+
+        if (node->m_isLeaf) {
+          continue;
+        }
+
+        float distSquared[8];
+        nodeRef.m_bounds.getChildDistSquared(point, distSquared);
+        for (uint32 i = 0; i < 8; ++i) {
+          if (node->hasChild(i) && distSquared[i] <= maxDistSquared) {
+            nodeQueue.emplace_back(node->getChild(i),
+                                   nodeRef.m_bounds.getChild(i),
+                                   distSquared[i]);
+            std::push_heap(nodeQueue.begin(), nodeQueue.end(), fartherNode);
+          }
+        }
+      }
+
+      return numFound;
+    }
+
+    /**
+     * @brief Finds all elements whose bounds are within the specified
+     *        distance of a point.
+     * @param[in]  point    Point to measure the distance from.
+     * @param[in]  radius   Maximum distance from the point to the element
+     *             bounds.
+     * @param[out] output   Buffer receiving the elements, in no particular
+     *             order.
+     * @param[in]  capacity Number of elements @p output can hold.
+     * @return Number of elements within the radius. If larger than
+     *         @p capacity only the first @p capacity elements were written.
+     */
+    SIZE_T
+    findWithinRadius(const Vector3& point,
+                     float radius,
+                     ElemType* output,
+                     SIZE_T capacity) const {
+      StaticAlloc<Options::maxDepth * 8 * sizeof(HNode), FreeAlloc> stackAlloc;
+      StaticVector<HNode, Options::maxDepth * 8> nodeStack(&stackAlloc);
+      nodeStack.reserve(Options::maxDepth * 8);
+
+      //Elements in the root may lie outside of its bounds, always test them
+      nodeStack.emplace_back(&m_root, m_rootBounds);
+
+      QueryRecorder recorder(*this, OCTREE_QUERY::kRadius);
+
+      const float radiusSquared = radius * radius;
+      SIZE_T count = 0;
+      while (!nodeStack.empty()) {
+        HNode nodeRef = nodeStack.back();
+        nodeStack.pop_back();
+
+        const Node* node = nodeRef.getNode();
+        recorder.visitNode(node);
+
+        forEachElementQuad(node, [&](const ElemType* elems,
+                                     const simd::AABox* bounds,
+                                     uint32 laneCount) {
+          SIMDPP_ALIGN(16) float distSquared[4];
+          simd::store(distSquared, getDistSquared(point, bounds, laneCount));
+
+          for (uint32 lane = 0; lane < laneCount; ++lane) {
+            if (distSquared[lane] <= radiusSquared) {
+              if (count < capacity) {
+                output[count] = elems[lane];
+              }
+              ++count;
+            }
+          }
+        });
+
+        if (node->m_isLeaf) {
+          continue;
+        }
+
+        float distSquared[8];
+        nodeRef.getBounds().getChildDistSquared(point, distSquared);
+        for (uint32 i = 0; i < 8; ++i) {
+          if (node->hasChild(i) && distSquared[i] <= radiusSquared) {
+            nodeStack.emplace_back(node->getChild(i), nodeRef.getBounds().getChild(i));
+          }
+        }
+      }
+
+      return count;
+    }
+
+    /**
+     * @brief Walks the tree and returns statistics about its shape, along
+     *        with the query counters collected since the last call to
+     *        resetQueryStats() (if enabled by GE_OCTREE_QUERY_STATS).
+     * @note  Reads the whole tree, meant for debugging and tuning only.
+     */
+    OctreeStats
+    getStats() const {
+      OctreeStats stats;
+
+      Vector<std::pair<const Node*, uint32>> nodeStack;
+      nodeStack.emplace_back(&m_root, 0);
+      while (!nodeStack.empty()) {
+        const Node* node = nodeStack.back().first;
+        const uint32 depth = nodeStack.back().second;
+        nodeStack.pop_back();
+
+        const uint32 numElements = node->m_elements.count;
+        if (stats.nodesPerDepth.size() <= depth) {
+          stats.nodesPerDepth.resize(depth + 1, 0);
+          stats.elementsPerDepth.resize(depth + 1, 0);
+        }
+        if (stats.nodesPerElementCount.size() <= numElements) {
+          stats.nodesPerElementCount.resize(numElements + 1, 0);
+        }
+
+        ++stats.numNodes;
+        ++stats.nodesPerDepth[depth];
+        ++stats.nodesPerElementCount[numElements];
+        stats.numElements += numElements;
+        stats.elementsPerDepth[depth] += numElements;
+
+        if (node->m_isLeaf) {
+          ++stats.numLeafNodes;
+          continue;
+        }
+
+        stats.numNonLeafElements += numElements;
+        for (uint32 i = 0; i < 8; ++i) {
+          if (node->hasChild(i)) {
+            nodeStack.emplace_back(node->getChild(i), depth + 1);
+          }
+        }
+      }
+
+      //The root isn't allocated from the pool
+      stats.nodeMemory = sizeof(Node) + m_nodeAlloc.getMemoryUsage();
+      stats.elementMemory = m_elemAlloc.getMemoryUsage();
+      stats.elementBoundsMemory = m_elemBoundsAlloc.getMemoryUsage();
+
+#if GE_OCTREE_QUERY_STATS
+      stats.queryStatsEnabled = true;
+      for (uint32 i = 0; i < OCTREE_QUERY::kCount; ++i) {
+        stats.queries[i].numQueries = m_queryCounters[i].numQueries.load();
+        stats.queries[i].numNodesVisited = m_queryCounters[i].numNodesVisited.load();
+        stats.queries[i].numElementsVisited = m_queryCounters[i].numElementsVisited.load();
+      }
+#endif
+
+      return stats;
+    }
+
+    /**
+     * @brief Sets the query counters back to zero. Does nothing if they are
+     *        compiled out.
+     */
+    void
+    resetQueryStats() {
+#if GE_OCTREE_QUERY_STATS
+      for (auto& counters : m_queryCounters) {
+        counters.numQueries = 0;
+        counters.numNodesVisited = 0;
+        counters.numElementsVisited = 0;
+      }
+#endif
+    }
+
+   private:
+    /**
+     * @brief Adds, updates and removes elements in a single batch. Elements
+     *        are first taken out of their nodes, then re-inserted, and nodes
+     *        left with too few elements are collapsed last.
+     */
+    void
+    applyChanges(const ElemType* added,
+                 SIZE_T numAdded,
+                 const OctreeElementId* updated,
+                 SIZE_T numUpdated,
+                 const OctreeElementId* removed,
+                 SIZE_T numRemoved) {
+      struct MovedElement
+      {
+        Node* node;
+        uint32 elementIdx;
+        Node* ancestor;  //Null for removed elements
+      };
+
+      ge_frame_mark();
+      {
+        //Refresh the bounds of the elements that still fit their nodes
+        FrameVector<MovedElement> moved;
+        for (SIZE_T i = 0; i < numUpdated; ++i) {
+          Node* node = reinterpret_cast<Node*>(updated[i].m_node);
+
+          ElementGroup* elemGroup;
+          ElementBoundGroup* boundGroup;
+          uint32 groupIdx = node->mapToGroup(updated[i].m_elementIdx, &elemGroup, &boundGroup);
+
+          simd::AABox bounds = Options::getBounds(elemGroup->v[groupIdx], m_context);
+
+          NodeBounds ancestorBounds;
+          Node* ancestor = findContainingAncestor(node, bounds, ancestorBounds);
+          if (ancestor == node) {
+            boundGroup->v[groupIdx] = bounds;
+          }
+          else {
+            moved.push_back({ node, updated[i].m_elementIdx, ancestor });
+          }
+        }
+
+        for (SIZE_T i = 0; i < numRemoved; ++i) {
+          moved.push_back({ reinterpret_cast<Node*>(removed[i].m_node),
+                            removed[i].m_elementIdx,
+                            nullptr });
+        }
+
+        //Remove the elements that need to move or go away. Going from the last element of
+        //each node to the first ensures the elements swapped into the freed
+        //slots were never queued for removal, so the queued indices stay valid
+        std::sort(moved.begin(), moved.end(),
+                  [](const MovedElement& a, const MovedElement& b) {
+                    return a.node != b.node ? a.node < b.node : a.elementIdx > b.elementIdx;
+                  });
+
+        FrameVector<ElemType> movedElems;
+        movedElems.reserve(moved.size());
+        for (auto& entry : moved) {
+          ElementGroup* elemGroup;
+          ElementBoundGroup* boundGroup;
+          uint32 groupIdx = entry.node->mapToGroup(entry.elementIdx, &elemGroup, &boundGroup);
+
+          movedElems.push_back(elemGroup->v[groupIdx]);
+          popElement(entry.node, entry.elementIdx);
+
+          for (Node* iterNode = entry.node; iterNode != entry.ancestor;
+               iterNode = iterNode->m_parent) {
+            --iterNode->m_totalNumElements;
+          }
+          if (entry.ancestor) {
+            --entry.ancestor->m_totalNumElements;
+          }
+        }
+
+        //No node was destroyed so far, re-insert starting at the ancestors
+        for (SIZE_T i = 0; i < moved.size(); ++i) {
+          if (moved[i].ancestor) {
+            addElementToNode(movedElems[i],
+                             moved[i].ancestor,
+                             getNodeBounds(moved[i].ancestor));
+          }
+        }
+
+        for (SIZE_T i = 0; i < numAdded; ++i) {
+          addElementToNode(added[i], &m_root, m_rootBounds);
+        }
+
+        //Collapse nodes left with too few elements. Skip the nodes inside of
+        //another collapsed node since they get destroyed with it
+        FrameVector<Node*> toCollapse;
+        for (auto& entry : moved) {
+          Node* nodeToCollapse = findNodeToCollapse(entry.node);
+          if (nodeToCollapse) {
+            toCollapse.push_back(nodeToCollapse);
+          }
+        }
+
+        std::sort(toCollapse.begin(), toCollapse.end());
+        toCollapse.erase(std::unique(toCollapse.begin(), toCollapse.end()), toCollapse.end());
+
+        for (auto& node : toCollapse) {
+          bool isNested = false;
+          for (Node* iterNode = node->m_parent; iterNode; iterNode = iterNode->m_parent) {
+            if (std::binary_search(toCollapse.begin(), toCollapse.end(), iterNode)) {
+              isNested = true;
+              break;
+            }
+          }
+
+          if (!isNested) {
+            collapseNode(node);
+          }
+        }
+      }
+      ge_frame_clear();
+    }
+
+    /**
+     * @brief Calculates the bounds of a node, going down from the root node
+     *        the same way the queries do.
+     */
+    NodeBounds
+    getNodeBounds(const Node* node) const {
+      uint32 path[Options::maxDepth + 1];
+      uint32 depth = 0;
+
+      for (const Node* iterNode = node; iterNode->m_parent; iterNode = iterNode->m_parent) {
+        const Node* parent = iterNode->m_parent;
+
+        uint32 childIdx = 0;
+        while (parent->m_children[childIdx] != iterNode) {
+          ++childIdx;
+        }
+
+        path[depth++] = childIdx;
+      }
+
+      NodeBounds bounds = m_rootBounds;
+      while (depth > 0) {
+        bounds = bounds.getChild(path[--depth]);
+      }
+
+      return bounds;
+    }
+
+    /**
+     * @brief Finds the deepest node, starting at @p node and going up, whose
+     *        bounds fully contain the provided bounds. The root node accepts
+     *        any bounds.
+     * @param[out] nodeBounds Bounds of the returned node.
+     */
+    Node*
+    findContainingAncestor(Node* node,
+                           const simd::AABox& bounds,
+                           NodeBounds& nodeBounds) {
+      Node* path[Options::maxDepth + 1];
+      uint32 depth = 0;
+
+      for (Node* iterNode = node; iterNode->m_parent; iterNode = iterNode->m_parent) {
+        path[depth++] = iterNode;
+      }
+
+      //Walk down from the root, remembering the last node containing the bounds
+      Node* output = &m_root;
+      nodeBounds = m_rootBounds;
+
+      NodeBounds iterBounds = m_rootBounds;
+      while (depth > 0) {
+        Node* child = path[--depth];
+
+        uint32 childIdx = 0;
+        while (child->m_parent->m_children[childIdx] != child) {
+          ++childIdx;
+        }
+
+        iterBounds = iterBounds.getChild(childIdx);
+        if (!iterBounds.contains(bounds)) {
+          break;
+        }
+
+        output = child;
+        nodeBounds = iterBounds;
+      }
+
+      return output;
+    }
+
+    /**
+     * @brief Returns the highest node, starting at @p node and going up,
+     *        with fewer elements than Options::minElementsPerNode. Null if
+     *        there is none.
+     */
+    Node*
+    findNodeToCollapse(Node* node) const {
+      Node* nodeToCollapse = nullptr;
+      for (Node* iterNode = node; iterNode; iterNode = iterNode->m_parent) {
+        if (iterNode->m_totalNumElements < Options::minElementsPerNode) {
+          nodeToCollapse = iterNode;
+        }
+      }
+
+      return nodeToCollapse;
+    }
+
+    /**
+     * @brief Moves all the elements of the child nodes of @p node into
+     *        @p node and destroys the child nodes.
+     */
+    void
+    collapseNode(Node* node) {
+      //Add all the child node elements to the current node
+      ge_frame_mark();
+      {
+        FrameStack<Node*> todo;
+        todo.push(node);
+
+        while (!todo.empty()) {
+          Node* curNode = todo.top();
+          todo.pop();
+
+          for (uint32 i = 0; i < 8; ++i) {
+            if (curNode->hasChild(i)) {
+              Node* childNode = curNode->getChild(i);
+
+              ElementIterator elemIter(childNode);
+              while (elemIter.moveNext()) {
+                pushElement(node,
+                            elemIter.getCurrentElem(),
+                            elemIter.getCurrentBounds());
+              }
+
+              todo.push(childNode);
+            }
+          }
+        }
+      }
+      ge_frame_clear();
+
+      node->m_isLeaf = true;
+
+      //Recursively delete all child nodes
+      for (uint32 i = 0; i < 8; ++i) {
+        if (node->m_children[i]) {
+          destroyNode(node->m_children[i]);
+          m_nodeAlloc.destruct(node->m_children[i]);
+          node->m_children[i] = nullptr;
+        }
+      }
+    }
+
+    /**
+     * @brief Calls @p func for each element whose bounds intersect a convex
+     *        volume. See findInVolume().
+     */
+    template<class Func>
+    void
+    forEachInVolume(const ConvexVolume& volume, Func func) const {
+      using simd::float32x4;
+
+      struct VolumeNode
+      {
+        VolumeNode(const Node* node, const NodeBounds& bounds, uint32 planeMask)
+          : m_node(node),
+            m_bounds(bounds),
+            m_planeMask(planeMask)
+        {}
+
+        const Node* m_node;
+        NodeBounds m_bounds;
+        uint32 m_planeMask;
+      };
+
+      StaticAlloc<Options::maxDepth * 8 * sizeof(VolumeNode), FreeAlloc> stackAlloc;
+      StaticVector<VolumeNode, Options::maxDepth * 8> nodeStack(&stackAlloc);
+      nodeStack.reserve(Options::maxDepth * 8);
+
+      //Elements in the root may lie outside of its bounds, always test them
+      nodeStack.emplace_back(&m_root, m_rootBounds, volume.getPlaneMask());
+
+      QueryRecorder recorder(*this, OCTREE_QUERY::kVolume);
+
+      while (!nodeStack.empty()) {
+        VolumeNode nodeRef = nodeStack.back();
+        nodeStack.pop_back();
+
+        const Node* node = nodeRef.m_node;
+        recorder.visitNode(node);
+
+        if (0 == nodeRef.m_planeMask) {
+          //Fully inside, output everything below this node
+          forEachElementQuad(node, [&](const ElemType* elems,
+                                       const simd::AABox*,
+                                       uint32 laneCount) {
+            for (uint32 lane = 0; lane < laneCount; ++lane) {
+              func(elems[lane]);
+            }
+          });
+
+          if (!node->m_isLeaf) {
+            for (uint32 i = 0; i < 8; ++i) {
+              if (node->hasChild(i)) {
+                //Bounds of fully inside nodes are never used
+                nodeStack.emplace_back(node->getChild(i), nodeRef.m_bounds, 0);
+              }
+            }
+          }
+
+          continue;
+        }
+
+        //Test the elements of the node, four at a time
+        forEachElementQuad(node, [&](const ElemType* elems,
+                                     const simd::AABox* bounds,
+                                     uint32 laneCount) {
+          float32x4 centerX, centerY, centerZ, extentX, extentY, extentZ;
+          loadBounds(bounds, laneCount,
+                     centerX, centerY, centerZ,
+                     extentX, extentY, extentZ);
+
+          simd::uint32x4 intersects;
+          SIMDPP_ALIGN(16) uint32 outside[4];
+          simd::store(outside, volume.classify(centerX, centerY, centerZ,
+                                               extentX, extentY, extentZ,
+                                               nodeRef.m_planeMask,
+                                               intersects));
+
+          for (uint32 lane = 0; lane < laneCount; ++lane) {
+            if (0 == outside[lane]) {
+              func(elems[lane]);
+            }
+          }
+        });
+
+        if (node->m_isLeaf) {
+          continue;
+        }
+
+        uint32 intersectMasks[8];
+        uint32 childMask = nodeRef.m_bounds.classifyChildren(volume,
+                                                             nodeRef.m_planeMask,
+                                                             intersectMasks);
+        for (uint32 i = 0; i < 8; ++i) {
+          if ((childMask & (1 << i)) && node->hasChild(i)) {
+            nodeStack.emplace_back(node->getChild(i),
+                                   nodeRef.m_bounds.getChild(i),
+                                   intersectMasks[i]);
+          }
+        }
+      }
+    }
+
+    /**
+     * @brief Calls @p func for each group of up to four consecutive elements
+     *        of a node, passing the elements, their bounds and the number of
+     *        elements in the group.
+     */
+    template<class Func>
+    static void
+    forEachElementQuad(const Node* node, Func func) {
+      const NodeElements& elements = node->m_elements;
+      const ElementGroup* elemGroup = elements.values;
+      const ElementBoundGroup* boundGroup = elements.bounds;
+      uint32 elemsInGroup = elements.count -
+        (Math::divideAndRoundUp(elements.count,
+                                static_cast<uint32>(Options::maxElementsPerNode)) - 1) *
+        Options::maxElementsPerNode;
+
+      while (elemGroup) {
+        for (uint32 i = 0; i < elemsInGroup; i += 4) {
+          func(&elemGroup->v[i], &boundGroup->v[i], Math::min(elemsInGroup - i, 4U));
+        }
+
+        //Following groups are always full
+        elemGroup = elemGroup->next;
+        boundGroup = boundGroup->next;
+        elemsInGroup = Options::maxElementsPerNode;
+      }
+    }
+
+    /**
+     * @brief Calculates the squared distance from a point to four boxes
+     *        (zero for boxes containing the point).
+     */
+    static simd::float32x4
+    getDistSquared(const Vector3& point,
+                   const simd::float32x4& centerX,
+                   const simd::float32x4& centerY,
+                   const simd::float32x4& centerZ,
+                   const simd::float32x4& extentX,
+                   const simd::float32x4& extentY,
+                   const simd::float32x4& extentZ) {
+      using simd::float32x4;
+
+      const float32x4 zero = simd::splat<float32x4>(0.0f);
+      float32x4 distX = simd::max(simd::abs(simd::load_splat<float32x4>(&point.x) - centerX) -
+                                  extentX, zero);
+      float32x4 distY = simd::max(simd::abs(simd::load_splat<float32x4>(&point.y) - centerY) -
+                                  extentY, zero);
+      float32x4 distZ = simd::max(simd::abs(simd::load_splat<float32x4>(&point.z) - centerZ) -
+                                  extentZ, zero);
+
+      return distX * distX + distY * distY + distZ * distZ;
+    }
+
+    /**
+     * @brief Calculates the squared distance from a point to the bounds of up
+     *        to four consecutive elements.
+     */
+    static simd::float32x4
+    getDistSquared(const Vector3& point, const simd::AABox* bounds, uint32 count) {
+      simd::float32x4 centerX, centerY, centerZ, extentX, extentY, extentZ;
+      loadBounds(bounds, count, centerX, centerY, centerZ, extentX, extentY, extentZ);
+
+      return getDistSquared(point, centerX, centerY, centerZ, extentX, extentY, extentZ);
+    }
+
+    /**
+     * @brief Loads the bounds of up to four consecutive elements, one element
+     *        per lane. Missing lanes repeat the last element.
+     */
+    static void
+    loadBounds(const simd::AABox* bounds,
+               uint32 count,
+               simd::float32x4& centerX,
+               simd::float32x4& centerY,
+               simd::float32x4& centerZ,
+               simd::float32x4& extentX,
+               simd::float32x4& extentY,
+               simd::float32x4& extentZ) {
+      using simd::float32x4;
+
+      const uint32 last = count - 1;
+
+      centerX = simd::load<float32x4>(&bounds[0].m_center);
+      centerY = simd::load<float32x4>(&bounds[Math::min(1U, last)].m_center);
+      centerZ = simd::load<float32x4>(&bounds[Math::min(2U, last)].m_center);
+      float32x4 centerW = simd::load<float32x4>(&bounds[last].m_center);
+      simd::transpose4(centerX, centerY, centerZ, centerW);
+
+      extentX = simd::load<float32x4>(&bounds[0].m_extents);
+      extentY = simd::load<float32x4>(&bounds[Math::min(1U, last)].m_extents);
+      extentZ = simd::load<float32x4>(&bounds[Math::min(2U, last)].m_extents);
+      float32x4 extentW = simd::load<float32x4>(&bounds[last].m_extents);
+      simd::transpose4(extentX, extentY, extentZ, extentW);
+    }
+
+    /**
+     * @brief Nodes with fewer elements than this are partitioned on a worker
+     *        thread during build(), along with their whole subtree.
+     */
+    static constexpr uint32 BUILD_TASK_ELEMENTS = 16384;
+
+    /**
+     * @brief Minimum number of elements handled by each worker thread when a
+     *        single build() step is spread across them.
+     */
+    static constexpr SIZE_T BUILD_RANGE_ELEMENTS = 16384;
+
+    /**
+     * @brief Minimum number of queries handled by each worker thread in
+     *        queryBatch().
+     */
+    static constexpr SIZE_T QUERY_RANGE_SIZE = 16;
+
+    /**
+     * @brief Immutable copy of the tree read by queryBatch().
+     */
+    typedef BakedOctree<ElemType, Options> Snapshot;
+
+    /**
+     * @brief Returns the snapshot baked by the last publishStagedWrites().
+     */
+    SPtr<const Snapshot>
+    getSnapshot() const {
+      Lock lock(m_snapshotMutex);
+      return m_snapshot;
+    }
+
+    /**
+     * @brief Temporary data shared by all the steps of build().
+     */
+    struct BuildData
+    {
+      const ElemType* elements;
+      Vector<simd::AABox> bounds;
+
+      //Element indices and bounds, sorted so each node owns a contiguous
+      //range. Moving the bounds along keeps the accesses sequential
+      Vector<uint32> order;
+      Vector<uint32> scratch;
+      Vector<simd::AABox> scratchBounds;
+      Vector<uint8> slots;
+    };
+
+    /**
+     * @brief Node of a subtree partitioned by a worker thread during build().
+     *        Subtrees are stored in depth first order.
+     */
+    struct BuildNode
+    {
+      uint32 firstElement;
+      uint32 numElements;
+      uint32 totalNumElements;
+      uint8 childMask;
+      bool isLeaf;
+    };
+
+    /**
+     * @brief Subtree partitioned by a worker thread during build().
+     */
+    struct SubtreeBuild
+    {
+      Node* node;
+      Vector<BuildNode> nodes;
+      SPtr<Task> task;
+    };
+
+    /**
+     * @brief Checks if a node with the provided number of elements should be
+     *        split, following the same rules as addElementToNode().
+     */
+    bool
+    shouldSplit(uint32 numElements, const NodeBounds& nodeBounds) const {
+      return numElements > Options::maxElementsPerNode &&
+             nodeBounds.getBounds().m_extents.x > m_minNodeExtent;
+    }
+
+    /**
+     * @brief Builds the node for the elements in range [begin, end) of the
+     *        build order, and recursively its children. Child nodes small
+     *        enough are handed over to a worker thread.
+     */
+    void
+    buildNode(Node* node,
+              const NodeBounds& nodeBounds,
+              uint32 begin,
+              uint32 end,
+              BuildData& data,
+              List<SubtreeBuild>& subtrees) {
+      node->m_totalNumElements = end - begin;
+      if (!shouldSplit(end - begin, nodeBounds)) {
+        for (uint32 i = begin; i < end; ++i) {
+          pushElement(node, data.elements[data.order[i]], data.bounds[i]);
+        }
+        return;
+      }
+
+      node->m_isLeaf = false;
+
+      uint32 offsets[10];
+      partitionElements(nodeBounds, begin, end, data, offsets);
+
+      //Elements that don't fit into any child
+      for (uint32 i = offsets[0]; i < offsets[1]; ++i) {
+        pushElement(node, data.elements[data.order[i]], data.bounds[i]);
+      }
+
+      const bool useWorkers = TaskScheduler::isStarted();
+      for (uint32 i = 0; i < 8; ++i) {
+        const uint32 childBegin = offsets[i + 1];
+        const uint32 childEnd = offsets[i + 2];
+        if (childBegin == childEnd) {
+          continue;
+        }
+
+        Node* child = m_nodeAlloc.construct<Node>(node);
+        node->m_children[i] = child;
+
+        NodeBounds childBounds = nodeBounds.getChild(HChildNode(i));
+        const uint32 numChildElements = childEnd - childBegin;
+        if (useWorkers &&
+            numChildElements <= BUILD_TASK_ELEMENTS &&
+            shouldSplit(numChildElements, childBounds)) {
+          subtrees.emplace_back();
+          SubtreeBuild* subtree = &subtrees.back();
+          subtree->node = child;
+          subtree->task = Task::create("OctreeBuild",
+            [this, subtree, childBounds, childBegin, childEnd, &data]() {
+              partitionSubtree(childBounds, childBegin, childEnd, data, subtree->nodes);
+            });
+
+          TaskScheduler::instance().addTask(subtree->task);
+        }
+        else {
+          buildNode(child, childBounds, childBegin, childEnd, data, subtrees);
+        }
+      }
+    }
+
+    /**
+     * @brief Same as buildNode(), but only records the nodes to create
+     *        instead of creating them, so it can run on any thread.
+     */
+    void
+    partitionSubtree(const NodeBounds& nodeBounds,
+                     uint32 begin,
+                     uint32 end,
+                     BuildData& data,
+                     Vector<BuildNode>& output) const {
+      SIZE_T nodeIdx = output.size();
+      output.push_back({ begin, end - begin, end - begin, 0, true });
+      if (!shouldSplit(end - begin, nodeBounds)) {
+        return;
+      }
+
+      uint32 offsets[10];
+      partitionElements(nodeBounds, begin, end, data, offsets);
+
+      output[nodeIdx].numElements = offsets[1] - offsets[0];
+      output[nodeIdx].isLeaf = false;
+
+      for (uint32 i = 0; i < 8; ++i) {
+        if (offsets[i + 1] != offsets[i + 2]) {
+          output[nodeIdx].childMask |= static_cast<uint8>(1 << i);
+          partitionSubtree(nodeBounds.getChild(HChildNode(i)),
+                           offsets[i + 1],
+                           offsets[i + 2],
+                           data,
+                           output);
+        }
+      }
+    }
+
+    /**
+     * @brief Creates the nodes recorded by partitionSubtree(), starting at
+     *        the node at @p cursor.
+     */
+    void
+    createSubtree(Node* node,
+                  const Vector<BuildNode>& nodes,
+                  SIZE_T& cursor,
+                  const BuildData& data) {
+      const BuildNode& entry = nodes[cursor++];
+
+      node->m_totalNumElements = entry.totalNumElements;
+      node->m_isLeaf = entry.isLeaf;
+
+      const uint32 end = entry.firstElement + entry.numElements;
+      for (uint32 i = entry.firstElement; i < end; ++i) {
+        pushElement(node, data.elements[data.order[i]], data.bounds[i]);
+      }
+
+      for (uint32 i = 0; i < 8; ++i) {
+        if (entry.childMask & (1 << i)) {
+          node->m_children[i] = m_nodeAlloc.construct<Node>(node);
+          createSubtree(node->m_children[i], nodes, cursor, data);
+        }
+      }
+    }
+
+    /**
+     * @brief Sorts the elements in range [begin, end) of the build order by
+     *        the child they fit into. Elements that don't fit into any child
+     *        go first.
+     * @param[out] offsets  Start of the elements staying in the node, start
+     *             of the elements of each of the eight children, and the end
+     *             of the range.
+     */
+    static void
+    partitionElements(const NodeBounds& nodeBounds,
+                      uint32 begin,
+                      uint32 end,
+                      BuildData& data,
+                      uint32 offsets[10]) {
+      auto classify = [&](SIZE_T first, SIZE_T last) {
+        for (SIZE_T i = first; i < last; ++i) {
+          HChildNode child = nodeBounds.findContainingChild(data.bounds[i]);
+          data.slots[i] = child.empty ? 0 : static_cast<uint8>(child.index + 1);
+        }
+      };
+
+      parallelFor(end - begin, BUILD_RANGE_ELEMENTS, [&](SIZE_T first, SIZE_T last) {
+        classify(begin + first, begin + last);
+      });
+
+      uint32 counts[9] = { 0 };
+      for (uint32 i = begin; i < end; ++i) {
+        ++counts[data.slots[i]];
+      }
+
+      offsets[0] = begin;
+      for (uint32 i = 0; i < 9; ++i) {
+        offsets[i + 1] = offsets[i] + counts[i];
+      }
+
+      uint32 writePos[9];
+      std::copy(offsets, offsets + 9, writePos);
+      for (uint32 i = begin; i < end; ++i) {
+        const uint32 dest = writePos[data.slots[i]]++;
+        data.scratch[dest] = data.order[i];
+        data.scratchBounds[dest] = data.bounds[i];
+      }
+
+      std::copy(data.scratch.begin() + begin,
+                data.scratch.begin() + end,
+                data.order.begin() + begin);
+      std::copy(data.scratchBounds.begin() + begin,
+                data.scratchBounds.begin() + end,
+                data.bounds.begin() + begin);
+    }
+
+    /**
+     * @brief Calls @p func with consecutive ranges covering [0, count), on
+     *        the TaskScheduler workers if it's running and there is enough
+     *        work, otherwise on the calling thread. Ranges are never smaller
+     *        than @p minRangeSize, except for the last one.
+     */
+    template<class Func>
+    static void
+    parallelFor(SIZE_T count, SIZE_T minRangeSize, Func func) {
+      if (count <= minRangeSize || !TaskScheduler::isStarted()) {
+        func(0, count);
+        return;
+      }
+
+      //A few ranges per worker, so uneven ranges even out
+      const SIZE_T numRanges = TaskScheduler::instance().getNumWorkers() * 4;
+      const SIZE_T rangeSize = std::max(minRangeSize,
+                                        Math::divideAndRoundUp(count, numRanges));
+
+      //The calling thread takes care of the first range
+      Vector<SPtr<Task>> tasks;
+      for (SIZE_T first = rangeSize; first < count; first += rangeSize) {
+        const SIZE_T last = std::min(first + rangeSize, count);
+        tasks.push_back(Task::create("Octree", [&func, first, last]() {
+          func(first, last);
+        }));
+
+        TaskScheduler::instance().addTask(tasks.back());
+      }
+
+      func(0, rangeSize);
+
+      for (auto& task : tasks) {
+        task->wait();
+      }
+    }
+
+    /**
+     * @brief Adds a new element to the specified node.
+     *        Potentially also subdivides the node.
+     */
+    void
+    addElementToNode(const ElemType& elem,
+                     Node* node,
+                     const NodeBounds& nodeBounds) {
+      simd::AABox elemBounds = Options::getBounds(elem, m_context);
+
+      ++node->m_totalNumElements;
+      if (node->m_isLeaf) {
         const simd::AABox& bounds = nodeBounds.getBounds();
 
         //Check if the node has too many elements and should be broken up
@@ -948,9 +2870,24 @@ namespace geEngineSDK {
     PoolAlloc<sizeof(Node)> m_nodeAlloc;
     PoolAlloc<sizeof(ElementGroup)> m_elemAlloc;
     PoolAlloc<sizeof(ElementBoundGroup), 512, 16> m_elemBoundsAlloc;
+
+    Mutex m_stagingMutex;
+    Vector<ElemType> m_stagedAdds;
+    Vector<OctreeElementId> m_stagedUpdates;
+    Vector<OctreeElementId> m_stagedRemoves;
+
+    mutable Mutex m_snapshotMutex;
+    SPtr<const Snapshot> m_snapshot;
+
+#if GE_OCTREE_QUERY_STATS
+    mutable QueryCounters m_queryCounters[OCTREE_QUERY::kCount];
+#endif
   };
 }
 
 #if GE_COMPILER == GE_COMPILER_MSVC
 # pragma warning(default: 4201)
 #endif
+
+//queryBatch() reads from a BakedOctree, which needs the complete Octree
+#include "geBakedOctree.h"
@@ -0,0 +1,108 @@
+/*****************************************************************************/
+/**
+ * @file    geOctreeStats.h
+ * @author  Samuel Prince (samuel.prince.quezada@gmail.com)
+ * @date    2018/07/16
+ * @brief   Statistics about the shape of an Octree and its queries.
+ *
+ * Statistics about the shape of an Octree (nodes per depth, elements per
+ * node, pool memory) and counters of the work done by its queries, meant for
+ * tuning the Octree options of each world.
+ *
+ * @bug     No known bugs.
+ */
+/*****************************************************************************/
+#pragma once
+
+/*****************************************************************************/
+/**
+ * Includes
+ */
+/*****************************************************************************/
+#include "gePrerequisitesUtil.h"
+
+/**
+ * Enables the per-query counters of the Octree. They cost an atomic add per
+ * query, so by default they are only collected in debug builds.
+ */
+#ifndef GE_OCTREE_QUERY_STATS
+# define GE_OCTREE_QUERY_STATS GE_DEBUG_MODE
+#endif
+
+namespace geEngineSDK {
+  /**
+   * @brief Types of Octree queries tracked by the query counters.
+   */
+  namespace OCTREE_QUERY {
+    enum E {
+      kBox = 0,   //BoxIntersectIterator
+      kRay,       //RayIntersectIterator and findClosestHit()
+      kVolume,    //findInVolume()
+      kNearest,   //findNearest()
+      kRadius,    //findWithinRadius()
+      kCount
+    };
+  }
+
+  /**
+   * @brief Work done by the queries of a single type since the counters were
+   *        last reset.
+   */
+  struct OctreeQueryStats
+  {
+    uint64 numQueries = 0;
+    uint64 numNodesVisited = 0;
+    uint64 numElementsVisited = 0;
+  };
+
+  /**
+   * @brief Snapshot of the shape of an Octree, as returned by
+   *        Octree::getStats().
+   */
+  struct GE_UTILITY_EXPORT OctreeStats
+  {
+    /**
+     * @brief Writes the statistics as a JSON object.
+     * @param[in] indent  Number of spaces per indentation level, or -1 to
+     *            write everything in a single line.
+     */
+    String
+    toJSON(int32 indent = 2) const;
+
+    uint32 numNodes = 0;
+    uint32 numLeafNodes = 0;
+    uint32 numElements = 0;
+
+    /**
+     * @brief Elements in nodes with children, which straddle the boundary
+     *        between the children. Every query reaching the node tests them.
+     */
+    uint32 numNonLeafElements = 0;
+
+    /**
+     * @brief Number of nodes and elements at each depth, starting with the
+     *        root.
+     */
+    Vector<uint32> nodesPerDepth;
+    Vector<uint32> elementsPerDepth;
+
+    /**
+     * @brief Number of nodes holding each number of elements, starting with
+     *        the nodes with no elements.
+     */
+    Vector<uint32> nodesPerElementCount;
+
+    /**
+     * @brief Bytes reserved by the node, element and element bounds pools.
+     */
+    SIZE_T nodeMemory = 0;
+    SIZE_T elementMemory = 0;
+    SIZE_T elementBoundsMemory = 0;
+
+    /**
+     * @brief Whether the query counters are collected in this build.
+     */
+    bool queryStatsEnabled = false;
+    OctreeQueryStats queries[OCTREE_QUERY::kCount];
+  };
+}
@@ -0,0 +1,173 @@
+/*****************************************************************************/
+/**
+ * @file    gePerformanceReport.h
+ * @author  Samuel Prince (samuel.prince.quezada@gmail.com)
+ * @date    2018/07/23
+ * @brief   Captures performance counters and writes them as HTML reports.
+ *
+ * A capture gathers, over a number of frames, the profiler zone statistics,
+ * the allocation counters, the task scheduler usage and the frame times.
+ * Captures are saved as HTML pages in the style of Debug::saveLog(), and as
+ * JSON so two captures (e.g. from two builds) can be compared later.
+ *
+ * @bug     No known bugs.
+ */
+/*****************************************************************************/
+#pragma once
+
+/*****************************************************************************/
+/**
+ * Includes
+ */
+/*****************************************************************************/
+#include "gePrerequisitesUtil.h"
+#include "geTaskScheduler.h"
+#include "geTime.h"
+#include "geTimer.h"
+
+namespace geEngineSDK {
+  /**
+   * @brief Statistics of every call of a profiler zone during a capture.
+   *        Times are in nanoseconds.
+   */
+  struct PerformanceZoneStats
+  {
+    String name;
+    uint64 numCalls = 0;
+    uint64 totalTime = 0;
+    uint64 minTime = 0;
+    uint64 avgTime = 0;
+    uint64 maxTime = 0;
+    uint64 p99Time = 0;
+  };
+
+  /**
+   * @brief Performance counters gathered by a PerformanceReport.
+   */
+  struct PerformanceCapture
+  {
+    String name;
+
+    /**
+     * @brief Length of the capture, in microseconds.
+     */
+    uint64 duration = 0;
+
+    /**
+     * @brief Zones measured by the ProfilerCPU, sorted by total time.
+     */
+    Vector<PerformanceZoneStats> zones;
+
+    /**
+     * @brief Allocations and frees made by the capturing thread, as counted
+     *        by MemoryCounter.
+     */
+    uint64 numAllocs = 0;
+    uint64 numFrees = 0;
+
+    /**
+     * @brief Task scheduler usage, if the TaskScheduler is running.
+     */
+    bool hasTaskScheduler = false;
+    uint32 numWorkers = 0;
+    uint32 peakQueueDepth = 0;
+    float avgQueueDepth = 0.0f;
+    uint64 numTasksCompleted = 0;
+
+    /**
+     * @brief Part of the time the workers spent running tasks, from 0 to 1.
+     */
+    float utilization = 0.0f;
+
+    /**
+     * @brief Frames updated by Time during the capture.
+     */
+    FrameTimeHistogram frameTimes;
+  };
+
+  /**
+   * @brief Gathers performance counters between beginCapture() and
+   *        endCapture(), and writes captures as HTML reports.
+   * @note  Zone statistics are only gathered if the ProfilerCPU is running,
+   *        and only for the frames ended with ProfilerCPU::endFrame() during
+   *        the capture. Allocations are counted on the capturing thread.
+   */
+  class GE_UTILITY_EXPORT PerformanceReport
+  {
+   public:
+    /**
+     * @brief Starts a capture. Starts a ProfilerCPU capture as well.
+     */
+    void
+    beginCapture();
+
+    /**
+     * @brief Ends the capture and returns its counters.
+     */
+    PerformanceCapture
+    endCapture(const String& name);
+
+    /**
+     * @brief Returns a capture as an HTML page.
+     */
+    static String
+    toHtml(const PerformanceCapture& capture);
+
+    /**
+     * @brief Returns an HTML page comparing two captures.
+     * @param[in] threshold Relative change past which a value is shown as a
+     *            regression or an improvement.
+     */
+    static String
+    toHtmlDiff(const PerformanceCapture& baseline,
+               const PerformanceCapture& current,
+               float threshold = 0.1f);
+
+    /**
+     * @brief Saves a capture as an HTML page.
+     */
+    static void
+    saveHtml(const PerformanceCapture& capture, const Path& path);
+
+    /**
+     * @brief Saves an HTML page comparing two captures.
+     */
+    static void
+    saveHtmlDiff(const PerformanceCapture& baseline,
+                 const PerformanceCapture& current,
+                 const Path& path,
+                 float threshold = 0.1f);
+
+    /**
+     * @brief Returns a capture as JSON.
+     */
+    static String
+    toJson(const PerformanceCapture& capture);
+
+    /**
+     * @brief Reads a capture written by toJson().
+     * @return false if the text isn't a valid capture.
+     */
+    static bool
+    fromJson(const String& text, PerformanceCapture& capture);
+
+    /**
+     * @brief Saves a capture as JSON, to be compared with later captures.
+     */
+    static void
+    saveCapture(const PerformanceCapture& capture, const Path& path);
+
+    /**
+     * @brief Loads a capture saved with saveCapture().
+     */
+    static bool
+    loadCapture(const Path& path, PerformanceCapture& capture);
+
+   private:
+    Timer m_timer;
+    uint64 m_startAllocs = 0;
+    uint64 m_startFrees = 0;
+    TaskSchedulerStats m_startSchedulerStats;
+    FrameTimeHistogram m_startFrameTimes;
+  };
+}
@@ -165,6 +165,23 @@ namespace geEngineSDK {
       GE_ASSERT(false);
     }
 
+    /**
+     * @brief Returns the number of elements currently allocated.
+     */
+    SIZE_T
+    getNumElements() const {
+      return m_totalNumElems;
+    }
+
+    /**
+     * @brief Returns the number of bytes reserved from the heap, including
+     *        the unused space in the blocks.
+     */
+    SIZE_T
+    getMemoryUsage() const {
+      return m_numBlocks * (sizeof(MemBlock) + ActualElemSize * ElemsPerBlock + (Alignment - 1));
+    }
+
     /**
      * @brief Allocates and constructs a single pool element.
      */
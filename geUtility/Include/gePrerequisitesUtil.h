@@ -37,6 +37,13 @@
 /*****************************************************************************/
 #define GE_PROFILING_ENABLED	1
 
+/*****************************************************************************/
+/**
+ * GE_FLIGHT_RECORDER_ENABLED - Enable/Disable the crash flight recorder
+ */
+/*****************************************************************************/
+#define GE_FLIGHT_RECORDER_ENABLED 1
+
 /*****************************************************************************/
 /**
  * Version tracking constants
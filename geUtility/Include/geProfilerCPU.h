@@ -0,0 +1,336 @@
+/*****************************************************************************/
+/**
+ * @file    geProfilerCPU.h
+ * @author  Samuel Prince (samuel.prince.quezada@gmail.com)
+ * @date    2018/07/22
+ * @brief   Hierarchical CPU profiler.
+ *
+ * Code marks the zones it wants measured with GE_PROFILE_SCOPE. Every thread
+ * records the start and end of its zones in a lock-free buffer of its own,
+ * and once per frame the buffers are gathered into a call tree for each
+ * thread. Frames can be captured and exported as Chrome trace JSON.
+ *
+ * @bug     No known bugs.
+ */
+/*****************************************************************************/
+#pragma once
+
+/*****************************************************************************/
+/**
+ * Includes
+ */
+/*****************************************************************************/
+#include "gePrerequisitesUtil.h"
+#include "geModule.h"
+#include "geFlightRecorder.h"
+
+namespace geEngineSDK {
+  /**
+   * @brief Description of a profiled zone. Meant to be a static constant of
+   *        the code it measures, see GE_PROFILE_SCOPE.
+   */
+  struct ProfilerZone
+  {
+    const char* name;
+    const char* file;
+    uint32 line;
+  };
+
+  /**
+   * @brief Node of the call tree of a thread during a frame. Each node holds
+   *        every call of a zone made from the same parent node.
+   */
+  struct ProfilerNode
+  {
+    static constexpr uint32 INVALID_IDX = 0xFFFFFFFF;
+
+    const ProfilerZone* zone = nullptr;
+    uint32 parent = INVALID_IDX;
+    uint32 firstChild = INVALID_IDX;
+    uint32 nextSibling = INVALID_IDX;
+
+    /**
+     * @brief Calls started during the frame. Zones still running from the
+     *        previous frame are measured but not counted again.
+     */
+    uint32 numCalls = 0;
+
+    /**
+     * @brief Time spent in the zone during the frame, in nanoseconds.
+     */
+    uint64 totalTime = 0;
+
+    /**
+     * @brief Time spent in the zone itself, without its children.
+     */
+    uint64 selfTime = 0;
+
+    /**
+     * @brief Shortest and longest single call that ended during the frame.
+     */
+    uint64 minTime = std::numeric_limits<uint64>::max();
+    uint64 maxTime = 0;
+  };
+
+  /**
+   * @brief Call tree of a thread during a frame.
+   */
+  struct ProfilerThreadFrame
+  {
+    uint32 threadIdx = 0;
+    String threadName;
+
+    /**
+     * @brief Nodes of the tree. Parents always come before their children,
+     *        nodes without a parent are the roots.
+     */
+    Vector<ProfilerNode> nodes;
+  };
+
+  /**
+   * @brief Zone timings of every thread during a frame.
+   */
+  struct ProfilerFrame
+  {
+    uint64 frameIdx = 0;
+
+    /**
+     * @brief Start and end of the frame, in nanoseconds since the profiler
+     *        started.
+     */
+    uint64 startTime = 0;
+    uint64 endTime = 0;
+
+    /**
+     * @brief Threads that recorded zones during the frame.
+     */
+    Vector<ProfilerThreadFrame> threads;
+  };
+
+  /**
+   * @brief A single call of a zone, as kept by frame captures.
+   */
+  struct ProfilerSpan
+  {
+    const ProfilerZone* zone;
+    uint32 threadIdx;
+    uint64 startTime;
+    uint64 endTime;
+  };
+
+  /**
+   * @brief Hierarchical CPU profiler. Zones are measured by the threads that
+   *        run them, with the time stamp counter of the CPU, and aggregated
+   *        into call trees when endFrame() is called.
+   * @note  Thread safe. Zones may be measured on any thread.
+   */
+  class GE_UTILITY_EXPORT ProfilerCPU : public Module<ProfilerCPU>
+  {
+    struct ThreadEvents;
+    struct ThreadEventsHolder;
+    struct OpenZone;
+
+   public:
+    /**
+     * @brief Creates the profiler.
+     * @param[in] eventsPerThread Number of zone starts and ends each thread
+     *            can record between two frames. Rounded up to a power of two.
+     *            Events past it are dropped.
+     */
+    explicit ProfilerCPU(uint32 eventsPerThread = 64 * 1024);
+    ~ProfilerCPU();
+
+    /**
+     * @brief Starts measuring a zone on the calling thread. The zone is also
+     *        added to the FlightRecorder, with the same time stamp.
+     * @return false if the profiler is not running, in which case endZone()
+     *         must not be called.
+     */
+    static bool
+    beginZone(const ProfilerZone* zone);
+
+    /**
+     * @brief Ends the last zone started by the calling thread, in the
+     *        FlightRecorder too.
+     */
+    static void
+    endZone(const ProfilerZone* zone);
+
+    /**
+     * @brief Enables or disables the measuring of zones. Zones already
+     *        started are still ended.
+     */
+    void
+    setEnabled(bool enabled);
+
+    /**
+     * @brief Sets the name the calling thread is shown with.
+     */
+    void
+    setThreadName(const String& name);
+
+    /**
+     * @brief Ends the current frame. Gathers the zones recorded by all threads
+     *        since the previous call into the frame call trees.
+     * @note  Meant to be called by a single thread, once per frame.
+     */
+    void
+    endFrame();
+
+    /**
+     * @brief Returns the call trees of the last frame that ended.
+     */
+    ProfilerFrame
+    getLastFrame() const;
+
+    /**
+     * @brief Starts keeping every zone call of the following frames.
+     */
+    void
+    beginCapture();
+
+    /**
+     * @brief Stops keeping zone calls. The capture is kept until the next
+     *        call to beginCapture().
+     */
+    void
+    endCapture();
+
+    /**
+     * @brief Returns the zone calls of the capture.
+     */
+    Vector<ProfilerSpan>
+    getCapturedSpans() const;
+
+    /**
+     * @brief Returns the capture in the Chrome trace event format, which can
+     *        be loaded in chrome://tracing or other trace viewers.
+     */
+    String
+    getChromeTrace() const;
+
+    /**
+     * @brief Saves the capture in the Chrome trace event format.
+     */
+    void
+    saveChromeTrace(const Path& path) const;
+
+    /**
+     * @brief Returns the number of zone starts and ends dropped because the
+     *        buffer of their thread was full.
+     */
+    uint64
+    getNumDroppedEvents() const;
+
+    /**
+     * @brief Returns the current time, in nanoseconds since the profiler
+     *        started.
+     */
+    uint64
+    getTime() const;
+
+   private:
+    void
+    onStartUp() override;
+
+    void
+    onShutDown() override;
+
+    /**
+     * @brief Returns the event buffer of the calling thread, creating it if
+     *        needed.
+     */
+    ThreadEvents*
+    getThreadEvents();
+
+    /**
+     * @brief Converts a time stamp counter value to nanoseconds since start.
+     */
+    uint64
+    toNanoseconds(uint64 ticks) const;
+
+    /**
+     * @brief Adds the events recorded by a thread to the frame call tree.
+     */
+    void
+    processEvents(ThreadEvents& events,
+                  ProfilerThreadFrame& frame,
+                  uint64 frameStart,
+                  uint64 frameEnd);
+
+    /**
+     * @brief Returns the node of a zone under a parent, adding it if needed.
+     */
+    static uint32
+    findOrAddNode(ProfilerThreadFrame& frame, uint32 parent, const ProfilerZone* zone);
+
+    uint32 m_eventsPerThread;
+    uint64 m_startTicks;
+    std::atomic<bool> m_enabled{true};
+
+    Vector<SPtr<ThreadEvents>> m_threads;
+    mutable Mutex m_threadsMutex;
+
+    mutable Mutex m_frameMutex;
+    ProfilerFrame m_lastFrame;
+    uint64 m_frameIdx = 0;
+    uint64 m_frameStart = 0;
+    bool m_capturing = false;
+    Vector<ProfilerSpan> m_capturedSpans;
+    Vector<uint64> m_capturedFrames;
+  };
+
+  /**
+   * @brief Measures a zone until it goes out of scope. The zone is also kept
+   *        by the FlightRecorder, even if the profiler is not running, in
+   *        which case the counter isn't read at all (see
+   *        FlightRecorder::UNTIMED).
+   */
+  class ProfilerScope
+  {
+   public:
+    explicit ProfilerScope(const ProfilerZone* zone)
+      : m_zone(zone),
+        m_active(ProfilerCPU::beginZone(zone)) {
+      if (!m_active) {
+        FlightRecorder::beginZone(zone);
+      }
+    }
+
+    ~ProfilerScope() {
+      if (m_active) {
+        ProfilerCPU::endZone(m_zone);
+      }
+      else {
+        FlightRecorder::endZone(m_zone);
+      }
+    }
+
+    ProfilerScope(const ProfilerScope&) = delete;
+    ProfilerScope&
+    operator=(const ProfilerScope&) = delete;
+
+   private:
+    const ProfilerZone* m_zone;
+    bool m_active;
+  };
+
+#define GE_PROFILE_CONCAT_IMPL(a, b) a##b
+#define GE_PROFILE_CONCAT(a, b) GE_PROFILE_CONCAT_IMPL(a, b)
+
+  /**
+   * @brief Measures the rest of the current scope as a zone of the CPU
+   *        profiler, if it's running. The name must be a string literal.
+   *        Compiled out when GE_PROFILING_ENABLED is 0.
+   */
+#if GE_PROFILING_ENABLED
+# define GE_PROFILE_SCOPE(name)                                               \
+  static const geEngineSDK::ProfilerZone                                      \
+    GE_PROFILE_CONCAT(geProfileZone, __LINE__) = { name, __FILE__, __LINE__ };\
+  geEngineSDK::ProfilerScope                                                  \
+    GE_PROFILE_CONCAT(geProfileScope, __LINE__)(                              \
+      &GE_PROFILE_CONCAT(geProfileZone, __LINE__))
+#else
+# define GE_PROFILE_SCOPE(name) ((void)0)
+#endif
+}
@@ -0,0 +1,100 @@
+/*****************************************************************************/
+/**
+ * @file    geQuaternionBatch.h
+ * @author  Samuel Prince (samuel.prince.quezada@gmail.com)
+ * @date    2018/07/02
+ * @brief   SIMD kernels that operate over arrays of quaternions.
+ *
+ * SIMD kernels that operate over arrays of quaternions. Input and output
+ * arrays use the regular Quaternion / Vector3 layout, the kernels transpose
+ * groups of four elements into SoA registers internally.
+ *
+ * @bug     No known bugs.
+ */
+/*****************************************************************************/
+#pragma once
+
+/*****************************************************************************/
+/**
+ * Includes
+ */
+/*****************************************************************************/
+#include "gePrerequisitesUtil.h"
+#include "geQuaternion.h"
+#include "geVector3.h"
+
+namespace geEngineSDK {
+  /**
+   * @brief Batch versions of the most common Quaternion operations. Every
+   *        method processes four elements per iteration. Output arrays may be
+   *        the same as any of the input arrays.
+   */
+  class GE_UTILITY_EXPORT QuaternionBatch
+  {
+   public:
+    /**
+     * @brief Multiplies every quaternion in @p A by its pair in @p B
+     *        (output[i] = A[i] * B[i]).
+     */
+    static void
+    multiply(const Quaternion* A,
+             const Quaternion* B,
+             Quaternion* output,
+             uint32 count);
+
+    /**
+     * @brief Normalizes an array of quaternions. Quaternions whose squared
+     *        size is below @p tolerance are set to identity, in the same way
+     *        Quaternion::normalize() does.
+     */
+    static void
+    normalize(const Quaternion* input,
+              Quaternion* output,
+              uint32 count,
+              float tolerance = Math::SMALL_NUMBER);
+
+    /**
+     * @brief Normalized linear interpolation with a per element alpha.
+     *        Takes the shortest path. Result is normalized.
+     */
+    static void
+    nlerp(const Quaternion* A,
+          const Quaternion* B,
+          const float* alpha,
+          Quaternion* output,
+          uint32 count);
+
+    /**
+     * @brief Spherical interpolation with a per element alpha. Will correct
+     *        alignment. Result is normalized.
+     * @note  Uses a polynomial approximation of the slerp weights instead of
+     *        acos / sin, so results can differ from Quaternion::slerp() by up
+     *        to 1e-5 per component.
+     */
+    static void
+    slerp(const Quaternion* A,
+          const Quaternion* B,
+          const float* alpha,
+          Quaternion* output,
+          uint32 count);
+
+    /**
+     * @brief Rotates an array of vectors by a single quaternion.
+     */
+    static void
+    rotateVectors(const Quaternion& rotation,
+                  const Vector3* input,
+                  Vector3* output,
+                  uint32 count);
+
+    /**
+     * @brief Rotates every vector in @p input by its matching quaternion in
+     *        @p rotations.
+     */
+    static void
+    rotateVectors(const Quaternion* rotations,
+                  const Vector3* input,
+                  Vector3* output,
+                  uint32 count);
+  };
+}
@@ -0,0 +1,202 @@
+/*****************************************************************************/
+/**
+ * @file    geRandomStream.h
+ * @author  Samuel Prince (samuel.prince.quezada@gmail.com)
+ * @date    2018/07/05
+ * @brief   Counter based pseudo random number generator (Philox4x32-10).
+ *
+ * Counter based pseudo random number generator. Every output is a pure
+ * function of the seed, the stream index and its position in the stream, so
+ * any number of independent and reproducible streams can be created (one per
+ * task, per particle emitter, per chunk...) and any stream can jump to any
+ * position in constant time.
+ *
+ * @bug     No known bugs.
+ */
+/*****************************************************************************/
+#pragma once
+
+/*****************************************************************************/
+/**
+ * Includes
+ */
+/*****************************************************************************/
+#include "gePrerequisitesUtil.h"
+#include "geVector3.h"
+
+namespace geEngineSDK {
+  /**
+   * @brief Generates pseudo random numbers using the Philox4x32-10 algorithm.
+   *        Unlike Random, the generator doesn't hide any state behind const
+   *        methods: to generate numbers from multiple threads give each one
+   *        its own stream (e.g. RandomStream(seed, taskIndex)). The batch
+   *        methods generate the same numbers as calling get() repeatedly, but
+   *        four blocks at a time on SIMD registers.
+   */
+  class GE_UTILITY_EXPORT RandomStream
+  {
+   public:
+    /**
+     * @brief Initializes a new generator using the specified seed.
+     * @param seed    Seed shared by all related streams.
+     * @param stream  Index of the stream. Different stream indices produce
+     *                independent sequences for the same seed.
+     */
+    explicit RandomStream(uint64 seed = 0, uint64 stream = 0) {
+      setSeed(seed, stream);
+    }
+
+    /**
+     * @brief Changes the seed and stream of the generator and rewinds it to
+     *        the start of the stream.
+     */
+    void
+    setSeed(uint64 seed, uint64 stream = 0);
+
+    /**
+     * @brief Moves the generator forward by @p count values (as if get() was
+     *        called @p count times).
+     */
+    void
+    jump(uint64 count) {
+      m_position += count;
+    }
+
+    /**
+     * @brief Moves the generator to the specified position in the stream.
+     */
+    void
+    setPosition(uint64 position) {
+      m_position = position;
+    }
+
+    /**
+     * @brief Returns the number of values generated since the start of the
+     *        stream.
+     */
+    uint64
+    getPosition() const {
+      return m_position;
+    }
+
+    /**
+     * @brief Returns a random value in range [0, NumLimit::MAX_UINT32].
+     */
+    uint32
+    get() {
+      const uint64 block = m_position >> 2;
+      if (block != m_cachedBlock) {
+        generateBlock(block, m_cache);
+        m_cachedBlock = block;
+      }
+
+      return m_cache[m_position++ & 3];
+    }
+
+    /**
+     * @brief Returns a random value in range [min, max].
+     */
+    int32
+    getRange(int32 min, int32 max) {
+      GE_ASSERT(max > min);
+      const uint64 range = static_cast<uint64>(static_cast<int64>(max) - min + 1);
+      return static_cast<int32>(min + static_cast<int64>((get() * range) >> 32));
+    }
+
+    /**
+     * @brief Returns a random value in range [0, 1).
+     */
+    float
+    getUNorm() {
+      return toUNorm(get());
+    }
+
+    /**
+     * @brief Returns a random value in range [-1, 1).
+     */
+    float
+    getSNorm() {
+      return 2.0f * getUNorm() - 1.0f;
+    }
+
+    /**
+     * @brief Returns a random unit vector in three dimensions. Consumes
+     *        exactly two values of the stream.
+     */
+    Vector3
+    getUnitVector();
+
+    /**
+     * @brief Returns a random point inside a unit sphere. Consumes exactly
+     *        three values of the stream.
+     */
+    Vector3
+    getPointInSphere();
+
+    /**
+     * @brief Fills an array with random values in range
+     *        [0, NumLimit::MAX_UINT32].
+     */
+    void
+    fill(uint32* output, SIZE_T count);
+
+    /**
+     * @brief Fills an array with random values in range [0, 1).
+     */
+    void
+    fill(float* output, SIZE_T count);
+
+    /**
+     * @brief Fills an array with random unit vectors. Produces the same
+     *        vectors (within float precision) as calling getUnitVector()
+     *        @p count times.
+     */
+    void
+    fillUnitVectors(Vector3* output, SIZE_T count);
+
+    /**
+     * @brief Fills an array with random points inside a unit sphere.
+     *        Produces the same points (within float precision) as calling
+     *        getPointInSphere() @p count times.
+     */
+    void
+    fillInSphere(Vector3* output, SIZE_T count);
+
+    /**
+     * @brief Generates a single Philox4x32-10 block.
+     * @param key     The two key words.
+     * @param counter The four counter words.
+     * @param output  Receives the four output words.
+     */
+    static void
+    philox(const uint32 key[2], const uint32 counter[4], uint32 output[4]);
+
+    /**
+     * @brief Converts a random 32 bit value into a float in range [0, 1).
+     */
+    static float
+    toUNorm(uint32 value) {
+      return static_cast<float>(value >> 8) * (1.0f / 16777216.0f);
+    }
+
+   private:
+    /**
+     * @brief Generates the four values of the specified block of the stream.
+     */
+    void
+    generateBlock(uint64 block, uint32 output[4]) const;
+
+    /**
+     * @brief Generates @p blockCount consecutive blocks starting at
+     *        @p firstBlock and writes them in stream order.
+     */
+    void
+    generateBlocks(uint64 firstBlock, SIZE_T blockCount, uint32* output) const;
+
+    uint32 m_key[2];
+    uint32 m_stream[2];
+    uint64 m_position;
+    uint64 m_cachedBlock;
+    uint32 m_cache[4];
+  };
+}
@@ -20,6 +20,7 @@
 #include "gePrerequisitesUtil.h"
 #include "geVector4.h"
 #include "geBox.h"
+#include "geBox2D.h"
 #include "geSphere.h"
 
 #define SIMDPP_ARCH_X86_SSE4_1
@@ -105,5 +106,58 @@ namespace geEngineSDK {
        */
       SIMDPP_ALIGN(16) Vector4 m_extents;
     };
+
+    /**
+     * @brief Version of geEngineSDK::Box2D suitable for SIMD use. The center
+     *        and the extents are packed in a single 16-byte aligned vector.
+     */
+    struct Box2D
+    {
+      Box2D() {}
+
+      /**
+       * @brief Initializes bounds from a Box2D.
+       */
+      Box2D(const geEngineSDK::Box2D& box) {
+        box.getCenterAndExtents(m_center, m_extents);
+      }
+
+      /**
+       * @brief Initializes bounds from a vector representing the center and
+       *        equal extents in both directions.
+       */
+      Box2D(const Vector2& center, float extent)
+        : m_center(center),
+          m_extents(extent, extent)
+      {}
+
+      /**
+       * @brief Returns true if the current bounds object intersects the
+       *        provided object.
+       */
+      bool
+      intersect(const Box2D& other) const {
+        auto myBounds = load<float32x4>(&m_center);
+        auto otherBounds = load<float32x4>(&other.m_center);
+
+        //Distance between the centers in X and Y. The difference between the
+        //extents in Z and W is never larger than their sum, so it never fails
+        float32x4 diff = abs(sub(myBounds, otherBounds));
+        float32x4 extents = permute4<2, 3, 2, 3>(add(myBounds, otherBounds));
+
+        return test_bits_any(bit_cast<uint32x4>(cmp_gt(diff, extents))) == false;
+      }
+
+      /**
+       * @brief Center of the bounds, followed by the extents in the same
+       *        vector.
+       */
+      SIMDPP_ALIGN(16) Vector2 m_center;
+
+      /**
+       * @brief Extents (half-size) of the bounds.
+       */
+      Vector2 m_extents;
+    };
   }
 }
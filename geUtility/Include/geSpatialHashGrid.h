@@ -0,0 +1,801 @@
+/*****************************************************************************/
+/**
+ * @file    geSpatialHashGrid.h
+ * @author  Samuel Prince (samuel.prince.quezada@gmail.com)
+ * @date    2018/07/14
+ * @brief   Uniform grid of hashed cells for small, dynamic objects.
+ *
+ * Uniform grid that divides space in cubic cells of the same size and only
+ * stores the cells that contain elements, in open addressed hash tables.
+ * Unlike the Octree there are no nodes to split or collapse, so elements that
+ * move every frame are cheap to update.
+ *
+ * @bug     No known bugs.
+ */
+/*****************************************************************************/
+#pragma once
+
+/*****************************************************************************/
+/**
+ * Includes
+ */
+/*****************************************************************************/
+#include "gePrerequisitesUtil.h"
+#include "geMath.h"
+#include "geSIMD.h"
+#include "geTaskScheduler.h"
+
+namespace geEngineSDK {
+  /**
+   * @brief Identifier that may be used for finding an element in the grid.
+   */
+  class SpatialHashGridElementId
+  {
+   public:
+    SpatialHashGridElementId() = default;
+
+    explicit SpatialHashGridElementId(uint32 elementIdx)
+      : m_elementIdx(elementIdx)
+    {}
+
+   private:
+    template<class, class>
+    friend class SpatialHashGrid;
+
+    uint32 m_elementIdx = 0u;
+  };
+
+  /**
+   * @brief Uniform spatial hash grid for 3D space. A lighter alternative to
+   *        the Octree for large numbers of small elements that move often,
+   *        such as particles, projectiles or crowd agents. Elements are
+   *        referenced by every cell their bounds touch, so they should be
+   *        about the size of a cell or smaller.
+   * @tparam  ElemType  Type of elements to be stored in the grid.
+   * @tparam  Options   Class that controls various options of the grid.
+   *          It must provide the following methods:
+   *          - "static AABox getBounds(const ElemType&, void*)"
+   *            Returns the bounds for the provided element.
+   *          - "static void setElementId(const ElemType&,
+   *            const SpatialHashGridElementId&, void*)"
+   *            Gets called when element's ID is first assigned or subsequently
+   *            modified.
+   * @note    All const methods only read from the grid, so any number of
+   *          threads may query it at once without locking, as long as no
+   *          thread modifies it at the same time.
+   */
+  template<class ElemType, class Options>
+  class SpatialHashGrid
+  {
+    static constexpr uint64 EMPTY_KEY = ~static_cast<uint64>(0);
+
+    /**
+     * @brief Number of bits used by each cell coordinate in a key. Cells
+     *        past this range are clamped to the outermost cells.
+     */
+    static constexpr uint32 COORD_BITS = 21;
+    static constexpr int32 MAX_COORD = (1 << (COORD_BITS - 1)) - 1;
+
+    /**
+     * @brief Cell entries hold the element index in the low bits, and flags
+     *        marking the cells that are the first ones touched by the element
+     *        along each axis in the high bits.
+     */
+    static constexpr uint32 FIRST_CELL_X = 1U << 31;
+    static constexpr uint32 FIRST_CELL_Y = 1U << 30;
+    static constexpr uint32 FIRST_CELL_Z = 1U << 29;
+    static constexpr uint32 ENTRY_INDEX_MASK = FIRST_CELL_Z - 1;
+
+    /**
+     * @brief Number of entries a cell stores without allocating memory.
+     */
+    static constexpr uint32 LOCAL_CELL_ENTRIES = 4;
+
+    static constexpr uint32 NUM_TABLES = 16;
+    static constexpr uint32 MIN_TABLE_SIZE = 16;
+    static constexpr SIZE_T BUILD_RANGE_ELEMENTS = 16384;
+
+    /**
+     * @brief Range of cells touched by the bounds of an element, inclusive.
+     */
+    struct CellRange
+    {
+      int32 minX, minY, minZ;
+      int32 maxX, maxY, maxZ;
+
+      bool
+      operator==(const CellRange& rhs) const {
+        return minX == rhs.minX && minY == rhs.minY && minZ == rhs.minZ &&
+               maxX == rhs.maxX && maxY == rhs.maxY && maxZ == rhs.maxZ;
+      }
+
+      bool
+      contains(int32 x, int32 y, int32 z) const {
+        return x >= minX && x <= maxX &&
+               y >= minY && y <= maxY &&
+               z >= minZ && z <= maxZ;
+      }
+    };
+
+    /**
+     * @brief A single occupied cell. Most cells only reference a few
+     *        elements, which are stored in the cell itself, larger cells
+     *        allocate their entries. Cells are moved around the table as raw
+     *        bytes.
+     */
+    struct Cell
+    {
+      uint32*
+      getEntries() {
+        return capacity > LOCAL_CELL_ENTRIES ? heapEntries : localEntries;
+      }
+
+      const uint32*
+      getEntries() const {
+        return capacity > LOCAL_CELL_ENTRIES ? heapEntries : localEntries;
+      }
+
+      uint64 key = EMPTY_KEY;
+      uint32 count = 0;
+      uint32 capacity = LOCAL_CELL_ENTRIES;
+      union
+      {
+        uint32 localEntries[LOCAL_CELL_ENTRIES];
+        uint32* heapEntries;
+      };
+    };
+
+    /**
+     * @brief Open addressed (linear probing) table of cells. The cells are
+     *        split among several tables by hash, so the tables can be filled
+     *        in parallel.
+     */
+    struct CellTable
+    {
+      Vector<Cell> cells;
+      uint32 count = 0;
+    };
+
+   public:
+    /**
+     * @brief Constructs an empty grid.
+     * @param[in] cellSize  Size of the cells in all directions. Works best
+     *            around the size of the typical query, as long as elements
+     *            only touch a few cells.
+     * @param[in] context   Optional user context that will be passed along to
+     *            getBounds() and setElementId() methods on the provided
+     *            Options class.
+     */
+    explicit SpatialHashGrid(float cellSize, void* context = nullptr)
+      : m_cellSize(cellSize),
+        m_invCellSize(1.0f / cellSize),
+        m_context(context) {
+      GE_ASSERT(cellSize > 0.0f);
+    }
+
+    SpatialHashGrid(const SpatialHashGrid&) = delete;
+
+    SpatialHashGrid&
+    operator=(const SpatialHashGrid&) = delete;
+
+    ~SpatialHashGrid() {
+      clear();
+    }
+
+    /**
+     * @brief Returns the size of the cells.
+     */
+    float
+    getCellSize() const {
+      return m_cellSize;
+    }
+
+    /**
+     * @brief Returns the number of elements in the grid.
+     */
+    uint32
+    getNumElements() const {
+      return static_cast<uint32>(m_elements.size());
+    }
+
+    /**
+     * @brief Returns the number of cells holding at least one element.
+     */
+    uint32
+    getNumCells() const {
+      uint32 count = 0;
+      for (auto& table : m_tables) {
+        count += table.count;
+      }
+      return count;
+    }
+
+    /**
+     * @brief Adds a new element to the grid.
+     */
+    void
+    addElement(const ElemType& elem) {
+      const uint32 elementIdx = static_cast<uint32>(m_elements.size());
+      GE_ASSERT(elementIdx <= ENTRY_INDEX_MASK);
+
+      const simd::AABox bounds = Options::getBounds(elem, m_context);
+      const CellRange range = getCellRange(bounds);
+
+      m_elements.push_back(elem);
+      m_bounds.push_back(bounds);
+      m_ranges.push_back(range);
+
+      forEachCell(range, [&](int32 x, int32 y, int32 z) {
+        pushEntry(findOrAddCell(packKey(x, y, z)), makeEntry(elementIdx, range, x, y, z));
+      });
+
+      Options::setElementId(elem, SpatialHashGridElementId(elementIdx), m_context);
+    }
+
+    /**
+     * @brief Removes an existing element from the grid. The last element
+     *        takes the place of the removed one, so its ID changes (reported
+     *        through Options::setElementId() as usual).
+     */
+    void
+    removeElement(const SpatialHashGridElementId& elemId) {
+      const uint32 elementIdx = elemId.m_elementIdx;
+      const uint32 lastIdx = static_cast<uint32>(m_elements.size()) - 1;
+
+      forEachCell(m_ranges[elementIdx], [&](int32 x, int32 y, int32 z) {
+        removeFromCell(packKey(x, y, z), elementIdx);
+      });
+
+      if (elementIdx != lastIdx) {
+        forEachCell(m_ranges[lastIdx], [&](int32 x, int32 y, int32 z) {
+          uint32& entry = findEntry(packKey(x, y, z), lastIdx);
+          entry = (entry & ~ENTRY_INDEX_MASK) | elementIdx;
+        });
+
+        m_elements[elementIdx] = m_elements[lastIdx];
+        m_bounds[elementIdx] = m_bounds[lastIdx];
+        m_ranges[elementIdx] = m_ranges[lastIdx];
+
+        Options::setElementId(m_elements[elementIdx],
+                              SpatialHashGridElementId(elementIdx),
+                              m_context);
+      }
+
+      m_elements.pop_back();
+      m_bounds.pop_back();
+      m_ranges.pop_back();
+    }
+
+    /**
+     * @brief Updates an element after its bounds changed. If the element
+     *        still touches the same cells only the stored bounds are
+     *        refreshed, otherwise it's only removed from the cells it left
+     *        and added to the cells it entered. The element ID doesn't
+     *        change.
+     */
+    void
+    updateElement(const SpatialHashGridElementId& elemId) {
+      const uint32 elementIdx = elemId.m_elementIdx;
+      const simd::AABox bounds = Options::getBounds(m_elements[elementIdx], m_context);
+      const CellRange range = getCellRange(bounds);
+
+      m_bounds[elementIdx] = bounds;
+
+      const CellRange oldRange = m_ranges[elementIdx];
+      if (range == oldRange) {
+        return;
+      }
+
+      const bool firstCellMoved = range.minX != oldRange.minX ||
+                                  range.minY != oldRange.minY ||
+                                  range.minZ != oldRange.minZ;
+
+      forEachCell(oldRange, [&](int32 x, int32 y, int32 z) {
+        if (!range.contains(x, y, z)) {
+          removeFromCell(packKey(x, y, z), elementIdx);
+        }
+        else if (firstCellMoved) {
+          findEntry(packKey(x, y, z), elementIdx) = makeEntry(elementIdx, range, x, y, z);
+        }
+      });
+
+      forEachCell(range, [&](int32 x, int32 y, int32 z) {
+        if (!oldRange.contains(x, y, z)) {
+          pushEntry(findOrAddCell(packKey(x, y, z)), makeEntry(elementIdx, range, x, y, z));
+        }
+      });
+
+      m_ranges[elementIdx] = range;
+    }
+
+    /**
+     * @brief Removes all elements from the grid.
+     */
+    void
+    clear() {
+      m_elements.clear();
+      m_bounds.clear();
+      m_ranges.clear();
+
+      for (auto& table : m_tables) {
+        for (auto& cell : table.cells) {
+          releaseEntries(cell);
+        }
+
+        table.cells.clear();
+        table.count = 0;
+      }
+    }
+
+    /**
+     * @brief Replaces the contents of the grid with a set of elements. The
+     *        elements receive IDs in the order they are provided.
+     *        If the TaskScheduler is running the element bounds are calculated
+     *        and the cell tables are filled on its worker threads, so
+     *        Options::getBounds() must be safe to call concurrently.
+     *        Options::setElementId() is only called from the calling thread.
+     * @param[in] elements  Elements to add.
+     * @param[in] count     Number of entries in @p elements.
+     */
+    void
+    build(const ElemType* elements, SIZE_T count);
+
+    /**
+     * @brief Calls @p func once for each element whose bounds intersect
+     *        @p bounds.
+     */
+    template<class Func>
+    void
+    forEachIntersecting(const AABox& bounds, Func func) const {
+      const simd::AABox query(bounds);
+
+      forEachInRange(getCellRange(query), [&](uint32 elementIdx) {
+        if (m_bounds[elementIdx].intersect(query)) {
+          func(m_elements[elementIdx]);
+        }
+      });
+    }
+
+    /**
+     * @brief Finds all elements whose bounds are within the specified
+     *        distance of a point. Same as Octree::findWithinRadius().
+     * @param[in]  point    Point to measure the distance from.
+     * @param[in]  radius   Maximum distance from the point to the element
+     *             bounds.
+     * @param[out] output   Buffer receiving the elements, in no particular
+     *             order.
+     * @param[in]  capacity Number of elements @p output can hold.
+     * @return Number of elements within the radius. If larger than
+     *         @p capacity only the first @p capacity elements were written.
+     */
+    SIZE_T
+    findWithinRadius(const Vector3& point,
+                     float radius,
+                     ElemType* output,
+                     SIZE_T capacity) const {
+      const float radiusSquared = radius * radius;
+      SIZE_T count = 0;
+
+      forEachInRange(getCellRange(simd::AABox(point, radius)), [&](uint32 elementIdx) {
+        const simd::AABox& bounds = m_bounds[elementIdx];
+
+        //Distance from the point to the closest point of the box
+        const float dx = Math::max(Math::abs(point.x - bounds.m_center.x) -
+                                   bounds.m_extents.x, 0.0f);
+        const float dy = Math::max(Math::abs(point.y - bounds.m_center.y) -
+                                   bounds.m_extents.y, 0.0f);
+        const float dz = Math::max(Math::abs(point.z - bounds.m_center.z) -
+                                   bounds.m_extents.z, 0.0f);
+
+        if (dx * dx + dy * dy + dz * dz <= radiusSquared) {
+          if (count < capacity) {
+            output[count] = m_elements[elementIdx];
+          }
+          ++count;
+        }
+      });
+
+      return count;
+    }
+
+   private:
+    /**
+     * @brief Returns the cell coordinate a position falls in.
+     */
+    int32
+    getCellCoord(float position) const {
+      const float cell = Math::floorFloat(position * m_invCellSize);
+      return static_cast<int32>(Math::clamp(cell,
+                                            static_cast<float>(-MAX_COORD),
+                                            static_cast<float>(MAX_COORD)));
+    }
+
+    /**
+     * @brief Returns the range of cells touched by a box.
+     */
+    CellRange
+    getCellRange(const simd::AABox& bounds) const {
+      const Vector4& center = bounds.m_center;
+      const Vector4& extents = bounds.m_extents;
+
+      CellRange range;
+      range.minX = getCellCoord(center.x - extents.x);
+      range.minY = getCellCoord(center.y - extents.y);
+      range.minZ = getCellCoord(center.z - extents.z);
+      range.maxX = getCellCoord(center.x + extents.x);
+      range.maxY = getCellCoord(center.y + extents.y);
+      range.maxZ = getCellCoord(center.z + extents.z);
+      return range;
+    }
+
+    template<class Func>
+    static void
+    forEachCell(const CellRange& range, Func func) {
+      for (int32 z = range.minZ; z <= range.maxZ; ++z) {
+        for (int32 y = range.minY; y <= range.maxY; ++y) {
+          for (int32 x = range.minX; x <= range.maxX; ++x) {
+            func(x, y, z);
+          }
+        }
+      }
+    }
+
+    /**
+     * @brief Returns the entry of an element in one of the cells it touches.
+     */
+    static uint32
+    makeEntry(uint32 elementIdx, const CellRange& range, int32 x, int32 y, int32 z) {
+      return elementIdx |
+             (x == range.minX ? FIRST_CELL_X : 0) |
+             (y == range.minY ? FIRST_CELL_Y : 0) |
+             (z == range.minZ ? FIRST_CELL_Z : 0);
+    }
+
+    /**
+     * @brief Calls @p func once for each element referenced by the cells in
+     *        @p range. Elements touching several of the cells are only
+     *        reported by the first of them inside of the range.
+     */
+    template<class Func>
+    void
+    forEachInRange(const CellRange& range, Func func) const {
+      auto visitCell = [&](const Cell& cell, int32 x, int32 y, int32 z) {
+        //Along each axis, the cells first touched by both the element and
+        //the range are the first cell of one of the two
+        const uint32 firstInRange = (x == range.minX ? FIRST_CELL_X : 0) |
+                                    (y == range.minY ? FIRST_CELL_Y : 0) |
+                                    (z == range.minZ ? FIRST_CELL_Z : 0);
+        const uint32 allFirst = FIRST_CELL_X | FIRST_CELL_Y | FIRST_CELL_Z;
+
+        const uint32* entries = cell.getEntries();
+        for (uint32 i = 0; i < cell.count; ++i) {
+          if (allFirst == ((entries[i] | firstInRange) & allFirst)) {
+            func(entries[i] & ENTRY_INDEX_MASK);
+          }
+        }
+      };
+
+      const uint64 numRangeCells = static_cast<uint64>(range.maxX - range.minX + 1) *
+                                   static_cast<uint64>(range.maxY - range.minY + 1) *
+                                   static_cast<uint64>(range.maxZ - range.minZ + 1);
+
+      //Large queries walk the occupied cells instead of the empty ones
+      if (numRangeCells > getNumCells()) {
+        for (auto& table : m_tables) {
+          for (auto& cell : table.cells) {
+            if (EMPTY_KEY == cell.key) {
+              continue;
+            }
+
+            int32 x, y, z;
+            unpackKey(cell.key, x, y, z);
+            if (range.contains(x, y, z)) {
+              visitCell(cell, x, y, z);
+            }
+          }
+        }
+
+        return;
+      }
+
+      forEachCell(range, [&](int32 x, int32 y, int32 z) {
+        const Cell* cell = findCell(packKey(x, y, z));
+        if (cell) {
+          visitCell(*cell, x, y, z);
+        }
+      });
+    }
+
+    static uint64
+    packKey(int32 x, int32 y, int32 z) {
+      const uint64 mask = (static_cast<uint64>(1) << COORD_BITS) - 1;
+      return ((static_cast<uint64>(x) & mask) << (COORD_BITS * 2)) |
+             ((static_cast<uint64>(y) & mask) << COORD_BITS) |
+             (static_cast<uint64>(z) & mask);
+    }
+
+    static void
+    unpackKey(uint64 key, int32& x, int32& y, int32& z) {
+      //Shift the coordinate to the top of the word, then back with sign
+      const uint32 unusedBits = 64 - COORD_BITS;
+      x = static_cast<int32>(static_cast<int64>(key << (unusedBits - COORD_BITS * 2)) >> unusedBits);
+      y = static_cast<int32>(static_cast<int64>(key << (unusedBits - COORD_BITS)) >> unusedBits);
+      z = static_cast<int32>(static_cast<int64>(key << unusedBits) >> unusedBits);
+    }
+
+    static uint64
+    hashKey(uint64 key) {
+      return key * 0x9E3779B97F4A7C15ULL;
+    }
+
+    /**
+     * @brief Returns the table a key belongs to, using the top bits of its
+     *        hash. The rest of the hash picks the slot within the table.
+     */
+    static uint32
+    getTableIndex(uint64 hash) {
+      return static_cast<uint32>(hash >> 60);
+    }
+
+    const Cell*
+    findCell(uint64 key) const {
+      const uint64 hash = hashKey(key);
+      const CellTable& table = m_tables[getTableIndex(hash)];
+      if (table.cells.empty()) {
+        return nullptr;
+      }
+
+      const uint32 mask = static_cast<uint32>(table.cells.size()) - 1;
+      for (uint32 slot = static_cast<uint32>(hash >> 28) & mask; ; slot = (slot + 1) & mask) {
+        const Cell& cell = table.cells[slot];
+        if (cell.key == key) {
+          return &cell;
+        }
+
+        if (EMPTY_KEY == cell.key) {
+          return nullptr;
+        }
+      }
+    }
+
+    Cell*
+    findCell(uint64 key) {
+      return const_cast<Cell*>(static_cast<const SpatialHashGrid*>(this)->findCell(key));
+    }
+
+    /**
+     * @brief Returns the entry of an element in a cell it touches.
+     */
+    uint32&
+    findEntry(uint64 key, uint32 elementIdx) {
+      Cell* cell = findCell(key);
+      uint32* entries = cell->getEntries();
+
+      uint32 i = 0;
+      while ((entries[i] & ENTRY_INDEX_MASK) != elementIdx) {
+        ++i;
+      }
+
+      return entries[i];
+    }
+
+    static void
+    pushEntry(Cell& cell, uint32 entry) {
+      if (cell.count == cell.capacity) {
+        const uint32 newCapacity = cell.capacity * 2;
+        uint32* newEntries = reinterpret_cast<uint32*>(ge_alloc(newCapacity * sizeof(uint32)));
+        memcpy(newEntries, cell.getEntries(), cell.count * sizeof(uint32));
+
+        releaseEntries(cell);
+        cell.heapEntries = newEntries;
+        cell.capacity = newCapacity;
+      }
+
+      cell.getEntries()[cell.count++] = entry;
+    }
+
+    static void
+    releaseEntries(Cell& cell) {
+      if (cell.capacity > LOCAL_CELL_ENTRIES) {
+        ge_free(cell.heapEntries);
+        cell.capacity = LOCAL_CELL_ENTRIES;
+      }
+    }
+
+    /**
+     * @brief Finds the cell with the specified key, inserting an empty one if
+     *        it doesn't exist.
+     */
+    Cell&
+    findOrAddCell(uint64 key) {
+      return findOrAddCell(m_tables[getTableIndex(hashKey(key))], key);
+    }
+
+    static Cell&
+    findOrAddCell(CellTable& table, uint64 key) {
+      //Keep the table at most half full so probe sequences stay short
+      if ((table.count + 1) * 2 > table.cells.size()) {
+        growTable(table);
+      }
+
+      const uint32 mask = static_cast<uint32>(table.cells.size()) - 1;
+      for (uint32 slot = static_cast<uint32>(hashKey(key) >> 28) & mask; ;
+           slot = (slot + 1) & mask) {
+        Cell& cell = table.cells[slot];
+        if (cell.key == key) {
+          return cell;
+        }
+
+        if (EMPTY_KEY == cell.key) {
+          cell.key = key;
+          ++table.count;
+          return cell;
+        }
+      }
+    }
+
+    static void
+    growTable(CellTable& table) {
+      const SIZE_T newSize = Math::max(table.cells.size() * 2,
+                                       static_cast<SIZE_T>(MIN_TABLE_SIZE));
+
+      Vector<Cell> oldCells(newSize);
+      table.cells.swap(oldCells);
+
+      const uint32 mask = static_cast<uint32>(newSize) - 1;
+      for (auto& oldCell : oldCells) {
+        if (EMPTY_KEY == oldCell.key) {
+          continue;
+        }
+
+        uint32 slot = static_cast<uint32>(hashKey(oldCell.key) >> 28) & mask;
+        while (EMPTY_KEY != table.cells[slot].key) {
+          slot = (slot + 1) & mask;
+        }
+
+        table.cells[slot] = oldCell;
+      }
+    }
+
+    /**
+     * @brief Removes an element from a cell, and the cell from its table once
+     *        it's empty.
+     */
+    void
+    removeFromCell(uint64 key, uint32 elementIdx) {
+      CellTable& table = m_tables[getTableIndex(hashKey(key))];
+      Cell* cell = findCell(key);
+
+      uint32& entry = findEntry(key, elementIdx);
+      entry = cell->getEntries()[--cell->count];
+
+      if (0 != cell->count) {
+        return;
+      }
+
+      releaseEntries(*cell);
+
+      //Shift back the cells that probed past the removed one, so lookups
+      //don't need tombstones
+      const uint32 mask = static_cast<uint32>(table.cells.size()) - 1;
+      uint32 hole = static_cast<uint32>(cell - table.cells.data());
+      for (uint32 slot = (hole + 1) & mask; EMPTY_KEY != table.cells[slot].key;
+           slot = (slot + 1) & mask) {
+        Cell& next = table.cells[slot];
+        const uint32 home = static_cast<uint32>(hashKey(next.key) >> 28) & mask;
+
+        //Move the cell only if the hole lies between its home slot and it
+        if (((slot - home) & mask) >= ((slot - hole) & mask)) {
+          table.cells[hole] = next;
+          hole = slot;
+        }
+      }
+
+      table.cells[hole] = Cell();
+      --table.count;
+    }
+
+    /**
+     * @brief Calls @p func with consecutive ranges covering [0, count), on
+     *        the TaskScheduler workers if it's running and there is enough
+     *        work, otherwise on the calling thread. Ranges are never smaller
+     *        than @p minRangeSize, except for the last one.
+     */
+    template<class Func>
+    static void
+    parallelFor(SIZE_T count, SIZE_T minRangeSize, Func func) {
+      if (count <= minRangeSize || !TaskScheduler::isStarted()) {
+        func(0, count);
+        return;
+      }
+
+      //A few ranges per worker, so uneven ranges even out
+      const SIZE_T numRanges = TaskScheduler::instance().getNumWorkers() * 4;
+      const SIZE_T rangeSize = std::max(minRangeSize,
+                                        Math::divideAndRoundUp(count, numRanges));
+
+      //The calling thread takes care of the first range
+      Vector<SPtr<Task>> tasks;
+      for (SIZE_T first = rangeSize; first < count; first += rangeSize) {
+        const SIZE_T last = std::min(first + rangeSize, count);
+        tasks.push_back(Task::create("SpatialHashGrid", [&func, first, last]() {
+          func(first, last);
+        }));
+
+        TaskScheduler::instance().addTask(tasks.back());
+      }
+
+      func(0, rangeSize);
+
+      for (auto& task : tasks) {
+        task->wait();
+      }
+    }
+
+    Vector<ElemType> m_elements;
+    Vector<simd::AABox> m_bounds;
+    Vector<CellRange> m_ranges;
+    CellTable m_tables[NUM_TABLES];
+
+    float m_cellSize;
+    float m_invCellSize;
+    void* m_context;
+  };
+
+  template<class ElemType, class Options>
+  void
+  SpatialHashGrid<ElemType, Options>::build(const ElemType* elements, SIZE_T count) {
+    struct CellEntry
+    {
+      uint64 key;
+      uint32 entry;
+    };
+
+    GE_ASSERT(count <= ENTRY_INDEX_MASK);
+    clear();
+
+    m_elements.assign(elements, elements + count);
+    m_bounds.resize(count);
+    m_ranges.resize(count);
+
+    //Each block of elements sorts its cell entries by table, so every table
+    //can then be filled by a single thread, in element order
+    const SIZE_T numBlocks = Math::divideAndRoundUp(count, BUILD_RANGE_ELEMENTS);
+    Vector<Vector<CellEntry>> blockEntries(numBlocks * NUM_TABLES);
+
+    parallelFor(numBlocks, 1, [&](SIZE_T firstBlock, SIZE_T lastBlock) {
+      for (SIZE_T block = firstBlock; block < lastBlock; ++block) {
+        const SIZE_T first = block * BUILD_RANGE_ELEMENTS;
+        const SIZE_T last = std::min(first + BUILD_RANGE_ELEMENTS, count);
+
+        for (SIZE_T i = first; i < last; ++i) {
+          m_bounds[i] = Options::getBounds(elements[i], m_context);
+          m_ranges[i] = getCellRange(m_bounds[i]);
+
+          forEachCell(m_ranges[i], [&](int32 x, int32 y, int32 z) {
+            const uint64 key = packKey(x, y, z);
+            blockEntries[block * NUM_TABLES + getTableIndex(hashKey(key))].push_back(
+              { key, makeEntry(static_cast<uint32>(i), m_ranges[i], x, y, z) });
+          });
+        }
+      }
+    });
+
+    parallelFor(NUM_TABLES, 1, [&](SIZE_T firstTable, SIZE_T lastTable) {
+      for (SIZE_T tableIdx = firstTable; tableIdx < lastTable; ++tableIdx) {
+        CellTable& table = m_tables[tableIdx];
+        for (SIZE_T block = 0; block < numBlocks; ++block) {
+          for (auto& entry : blockEntries[block * NUM_TABLES + tableIdx]) {
+            pushEntry(findOrAddCell(table, entry.key), entry.entry);
+          }
+        }
+      }
+    });
+
+    for (SIZE_T i = 0; i < count; ++i) {
+      Options::setElementId(m_elements[i],
+                            SpatialHashGridElementId(static_cast<uint32>(i)),
+                            m_context);
+    }
+  }
+}
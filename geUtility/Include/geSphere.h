@@ -21,6 +21,8 @@
 #include "geVector3.h"
 
 namespace geEngineSDK {
+  class Vector3Stream;
+
   /**
    * @brief Implements a basic sphere.
    */
@@ -55,6 +57,12 @@ namespace geEngineSDK {
      */
     GE_UTILITY_EXPORT Sphere(const Vector3* Pts, SIZE_T Count);
 
+    /**
+     * @brief Constructor.
+     * @param Pts Stream of points this sphere must contain.
+     */
+    GE_UTILITY_EXPORT explicit Sphere(const Vector3Stream& Pts);
+
    public:
     /**
      * @brief Check whether two spheres are the same within specified tolerance.
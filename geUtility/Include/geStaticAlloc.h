@@ -151,7 +151,7 @@ namespace geEngineSDK {
       SIZE_T* storedSize = reinterpret_cast<SIZE_T*>(dataPtr);
       m_totalAllocBytes -= *storedSize;
 #endif
-      if (data > m_staticData && data < (m_staticData + BlockSize)) {
+      if (data >= m_staticData && data < (m_staticData + BlockSize)) {
         if (((reinterpret_cast<uint8*>(data)) + allocSize) == (m_staticData + m_freePtr)) {
           m_freePtr -= allocSize;
         }
@@ -319,7 +319,7 @@ namespace geEngineSDK {
      */
     void
     deallocate(T* p, size_t num) const _NOEXCEPT {
-      m_staticAlloc->free(reinterpret_cast<uint8*>(p), num);
+      m_staticAlloc->free(reinterpret_cast<uint8*>(p), num * sizeof(T));
     }
 
     StaticAlloc<BlockSize, FreeAlloc>* m_staticAlloc = nullptr;
@@ -323,6 +323,15 @@ namespace geEngineSDK {
       return StringFormat::format(source, forward<Args>(args)...);
     }
 
+    /**
+     * @copydoc StringFormat::format
+     */
+    template<class T, SIZE_T N, class... Args>
+    static BasicString<T>
+    format(const CompiledFormat<T, N>& source, Args&&... args) {
+      return StringFormat::format(source, forward<Args>(args)...);
+    }
+
     /**
      * @brief Constant blank string, useful for returning by ref where local does not exist.
      */
@@ -18,6 +18,7 @@
  */
 /*****************************************************************************/
 #include "geNumericLimits.h"
+#include "geFrameAlloc.h"
 
 namespace geEngineSDK {
   using std::forward;
@@ -28,6 +29,163 @@ namespace geEngineSDK {
   using std::to_wstring;
   using std::is_same;
 
+  /**
+   * @brief Part of a parsed format string: literal text, or a reference to
+   *        a parameter.
+   */
+  struct FormatSegment
+  {
+    static constexpr uint32 NO_PARAM = 0xFFFFFFFF;
+
+    uint32 start = 0;
+    uint32 length = 0;
+    uint32 paramIdx = NO_PARAM;
+  };
+
+  /**
+   * @brief Parses format strings, at compile time for CompiledFormat or
+   *        while formatting for StringFormat::format().
+   */
+  struct FormatParser
+  {
+    static constexpr uint32 MAX_PARAMS = 20;
+    static constexpr uint32 MAX_IDENTIFIER_SIZE = 2;
+
+    /**
+     * @brief Calls visitor.literal(start, length) for each run of literal
+     *        text and visitor.param(index) for each parameter identifier,
+     *        in order.
+     */
+    template<class T, class Visitor>
+    static constexpr void
+    parse(const T* source, SIZE_T length, Visitor& visitor) {
+      SIZE_T runStart = 0;
+      SIZE_T runLength = 0;
+
+      SIZE_T i = 0;
+      while (i < length) {
+        SIZE_T literalStart = i;
+        SIZE_T literalLength = 1;
+
+        if (T('\\') == source[i]) {
+          //The escaped character is kept as is, the backslash is dropped
+          literalStart = i + 1;
+          literalLength = i + 1 < length ? 1 : 0;
+          i += 2;
+        }
+        else if (T('{') == source[i]) {
+          SIZE_T end = i + 1;
+          uint32 paramIdx = 0;
+          uint32 numDigits = 0;
+          while (end < length &&
+                 MAX_IDENTIFIER_SIZE > numDigits &&
+                 T('0') <= source[end] && T('9') >= source[end]) {
+            paramIdx = paramIdx * 10 + static_cast<uint32>(source[end] - T('0'));
+            ++numDigits;
+            ++end;
+          }
+
+          if (0 < numDigits && end < length && T('}') == source[end] && MAX_PARAMS > paramIdx) {
+            if (0 < runLength) {
+              visitor.literal(runStart, runLength);
+              runLength = 0;
+            }
+            visitor.param(paramIdx);
+            i = end + 1;
+            continue;
+          }
+
+          //Not an identifier, the text up to the character that ended it is kept
+          literalLength = (end < length ? end + 1 : end) - i;
+          i += literalLength;
+        }
+        else {
+          ++i;
+        }
+
+        if (0 < runLength && runStart + runLength == literalStart) {
+          runLength += literalLength;
+        }
+        else {
+          if (0 < runLength) {
+            visitor.literal(runStart, runLength);
+          }
+          runStart = literalStart;
+          runLength = literalLength;
+        }
+      }
+
+      if (0 < runLength) {
+        visitor.literal(runStart, runLength);
+      }
+    }
+  };
+
+  /**
+   * @brief A format string parsed at compile time. Create it from a string
+   *        literal with GE_FORMAT_STRING, and pass it to StringFormat in
+   *        place of the string.
+   */
+  template<class T, SIZE_T N>
+  class CompiledFormat
+  {
+   private:
+    struct SegmentCollector
+    {
+      constexpr void
+      literal(SIZE_T start, SIZE_T length) {
+        segments[numSegments++] = FormatSegment{ static_cast<uint32>(start),
+                                                 static_cast<uint32>(length),
+                                                 FormatSegment::NO_PARAM };
+      }
+
+      constexpr void
+      param(uint32 paramIdx) {
+        segments[numSegments++] = FormatSegment{ 0, 0, paramIdx };
+      }
+
+      FormatSegment* segments;
+      uint32& numSegments;
+    };
+
+   public:
+    constexpr explicit CompiledFormat(const T (&source)[N]) {
+      for (SIZE_T i = 0; i < N; ++i) {
+        m_source[i] = source[i];
+      }
+
+      SegmentCollector collector{ m_segments, m_numSegments };
+      FormatParser::parse(source, N - 1, collector);
+    }
+
+    T m_source[N] = {};
+
+    /**
+     * @brief Every segment uses at least a character of the source.
+     */
+    FormatSegment m_segments[N] = {};
+    uint32 m_numSegments = 0;
+  };
+
+  /**
+   * @brief Parses a format string at compile time.
+   */
+  template<class T, SIZE_T N>
+  constexpr CompiledFormat<T, N>
+  compileFormat(const T (&source)[N]) {
+    return CompiledFormat<T, N>(source);
+  }
+
+/**
+ * Parses a format string literal at compile time, and returns the resulting
+ * CompiledFormat, stored once for the whole program.
+ */
+#define GE_FORMAT_STRING(str)                                                 \
+  ([]() -> const auto& {                                                      \
+    static constexpr auto compiledFormat = ::geEngineSDK::compileFormat(str); \
+    return compiledFormat;                                                    \
+  }())
+
   /**
    * @class StringFormat
    * @brief Helper class used for string formatting operations
@@ -36,28 +194,77 @@ namespace geEngineSDK {
   {
    private:
     /**
-     * @brief Data structure used during string formatting. It holds information
-     *        about parameter identifiers to replace with actual parameters.
+     * @brief Output of a formatting operation. Counts every character, but
+     *        only writes the ones that fit.
      */
-    struct FormatParamRange
+    template<class T>
+    struct FormatBuffer
     {
-      FormatParamRange() = default;
-      FormatParamRange(SIZE_T start, uint32 identifierSize, uint32 paramIdx) :
-        m_start(start), m_identifierSize(identifierSize), m_paramIdx(paramIdx) {}
+      void
+      append(const T* chars, SIZE_T count) {
+        if (m_length < m_capacity) {
+          const SIZE_T numWritten = std::min(count, m_capacity - m_length);
+          memcpy(m_data + m_length, chars, numWritten * sizeof(T));
+        }
+        m_length += count;
+      }
 
-      SIZE_T m_start = 0;
-      uint32 m_identifierSize = 0;
-      uint32 m_paramIdx = 0;
+      void
+      appendNarrow(const ANSICHAR* chars, SIZE_T count) {
+        for (SIZE_T i = 0; i < count; ++i, ++m_length) {
+          if (m_length < m_capacity) {
+            m_data[m_length] = static_cast<T>(chars[i]);
+          }
+        }
+      }
+
+      T* m_data;
+      SIZE_T m_capacity;
+      SIZE_T m_length = 0;
     };
 
     /**
-     * @brief Structure that holds value of a parameter during string formatting.
+     * @brief A parameter to format, referenced along with the method that
+     *        writes it.
      */
     template<class T>
-    struct ParamData
+    struct FormatArg
     {
-      T* m_buffer = nullptr;
-      SIZE_T m_size = 0;
+      FormatArg() = default;
+
+      template<class P>
+      explicit FormatArg(const P& param)
+        : m_param(&param),
+          m_write(&writeParam<T, P>)
+      {}
+
+      const void* m_param = nullptr;
+      void (*m_write)(FormatBuffer<T>&, const void*) = nullptr;
+    };
+
+    /**
+     * @brief Writes the literal text and the parameters of a format string
+     *        parsed while formatting.
+     */
+    template<class T>
+    struct FormatWriter
+    {
+      void
+      literal(SIZE_T start, SIZE_T length) {
+        m_buffer.append(m_source + start, length);
+      }
+
+      void
+      param(uint32 paramIdx) {
+        if (paramIdx < m_numArgs) {
+          m_args[paramIdx].m_write(m_buffer, m_args[paramIdx].m_param);
+        }
+      }
+
+      FormatBuffer<T>& m_buffer;
+      const T* m_source;
+      const FormatArg<T>* m_args;
+      uint32 m_numArgs;
     };
 
    public:
@@ -70,340 +277,297 @@ namespace geEngineSDK {
      * @note  You may use "\" to escape ID brackets.
      * @note  Maximum ID number is 19 (for a total of 20 unique IDs.
      *        e.g. {20} won't be recognized as an Identifier).
-     * @note  Total number of parameters that can be referenced is 200.
+     * @note  Parameters are written straight to the output, which is only
+     *        allocated if longer than 255 characters.
      */
     template<class T, class... Args>
     static BasicString<T>
     format(const T* source, Args&&... args) {
-      //Get the length of the string
-      SIZE_T strLength = getLength(source);
-
-      //Create an array to store the parameters and fill it with the parameters sent
-      ParamData<T> parameters[MAX_PARAMS];
-      memset(parameters, 0, sizeof(parameters));
-      getParams(parameters, 0U, forward<Args>(args)...);
-
-      //Brackets characters plus NULL terminator
-      T bracketChars[MAX_IDENTIFIER_SIZE + 1];
-      uint32 bracketWriteIdx = 0;
-
-      FormatParamRange paramRanges[MAX_PARAM_REFERENCES];
-      memset(paramRanges, 0, sizeof(paramRanges));
-      SIZE_T paramRangeWriteIdx = 0;
-
-      //Determine parameter positions
-      int32 lastBracket = -1;
-      bool escaped = false;
-      SIZE_T charWriteIdx = 0;
-      for (SIZE_T i = 0; i < strLength; ++i) {
-        if ('\\' == source[i] && !escaped && MAX_PARAM_REFERENCES > paramRangeWriteIdx) {
-          escaped = true;
-          //TODO: Test -1 this with PS4 or change for MAX_UINT32
-          paramRanges[paramRangeWriteIdx++] = FormatParamRange(charWriteIdx,
-                                                               1,
-                                                               NumLimit::MAX_UINT32);
-          continue;
-        }
-
-        if (-1 == lastBracket) {
-          //If current char is non-escaped opening bracket start parameter definition
-          if ('{' == source[i] && !escaped) {
-            lastBracket = static_cast<int32>(i);
-          }
-          else {
-            ++charWriteIdx;
-          }
-        }
-        else {
-          if (isdigit(source[i]) && bracketWriteIdx < MAX_IDENTIFIER_SIZE) {
-            bracketChars[bracketWriteIdx++] = source[i];
-          }
-          else {
-            //If current char is non-escaped closing bracket end parameter definition
-            uint32 numParamChars = bracketWriteIdx;
-            bool processedBracket = false;
-            if ('}' == source[i] && 0 < numParamChars && !escaped)
-            {
-              bracketChars[bracketWriteIdx] = '\0';
-              uint32 paramIdx = strToInt(bracketChars);
-
-              //Check if exceeded maximum parameter limit
-              if (MAX_PARAMS > paramIdx && MAX_PARAM_REFERENCES > paramRangeWriteIdx) {
-                paramRanges[paramRangeWriteIdx++] = FormatParamRange(charWriteIdx,
-                                                                     numParamChars + 2,
-                                                                     paramIdx);
-                charWriteIdx += parameters[paramIdx].m_size;
-                processedBracket = true;
-              }
-            }
-
-            if (!processedBracket) {
-              //Last bracket wasn't really a parameter
-              for (uint32 j = static_cast<uint32>(lastBracket); j <= i; ++j) {
-                ++charWriteIdx;
-              }
-            }
-
-            lastBracket = -1;
-            bracketWriteIdx = 0;
-          }
-        }
-
-        escaped = false;
-      }
-
-      //Copy the clean string into output buffer
-      SIZE_T finalStringSize = charWriteIdx;
-
-      T* outputBuffer = reinterpret_cast<T*>(ge_alloc(finalStringSize * sizeof(T)));
-      SIZE_T copySourceIdx = 0;
-      SIZE_T copyDestIdx = 0;
-
-      for (SIZE_T i = 0; i < paramRangeWriteIdx; ++i) {
-        const FormatParamRange& rangeInfo = paramRanges[i];
-        SIZE_T copySize = rangeInfo.m_start - copyDestIdx;
-
-        memcpy(outputBuffer + copyDestIdx, source + copySourceIdx, copySize * sizeof(T));
-        copySourceIdx += copySize + rangeInfo.m_identifierSize;
-        copyDestIdx += copySize;
-
-        if (NumLimit::MAX_UINT32 == rangeInfo.m_paramIdx) {
-          continue;
-        }
-
-        SIZE_T paramSize = parameters[rangeInfo.m_paramIdx].m_size;
-        memcpy(outputBuffer + copyDestIdx,
-               parameters[rangeInfo.m_paramIdx].m_buffer,
-               paramSize * sizeof(T));
-        copyDestIdx += paramSize;
-      }
-
-      memcpy(outputBuffer + copyDestIdx, 
-             source + copySourceIdx, 
-             (finalStringSize - copyDestIdx) * sizeof(T));
-
-      BasicString<T> outputStr(outputBuffer, finalStringSize);
-      ge_free(outputBuffer);
-
-      //Free the memory of all the parameters buffers
-      for (auto& param : parameters) {
-        if (nullptr != param.m_buffer) {
-          ge_free(param.m_buffer);
-        }
-      }
-
-      return outputStr;
+      const FormatArg<T> params[] = { FormatArg<T>(args)..., FormatArg<T>() };
+      return makeString(source, params, sizeof...(Args));
     }
 
-   private:
     /**
-     * @brief Set of methods that can be specialized so we have a generalized
-     *        way for retrieving length of strings of different types.
+     * @copydoc StringFormat::format(const T*, Args&&...)
      */
-    static SIZE_T
-    getLength(const ANSICHAR* source) {
-      return strlen(source);
+    template<class T, SIZE_T N, class... Args>
+    static BasicString<T>
+    format(const CompiledFormat<T, N>& source, Args&&... args) {
+      const FormatArg<T> params[] = { FormatArg<T>(args)..., FormatArg<T>() };
+      return makeString(source, params, sizeof...(Args));
     }
 
     /**
-     * @brief Set of methods that can be specialized so we have a generalized
-     *        way for retrieving length of strings of different types.
+     * @brief Formats the provided string like format(), into @p buffer. The
+     *        output is cut to fit @p bufferSize characters, null terminator
+     *        included.
+     * @return  The length of the whole output, without null terminator. If
+     *          it's not less than @p bufferSize the output was cut.
      */
+    template<class T, class... Args>
     static SIZE_T
-    getLength(const UNICHAR* source) {
-      return wcslen(source);
+    formatTo(T* buffer, SIZE_T bufferSize, const T* source, Args&&... args) {
+      const FormatArg<T> params[] = { FormatArg<T>(args)..., FormatArg<T>() };
+      return write(buffer, bufferSize, source, params, sizeof...(Args));
     }
 
     /**
-     * @brief Parses the string and returns an integer value extracted from string characters.
+     * @copydoc StringFormat::formatTo(T*, SIZE_T, const T*, Args&&...)
      */
-    static uint32
-    strToInt(const ANSICHAR* buffer) {
-      return static_cast<uint32>(strtoul(buffer, nullptr, 10));
+    template<class T, SIZE_T N, class... Args>
+    static SIZE_T
+    formatTo(T* buffer, SIZE_T bufferSize, const CompiledFormat<T, N>& source, Args&&... args) {
+      const FormatArg<T> params[] = { FormatArg<T>(args)..., FormatArg<T>() };
+      return write(buffer, bufferSize, source, params, sizeof...(Args));
     }
 
     /**
-     * @brief Parses the string and returns an integer value extracted from string characters.
+     * @brief Formats the provided string like format(), into memory of the
+     *        global frame allocator.
+     * @return  The null terminated output. Free it with ge_frame_free(), or
+     *          leave it to the frame allocator.
      */
-    static uint32
-    strToInt(const UNICHAR* buffer) {
-      return static_cast<uint32>(wcstoul(buffer, nullptr, 10));
+    template<class T, class... Args>
+    static T*
+    formatFrame(const T* source, Args&&... args) {
+      const FormatArg<T> params[] = { FormatArg<T>(args)..., FormatArg<T>() };
+      return makeFrameString(source, params, sizeof...(Args));
     }
 
     /**
-     * @brief Helper method for converting any data type to a narrow string.
+     * @copydoc StringFormat::formatFrame(const T*, Args&&...)
      */
-    template<class T>
-    static string
-    toString(const T& param) {
-      return to_string(param);
+    template<class T, SIZE_T N, class... Args>
+    static T*
+    formatFrame(const CompiledFormat<T, N>& source, Args&&... args) {
+      const FormatArg<T> params[] = { FormatArg<T>(args)..., FormatArg<T>() };
+      return makeFrameString(source, params, sizeof...(Args));
     }
 
+   private:
     /**
-     * @brief Helper method that "converts" a narrow string to a narrow string
-     *        (simply a pass through).
+     * @brief Size of the stack buffer outputs are written to first.
      */
-    static string
-    toString(const string& param) {
-      return param;
+    static constexpr SIZE_T STACK_BUFFER_SIZE = 256;
+
+    template<class T>
+    static SIZE_T
+    write(T* buffer,
+          SIZE_T bufferSize,
+          const T* source,
+          const FormatArg<T>* args,
+          uint32 numArgs) {
+      FormatBuffer<T> output{ buffer, 0 < bufferSize ? bufferSize - 1 : 0 };
+      FormatWriter<T> writer{ output, source, args, numArgs };
+      FormatParser::parse(source, getLength(source), writer);
+      return finish(output);
     }
 
-    /**
-     * @brief Helper method that converts a geEngine narrow string to a narrow string.
-     */
-    static string
-    toString(const String& param) {
-      return string(param.c_str());
+    template<class T, SIZE_T N>
+    static SIZE_T
+    write(T* buffer,
+          SIZE_T bufferSize,
+          const CompiledFormat<T, N>& source,
+          const FormatArg<T>* args,
+          uint32 numArgs) {
+      FormatBuffer<T> output{ buffer, 0 < bufferSize ? bufferSize - 1 : 0 };
+      for (uint32 i = 0; i < source.m_numSegments; ++i) {
+        const FormatSegment& segment = source.m_segments[i];
+        if (FormatSegment::NO_PARAM == segment.paramIdx) {
+          output.append(source.m_source + segment.start, segment.length);
+        }
+        else if (segment.paramIdx < numArgs) {
+          args[segment.paramIdx].m_write(output, args[segment.paramIdx].m_param);
+        }
+      }
+      return finish(output);
     }
 
-    /**
-     * @brief Helper method that converts a narrow character array to a narrow string.
-     */
     template<class T>
-    static string
-    toString(T* param) {
-      static_assert(!is_same<T, T>::value, "Invalid pointer type.");
-      return "";
+    static SIZE_T
+    finish(FormatBuffer<T>& output) {
+      if (nullptr != output.m_data) {
+        output.m_data[std::min(output.m_length, output.m_capacity)] = T(0);
+      }
+      return output.m_length;
     }
 
-    /**
-     * @brief Helper method that converts a narrow character array to a narrow string.
-     */
-    static string
-    toString(const char* param) {
-      if (nullptr == param) {
-        return string();
+    template<class T, class Source>
+    static BasicString<T>
+    makeString(const Source& source, const FormatArg<T>* args, uint32 numArgs) {
+      T stackBuffer[STACK_BUFFER_SIZE];
+      const SIZE_T length = write(stackBuffer, STACK_BUFFER_SIZE, source, args, numArgs);
+      if (STACK_BUFFER_SIZE > length) {
+        return BasicString<T>(stackBuffer, length);
       }
-      return string(param);
+
+      BasicString<T> output(length, T(0));
+      write(&output[0], length + 1, source, args, numArgs);
+      return output;
     }
 
-    /**
-     * @brief Helper method that converts a narrow character array to a narrow string.
-     */
-    static string
-    toString(char* param) {
-      if (nullptr == param) {
-        return string();
+    template<class T, class Source>
+    static T*
+    makeFrameString(const Source& source, const FormatArg<T>* args, uint32 numArgs) {
+      T stackBuffer[STACK_BUFFER_SIZE];
+      const SIZE_T length = write(stackBuffer, STACK_BUFFER_SIZE, source, args, numArgs);
+
+      T* output = reinterpret_cast<T*>(ge_frame_alloc((length + 1) * sizeof(T)));
+      if (STACK_BUFFER_SIZE > length) {
+        memcpy(output, stackBuffer, (length + 1) * sizeof(T));
+      }
+      else {
+        write(output, length + 1, source, args, numArgs);
       }
-      return string(param);
+      return output;
     }
 
     /**
-     * @brief Helper method for converting any data type to a wide string.
+     * @brief Set of methods that can be specialized so we have a generalized
+     *        way for retrieving length of strings of different types.
      */
-    template<class T>
-    static wstring
-    toWString(const T& param) {
-      return to_wstring(param);
+    static SIZE_T
+    getLength(const ANSICHAR* source) {
+      return strlen(source);
     }
 
     /**
-     * @brief Helper method that "converts" a wide string to a wide string
-     *        (simply a pass through).
+     * @brief Set of methods that can be specialized so we have a generalized
+     *        way for retrieving length of strings of different types.
      */
-    static wstring
-    toWString(const wstring& param) {
-      return param;
+    static SIZE_T
+    getLength(const UNICHAR* source) {
+      return wcslen(source);
+    }
+
+    template<class T, class P>
+    static void
+    writeParam(FormatBuffer<T>& output, const void* param) {
+      writeValue(output, *static_cast<const P*>(param));
     }
 
     /**
-     * @brief Helper method that converts a geEngine wide string to a wide string.
+     * @brief Writes an integer in decimal, as std::to_string() would.
      */
-    static wstring
-    toWString(const WString& param) {
-      return wstring(param.c_str());
+    template<class T, class P>
+    static typename std::enable_if<std::is_integral<P>::value && !is_same<P, bool>::value>::type
+    writeValue(FormatBuffer<T>& output, P param) {
+      using Unsigned = typename std::make_unsigned<P>::type;
+
+      ANSICHAR digits[24];
+      ANSICHAR* end = digits + sizeof(digits);
+      ANSICHAR* start = end;
+
+      const bool negative = param < P(0);
+      Unsigned value = negative ? static_cast<Unsigned>(Unsigned(0) - static_cast<Unsigned>(param))
+                                : static_cast<Unsigned>(param);
+      do {
+        *--start = static_cast<ANSICHAR>('0' + value % 10);
+        value /= 10;
+      } while (0 != value);
+
+      if (negative) {
+        *--start = '-';
+      }
+
+      output.appendNarrow(start, static_cast<SIZE_T>(end - start));
     }
 
     /**
-     * @brief Helper method that converts a wide character array to a wide string.
+     * @brief Writes a boolean as 1 or 0, as std::to_string() would.
      */
     template<class T>
-    static wstring toWString(T* param) {
-      static_assert(!is_same<T, T>::value, "Invalid pointer type.");
-      return L"";
+    static void
+    writeValue(FormatBuffer<T>& output, bool param) {
+      output.appendNarrow(param ? "1" : "0", 1);
     }
 
     /**
-     * @brief Helper method that converts a wide character array to a wide string.
+     * @brief Writes a floating point number, as std::to_string() would.
      */
-    static wstring
-    toWString(const wchar_t* param) {
-      if (nullptr == param) {
-        return wstring();
+    template<class T, class P>
+    static typename std::enable_if<std::is_floating_point<P>::value>::type
+    writeValue(FormatBuffer<T>& output, P param) {
+      const bool isLong = is_same<P, long double>::value;
+
+      ANSICHAR digits[64];
+      int32 length = isLong ? snprintf(digits, sizeof(digits), "%Lf", static_cast<long double>(param))
+                            : snprintf(digits, sizeof(digits), "%f", static_cast<double>(param));
+      if (0 > length) {
+        return;
       }
-      return wstring(param);
+
+      if (static_cast<SIZE_T>(length) < sizeof(digits)) {
+        output.appendNarrow(digits, static_cast<SIZE_T>(length));
+        return;
+      }
+
+      //Only huge values need more room
+      auto largeDigits = reinterpret_cast<ANSICHAR*>(ge_alloc(static_cast<SIZE_T>(length) + 1));
+      if (isLong) {
+        snprintf(largeDigits, static_cast<SIZE_T>(length) + 1, "%Lf", static_cast<long double>(param));
+      }
+      else {
+        snprintf(largeDigits, static_cast<SIZE_T>(length) + 1, "%f", static_cast<double>(param));
+      }
+      output.appendNarrow(largeDigits, static_cast<SIZE_T>(length));
+      ge_free(largeDigits);
     }
 
     /**
-     * @brief Helper method that converts a wide character array to a wide string.
+     * @brief Writes an enumeration value as its underlying integer.
      */
-    static wstring
-    toWString(wchar_t* param) {
-      if (nullptr == param) {
-        return wstring();
-      }
-      return wstring(param);
+    template<class T, class P>
+    static typename std::enable_if<std::is_enum<P>::value>::type
+    writeValue(FormatBuffer<T>& output, P param) {
+      writeValue(output, static_cast<typename std::underlying_type<P>::type>(param));
     }
 
     /**
-     * @brief Converts all the provided parameters into string representations
-     *        and populates the provided @p parameters array.
+     * @brief Writes a narrow character array.
      */
-    template<class P, class... Args>
     static void
-    getParams(ParamData<ANSICHAR>* parameters, uint32 idx, P&& param, Args&&... args) {
-      if (MAX_PARAMS <= idx) {
-        return;
+    writeValue(FormatBuffer<ANSICHAR>& output, const ANSICHAR* param) {
+      if (nullptr != param) {
+        output.append(param, strlen(param));
       }
-
-      basic_string<ANSICHAR> sourceParam = toString(param);
-      parameters[idx].m_buffer = reinterpret_cast<ANSICHAR*>(ge_alloc(sourceParam.size()
-                                                                    * sizeof(ANSICHAR)));
-      parameters[idx].m_size = sourceParam.size();
-      sourceParam.copy(parameters[idx].m_buffer, parameters[idx].m_size, 0);
-      getParams(parameters, idx + 1, forward<Args>(args)...);
     }
 
     /**
-     * @brief Converts all the provided parameters into string representations
-     *        and populates the provided @p parameters array.
+     * @brief Writes a wide character array.
      */
-    template<class P, class... Args>
     static void
-    getParams(ParamData<UNICHAR>* parameters, uint32 idx, P&& param, Args&&... args) {
-      if (MAX_PARAMS <= idx) {
-        return;
+    writeValue(FormatBuffer<UNICHAR>& output, const UNICHAR* param) {
+      if (nullptr != param) {
+        output.append(param, wcslen(param));
       }
-
-      basic_string<UNICHAR> sourceParam = toWString(param);
-      parameters[idx].m_buffer = reinterpret_cast<UNICHAR*>(ge_alloc(sourceParam.size()
-                                                                   * sizeof(UNICHAR)));
-      parameters[idx].m_size = sourceParam.size();
-      sourceParam.copy(parameters[idx].m_buffer, parameters[idx].m_size, 0);
-      getParams(parameters, idx + 1, forward<Args>(args)...);
     }
 
     /**
-     * @brief Helper method used for parameter size calculation.
-     *        Used as a stopping point in template recursion.
+     * @brief Writes a geEngine string.
      */
+    template<class T>
     static void
-    getParams(ParamData<ANSICHAR>*, uint32) {
-      // Do nothing
+    writeValue(FormatBuffer<T>& output, const BasicString<T>& param) {
+      output.append(param.data(), param.size());
     }
 
     /**
-     * @brief Helper method used for parameter size calculation.
-     *        Used as a stopping point in template recursion.
+     * @brief Writes a standard string.
      */
+    template<class T>
     static void
-    getParams(ParamData<UNICHAR>*, uint32) {
-      // Do nothing
+    writeValue(FormatBuffer<T>& output, const basic_string<T>& param) {
+      output.append(param.data(), param.size());
     }
 
-   private:
-    static constexpr const uint32 MAX_PARAMS = 20;
-    static constexpr const uint32 MAX_IDENTIFIER_SIZE = 2;
-    static constexpr const uint32 MAX_PARAM_REFERENCES = 200;
+    /**
+     * @brief Catches the pointers that aren't strings.
+     */
+    template<class T, class P>
+    static void
+    writeValue(FormatBuffer<T>&, const P*) {
+      static_assert(!is_same<P, P>::value, "Invalid pointer type.");
+    }
   };
 }
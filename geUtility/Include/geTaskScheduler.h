@@ -118,6 +118,41 @@ namespace geEngineSDK {
     TaskScheduler* m_parent;
   };
 
+  /**
+   * @brief Counters of a TaskScheduler. All counts are totals since the
+   *        scheduler started, except where noted.
+   */
+  struct TaskSchedulerStats
+  {
+    uint32 numWorkers = 0;
+
+    /**
+     * @brief Tasks waiting in the queue and running when the stats were read.
+     */
+    uint32 queueDepth = 0;
+    uint32 numActiveTasks = 0;
+
+    /**
+     * @brief Largest number of tasks waiting in the queue since the last call
+     *        to TaskScheduler::resetPeakQueueDepth().
+     */
+    uint32 peakQueueDepth = 0;
+
+    uint64 numQueued = 0;
+    uint64 numCompleted = 0;
+
+    /**
+     * @brief Sum of the queue depth seen by every queued task, divide by
+     *        numQueued to get the average depth.
+     */
+    uint64 queueDepthSum = 0;
+
+    /**
+     * @brief Time spent by the workers running tasks, in microseconds.
+     */
+    uint64 busyTime = 0;
+  };
+
   /**
    * @brief Represents a task scheduler running on multiple threads. You may
    *        queue tasks on it from any thread and they will be executed in user
@@ -163,6 +198,18 @@ namespace geEngineSDK {
       return m_maxActiveTasks;
     }
 
+    /**
+     * @brief Returns the queue and worker counters of the scheduler.
+     */
+    TaskSchedulerStats
+    getStats() const;
+
+    /**
+     * @brief Starts measuring the peak queue depth from the current depth.
+     */
+    void
+    resetPeakQueueDepth();
+
    protected:
     friend class Task;
 
@@ -198,7 +245,13 @@ namespace geEngineSDK {
     bool m_shutdown;
     bool m_checkTasks;
 
-    Mutex m_readyMutex;
+    uint32 m_peakQueueDepth = 0;
+    uint64 m_numQueued = 0;
+    uint64 m_queueDepthSum = 0;
+    atomic<uint64> m_numCompleted{0};
+    atomic<uint64> m_busyCycles{0};
+
+    mutable Mutex m_readyMutex;
     Mutex m_completeMutex;
     Signal m_taskReadyCond;
     Signal m_taskCompleteCond;
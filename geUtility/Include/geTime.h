@@ -23,6 +23,258 @@
 namespace geEngineSDK {
   using std::atomic;
 
+  /**
+   * @brief Histogram of frame times, in buckets of a millisecond.
+   */
+  struct GE_UTILITY_EXPORT FrameTimeHistogram
+  {
+    /**
+     * @brief Number of buckets. The last one also holds every longer frame.
+     */
+    static constexpr uint32 NUM_BUCKETS = 64;
+
+    /**
+     * @brief Width of a bucket, in microseconds.
+     */
+    static constexpr uint64 BUCKET_WIDTH = 1000;
+
+    /**
+     * @brief Adds a frame that took @p frameTime microseconds.
+     */
+    void
+    addFrame(uint64 frameTime);
+
+    /**
+     * @brief Returns the frames added since @p earlier, a previous copy of
+     *        this histogram.
+     */
+    FrameTimeHistogram
+    since(const FrameTimeHistogram& earlier) const;
+
+    /**
+     * @brief Returns the average frame time, in microseconds.
+     */
+    uint64
+    getAverage() const;
+
+    /**
+     * @brief Returns the frame time under which @p percentile (0 to 1) of the
+     *        frames fall, as the upper bound of its bucket, in microseconds.
+     */
+    uint64
+    getPercentile(float percentile) const;
+
+    uint64 counts[NUM_BUCKETS] = {};
+    uint64 numFrames = 0;
+
+    /**
+     * @brief Sum of the frame times, in microseconds.
+     */
+    uint64 totalTime = 0;
+  };
+
+  /**
+   * @brief Times of the most recent frames, to follow the current frame rate.
+   */
+  struct GE_UTILITY_EXPORT FrameTimeStats
+  {
+    /**
+     * @brief Number of frames kept. Older frames are overwritten.
+     */
+    static constexpr uint32 CAPACITY = 256;
+
+    /**
+     * @brief Adds a frame that took @p frameTime microseconds.
+     */
+    void
+    addFrame(uint64 frameTime);
+
+    /**
+     * @brief Returns the number of frames kept, up to CAPACITY.
+     */
+    uint32
+    getNumFrames() const {
+      return static_cast<uint32>(std::min<uint64>(numAdded, CAPACITY));
+    }
+
+    /**
+     * @brief Returns the shortest frame time kept, in microseconds.
+     */
+    uint64
+    getMin() const;
+
+    /**
+     * @brief Returns the longest frame time kept, in microseconds.
+     */
+    uint64
+    getMax() const;
+
+    /**
+     * @brief Returns the average of the frame times kept, in microseconds.
+     */
+    uint64
+    getAverage() const;
+
+    /**
+     * @brief Returns the frame time under which @p percentile (0 to 1) of the
+     *        frames kept fall, in microseconds.
+     */
+    uint64
+    getPercentile(float percentile) const;
+
+    /**
+     * @brief Frame times in microseconds, oldest overwritten first.
+     */
+    uint32 frameTimes[CAPACITY] = {};
+    uint64 numAdded = 0;
+  };
+
+  /**
+   * @brief A time line advanced every frame, that can be paused and scaled
+   *        independently of the others. E.g. the game clock slowed down
+   *        while the UI keeps running in real time.
+   * @note  Times are kept in integer microseconds, so they don't lose
+   *        precision over long uptimes and fixed steps are deterministic.
+   */
+  class GE_UTILITY_EXPORT Clock
+  {
+   public:
+    /**
+     * @brief Advances the clock by @p realDelta microseconds of real time,
+     *        scaled by the clock's scale. Time calls it every frame for the
+     *        clocks it owns.
+     */
+    void
+    advance(uint64 realDelta);
+
+    /**
+     * @brief Stops or resumes the clock. A paused clock has no frame delta
+     *        and accumulates no fixed steps.
+     */
+    void
+    setPaused(bool paused) {
+      m_paused = paused;
+    }
+
+    bool
+    isPaused() const {
+      return m_paused;
+    }
+
+    /**
+     * @brief Sets how fast the clock runs compared to real time.
+     */
+    void
+    setScale(double scale) {
+      m_scale = std::max(scale, 0.0);
+    }
+
+    double
+    getScale() const {
+      return m_scale;
+    }
+
+    /**
+     * @brief Returns the time elapsed on the clock, in microseconds.
+     */
+    uint64
+    getTimeUs() const {
+      return m_time;
+    }
+
+    /**
+     * @brief Returns the time elapsed on the clock, in seconds.
+     */
+    double
+    getTime() const {
+      return m_time * MICROSEC_TO_SEC;
+    }
+
+    /**
+     * @brief Returns the time the clock advanced on the last frame, in
+     *        microseconds.
+     */
+    uint64
+    getFrameDeltaUs() const {
+      return m_frameDelta;
+    }
+
+    /**
+     * @brief Returns the time the clock advanced on the last frame, in seconds.
+     */
+    float
+    getFrameDelta() const {
+      return static_cast<float>(m_frameDelta * MICROSEC_TO_SEC);
+    }
+
+    /**
+     * @brief Sets the length of a fixed step, in microseconds.
+     */
+    void
+    setFixedStep(uint64 step) {
+      m_fixedStep = std::max<uint64>(step, 1);
+    }
+
+    uint64
+    getFixedStepUs() const {
+      return m_fixedStep;
+    }
+
+    /**
+     * @brief Returns the length of a fixed step, in seconds.
+     */
+    float
+    getFixedStepDelta() const {
+      return static_cast<float>(m_fixedStep * MICROSEC_TO_SEC);
+    }
+
+    /**
+     * @brief Sets the most fixed steps consumeFixedSteps() returns at once.
+     *        Time past that is dropped, so a long frame doesn't make the
+     *        next ones longer.
+     */
+    void
+    setMaxFixedSteps(uint32 maxSteps) {
+      m_maxFixedSteps = std::max(maxSteps, 1u);
+    }
+
+    /**
+     * @brief Returns how many fixed steps to simulate for the time the clock
+     *        advanced, and removes them from the accumulated time.
+     */
+    uint32
+    consumeFixedSteps();
+
+    /**
+     * @brief Returns how far the clock is between the last fixed step and
+     *        the next one, from 0 to 1, to interpolate the states of both.
+     */
+    float
+    getFixedStepAlpha() const {
+      return static_cast<float>(static_cast<double>(m_fixedAccumulator) / m_fixedStep);
+    }
+
+    /**
+     * @brief Multiply with time in microseconds to get a time in seconds.
+     */
+    static constexpr double MICROSEC_TO_SEC = 1.0 / 1000000.0;
+
+   private:
+    uint64 m_time = 0;
+    uint64 m_frameDelta = 0;
+    double m_scale = 1.0;
+
+    /**
+     * @brief Fraction of a microsecond left over by the scale.
+     */
+    double m_scaleRemainder = 0.0;
+    bool m_paused = false;
+
+    uint64 m_fixedStep = 16667;
+    uint64 m_fixedAccumulator = 0;
+    uint32 m_maxFixedSteps = 8;
+  };
+
   /**
    * @brief Manages all time related functionality.
    * @note  Sim thread only unless where specified otherwise.
@@ -37,16 +289,23 @@ namespace geEngineSDK {
      * @brief Gets the time elapsed since application start. Only gets updated once per frame.
      * @return  The time since application start, in seconds.
      */
-    float
+    double
     getTime() const {
-      return m_timeSinceStart;
+      return m_timeSinceStart * MICROSEC_TO_SEC;
     }
 
     /**
      * @copydoc Time::getTime()
      */
     uint64 getTimeMs() const {
-      return m_timeSinceStartMs;
+      return m_timeSinceStart / 1000;
+    }
+
+    /**
+     * @copydoc Time::getTime()
+     */
+    uint64 getTimeUs() const {
+      return m_timeSinceStart;
     }
 
     /**
@@ -55,6 +314,14 @@ namespace geEngineSDK {
      */
     float
     getFrameDelta() const {
+      return static_cast<float>(m_frameDelta * MICROSEC_TO_SEC);
+    }
+
+    /**
+     * @copydoc Time::getFrameDelta()
+     */
+    uint64
+    getFrameDeltaUs() const {
       return m_frameDelta;
     }
 
@@ -89,6 +356,38 @@ namespace geEngineSDK {
       return m_appStartTime;
     }
 
+    /**
+     * @brief Returns the histogram of the frame times since the application
+     *        started.
+     */
+    const FrameTimeHistogram&
+    getFrameTimeHistogram() const {
+      return m_frameTimes;
+    }
+
+    /**
+     * @brief Returns the times of the most recent frames.
+     */
+    const FrameTimeStats&
+    getFrameTimeStats() const {
+      return m_frameTimeStats;
+    }
+
+    /**
+     * @brief Returns the clock of the game simulation, advanced every frame.
+     */
+    Clock&
+    getGameClock() {
+      return m_gameClock;
+    }
+
+    /**
+     * @brief Creates a clock advanced every frame, until the returned
+     *        pointer is released.
+     */
+    SPtr<Clock>
+    createClock();
+
     /**
      * @brief Called every frame. Should only be called by Application.
      */
@@ -100,12 +399,15 @@ namespace geEngineSDK {
      */
     static const double MICROSEC_TO_SEC;
    private:
-    float m_frameDelta = 0.0f;      /**< Frame delta in seconds */
-    float m_timeSinceStart = 0.0f;  /**< Time since start in seconds */
-    uint64 m_timeSinceStartMs = 0u;
+    uint64 m_frameDelta = 0u;       /**< Frame delta in microseconds */
+    uint64 m_timeSinceStart = 0u;   /**< Time since start in microseconds */
     uint64 m_appStartTime = 0u;     /**< Time the application started, in microseconds */
     uint64 m_lastFrameTime = 0u;    /**< Time since last runOneFrame call, In microseconds */
-    atomic<uint32> m_currentFrame{0UL};
+    atomic<uint64> m_currentFrame{0UL};
+    FrameTimeHistogram m_frameTimes;
+    FrameTimeStats m_frameTimeStats;
+    Clock m_gameClock;
+    Vector<SPtr<Clock>> m_clocks;
     Timer* m_timer;
   };
 
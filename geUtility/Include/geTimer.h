@@ -18,8 +18,24 @@
  */
 /*****************************************************************************/
 #include "gePrerequisitesUtil.h"
+#include <atomic>
 #include <chrono>
 
+#if GE_ARCH_TYPE == GE_ARCHITECTURE_x86_32 || GE_ARCH_TYPE == GE_ARCHITECTURE_x86_64
+# if GE_COMPILER == GE_COMPILER_MSVC
+#   include <intrin.h>
+# else
+#   include <x86intrin.h>
+# endif
+# define GE_CYCLE_TIMER_TSC 1
+#else
+# define GE_CYCLE_TIMER_TSC 0
+#endif
+
+#if GE_PLATFORM == GE_PLATFORM_LINUX
+# include <time.h>
+#endif
+
 namespace geEngineSDK {
   using std::chrono::high_resolution_clock;
   using std::chrono::time_point;
@@ -64,4 +80,153 @@ namespace geEngineSDK {
     high_resolution_clock m_highResClock;
     time_point<high_resolution_clock> m_startTime;
   };
+
+  /**
+   * @brief Timer reading the processor time stamp counter, for measurements
+   *        too fine or too frequent for Timer. Where the counter doesn't run
+   *        at a constant rate it reads a raw monotonic clock instead.
+   * @note  Counts are converted to nanoseconds with integer math, using the
+   *        rate measured by calibrate(). Time calls it when started.
+   */
+  class GE_UTILITY_EXPORT CycleTimer
+  {
+   public:
+    /**
+     * @brief Construct the timer and start timing.
+     */
+    CycleTimer() : m_start(now()) {}
+
+    /**
+     * @brief Reset the timer to zero.
+     */
+    void
+    reset() {
+      m_start = now();
+    }
+
+    /**
+     * @brief Returns the counts elapsed since the timer was initialized or
+     *        last reset.
+     */
+    uint64
+    getCycles() const {
+      return now() - m_start;
+    }
+
+    /**
+     * @brief Returns time in nanoseconds since timer was initialized or last reset.
+     */
+    uint64
+    getNanoseconds() const {
+      return toNanoseconds(getCycles());
+    }
+
+    /**
+     * @brief Returns time in microseconds since timer was initialized or last reset.
+     */
+    uint64
+    getMicroseconds() const {
+      return getNanoseconds() / 1000;
+    }
+
+    /**
+     * @brief Reads the counter.
+     */
+    static uint64
+    now() {
+#if GE_CYCLE_TIMER_TSC
+      if (isUsingTsc()) {
+        return __rdtsc();
+      }
+#endif
+      return readClock();
+    }
+
+    /**
+     * @brief Converts a number of counts to nanoseconds.
+     */
+    static uint64
+    toNanoseconds(uint64 cycles) {
+      const Rate& rate = *s_rate.load(std::memory_order_acquire);
+
+      //cycles * multiplier / 2^shift, split so it doesn't overflow
+      return (((cycles >> 32) * rate.multiplier) << (32 - rate.shift)) +
+             (((cycles & 0xFFFFFFFF) * rate.multiplier) >> rate.shift);
+    }
+
+    /**
+     * @brief Measures the rate of the counter. Only the first call measures,
+     *        it takes about 10 milliseconds. Until then a count is taken as
+     *        a nanosecond.
+     * @note  Thread safe, concurrent calls wait for the measure.
+     */
+    static void
+    calibrate();
+
+    /**
+     * @brief Returns true if the time stamp counter is read, false if the
+     *        monotonic clock is.
+     */
+    static bool
+    isUsingTsc() {
+      //On first use, so counts read during the static initialization of
+      //other modules are in the same units as the later ones
+      static const bool useTsc = hasInvariantTsc();
+      return useTsc;
+    }
+
+    /**
+     * @brief Returns the length of a count, in nanoseconds.
+     */
+    static double
+    getNanosecondsPerCycle();
+
+   private:
+    /**
+     * @brief Returns true if the processor has a time stamp counter running
+     *        at a constant rate, whatever the power state.
+     */
+    static bool
+    hasInvariantTsc();
+
+    /**
+     * @brief Reads the monotonic clock, in nanoseconds.
+     */
+    static uint64
+    readClock() {
+#if GE_PLATFORM == GE_PLATFORM_LINUX
+      timespec time;
+      clock_gettime(CLOCK_MONOTONIC_RAW, &time);
+      return static_cast<uint64>(time.tv_sec) * 1000000000ULL +
+             static_cast<uint64>(time.tv_nsec);
+#else
+      return static_cast<uint64>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+    }
+
+    /**
+     * @brief Nanoseconds per count, as a fixed point number with shift
+     *        fractional bits. Kept at most 2^32 so the conversion can't
+     *        overflow.
+     */
+    struct Rate
+    {
+      uint64 multiplier;
+      uint32 shift;
+    };
+
+    uint64 m_start;
+
+    /**
+     * @brief Published once by calibrate(), so readers never see the
+     *        multiplier of a rate with the shift of another.
+     */
+    static std::atomic<const Rate*> s_rate;
+
+    /**
+     * @brief Used until calibrated, a count is a nanosecond.
+     */
+    static const Rate s_uncalibratedRate;
+  };
 }
@@ -0,0 +1,243 @@
+/*****************************************************************************/
+/**
+ * @file    geVector3Stream.h
+ * @author  Samuel Prince (samuel.prince.quezada@gmail.com)
+ * @date    2018/07/04
+ * @brief   Structure of arrays container for 3D vectors.
+ *
+ * Stores a list of 3D vectors as three separate arrays of components so the
+ * common sweeps over point clouds (bounds, centroids, dot products,
+ * transformations) can run on SIMD registers four vectors at a time.
+ *
+ * @bug     No known bugs.
+ */
+/*****************************************************************************/
+#pragma once
+
+/*****************************************************************************/
+/**
+ * Includes
+ */
+/*****************************************************************************/
+#include "gePrerequisitesUtil.h"
+#include "geVector3.h"
+
+namespace geEngineSDK {
+  class AABox;
+  class Matrix4;
+
+  /**
+   * @brief Structure of arrays container for 3D vectors.
+   */
+  class GE_UTILITY_EXPORT Vector3Stream
+  {
+   public:
+    Vector3Stream() = default;
+
+    /**
+     * @brief Creates a stream with @p count zero vectors.
+     */
+    explicit Vector3Stream(SIZE_T count);
+
+    /**
+     * @brief Creates a stream from an array of vectors.
+     */
+    Vector3Stream(const Vector3* points, SIZE_T count);
+
+    /**
+     * @brief Creates a stream from an array of vectors.
+     */
+    explicit Vector3Stream(const Vector<Vector3>& points);
+
+    /**
+     * @brief Replaces the contents of the stream with an array of vectors.
+     */
+    void
+    assign(const Vector3* points, SIZE_T count);
+
+    /**
+     * @brief Writes the contents of the stream into an array of vectors.
+     *        @p output must have room for size() elements.
+     */
+    void
+    copyTo(Vector3* output) const;
+
+    /**
+     * @brief Appends a vector at the end of the stream.
+     */
+    void
+    add(const Vector3& point) {
+      m_x.push_back(point.x);
+      m_y.push_back(point.y);
+      m_z.push_back(point.z);
+    }
+
+    /**
+     * @brief Returns the vector at the specified index.
+     */
+    Vector3
+    get(SIZE_T index) const {
+      return Vector3(m_x[index], m_y[index], m_z[index]);
+    }
+
+    /**
+     * @brief Sets the vector at the specified index.
+     */
+    void
+    set(SIZE_T index, const Vector3& point) {
+      m_x[index] = point.x;
+      m_y[index] = point.y;
+      m_z[index] = point.z;
+    }
+
+    /**
+     * @brief Changes the number of vectors in the stream. New vectors are
+     *        set to zero.
+     */
+    void
+    resize(SIZE_T count) {
+      m_x.resize(count, 0.0f);
+      m_y.resize(count, 0.0f);
+      m_z.resize(count, 0.0f);
+    }
+
+    void
+    reserve(SIZE_T count) {
+      m_x.reserve(count);
+      m_y.reserve(count);
+      m_z.reserve(count);
+    }
+
+    void
+    clear() {
+      m_x.clear();
+      m_y.clear();
+      m_z.clear();
+    }
+
+    SIZE_T
+    size() const {
+      return m_x.size();
+    }
+
+    bool
+    empty() const {
+      return m_x.empty();
+    }
+
+    float*
+    getX() {
+      return m_x.data();
+    }
+
+    float*
+    getY() {
+      return m_y.data();
+    }
+
+    float*
+    getZ() {
+      return m_z.data();
+    }
+
+    const float*
+    getX() const {
+      return m_x.data();
+    }
+
+    const float*
+    getY() const {
+      return m_y.data();
+    }
+
+    const float*
+    getZ() const {
+      return m_z.data();
+    }
+
+    /**
+     * @brief Returns the axis aligned box that contains every vector in the
+     *        stream. The box is invalid if the stream is empty.
+     */
+    AABox
+    getBounds() const;
+
+    /**
+     * @brief Returns the sum of all the vectors in the stream.
+     */
+    Vector3
+    getSum() const;
+
+    /**
+     * @brief Returns the average of all the vectors in the stream, or zero if
+     *        the stream is empty.
+     */
+    Vector3
+    getCentroid() const;
+
+    /**
+     * @brief Returns the largest squared distance between @p point and any
+     *        of the vectors in the stream.
+     */
+    float
+    getMaxDistSquared(const Vector3& point) const;
+
+    /**
+     * @brief Normalizes every vector in the stream. Vectors whose squared
+     *        size is not above @p tolerance are left unchanged, in the same
+     *        way Vector3::normalize() does.
+     */
+    void
+    normalize(float tolerance = Math::SMALL_NUMBER);
+
+    /**
+     * @brief Calculates the dot product of every vector in the stream with
+     *        @p v. @p output must have room for size() elements.
+     */
+    void
+    dot(const Vector3& v, float* output) const;
+
+    /**
+     * @brief Calculates the cross product of every vector in the stream with
+     *        @p v. @p output is resized to match and may be this stream.
+     */
+    void
+    cross(const Vector3& v, Vector3Stream& output) const;
+
+    /**
+     * @brief Transforms every vector in the stream as a position (takes the
+     *        translation into account). Same as Matrix4::transformPosition()
+     *        without the w component. @p output may be this stream.
+     */
+    void
+    transformPosition(const Matrix4& m, Vector3Stream& output) const;
+
+    /**
+     * @brief Transforms every vector in the stream as a direction (ignores
+     *        the translation). Same as Matrix4::transformVector().
+     *        @p output may be this stream.
+     */
+    void
+    transformVector(const Matrix4& m, Vector3Stream& output) const;
+
+    /**
+     * @brief Returns the axis aligned box that contains every vector in an
+     *        array, without converting the array into a stream first.
+     */
+    static AABox
+    getBounds(const Vector3* points, SIZE_T count);
+
+    /**
+     * @brief Returns the largest squared distance between @p point and any
+     *        of the vectors in an array, without converting the array into a
+     *        stream first.
+     */
+    static float
+    getMaxDistSquared(const Vector3* points, SIZE_T count, const Vector3& point);
+
+   private:
+    Vector<float> m_x;
+    Vector<float> m_y;
+    Vector<float> m_z;
+  };
+}
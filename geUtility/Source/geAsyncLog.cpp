@@ -0,0 +1,539 @@
+/*****************************************************************************/
+/**
+ * @file    geAsyncLog.cpp
+ * @author  Samuel Prince (samuel.prince.quezada@gmail.com)
+ * @date    2018/07/20
+ * @brief   Asynchronous backend for the Debug log.
+ *
+ * Logging threads write compact records (a format string ID and its raw
+ * arguments) to a lock-free ring buffer of their own. A background thread
+ * formats the records and writes them in batches to the console, a file and
+ * the Debug log, so threads that log never wait on I/O.
+ *
+ * @bug     No known bugs.
+ */
+/*****************************************************************************/
+
+/*****************************************************************************/
+/**
+ * Includes
+ */
+/*****************************************************************************/
+#include "geAsyncLog.h"
+#include "geBitwise.h"
+#include "geDataStream.h"
+#include "geDebug.h"
+#include "geFileSystem.h"
+#include "geFlightRecorder.h"
+
+#if GE_PLATFORM == GE_PLATFORM_WIN32 && GE_COMPILER == GE_COMPILER_MSVC
+# include <windows.h>
+#endif
+
+#include <iostream>
+
+namespace geEngineSDK {
+  using std::memory_order_acquire;
+  using std::memory_order_relaxed;
+  using std::memory_order_release;
+
+  namespace {
+    /**
+     * @brief Maximum number of format strings that can be registered. Call
+     *        sites registered past this limit only print their first argument.
+     */
+    const uint32 MAX_FORMATS = 4096;
+
+    /**
+     * @brief Maximum number of arguments of a single record, same as the
+     *        maximum parameter ID of StringUtil::format().
+     */
+    const uint32 MAX_ARGS = 20;
+
+    /**
+     * @brief Set on the size of the padding written when a record doesn't
+     *        fit before the end of the ring buffer.
+     */
+    const uint32 PADDING_FLAG = 0x80000000;
+
+    /**
+     * @brief Format of the records added through AsyncLog::logMessage().
+     */
+    const char* MESSAGE_FORMAT = "{0}";
+
+    std::atomic<const char*> s_formats[MAX_FORMATS];
+    std::atomic<uint32> s_numFormats{1};
+
+    /**
+     * @brief Start of every record in a ring buffer.
+     */
+    struct RecordHeader
+    {
+      uint32 size;
+      uint32 formatId;
+      uint32 channel;
+      uint32 numArgs;
+      uint64 time;
+      uint64 threadId;
+      union
+      {
+        const LogSourceLocation* location;
+        uint64 locationPadding;
+      };
+    };
+
+    /**
+     * @brief Start of every argument in a record. Strings follow the entry,
+     *        padded to 8 bytes, instead of using the value.
+     */
+    struct ArgEntry
+    {
+      uint32 type;
+      uint32 size;
+      union
+      {
+        int64 intValue;
+        uint64 uintValue;
+        double floatValue;
+      };
+    };
+
+    static_assert(sizeof(RecordHeader) % 8 == 0, "Records must stay 8-byte aligned");
+    static_assert(sizeof(ArgEntry) % 8 == 0, "Records must stay 8-byte aligned");
+
+    uint32
+    alignSize(uint32 size) {
+      return (size + 7) & ~7u;
+    }
+
+    /**
+     * @brief Appends the text of a decoded argument.
+     */
+    void
+    appendArg(String& output, const ArgEntry* arg) {
+      switch (arg->type)
+      {
+        case ASYNC_LOG_ARG::kInt:
+          output += toString(arg->intValue);
+          break;
+        case ASYNC_LOG_ARG::kUInt:
+          output += toString(arg->uintValue);
+          break;
+        case ASYNC_LOG_ARG::kFloat:
+          output += toString(arg->floatValue);
+          break;
+        case ASYNC_LOG_ARG::kBool:
+          output += toString(0 != arg->uintValue);
+          break;
+        case ASYNC_LOG_ARG::kString:
+          output.append(reinterpret_cast<const char*>(arg + 1), arg->size);
+          break;
+        default:
+          break;
+      }
+    }
+
+    /**
+     * @brief Replaces the "{N}" identifiers of the record format with its
+     *        arguments. "\" escapes the next character, as in
+     *        StringUtil::format().
+     */
+    String
+    formatRecord(const RecordHeader* header) {
+      const ArgEntry* args[MAX_ARGS];
+      const uint8* data = reinterpret_cast<const uint8*>(header + 1);
+      for (uint32 i = 0; i < header->numArgs; ++i) {
+        args[i] = reinterpret_cast<const ArgEntry*>(data);
+        data += sizeof(ArgEntry);
+        if (ASYNC_LOG_ARG::kString == args[i]->type) {
+          data += alignSize(args[i]->size);
+        }
+      }
+
+      const char* format = header->formatId < MAX_FORMATS ?
+                           s_formats[header->formatId].load(memory_order_relaxed) :
+                           nullptr;
+      if (nullptr == format) {
+        format = MESSAGE_FORMAT;
+      }
+
+      String output;
+      for (const char* c = format; '\0' != *c; ++c) {
+        if ('\\' == *c && '\0' != c[1]) {
+          output += *++c;
+          continue;
+        }
+
+        if ('{' == *c && isdigit(c[1])) {
+          uint32 paramIdx = 0;
+          const char* end = c + 1;
+          for (; isdigit(*end); ++end) {
+            paramIdx = paramIdx * 10 + static_cast<uint32>(*end - '0');
+          }
+
+          if ('}' == *end && paramIdx < header->numArgs) {
+            appendArg(output, args[paramIdx]);
+            c = end;
+            continue;
+          }
+        }
+
+        output += *c;
+      }
+
+      return output;
+    }
+  }
+
+  /**
+   * @brief Ring buffer written by a single thread and read by the writer
+   *        thread. Positions only grow, the buffer offset is their low bits.
+   */
+  struct AsyncLog::ThreadBuffer
+  {
+    explicit ThreadBuffer(uint32 size)
+      : m_data(size)
+    {}
+
+    Vector<uint8> m_data;
+
+    //Keep the positions written by each thread on their own cache line
+    uint8 m_padding0[64];
+    std::atomic<uint64> m_head{0};
+    std::atomic<uint64> m_numDropped{0};
+    std::atomic<uint64> m_numBlocked{0};
+    uint8 m_padding1[64];
+    std::atomic<uint64> m_tail{0};
+    uint8 m_padding2[64];
+
+    /**
+     * @brief Set once the owner thread exits, so a new thread can reuse the
+     *        buffer.
+     */
+    std::atomic<bool> m_released{false};
+  };
+
+  /**
+   * @brief Thread local reference to the buffer of a thread. Hands the buffer
+   *        back when the thread exits.
+   */
+  struct AsyncLog::ThreadBufferHolder
+  {
+    ~ThreadBufferHolder() {
+      if (m_buffer) {
+        m_buffer->m_released.store(true, memory_order_release);
+      }
+    }
+
+    SPtr<ThreadBuffer> m_buffer;
+  };
+
+  AsyncLog::AsyncLog(const AsyncLogDesc& desc)
+    : m_desc(desc),
+      m_bufferSize(Bitwise::nextPow2(std::max(desc.bufferSize, 4096u)))
+  {}
+
+  void
+  AsyncLog::onStartUp() {
+    if (!m_desc.filePath.isEmpty()) {
+      m_file = FileSystem::createAndOpenFile(m_desc.filePath);
+    }
+
+    m_writerThread = Thread(std::bind(&AsyncLog::writerMain, this));
+    m_writerThreadId = m_writerThread.get_id();
+  }
+
+  void
+  AsyncLog::onShutDown() {
+    {
+      Lock lock(m_writerMutex);
+      m_stop = true;
+    }
+    m_writerSignal.notify_one();
+    m_writerThread.join();
+
+    if (m_file) {
+      m_file->close();
+      m_file = nullptr;
+    }
+  }
+
+  uint32
+  AsyncLog::registerFormat(const char* format) {
+    uint32 formatId = s_numFormats.fetch_add(1, memory_order_relaxed);
+    if (formatId >= MAX_FORMATS) {
+      return 0;
+    }
+
+    s_formats[formatId].store(format, memory_order_relaxed);
+    return formatId;
+  }
+
+  bool
+  AsyncLog::logMessage(const String& message,
+                       uint32 channel,
+                       const LogSourceLocation* location) {
+    AsyncLogArg arg(message);
+    return write(channel, 0, location, &arg, 1);
+  }
+
+  bool
+  AsyncLog::write(uint32 channel,
+                  uint32 formatId,
+                  const LogSourceLocation* location,
+                  const AsyncLogArg* args,
+                  uint32 numArgs) {
+    numArgs = std::min(numArgs, MAX_ARGS);
+
+    //Messages are kept as they are, other records with their format string
+    if (0 == formatId && 0 < numArgs && ASYNC_LOG_ARG::kString == args[0].m_type) {
+      FlightRecorder::record(FLIGHT_RECORD::kLog,
+                             location,
+                             channel,
+                             args[0].m_string,
+                             args[0].m_stringSize);
+    }
+    else {
+      const char* format = s_formats[formatId].load(memory_order_relaxed);
+      FlightRecorder::record(FLIGHT_RECORD::kLog,
+                             location,
+                             channel,
+                             format,
+                             format ? strlen(format) : 0);
+    }
+
+    //Strings share what is left of the maximum record size, in order
+    const uint32 maxRecordSize = m_bufferSize / 4;
+    uint32 stringBudget = maxRecordSize - sizeof(RecordHeader) - numArgs * sizeof(ArgEntry);
+    uint32 stringSizes[MAX_ARGS];
+
+    uint32 size = sizeof(RecordHeader) + numArgs * sizeof(ArgEntry);
+    for (uint32 i = 0; i < numArgs; ++i) {
+      if (ASYNC_LOG_ARG::kString == args[i].m_type) {
+        stringSizes[i] = std::min(args[i].m_stringSize, stringBudget);
+        stringBudget -= alignSize(stringSizes[i]);
+        size += alignSize(stringSizes[i]);
+      }
+    }
+
+    ThreadBuffer* buffer = getThreadBuffer();
+    const uint64 head = buffer->m_head.load(memory_order_relaxed);
+    uint32 offset = static_cast<uint32>(head) & (m_bufferSize - 1);
+    const uint32 contiguous = m_bufferSize - offset;
+
+    //Records never wrap, skip to the start of the buffer if needed
+    const uint32 needed = size <= contiguous ? size : contiguous + size;
+
+    bool blocked = false;
+    while (head + needed - buffer->m_tail.load(memory_order_acquire) > m_bufferSize) {
+      //The writer thread can't wait for itself
+      if (ASYNC_LOG_OVERFLOW::kDrop == m_desc.overflow ||
+          GE_THREAD_CURRENT_ID == m_writerThreadId) {
+        buffer->m_numDropped.fetch_add(1, memory_order_relaxed);
+        return false;
+      }
+
+      if (!blocked) {
+        buffer->m_numBlocked.fetch_add(1, memory_order_relaxed);
+        blocked = true;
+      }
+
+      //Wake the writer and sleep until it drained the buffers once more
+      Lock lock(m_writerMutex);
+      if (m_stop) {
+        //The writer may already be done, don't wait for it
+        buffer->m_numDropped.fetch_add(1, memory_order_relaxed);
+        return false;
+      }
+
+      const uint64 numDrains = m_numDrains;
+      m_spaceWanted = true;
+      m_writerSignal.notify_one();
+      m_spaceSignal.wait(lock, [&]() { return m_numDrains != numDrains; });
+    }
+
+    uint8* data = buffer->m_data.data();
+    if (size > contiguous) {
+      RecordHeader* padding = reinterpret_cast<RecordHeader*>(data + offset);
+      padding->size = contiguous | PADDING_FLAG;
+      offset = 0;
+    }
+
+    RecordHeader* header = reinterpret_cast<RecordHeader*>(data + offset);
+    header->size = size;
+    header->formatId = formatId;
+    header->channel = channel;
+    header->numArgs = numArgs;
+    header->time = Log::getCurrentTime();
+    header->threadId = Log::getCurrentThreadId();
+    header->location = location;
+
+    uint8* argData = reinterpret_cast<uint8*>(header + 1);
+    for (uint32 i = 0; i < numArgs; ++i) {
+      ArgEntry* entry = reinterpret_cast<ArgEntry*>(argData);
+      entry->type = args[i].m_type;
+      entry->size = 0;
+      entry->uintValue = args[i].m_uint;
+      argData += sizeof(ArgEntry);
+
+      if (ASYNC_LOG_ARG::kString == args[i].m_type) {
+        entry->size = stringSizes[i];
+        memcpy(argData, args[i].m_string, stringSizes[i]);
+        argData += alignSize(stringSizes[i]);
+      }
+    }
+
+    buffer->m_head.store(head + needed, memory_order_release);
+    return true;
+  }
+
+  AsyncLog::ThreadBuffer*
+  AsyncLog::getThreadBuffer() {
+    //Needs a destructor to hand the buffer back, so GE_THREADLOCAL won't do
+    static thread_local ThreadBufferHolder holder;
+    if (holder.m_buffer) {
+      return holder.m_buffer.get();
+    }
+
+    Lock lock(m_buffersMutex);
+    for (auto& buffer : m_buffers) {
+      //Only reuse buffers the writer is done with
+      if (buffer->m_released.load(memory_order_acquire) &&
+          buffer->m_head.load(memory_order_relaxed) ==
+            buffer->m_tail.load(memory_order_acquire)) {
+        buffer->m_released.store(false, memory_order_relaxed);
+        holder.m_buffer = buffer;
+        break;
+      }
+    }
+
+    if (!holder.m_buffer) {
+      holder.m_buffer = ge_shared_ptr_new<ThreadBuffer>(m_bufferSize);
+      m_buffers.push_back(holder.m_buffer);
+    }
+
+    return holder.m_buffer.get();
+  }
+
+  void
+  AsyncLog::flush() {
+    Lock lock(m_writerMutex);
+    const uint64 flushId = ++m_flushRequested;
+    m_writerSignal.notify_one();
+    m_flushSignal.wait(lock, [&]() { return m_flushCompleted >= flushId; });
+  }
+
+  AsyncLogStats
+  AsyncLog::getStats() const {
+    AsyncLogStats stats;
+    stats.numWritten = m_numWritten.load(memory_order_relaxed);
+    stats.numBatches = m_numBatches.load(memory_order_relaxed);
+
+    Lock lock(m_buffersMutex);
+    for (auto& buffer : m_buffers) {
+      stats.numDropped += buffer->m_numDropped.load(memory_order_relaxed);
+      stats.numBlocked += buffer->m_numBlocked.load(memory_order_relaxed);
+    }
+    stats.numThreadBuffers = static_cast<uint32>(m_buffers.size());
+
+    return stats;
+  }
+
+  void
+  AsyncLog::writerMain() {
+    while (true) {
+      bool stop;
+      uint64 flushId;
+      {
+        Lock lock(m_writerMutex);
+        m_writerSignal.wait_for(lock,
+                                std::chrono::milliseconds(m_desc.flushIntervalMs),
+                                [&]() {
+                                  return m_stop ||
+                                         m_spaceWanted ||
+                                         m_flushRequested != m_flushCompleted;
+                                });
+        stop = m_stop;
+        flushId = m_flushRequested;
+        m_spaceWanted = false;
+      }
+
+      //Records added before the flush request are visible from here on
+      writeRecords();
+
+      {
+        Lock lock(m_writerMutex);
+        m_flushCompleted = flushId;
+        ++m_numDrains;
+      }
+      m_flushSignal.notify_all();
+      m_spaceSignal.notify_all();
+
+      if (stop) {
+        break;
+      }
+    }
+  }
+
+  void
+  AsyncLog::writeRecords() {
+    Vector<SPtr<ThreadBuffer>> buffers;
+    {
+      Lock lock(m_buffersMutex);
+      buffers = m_buffers;
+    }
+
+    String batch;
+    uint64 numRecords = 0;
+    for (auto& buffer : buffers) {
+      const uint8* data = buffer->m_data.data();
+      const uint64 head = buffer->m_head.load(memory_order_acquire);
+      uint64 tail = buffer->m_tail.load(memory_order_relaxed);
+
+      while (tail != head) {
+        const uint32 offset = static_cast<uint32>(tail) & (m_bufferSize - 1);
+        const RecordHeader* header = reinterpret_cast<const RecordHeader*>(data + offset);
+        if (header->size & PADDING_FLAG) {
+          tail += header->size & ~PADDING_FLAG;
+          continue;
+        }
+
+        LogEntry entry(formatRecord(header),
+                       header->channel,
+                       header->time,
+                       header->threadId,
+                       header->location);
+        batch += entry.getFormattedMessage();
+        batch += '\n';
+
+        if (m_desc.forwardToLog) {
+          g_Debug().getLog().addEntry(std::move(entry));
+        }
+        tail += header->size;
+        ++numRecords;
+      }
+
+      //Hand the space back to the owner thread
+      buffer->m_tail.store(tail, memory_order_release);
+    }
+
+    if (0 == numRecords) {
+      return;
+    }
+
+    if (m_desc.writeToConsole) {
+#if GE_PLATFORM == GE_PLATFORM_WIN32 && GE_COMPILER == GE_COMPILER_MSVC
+      OutputDebugString(batch.c_str());
+#endif
+      std::cout.write(batch.data(), batch.size());
+      std::cout.flush();
+    }
+
+    if (m_file) {
+      m_file->write(batch.data(), batch.size());
+    }
+
+    m_numWritten.fetch_add(numRecords, memory_order_relaxed);
+    m_numBatches.fetch_add(1, memory_order_relaxed);
+  }
+}
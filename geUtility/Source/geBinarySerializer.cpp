@@ -42,6 +42,7 @@
 #include "geRTTIManagedDataBlockField.h"
 #include "geMemorySerializer.h"
 #include "geDataStream.h"
+#include "geProfilerCPU.h"
 
 #include <unordered_set>
 
@@ -84,6 +85,7 @@ namespace geEngineSDK {
                            function<uint8*(uint8*, uint32, uint32&)> flushBufferCallback,
                            bool shallow,
                            const UnorderedMap<String, uint64>& params) {
+    GE_PROFILE_SCOPE("BinarySerializer::encode");
     m_objectsToEncode.clear();
     m_objectAddrToId.clear();
     m_lastUsedObjectId = 1;
@@ -172,6 +174,7 @@ namespace geEngineSDK {
   BinarySerializer::decode(const SPtr<DataStream>& data,
                            uint32 dataLength,
                            const UnorderedMap<String, uint64>& params) {
+    GE_PROFILE_SCOPE("BinarySerializer::decode");
     m_params = params;
 
     if (0 == dataLength) {
@@ -22,6 +22,7 @@
 #include "geBox.h"
 #include "geVector4.h"
 #include "geMatrix4.h"
+#include "geVector3Stream.h"
 
 #define SIMDPP_ARCH_X86_SSE4_1
 
@@ -41,22 +42,16 @@ namespace geEngineSDK {
   using namespace simdpp;
 
   AABox::AABox(const Vector3* Points, SIZE_T Count)
-    : m_min(0, 0, 0),
-      m_max(0, 0, 0),
-      m_isValid(0) {
-    for (SIZE_T i = 0; i < Count; ++i) {
-      *this += Points[i];
-    }
-  }
+    : AABox(Vector3Stream::getBounds(Points, Count))
+  {}
 
   AABox::AABox(const Vector<Vector3>& Points)
-    : m_min(0, 0, 0),
-      m_max(0, 0, 0),
-      m_isValid(0) {
-    for (auto& Point : Points) {
-      *this += Point;
-    }
-  }
+    : AABox(Vector3Stream::getBounds(Points.data(), Points.size()))
+  {}
+
+  AABox::AABox(const Vector3Stream& Points)
+    : AABox(Points.getBounds())
+  {}
 
   AABox
   AABox::transformBy(const Matrix4& M) const {
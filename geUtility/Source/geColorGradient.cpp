@@ -19,8 +19,33 @@
 #include "geColorGradient.h"
 #include "geDebug.h"
 #include "geBitwise.h"
+#include "geSIMD.h"
 
 namespace geEngineSDK {
+  using simd::float32x4;
+  using simd::int32x4;
+  using simd::mask_float32x4;
+
+  namespace {
+    FORCEINLINE float32x4
+    loadColor(const LinearColor& color) {
+      return simd::load_u(&color.r);
+    }
+
+    FORCEINLINE void
+    storeColor(LinearColor& color, const float32x4& value) {
+      simd::store_u(&color.r, value);
+    }
+
+    /**
+     * @brief color0 + (color1 - color0) * alpha on a single SIMD register.
+     */
+    FORCEINLINE float32x4
+    lerpColor(const LinearColor& color0, const LinearColor& delta, float alpha) {
+      return loadColor(color0) + loadColor(delta) * simd::splat<float32x4>(alpha);
+    }
+  }
+
   LinearColor
   ColorGradient::evaluate(float t) const {
     if (0 == m_numKeys) {
@@ -36,7 +61,6 @@ namespace geEngineSDK {
                        m_times[0],
                        m_times[m_numKeys - 1]);
 
-    //TODO: Add a version of evaluate that supports caching?
     for (uint32 i = 1; i < m_numKeys; ++i) {
       const float curKeyTime = m_times[i];
       if (time > curKeyTime) {
@@ -51,6 +75,159 @@ namespace geEngineSDK {
     return m_colors[m_numKeys - 1];
   }
 
+  void
+  ColorGradient::evaluate(const float* t, LinearColor* output, SIZE_T count) const {
+    if (2 > m_numKeys) {
+      const LinearColor color = evaluate(0.0f);
+      for (SIZE_T i = 0; i < count; ++i) {
+        output[i] = color;
+      }
+      return;
+    }
+
+    const float32x4 firstTime = simd::splat<float32x4>(m_times[0]);
+    const float32x4 lastTime = simd::splat<float32x4>(m_times[m_numKeys - 1]);
+    const float32x4 one = simd::splat<float32x4>(1.0f);
+    const float32x4 zero = simd::splat<float32x4>(0.0f);
+
+    SIZE_T i = 0;
+    for (; i + 4 <= count; i += 4) {
+      float32x4 time = simd::min(simd::max(float32x4(simd::load_u(t + i)), firstTime), lastTime);
+
+      //The segment is the first key with a time not lower than the
+      //evaluated time, that is 1 + the number of inner keys before it.
+      float32x4 segment = one;
+      for (uint32 key = 1; key < m_numKeys - 1; ++key) {
+        mask_float32x4 after = simd::cmp_gt(time, simd::splat<float32x4>(m_times[key]));
+        segment = segment + simd::blend(one, zero, after);
+      }
+
+      SIMDPP_ALIGN(16) float times[4];
+      SIMDPP_ALIGN(16) int32 segments[4];
+      simd::store(times, time);
+      simd::store(segments, int32x4(simd::to_int32(segment)));
+
+      for (uint32 lane = 0; lane < 4; ++lane) {
+        const int32 key = segments[lane];
+        const float alpha = Math::clamp01((times[lane] - m_times[key - 1]) *
+                                          m_invLengths[key]);
+        storeColor(output[i + lane], lerpColor(m_colors[key - 1], m_deltas[key], alpha));
+      }
+    }
+
+    for (; i < count; ++i) {
+      output[i] = evaluate(t[i]);
+    }
+  }
+
+  LinearColor
+  ColorGradient::evaluate(float t, uint32& cursor) const {
+    if (2 > m_numKeys) {
+      return evaluate(t);
+    }
+
+    const float time = Math::clamp(t, m_times[0], m_times[m_numKeys - 1]);
+
+    uint32 key = Math::clamp(cursor, 1U, m_numKeys - 1);
+    if (time <= m_times[key - 1]) {
+      //Going backwards, restart the search
+      key = 1;
+    }
+
+    while (time > m_times[key]) {
+      ++key;
+    }
+
+    cursor = key;
+
+    const float alpha = Math::clamp01((time - m_times[key - 1]) * m_invLengths[key]);
+    LinearColor output;
+    storeColor(output, lerpColor(m_colors[key - 1], m_deltas[key], alpha));
+    return output;
+  }
+
+  void
+  ColorGradient::bake(uint32 resolution) {
+    if (0 == resolution) {
+      m_baked.clear();
+      m_baked.shrink_to_fit();
+      m_bakedScale = 0.0f;
+      return;
+    }
+
+    m_baked.resize(resolution + 1);
+    if (2 > m_numKeys) {
+      m_bakedScale = 0.0f;
+      for (auto& color : m_baked) {
+        color = evaluate(0.0f);
+      }
+      return;
+    }
+
+    const float start = m_times[0];
+    const float length = m_times[m_numKeys - 1] - start;
+    m_bakedScale = resolution / Math::max(length, 0.0001f);
+
+    uint32 cursor = 0;
+    for (uint32 i = 0; i <= resolution; ++i) {
+      m_baked[i] = evaluate(start + length * (i / static_cast<float>(resolution)), cursor);
+    }
+  }
+
+  LinearColor
+  ColorGradient::evaluateBaked(float t) const {
+    if (m_baked.empty() || 2 > m_numKeys) {
+      return evaluate(t);
+    }
+
+    const uint32 resolution = static_cast<uint32>(m_baked.size() - 1);
+    const float time = Math::clamp(t, m_times[0], m_times[m_numKeys - 1]);
+    const float position = (time - m_times[0]) * m_bakedScale;
+    const uint32 index = Math::min(static_cast<uint32>(position), resolution - 1);
+
+    return Math::lerp(m_baked[index], m_baked[index + 1], position - index);
+  }
+
+  void
+  ColorGradient::evaluateBaked(const float* t,
+                               LinearColor* output,
+                               SIZE_T count) const {
+    if (m_baked.empty() || 2 > m_numKeys) {
+      evaluate(t, output, count);
+      return;
+    }
+
+    const int32 resolution = static_cast<int32>(m_baked.size() - 1);
+    const float32x4 firstTime = simd::splat<float32x4>(m_times[0]);
+    const float32x4 lastTime = simd::splat<float32x4>(m_times[m_numKeys - 1]);
+    const float32x4 scale = simd::splat<float32x4>(m_bakedScale);
+
+    SIZE_T i = 0;
+    for (; i + 4 <= count; i += 4) {
+      float32x4 time = simd::min(simd::max(float32x4(simd::load_u(t + i)), firstTime), lastTime);
+      float32x4 position = (time - firstTime) * scale;
+      int32x4 index = simd::min(int32x4(simd::to_int32(position)),
+                                simd::splat<int32x4>(resolution - 1));
+
+      SIMDPP_ALIGN(16) float alphas[4];
+      SIMDPP_ALIGN(16) int32 indices[4];
+      simd::store(alphas, float32x4(position - simd::to_float32(index)));
+      simd::store(indices, index);
+
+      for (uint32 lane = 0; lane < 4; ++lane) {
+        const LinearColor* entry = &m_baked[indices[lane]];
+        float32x4 color0 = loadColor(entry[0]);
+        float32x4 color1 = loadColor(entry[1]);
+        storeColor(output[i + lane],
+                   color0 + (color1 - color0) * simd::splat<float32x4>(alphas[lane]));
+      }
+    }
+
+    for (; i < count; ++i) {
+      output[i] = evaluateBaked(t[i]);
+    }
+  }
+
   void
   ColorGradient::setKeys(const Vector<ColorGradientKey>& keys,
                          float duration) {
@@ -71,6 +248,7 @@ namespace geEngineSDK {
     }
 
     m_duration = duration;
+    update();
   }
 
   void
@@ -79,5 +257,19 @@ namespace geEngineSDK {
     m_times[0] = 0;
     m_numKeys = 1;
     m_duration = 0.0f;
+    update();
+  }
+
+  void
+  ColorGradient::update() {
+    for (uint32 i = 1; i < m_numKeys; ++i) {
+      //Same minimum length as Math::invLerp()
+      m_invLengths[i] = 1.0f / Math::max(m_times[i] - m_times[i - 1], 0.0001f);
+      m_deltas[i] = m_colors[i] - m_colors[i - 1];
+    }
+
+    if (!m_baked.empty()) {
+      bake(static_cast<uint32>(m_baked.size() - 1));
+    }
   }
 }
@@ -19,11 +19,13 @@
 #include "gePrerequisitesUtil.h"
 #include "geDebug.h"
 #include "geFileSystem.h"
+#include "geFlightRecorder.h"
 #include "gePath.h"
 
 namespace geEngineSDK {
   const String CrashHandler::s_crashReportFolder = "Reports";
   const String CrashHandler::s_crashLogName = u8"geEngine_Log.html";
+  const String CrashHandler::s_flightRecordName = u8"geEngine_FlightRecord.txt";
   const String CrashHandler::s_fatalErrorMsg = 
     "A fatal error occurred and the program has to terminate!";
 
@@ -74,6 +76,9 @@ namespace geEngineSDK {
 
   void
   CrashHandler::saveCrashLog() const {
+    //The flight record is saved first, it needs less of the state that may
+    //be broken by the crash
+    FlightRecorder::save(getCrashFolder() + s_flightRecordName);
     g_Debug().saveLog(getCrashFolder() + s_crashLogName);
   }
 }
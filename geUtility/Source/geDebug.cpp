@@ -18,10 +18,12 @@
 /*****************************************************************************/
 #include "geDebug.h"
 #include "geLog.h"
+#include "geAsyncLog.h"
 #include "geException.h"
 #include "geBitmapWriter.h"
 #include "geFileSystem.h"
 #include "geDataStream.h"
+#include "geFlightRecorder.h"
 
 #if GE_PLATFORM == GE_PLATFORM_WIN32 && GE_COMPILER == GE_COMPILER_MSVC
 #	include <windows.h>
@@ -45,26 +47,53 @@ logToIDEConsole(const geEngineSDK::String& message) {
 namespace geEngineSDK {
   void
   Debug::logDebug(const String& msg) {
-    m_log.logMsg(msg, (uint32)DEBUG_CHANNEL::kDebug);
-    logToIDEConsole(msg);
+    logMessage(msg, (uint32)DEBUG_CHANNEL::kDebug);
   }
 
   void
   Debug::logWarning(const String& msg) {
-    m_log.logMsg(msg, (uint32)DEBUG_CHANNEL::kWarning);
-    logToIDEConsole(msg);
+    logMessage(msg, (uint32)DEBUG_CHANNEL::kWarning);
   }
 
   void
   Debug::logError(const String& msg) {
-    m_log.logMsg(msg, (uint32)DEBUG_CHANNEL::kError);
-    logToIDEConsole(msg);
+    logMessage(msg, (uint32)DEBUG_CHANNEL::kError);
   }
 
   void
-  Debug::logMessage(const String& msg, uint32 channel) {
-    m_log.logMsg(msg, channel);
-    logToIDEConsole(msg);
+  Debug::logMessage(const String& msg,
+                    uint32 channel,
+                    const LogSourceLocation* location) {
+    if (!isChannelEnabled(channel)) {
+      return;
+    }
+
+    //The writer thread of the asynchronous log adds the message to m_log
+    if (AsyncLog::isStarted()) {
+      AsyncLog::instance().logMessage(msg, channel, location);
+      return;
+    }
+
+    FlightRecorder::recordLog(msg, channel, location);
+
+    LogEntry entry(msg, channel, Log::getCurrentTime(), Log::getCurrentThreadId(), location);
+    logToIDEConsole(entry.getFormattedMessage());
+    m_log.addEntry(std::move(entry));
+  }
+
+  void
+  Debug::setChannelEnabled(uint32 channel, bool enabled) {
+    if (channel >= 64) {
+      return;
+    }
+
+    const uint64 channelBit = 1ULL << channel;
+    if (enabled) {
+      m_enabledChannels.fetch_or(channelBit, std::memory_order_relaxed);
+    }
+    else {
+      m_enabledChannels.fetch_and(~channelBit, std::memory_order_relaxed);
+    }
   }
 
   void
@@ -196,7 +225,9 @@ R"(<!DOCTYPE HTML PUBLIC '-//W3C//DTD HTML 4.0 Transitional//EN'>
         stream << R"(<div class="cell">Debug</div>)" << std::endl;
       }
 
-      String parsedMessage = StringUtil::replaceAll(entry.getLogMessage(), "\n", "<BR>\n");
+      String parsedMessage = StringUtil::replaceAll(entry.getFormattedMessage(),
+                                                    "\n",
+                                                    "<BR>\n");
 
       stream << R"(<div class="cell">)" << parsedMessage << "</div>" << std::endl;
       stream << R"(</div>)" << std::endl;
@@ -208,6 +239,12 @@ R"(<!DOCTYPE HTML PUBLIC '-//W3C//DTD HTML 4.0 Transitional//EN'>
     fileStream->writeString(stream.str());
   }
 
+  void
+  Debug::saveLogBinary(const Path& path) const {
+    DataStreamPtr fileStream = FileSystem::createAndOpenFile(path);
+    LogArchive::write(m_log.getAllEntries(), *fileStream);
+  }
+
   GE_UTILITY_EXPORT Debug& g_Debug() {
     static Debug debug;
     return debug;
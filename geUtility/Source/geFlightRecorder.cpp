@@ -0,0 +1,370 @@
+/*****************************************************************************/
+/**
+ * @file    geFlightRecorder.cpp
+ * @author  Samuel Prince (samuel.prince.quezada@gmail.com)
+ * @date    2018/07/28
+ * @brief   Always-on recorder of the last events of every thread.
+ *
+ * Every thread writes small fixed-size binary records (log messages,
+ * profiler zones, tasks) to a ring buffer of its own, overwriting the oldest
+ * ones. Nothing is formatted until the records are saved, which the
+ * CrashHandler does when the application crashes.
+ *
+ * @bug     No known bugs.
+ */
+/*****************************************************************************/
+
+/*****************************************************************************/
+/**
+ * Includes
+ */
+/*****************************************************************************/
+#include "geFlightRecorder.h"
+#include "geDataStream.h"
+#include "geFileSystem.h"
+#include "geLog.h"
+#include "geProfilerCPU.h"
+#include "geTimer.h"
+
+namespace geEngineSDK {
+  using std::memory_order_acquire;
+  using std::memory_order_relaxed;
+  using std::memory_order_release;
+
+  namespace {
+    std::atomic<bool> s_enabled{true};
+
+    /**
+     * @brief Ring buffer of the records of a single thread. Only its owner
+     *        writes to it, readers copy the records and check they weren't
+     *        overwritten meanwhile.
+     */
+    struct ThreadRecords
+    {
+      struct Slot
+      {
+        /**
+         * @brief Position of the record in the ring plus one, or 0 while
+         *        the record is being written.
+         */
+        std::atomic<uint64> sequence{0};
+        FlightRecord record;
+      };
+
+      explicit ThreadRecords(uint32 threadIdx)
+        : m_slots(FlightRecorder::RECORDS_PER_THREAD),
+          m_threadIdx(threadIdx)
+      {}
+
+      void
+      push(FLIGHT_RECORD::E type,
+           const void* source,
+           uint64 value,
+           const char* text,
+           SIZE_T size,
+           uint64 time) {
+        const uint64 head = m_head.load(memory_order_relaxed);
+        const SIZE_T mask = m_slots.size() - 1;
+        Slot& slot = m_slots[static_cast<SIZE_T>(head) & mask];
+
+        if (0 == time) {
+          time = CycleTimer::now();
+        }
+        else if (FlightRecorder::UNTIMED == time) {
+          //Only the owner writes, the previous slot can't change meanwhile
+          time = head != m_first.load(memory_order_relaxed) ?
+            m_slots[static_cast<SIZE_T>(head - 1) & mask].record.time : CycleTimer::now();
+        }
+
+        slot.sequence.store(0, memory_order_relaxed);
+        std::atomic_thread_fence(memory_order_release);
+
+        FlightRecord& record = slot.record;
+        record.time = time;
+        record.source = source;
+        record.value = value;
+        record.type = static_cast<uint8>(type);
+        size = std::min(size, SIZE_T(FlightRecord::MAX_TEXT_SIZE));
+        record.textSize = static_cast<uint8>(size);
+
+        //Copy in words, short variable sized copies are slow to start
+        SIZE_T i = 0;
+        for (; i + sizeof(uint64) <= size; i += sizeof(uint64)) {
+          memcpy(record.text + i, text + i, sizeof(uint64));
+        }
+        for (; i < size; ++i) {
+          record.text[i] = text[i];
+        }
+
+        slot.sequence.store(head + 1, memory_order_release);
+        m_head.store(head + 1, memory_order_release);
+      }
+
+      Vector<Slot> m_slots;
+      uint32 m_threadIdx;
+      std::atomic<uint64> m_threadId{0};
+      std::atomic<uint64> m_head{0};
+
+      /**
+       * @brief Position of the first record of the current owner. Records
+       *        before it belong to a thread that exited.
+       */
+      std::atomic<uint64> m_first{0};
+
+      /**
+       * @brief Set once the owner thread exits, so a new thread can take it.
+       */
+      std::atomic<bool> m_released{false};
+    };
+
+    /**
+     * @brief Records of every thread that ever recorded. Never destroyed, as
+     *        threads may still record during the static destruction.
+     */
+    struct ThreadRecordsList
+    {
+      Mutex mutex;
+      Vector<SPtr<ThreadRecords>> threads;
+    };
+
+    ThreadRecordsList&
+    getThreadRecordsList() {
+      static ThreadRecordsList* list = ge_new<ThreadRecordsList>();
+      return *list;
+    }
+
+    /**
+     * @brief Thread local reference to the records of a thread. Hands the
+     *        buffer back when the thread exits.
+     */
+    struct ThreadRecordsHolder
+    {
+      ~ThreadRecordsHolder() {
+        if (m_records) {
+          m_records->m_released.store(true, memory_order_release);
+        }
+      }
+
+      SPtr<ThreadRecords> m_records;
+    };
+
+    /**
+     * @brief Records of the calling thread. Kept apart from the holder, which
+     *        has a destructor, so adding a record only reads a plain pointer.
+     */
+    thread_local void* t_records = nullptr;
+
+    ThreadRecords*
+    getThreadRecords() {
+      //Needs a destructor to hand the buffer back, so GE_THREADLOCAL won't do
+      static thread_local ThreadRecordsHolder holder;
+      if (holder.m_records) {
+        return holder.m_records.get();
+      }
+
+      ThreadRecordsList& list = getThreadRecordsList();
+      Lock lock(list.mutex);
+      for (auto& records : list.threads) {
+        if (records->m_released.load(memory_order_acquire)) {
+          records->m_first.store(records->m_head.load(memory_order_relaxed),
+                                 memory_order_release);
+          records->m_released.store(false, memory_order_relaxed);
+          holder.m_records = records;
+          break;
+        }
+      }
+
+      if (!holder.m_records) {
+        holder.m_records = ge_shared_ptr_new<ThreadRecords>(
+                             static_cast<uint32>(list.threads.size()));
+        list.threads.push_back(holder.m_records);
+      }
+
+      holder.m_records->m_threadId.store(Log::getCurrentThreadId(), memory_order_relaxed);
+      t_records = holder.m_records.get();
+      return holder.m_records.get();
+    }
+
+    /**
+     * @brief Copies the records of a thread that are still in its buffer,
+     *        oldest first.
+     */
+    void
+    copyRecords(const ThreadRecords& records, Vector<FlightRecord>& output) {
+      const uint64 head = records.m_head.load(memory_order_acquire);
+      const uint64 numSlots = records.m_slots.size();
+      const uint64 first = std::max(records.m_first.load(memory_order_acquire),
+                                    head > numSlots ? head - numSlots : 0);
+
+      output.reserve(static_cast<SIZE_T>(head - first));
+      for (uint64 i = first; i < head; ++i) {
+        auto& slot = records.m_slots[static_cast<SIZE_T>(i) & (numSlots - 1)];
+        if (slot.sequence.load(memory_order_acquire) != i + 1) {
+          continue;
+        }
+
+        FlightRecord record = slot.record;
+        std::atomic_thread_fence(memory_order_acquire);
+        if (slot.sequence.load(memory_order_relaxed) != i + 1) {
+          continue;
+        }
+
+        output.push_back(record);
+      }
+    }
+
+    const char*
+    getRecordTypeName(uint8 type) {
+      switch (type) {
+        case FLIGHT_RECORD::kLog:        return "Log";
+        case FLIGHT_RECORD::kZoneBegin:  return "Begin";
+        case FLIGHT_RECORD::kZoneEnd:    return "End";
+        case FLIGHT_RECORD::kTaskQueued: return "Queued";
+        case FLIGHT_RECORD::kTaskBegin:  return "Task";
+        case FLIGHT_RECORD::kTaskEnd:    return "Done";
+        case FLIGHT_RECORD::kMarker:     return "Marker";
+        default:                         return "?";
+      }
+    }
+  }
+
+  void
+  FlightRecorder::write(FLIGHT_RECORD::E type,
+                        const void* source,
+                        uint64 value,
+                        const char* text,
+                        SIZE_T size,
+                        uint64 time) {
+    if (!s_enabled.load(memory_order_relaxed)) {
+      return;
+    }
+
+    auto records = static_cast<ThreadRecords*>(t_records);
+    if (nullptr == records) {
+      records = getThreadRecords();
+    }
+
+    records->push(type, source, value, text, size, time);
+  }
+
+  void
+  FlightRecorder::setEnabled(bool enabled) {
+    s_enabled.store(enabled, memory_order_relaxed);
+  }
+
+  bool
+  FlightRecorder::isEnabled() {
+    return s_enabled.load(memory_order_relaxed);
+  }
+
+  Vector<FlightRecorderThread>
+  FlightRecorder::getRecords() {
+    Vector<FlightRecorderThread> output;
+
+    ThreadRecordsList& list = getThreadRecordsList();
+    Lock lock(list.mutex);
+    output.resize(list.threads.size());
+    for (SIZE_T i = 0; i < list.threads.size(); ++i) {
+      const ThreadRecords& records = *list.threads[i];
+      output[i].threadIdx = records.m_threadIdx;
+      output[i].threadId = records.m_threadId.load(memory_order_relaxed);
+      copyRecords(records, output[i].records);
+    }
+
+    return output;
+  }
+
+  String
+  FlightRecorder::getText() {
+    //Records keep raw counts, they are only converted here
+    CycleTimer::calibrate();
+
+    Vector<FlightRecorderThread> threads = getRecords();
+    const uint64 now = CycleTimer::now();
+    const uint64 currentThreadId = Log::getCurrentThreadId();
+
+    String output;
+    char line[512];
+
+    for (auto& thread : threads) {
+      snprintf(line,
+               sizeof(line),
+               "Thread %u (ID %llu)%s, %u records\n",
+               thread.threadIdx,
+               static_cast<unsigned long long>(thread.threadId),
+               thread.threadId == currentThreadId ? ", current thread" : "",
+               static_cast<uint32>(thread.records.size()));
+      output += line;
+
+      for (auto& record : thread.records) {
+        const double msAgo = record.time < now ?
+          CycleTimer::toNanoseconds(now - record.time) / 1000000.0 : 0.0;
+
+        int32 length = snprintf(line,
+                                sizeof(line),
+                                "  -%12.6f ms  %-6s  ",
+                                msAgo,
+                                getRecordTypeName(record.type));
+
+        const char* file = nullptr;
+        uint32 sourceLine = 0;
+        auto append = [&](const char* format, auto... args) {
+          if (length >= 0 && length < static_cast<int32>(sizeof(line))) {
+            length += snprintf(line + length, sizeof(line) - length, format, args...);
+          }
+        };
+
+        switch (record.type) {
+          case FLIGHT_RECORD::kLog:
+            if (auto location = static_cast<const LogSourceLocation*>(record.source)) {
+              file = location->file;
+              sourceLine = location->line;
+            }
+            append("[%u] ", static_cast<uint32>(record.value));
+            break;
+          case FLIGHT_RECORD::kZoneBegin:
+          case FLIGHT_RECORD::kZoneEnd:
+            if (auto zone = static_cast<const ProfilerZone*>(record.source)) {
+              file = zone->file;
+              sourceLine = zone->line;
+              append("%s", zone->name);
+            }
+            break;
+          case FLIGHT_RECORD::kTaskQueued:
+          case FLIGHT_RECORD::kTaskBegin:
+          case FLIGHT_RECORD::kTaskEnd:
+            append("#%llu ", static_cast<unsigned long long>(record.value));
+            break;
+          case FLIGHT_RECORD::kMarker:
+            append("(%llu) ", static_cast<unsigned long long>(record.value));
+            break;
+          default:
+            break;
+        }
+
+        //Keep each record on its own line
+        char text[FlightRecord::MAX_TEXT_SIZE];
+        for (uint32 i = 0; i < record.textSize; ++i) {
+          text[i] = static_cast<uint8>(record.text[i]) < ' ' ? ' ' : record.text[i];
+        }
+        append("%.*s", static_cast<int32>(record.textSize), text);
+        if (nullptr != file) {
+          append("  (%s:%u)", file, sourceLine);
+        }
+
+        output += line;
+        output += '\n';
+      }
+
+      output += '\n';
+    }
+
+    return output;
+  }
+
+  void
+  FlightRecorder::save(const Path& path) {
+    DataStreamPtr fileStream = FileSystem::createAndOpenFile(path);
+    fileStream->writeString(getText());
+  }
+}
@@ -0,0 +1,276 @@
+/*****************************************************************************/
+/**
+ * @file    geFloatPacking.cpp
+ * @author  Samuel Prince (samuel.prince.quezada@gmail.com)
+ * @date    2018/07/03
+ * @brief   Bulk conversion between 32-bit floats and reduced precision floats.
+ *
+ * Bulk conversion between 32-bit floats and the reduced precision formats
+ * (Float16, Float11, Float10). The conversions run on SIMD registers and
+ * produce the exact same bit patterns as the scalar classes.
+ *
+ * @bug     No known bugs.
+ */
+/*****************************************************************************/
+
+/*****************************************************************************/
+/**
+ * Includes
+ */
+/*****************************************************************************/
+#include "geFloatPacking.h"
+#include "geFloat10.h"
+#include "geFloat11.h"
+#include "geColor.h"
+#include "geVector3.h"
+#include "geSIMD.h"
+
+namespace geEngineSDK {
+  using simd::float32x4;
+  using simd::uint32x4;
+  using simd::int32x4;
+  using simd::float32x8;
+  using simd::uint32x8;
+  using simd::int32x8;
+  using simd::uint16x8;
+  using simd::mask_int32x4;
+
+  static_assert(sizeof(Float16) == sizeof(uint16),
+                "Float16 must be tightly packed for bulk conversion.");
+  static_assert(sizeof(Float16Color) == sizeof(Float16) * 4,
+                "Float16Color must be tightly packed for bulk conversion.");
+  static_assert(sizeof(LinearColor) == sizeof(float) * 4,
+                "LinearColor must be tightly packed for bulk conversion.");
+
+  namespace {
+    /**
+     * @brief Float16::set() on eight lanes.
+     */
+    FORCEINLINE uint16x8
+    encodeHalf(const uint32x8& bits) {
+      uint32x8 sign = simd::shift_r<16>(bits) & simd::splat<uint32x8>(0x8000);
+      uint32x8 absBits = bits & simd::splat<uint32x8>(0x7FFFFFFF);
+      int32x8 exponent = simd::shift_r<23>(absBits);
+
+      //Re-bias the exponent and drop the lower 13 bits of the mantissa
+      uint32x8 result = simd::shift_r<13>(absBits) - simd::splat<uint32x8>(112 << 10);
+
+      //Too big (or Inf/NaN) is clamped to 65504.0, too small is flushed to zero
+      result = simd::blend(simd::splat<uint32x8>(0x7BFF),
+                           result,
+                           simd::cmp_gt(exponent, simd::splat<int32x8>(142)));
+      result = simd::blend(simd::splat<uint32x8>(0),
+                           result,
+                           simd::cmp_lt(exponent, simd::splat<int32x8>(113)));
+
+      return simd::to_uint16(result | sign);
+    }
+
+    /**
+     * @brief Float16::getFloat() on eight lanes.
+     */
+    FORCEINLINE uint32x8
+    decodeHalf(const uint16x8& half) {
+      uint32x8 h = simd::to_uint32(half);
+      uint32x8 sign = simd::shift_l<16>(h & simd::splat<uint32x8>(0x8000));
+      int32x8 exponent = h & simd::splat<uint32x8>(0x7C00);
+      int32x8 mantissa = h & simd::splat<uint32x8>(0x03FF);
+
+      uint32x8 normal = simd::shift_l<13>(h & simd::splat<uint32x8>(0x7FFF)) +
+                        simd::splat<uint32x8>(112 << 23);
+
+      //Denormals (and zero) are exactly mantissa * 2^-24
+      float32x8 denormal = simd::to_float32(mantissa) *
+                           simd::splat<float32x8>(1.0f / 16777216.0f);
+
+      uint32x8 result = simd::blend(simd::bit_cast<uint32x8>(denormal),
+                                    normal,
+                                    simd::cmp_eq(exponent, simd::splat<int32x8>(0)));
+
+      //Infinity or NaN are set to 65504.0
+      result = simd::blend(simd::splat<uint32x8>(0x477FE000),
+                           result,
+                           simd::cmp_eq(exponent, simd::splat<int32x8>(0x7C00)));
+
+      return result | sign;
+    }
+
+    /**
+     * @brief Returns true if any of the lanes needs the scalar path of
+     *        Float11::set() / Float10::set(), that is Inf, NaN or values that
+     *        have to be converted into a denormalized packed float.
+     */
+    FORCEINLINE bool
+    needsScalarPackedFloat(const int32x4& bits) {
+      int32x4 exponentBits = bits & simd::splat<int32x4>(0x7F800000);
+      mask_int32x4 special = simd::cmp_eq(exponentBits, simd::splat<int32x4>(0x7F800000));
+      mask_int32x4 denormal = simd::cmp_gt(bits, simd::splat<int32x4>(0)) &
+                              simd::cmp_lt(bits, simd::splat<int32x4>(0x38800000));
+
+      return simd::test_bits_any(simd::bit_cast<uint32x4>(special | denormal));
+    }
+
+    /**
+     * @brief Float11::set() / Float10::set() for the lanes that don't need
+     *        the scalar path.
+     * @tparam  shift Number of mantissa bits dropped by the format.
+     */
+    template<uint32 shift>
+    FORCEINLINE uint32x4
+    encodePackedFloat(const int32x4& bits, int32 maxBits, uint32 maxEncoded) {
+      uint32x4 val = simd::bit_cast<uint32x4>(bits) + simd::splat<uint32x4>(0xC8000000);
+      uint32x4 round = simd::shift_r<shift>(val) & simd::splat<uint32x4>(1);
+      uint32x4 result = simd::shift_r<shift>(val +
+                                             simd::splat<uint32x4>((1U << (shift - 1)) - 1) +
+                                             round);
+      result = result & simd::splat<uint32x4>((1U << (28 - shift)) - 1);
+
+      //Too large values are clamped to the max value
+      result = simd::blend(simd::splat<uint32x4>(maxEncoded),
+                           result,
+                           simd::cmp_gt(bits, simd::splat<int32x4>(maxBits)));
+
+      //No negatives allowed, zero and negatives are clamped to 0
+      return simd::blend(simd::splat<uint32x4>(0),
+                         result,
+                         simd::cmp_le(bits, simd::splat<int32x4>(0)));
+    }
+
+    /**
+     * @brief Float11::getFloat() / Float10::getFloat() on four lanes.
+     * @tparam  mantissaBits  Number of mantissa bits of the format.
+     */
+    template<uint32 mantissaBits>
+    FORCEINLINE float32x4
+    decodePackedFloat(const uint32x4& encoded) {
+      static constexpr uint32 shift = 23 - mantissaBits;
+      static constexpr uint32 exponentMask = 31 << mantissaBits;
+      static constexpr float denormalScale = 1.0f / (1 << (14 + mantissaBits));
+
+      int32x4 exponent = encoded & simd::splat<uint32x4>(exponentMask);
+      int32x4 mantissa = encoded & simd::splat<uint32x4>((1 << mantissaBits) - 1);
+
+      uint32x4 normal = simd::shift_l<shift>(encoded) + simd::splat<uint32x4>(112 << 23);
+      uint32x4 infNaN = simd::shift_l<shift>(simd::bit_cast<uint32x4>(mantissa)) |
+                        simd::splat<uint32x4>(0x7F800000);
+      float32x4 denormal = simd::to_float32(mantissa) *
+                           simd::splat<float32x4>(denormalScale);
+
+      uint32x4 result = simd::blend(simd::bit_cast<uint32x4>(denormal),
+                                    normal,
+                                    simd::cmp_eq(exponent, simd::splat<int32x4>(0)));
+      result = simd::blend(infNaN,
+                           result,
+                           simd::cmp_eq(exponent, simd::splat<int32x4>(exponentMask)));
+
+      return simd::bit_cast<float32x4>(result);
+    }
+
+    FORCEINLINE uint32
+    packR11G11B10(const Vector3& value) {
+      return Float11(value.x).encoded |
+            (Float11(value.y).encoded << 11) |
+            (Float10(value.z).encoded << 22);
+    }
+  }
+
+  void
+  FloatPacking::floatToHalf(const float* input, Float16* output, SIZE_T count) {
+    SIZE_T i = 0;
+    for (; i + 8 <= count; i += 8) {
+      uint32x8 bits = simd::load_u(input + i);
+      simd::store_u(&output[i].encoded, encodeHalf(bits));
+    }
+
+    for (; i < count; ++i) {
+      output[i].set(input[i]);
+    }
+  }
+
+  void
+  FloatPacking::halfToFloat(const Float16* input, float* output, SIZE_T count) {
+    SIZE_T i = 0;
+    for (; i + 8 <= count; i += 8) {
+      uint16x8 half = simd::load_u(&input[i].encoded);
+      simd::store_u(output + i, decodeHalf(half));
+    }
+
+    for (; i < count; ++i) {
+      output[i] = input[i].getFloat();
+    }
+  }
+
+  void
+  FloatPacking::colorToHalf(const LinearColor* input,
+                            Float16Color* output,
+                            SIZE_T count) {
+    floatToHalf(&input->r, &output->r, count * 4);
+  }
+
+  void
+  FloatPacking::halfToColor(const Float16Color* input,
+                            LinearColor* output,
+                            SIZE_T count) {
+    halfToFloat(&input->r, &output->r, count * 4);
+  }
+
+  void
+  FloatPacking::vectorToR11G11B10(const Vector3* input,
+                                  uint32* output,
+                                  SIZE_T count) {
+    SIZE_T i = 0;
+    for (; i + 4 <= count; i += 4) {
+      SIMDPP_ALIGN(16) float tmp[12];
+      memcpy(tmp, input + i, sizeof(Vector3) * 4);
+
+      int32x4 x, y, z;
+      simd::load_packed3(x, y, z, tmp);
+
+      if (needsScalarPackedFloat(x) ||
+          needsScalarPackedFloat(y) ||
+          needsScalarPackedFloat(z)) {
+        for (SIZE_T j = i; j < i + 4; ++j) {
+          output[j] = packR11G11B10(input[j]);
+        }
+        continue;
+      }
+
+      uint32x4 packed = encodePackedFloat<17>(x, 0x477E0000, 1983) |
+                        simd::shift_l<11>(encodePackedFloat<17>(y, 0x477E0000, 1983)) |
+                        simd::shift_l<22>(encodePackedFloat<18>(z, 0x477C0000, 991));
+      simd::store_u(output + i, packed);
+    }
+
+    for (; i < count; ++i) {
+      output[i] = packR11G11B10(input[i]);
+    }
+  }
+
+  void
+  FloatPacking::r11g11b10ToVector(const uint32* input,
+                                  Vector3* output,
+                                  SIZE_T count) {
+    SIZE_T i = 0;
+    for (; i + 4 <= count; i += 4) {
+      uint32x4 packed = simd::load_u(input + i);
+      uint32x4 mask11 = simd::splat<uint32x4>(2047);
+
+      float32x4 x = decodePackedFloat<6>(packed & mask11);
+      float32x4 y = decodePackedFloat<6>(simd::shift_r<11>(packed) & mask11);
+      float32x4 z = decodePackedFloat<5>(simd::shift_r<22>(packed));
+
+      SIMDPP_ALIGN(16) float tmp[12];
+      simd::store_packed3(tmp, x, y, z);
+      memcpy(output + i, tmp, sizeof(Vector3) * 4);
+    }
+
+    for (; i < count; ++i) {
+      Float11 x, y;
+      Float10 z;
+      x.encoded = input[i] & 2047;
+      y.encoded = (input[i] >> 11) & 2047;
+      z.encoded = input[i] >> 22;
+      output[i] = Vector3(x.getFloat(), y.getFloat(), z.getFloat());
+    }
+  }
+}
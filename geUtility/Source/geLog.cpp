@@ -18,17 +18,152 @@
 */
 /*****************************************************************************/
 #include "geLog.h"
+#include "geDataStream.h"
 #include "geException.h"
+#include "geTime.h"
 
 namespace geEngineSDK {
+  namespace {
+    /**
+     * @brief Identifies log archives, "GELA" in little endian.
+     */
+    const uint32 LOG_ARCHIVE_MAGIC = 0x414C4547;
+    const uint32 LOG_ARCHIVE_VERSION = 1;
+
+    /**
+     * @brief Appends a number in LEB128 form: 7 bits per byte, the high bit
+     *        set on every byte but the last.
+     */
+    void
+    writeVarInt(Vector<uint8>& data, uint64 value) {
+      while (value >= 0x80) {
+        data.push_back(static_cast<uint8>(value | 0x80));
+        value >>= 7;
+      }
+      data.push_back(static_cast<uint8>(value));
+    }
+
+    void
+    writeBytes(Vector<uint8>& data, const void* bytes, SIZE_T size) {
+      const uint8* begin = reinterpret_cast<const uint8*>(bytes);
+      data.insert(data.end(), begin, begin + size);
+    }
+
+    void
+    writeString(Vector<uint8>& data, const char* string, SIZE_T size) {
+      writeVarInt(data, size);
+      writeBytes(data, string, size);
+    }
+
+    /**
+     * @brief Reads the fields of a log archive, failing on any value past
+     *        the end of the data.
+     */
+    class ArchiveReader
+    {
+     public:
+      ArchiveReader(const uint8* data, SIZE_T size)
+        : m_data(data),
+          m_end(data + size)
+      {}
+
+      bool
+      readVarInt(uint64& value) {
+        value = 0;
+        for (uint32 shift = 0; shift < 64; shift += 7) {
+          if (m_data == m_end) {
+            return false;
+          }
+
+          uint8 byte = *m_data++;
+          value |= static_cast<uint64>(byte & 0x7F) << shift;
+          if (0 == (byte & 0x80)) {
+            return true;
+          }
+        }
+
+        return false;
+      }
+
+      bool
+      readIndex(uint32& index, SIZE_T count) {
+        uint64 value;
+        if (!readVarInt(value) || value >= count) {
+          return false;
+        }
+
+        index = static_cast<uint32>(value);
+        return true;
+      }
+
+      bool
+      readBytes(void* bytes, SIZE_T size) {
+        if (static_cast<SIZE_T>(m_end - m_data) < size) {
+          return false;
+        }
+
+        memcpy(bytes, m_data, size);
+        m_data += size;
+        return true;
+      }
+
+      bool
+      readString(String& string) {
+        uint64 size;
+        if (!readVarInt(size) || static_cast<uint64>(m_end - m_data) < size) {
+          return false;
+        }
+
+        string.assign(reinterpret_cast<const char*>(m_data), static_cast<SIZE_T>(size));
+        m_data += size;
+        return true;
+      }
+
+     private:
+      const uint8* m_data;
+      const uint8* m_end;
+    };
+  }
+
+  String
+  LogEntry::getFormattedMessage() const {
+    if (nullptr == m_location) {
+      return m_msg;
+    }
+
+    return m_msg + "\n\t\t in " + m_location->function +
+           " [" + m_location->file + ":" + toString(m_location->line) + "]\n";
+  }
+
   Log::~Log() {
     clear();
   }
 
   void
-  Log::logMsg(const String& message, uint32 channel) {
+  Log::logMsg(const String& message,
+              uint32 channel,
+              const LogSourceLocation* location) {
+    addEntry(LogEntry(message,
+                      channel,
+                      getCurrentTime(),
+                      getCurrentThreadId(),
+                      location));
+  }
+
+  void
+  Log::addEntry(LogEntry entry) {
     RecursiveLock lock(m_mutex);
-    m_unreadEntries.push(LogEntry(message, channel));
+    m_unreadEntries.push(std::move(entry));
+  }
+
+  uint64
+  Log::getCurrentTime() {
+    return Time::isStarted() ? g_time().getTimePrecise() : 0;
+  }
+
+  uint64
+  Log::getCurrentThreadId() {
+    return static_cast<uint64>(std::hash<ThreadId>()(GE_THREAD_CURRENT_ID));
   }
 
   void
@@ -127,4 +262,160 @@ namespace geEngineSDK {
     
     return entries;
   }
+
+  void
+  LogArchive::write(const Vector<LogEntry>& entries, DataStream& stream) {
+    //Source locations are static, so equal pointers are the same location
+    UnorderedMap<const char*, uint32> stringIndices;
+    UnorderedMap<const LogSourceLocation*, uint32> locationIndices;
+    UnorderedMap<uint64, uint32> threadIndices;
+    Vector<const char*> strings;
+    Vector<const LogSourceLocation*> locations;
+    Vector<uint64> threads;
+
+    auto addString = [&](const char* string) {
+      auto inserted = stringIndices.insert({string, static_cast<uint32>(strings.size())});
+      if (inserted.second) {
+        strings.push_back(string);
+      }
+    };
+
+    for (auto& entry : entries) {
+      const LogSourceLocation* location = entry.getSourceLocation();
+      if (nullptr != location &&
+          locationIndices.insert({location, static_cast<uint32>(locations.size())}).second) {
+        locations.push_back(location);
+        addString(location->file);
+        addString(location->function);
+      }
+
+      if (threadIndices.insert({entry.getThreadId(),
+                                static_cast<uint32>(threads.size())}).second) {
+        threads.push_back(entry.getThreadId());
+      }
+    }
+
+    Vector<uint8> data;
+    writeBytes(data, &LOG_ARCHIVE_MAGIC, sizeof(LOG_ARCHIVE_MAGIC));
+    writeBytes(data, &LOG_ARCHIVE_VERSION, sizeof(LOG_ARCHIVE_VERSION));
+
+    writeVarInt(data, strings.size());
+    for (auto string : strings) {
+      writeString(data, string, strlen(string));
+    }
+
+    writeVarInt(data, locations.size());
+    for (auto location : locations) {
+      writeVarInt(data, stringIndices[location->file]);
+      writeVarInt(data, stringIndices[location->function]);
+      writeVarInt(data, location->line);
+    }
+
+    writeVarInt(data, threads.size());
+    for (auto threadId : threads) {
+      writeBytes(data, &threadId, sizeof(threadId));
+    }
+
+    writeVarInt(data, entries.size());
+    uint64 lastTime = 0;
+    for (auto& entry : entries) {
+      //Entries of several threads may be slightly out of order, so the time
+      //deltas are signed (zig-zag encoded)
+      int64 delta = static_cast<int64>(entry.getTime() - lastTime);
+      lastTime = entry.getTime();
+
+      writeVarInt(data, entry.getLogChannel());
+      writeVarInt(data, (static_cast<uint64>(delta) << 1) ^ static_cast<uint64>(delta >> 63));
+      writeVarInt(data, threadIndices[entry.getThreadId()]);
+
+      const LogSourceLocation* location = entry.getSourceLocation();
+      writeVarInt(data, nullptr != location ? locationIndices[location] + 1 : 0);
+
+      const String& message = entry.getLogMessage();
+      writeString(data, message.data(), message.size());
+    }
+
+    stream.write(data.data(), data.size());
+  }
+
+  bool
+  LogArchive::read(DataStream& stream) {
+    m_strings.clear();
+    m_locations.clear();
+    m_entries.clear();
+
+    Vector<uint8> data(stream.size() - stream.tell());
+    data.resize(stream.read(data.data(), data.size()));
+
+    ArchiveReader reader(data.data(), data.size());
+    uint32 magic = 0;
+    uint32 version = 0;
+    if (!reader.readBytes(&magic, sizeof(magic)) || LOG_ARCHIVE_MAGIC != magic ||
+        !reader.readBytes(&version, sizeof(version)) || LOG_ARCHIVE_VERSION != version) {
+      return false;
+    }
+
+    bool valid = true;
+    uint64 count = 0;
+
+    valid = valid && reader.readVarInt(count) && count <= data.size();
+    for (uint64 i = 0; valid && i < count; ++i) {
+      m_strings.emplace_back();
+      valid = reader.readString(m_strings.back());
+    }
+
+    valid = valid && reader.readVarInt(count) && count <= data.size();
+    for (uint64 i = 0; valid && i < count; ++i) {
+      uint32 fileIdx = 0;
+      uint32 functionIdx = 0;
+      uint64 line = 0;
+      valid = reader.readIndex(fileIdx, m_strings.size()) &&
+              reader.readIndex(functionIdx, m_strings.size()) &&
+              reader.readVarInt(line);
+      if (valid) {
+        m_locations.push_back({ m_strings[fileIdx].c_str(),
+                                m_strings[functionIdx].c_str(),
+                                static_cast<uint32>(line) });
+      }
+    }
+
+    Vector<uint64> threads;
+    valid = valid && reader.readVarInt(count) && count <= data.size();
+    for (uint64 i = 0; valid && i < count; ++i) {
+      uint64 threadId = 0;
+      valid = reader.readBytes(&threadId, sizeof(threadId));
+      threads.push_back(threadId);
+    }
+
+    valid = valid && reader.readVarInt(count) && count <= data.size();
+    uint64 time = 0;
+    for (uint64 i = 0; valid && i < count; ++i) {
+      uint64 channel = 0;
+      uint64 delta = 0;
+      uint32 threadIdx = 0;
+      uint32 locationIdx = 0;
+      String message;
+      valid = reader.readVarInt(channel) &&
+              reader.readVarInt(delta) &&
+              reader.readIndex(threadIdx, threads.size()) &&
+              reader.readIndex(locationIdx, m_locations.size() + 1) &&
+              reader.readString(message);
+      if (valid) {
+        time += (delta >> 1) ^ (~(delta & 1) + 1);
+        m_entries.emplace_back(std::move(message),
+                               static_cast<uint32>(channel),
+                               time,
+                               threads[threadIdx],
+                               0 != locationIdx ? &m_locations[locationIdx - 1] : nullptr);
+      }
+    }
+
+    if (!valid) {
+      m_strings.clear();
+      m_locations.clear();
+      m_entries.clear();
+    }
+
+    return valid;
+  }
 }
@@ -6,7 +6,9 @@
  * @brief   Allows to transparently pass messages between different systems
  *
  * Message system that allows you to transparently pass messages between
- * different systems. Only usable in the Simulation thread
+ * different systems. Messages are sent right away on the Simulation thread,
+ * or posted from any thread and sent when the Simulation thread calls
+ * processQueued().
  *
  * @bug	    No known bugs.
  */
@@ -18,80 +20,537 @@
 */
 /*****************************************************************************/
 #include "geMessageHandler.h"
+#include "geException.h"
 
 namespace geEngineSDK {
-  using std::remove_if;
+  using std::memory_order_acquire;
+  using std::memory_order_relaxed;
+  using std::memory_order_release;
 
-  Map<String, uint32> MessageId::m_uniqueMessageIds;
-  uint32 MessageId::m_nextMessageId = 0;
+  namespace {
+    constexpr uint32 INVALID_INDEX = NumLimit::MAX_UINT32;
 
-  MessageId::MessageId(const String& name) {
-    auto findIter = m_uniqueMessageIds.find(name);
+    /**
+     * @brief Handles keep the subscription index in the low bits (plus one,
+     *        so no handle is 0) and its generation in the high bits, so a
+     *        handle to a reused subscription does nothing.
+     */
+    constexpr uint32 HANDLE_INDEX_BITS = 20;
+    constexpr uint32 HANDLE_INDEX_MASK = (1u << HANDLE_INDEX_BITS) - 1;
+    constexpr uint32 HANDLE_GENERATION_MASK = (1u << (32 - HANDLE_INDEX_BITS)) - 1;
 
-    if (findIter != m_uniqueMessageIds.end()) {
-      m_msgIdentifier = findIter->second;
+    struct MessageIdRegistry
+    {
+      Mutex mutex;
+      UnorderedMap<String, uint32> ids;
+
+      /**
+       * @brief Payload type of each message, null if it has none.
+       */
+      Vector<const std::type_info*> payloadTypes{ nullptr };
+    };
+
+    MessageIdRegistry&
+    getMessageIdRegistry() {
+      static MessageIdRegistry registry;
+      return registry;
     }
-    else {
-      m_msgIdentifier = m_nextMessageId;
-      m_uniqueMessageIds[name] = m_nextMessageId++;
+
+    uint32
+    registerMessageId(const String& name, const std::type_info* payloadType) {
+      MessageIdRegistry& registry = getMessageIdRegistry();
+      Lock lock(registry.mutex);
+
+      auto findIter = registry.ids.find(name);
+      if (findIter == registry.ids.end()) {
+        const uint32 id = static_cast<uint32>(registry.payloadTypes.size());
+        registry.ids[name] = id;
+        registry.payloadTypes.push_back(payloadType);
+        return id;
+      }
+
+      const uint32 id = findIter->second;
+      const std::type_info*& registeredType = registry.payloadTypes[id];
+      if (nullptr != payloadType) {
+        if (nullptr == registeredType) {
+          registeredType = payloadType;
+        }
+        else if (*registeredType != *payloadType) {
+          GE_EXCEPT(InvalidParametersException,
+                    "Message \"" + name + "\" was registered with another payload type.");
+        }
+      }
+
+      return id;
     }
   }
 
+  MessageId::MessageId(const String& name)
+    : m_msgIdentifier(registerMessageId(name, nullptr))
+  {}
+
+  MessageId::MessageId(const String& name, const std::type_info& payloadType)
+    : m_msgIdentifier(registerMessageId(name, &payloadType))
+  {}
+
   HMessage::HMessage(uint32 id) : m_id(id) {}
 
   void
   HMessage::disconnect() {
     if (0 < m_id) {
       MessageHandler::instance().unsubscribe(m_id);
+      m_id = 0;
     }
   }
 
+  /**
+   * @brief Messages posted by one thread. A single producer, single consumer
+   *        queue made of chunks, the consumer hands consumed chunks back to
+   *        the producer so a thread posting steadily doesn't allocate.
+   *        Only the producer takes chunks off m_freeChunks, all at once, so
+   *        the stack has no ABA problem.
+   */
+  struct MessageHandler::ThreadQueue
+  {
+    static constexpr uint32 CHUNK_SIZE = 256;
+
+    struct Chunk
+    {
+      QueuedMessage messages[CHUNK_SIZE];
+      std::atomic<Chunk*> next{ nullptr };
+    };
+    static_assert(alignof(Chunk) <= 16, "Chunks are allocated 16 byte aligned.");
+
+    ThreadQueue()
+      : m_head(newChunk()),
+        m_tail(m_head)
+    {}
+
+    ~ThreadQueue() {
+      //Only destroy the payloads of the messages never sent
+      const uint64 numPosted = m_numPosted.load(memory_order_acquire);
+      while (m_numProcessed < numPosted) {
+        processNext(nullptr);
+      }
+
+      while (nullptr != m_head) {
+        Chunk* next = m_head->next.load(memory_order_relaxed);
+        deleteChunk(m_head);
+        m_head = next;
+      }
+
+      deleteChunks(m_freeChunks.load(memory_order_relaxed));
+      deleteChunks(m_producerFreeChunks);
+    }
+
+    /**
+     * @brief Allocates a chunk. ge_new() only guarantees the alignment of
+     *        malloc, 8 bytes on Win32, too little for inline payloads.
+     */
+    static Chunk*
+    newChunk() {
+      return new (ge_alloc_aligned16(sizeof(Chunk))) Chunk();
+    }
+
+    static void
+    deleteChunk(Chunk* chunk) {
+      chunk->~Chunk();
+      ge_free_aligned16(chunk);
+    }
+
+    static void
+    deleteChunks(Chunk* chunk) {
+      while (nullptr != chunk) {
+        Chunk* next = chunk->next.load(memory_order_relaxed);
+        deleteChunk(chunk);
+        chunk = next;
+      }
+    }
+
+    /**
+     * @brief Returns the slot of the next message. Producer only.
+     */
+    QueuedMessage&
+    back() {
+      const uint64 numPosted = m_numPosted.load(memory_order_relaxed);
+      const uint32 idx = static_cast<uint32>(numPosted % CHUNK_SIZE);
+      if (0 == idx && 0 != numPosted) {
+        if (nullptr == m_producerFreeChunks) {
+          m_producerFreeChunks = m_freeChunks.exchange(nullptr, memory_order_acquire);
+        }
+
+        Chunk* chunk = m_producerFreeChunks;
+        if (nullptr != chunk) {
+          m_producerFreeChunks = chunk->next.load(memory_order_relaxed);
+          chunk->next.store(nullptr, memory_order_relaxed);
+        }
+        else {
+          chunk = newChunk();
+        }
+        m_tail->next.store(chunk, memory_order_release);
+        m_tail = chunk;
+      }
+
+      return m_tail->messages[idx];
+    }
+
+    /**
+     * @brief Publishes the slot returned by back(). Producer only.
+     */
+    void
+    push() {
+      m_numPosted.store(m_numPosted.load(memory_order_relaxed) + 1, memory_order_release);
+    }
+
+    /**
+     * @brief Sends and destroys the oldest message. Consumer only.
+     */
+    void
+    processNext(MessageHandler* handler) {
+      const uint32 idx = static_cast<uint32>(m_numProcessed % CHUNK_SIZE);
+      if (0 == idx && 0 != m_numProcessed) {
+        Chunk* consumed = m_head;
+        m_head = consumed->next.load(memory_order_acquire);
+
+        Chunk* freeChunks = m_freeChunks.load(memory_order_relaxed);
+        do {
+          consumed->next.store(freeChunks, memory_order_relaxed);
+        } while (!m_freeChunks.compare_exchange_weak(freeChunks,
+                                                     consumed,
+                                                     memory_order_release,
+                                                     memory_order_relaxed));
+      }
+
+      QueuedMessage& queued = m_head->messages[idx];
+      ++m_numProcessed;
+      queued.process(handler, queued);
+    }
+
+    bool
+    isEmpty() const {
+      return m_numPosted.load(memory_order_acquire) == m_numProcessed;
+    }
+
+    /**
+     * @brief Consumer side.
+     */
+    Chunk* m_head;
+    uint64 m_numProcessed = 0;
+
+    /**
+     * @brief Producer side.
+     */
+    Chunk* m_tail;
+    Chunk* m_producerFreeChunks = nullptr;
+    std::atomic<uint64> m_numPosted{ 0 };
+
+    std::atomic<Chunk*> m_freeChunks{ nullptr };
+
+    /**
+     * @brief Set when the thread exits. Once empty, the queue is handed to
+     *        the next thread that posts, under m_queuesMutex.
+     */
+    std::atomic<bool> m_released{ false };
+    bool m_reusable = false;
+  };
+
+  /**
+   * @brief Thread local reference to the queue of a thread. Hands the queue
+   *        back when the thread exits.
+   */
+  struct MessageHandler::ThreadQueueHolder
+  {
+    ~ThreadQueueHolder() {
+      if (m_queue) {
+        m_queue->m_released.store(true, memory_order_release);
+      }
+    }
+
+    SPtr<ThreadQueue> m_queue;
+  };
+
+  namespace {
+    /**
+     * @brief Queue of the calling thread. Kept apart from the holder, which
+     *        has a destructor, so posting only reads a plain pointer.
+     */
+    thread_local void* t_queue = nullptr;
+  }
+
+  MessageHandler::MessageHandler() = default;
+
+  MessageHandler::~MessageHandler() = default;
+
   void
-  MessageHandler::send(MessageId message) {
-    auto iterFind = m_messageHandlers.find(message.m_msgIdentifier);
-    if (iterFind != m_messageHandlers.end()) {
-      for (auto& handlerData : iterFind->second) {
-        handlerData.callback();
+  MessageHandler::post(MessageId message) {
+    QueuedMessage& queued = beginPost(message.m_msgIdentifier);
+    queued.payload = nullptr;
+    queued.process = &processQueuedVoid;
+    endPost();
+  }
+
+  uint32
+  MessageHandler::processQueued() {
+    //Messages posted by a listener are sent on the next call
+    if (m_isProcessing) {
+      return 0;
+    }
+    m_isProcessing = true;
+
+    {
+      Lock lock(m_queuesMutex);
+      m_queuesToProcess.clear();
+      for (auto& queue : m_queues) {
+        if (queue->m_reusable) {
+          continue;
+        }
+
+        if (queue->m_released.load(memory_order_acquire) && queue->isEmpty()) {
+          queue->m_reusable = true;
+          continue;
+        }
+
+        m_queuesToProcess.push_back(queue.get());
       }
     }
+
+    uint32 numProcessed = 0;
+    for (ThreadQueue* queue : m_queuesToProcess) {
+      const uint64 numPosted = queue->m_numPosted.load(memory_order_acquire);
+      while (queue->m_numProcessed < numPosted) {
+        queue->processNext(this);
+        ++numProcessed;
+      }
+    }
+
+    m_isProcessing = false;
+    return numProcessed;
+  }
+
+  void
+  MessageHandler::processQueuedVoid(MessageHandler* handler, QueuedMessage& queued) {
+    if (nullptr != handler) {
+      handler->dispatch(queued.messageId, nullptr);
+    }
+  }
+
+  void
+  MessageHandler::dispatch(uint32 messageId, const void* payload) {
+    if (m_listeners.size() <= messageId) {
+      return;
+    }
+
+    MessageListeners& message = m_listeners[messageId];
+    if (nullptr == payload && 0 < message.numTyped) {
+      GE_EXCEPT(InvalidParametersException,
+                "Message sent without the payload its listeners expect.");
+    }
+
+    //Neither m_listeners nor the listeners of a message are resized until
+    //every dispatch ends, so the references stay valid
+    ++m_dispatchDepth;
+
+    Vector<Listener>& listeners = message.listeners;
+    const SIZE_T numListeners = listeners.size();
+    for (SIZE_T i = 0; i < numListeners; ++i) {
+      if (INVALID_INDEX != listeners[i].handleIdx) {
+        listeners[i].callback(payload);
+      }
+    }
+
+    if (0 == --m_dispatchDepth) {
+      endDispatch();
+    }
   }
 
   HMessage
-  MessageHandler::listen(MessageId message, function<void()>& callback) {
-    uint32 callbackId = m_nextCallbackId++;
+  MessageHandler::subscribe(uint32 messageId,
+                            function<void(const void*)> callback,
+                            bool isTyped) {
+    if (0 == messageId) {
+      GE_EXCEPT(InvalidParametersException, "Can't listen to an unnamed message.");
+    }
+
+    uint32 handleIdx;
+    if (!m_freeHandles.empty()) {
+      handleIdx = m_freeHandles.back();
+      m_freeHandles.pop_back();
+    }
+    else {
+      handleIdx = static_cast<uint32>(m_handles.size());
+      if (HANDLE_INDEX_MASK <= handleIdx) {
+        GE_EXCEPT(InvalidStateException, "Too many message listeners.");
+      }
+      m_handles.emplace_back();
+    }
 
-    MessageHandlerData data;
-    data.id = callbackId;
-    data.callback = callback;
+    Subscription& subscription = m_handles[handleIdx];
+    subscription.messageId = messageId;
+    subscription.isTyped = isTyped;
 
-    m_messageHandlers[message.m_msgIdentifier].push_back(data);
-    m_handlerIdToMessageMap[callbackId] = message.m_msgIdentifier;
+    Listener listener{ handleIdx, std::move(callback) };
+    if (0 < m_dispatchDepth) {
+      subscription.isPending = true;
+      subscription.listenerIdx = static_cast<uint32>(m_pendingListeners.size());
+      m_pendingListeners.emplace_back(messageId, std::move(listener));
+    }
+    else {
+      addListener(messageId, std::move(listener));
+    }
 
-    return HMessage(callbackId);
+    return HMessage((subscription.generation << HANDLE_INDEX_BITS) | (handleIdx + 1));
   }
 
   void
   MessageHandler::unsubscribe(uint32 handleId) {
-    uint32 msgId = m_handlerIdToMessageMap[handleId];
+    const uint32 handleIdx = (handleId & HANDLE_INDEX_MASK) - 1;
+    if (m_handles.size() <= handleIdx) {
+      return;
+    }
+
+    Subscription& subscription = m_handles[handleIdx];
+    if (0 == subscription.messageId ||
+        subscription.generation != (handleId >> HANDLE_INDEX_BITS)) {
+      return;
+    }
+
+    if (subscription.isPending) {
+      m_pendingListeners[subscription.listenerIdx].second.handleIdx = INVALID_INDEX;
+    }
+    else {
+      const uint32 messageId = subscription.messageId;
+      MessageListeners& message = m_listeners[messageId];
+      Listener& listener = message.listeners[subscription.listenerIdx];
+      listener.handleIdx = INVALID_INDEX;
+      ++message.numRemoved;
+      if (subscription.isTyped) {
+        --message.numTyped;
+      }
+
+      //A listener may be unsubscribing itself, so it's only released once
+      //every dispatch ends
+      if (0 < m_dispatchDepth) {
+        m_messagesToCompact.push_back(messageId);
+      }
+      else {
+        listener.callback = nullptr;
+        if (message.listeners.size() < message.numRemoved * 2) {
+          compact(messageId);
+        }
+      }
+    }
+
+    subscription.messageId = 0;
+    subscription.generation = (subscription.generation + 1) & HANDLE_GENERATION_MASK;
+    m_freeHandles.push_back(handleIdx);
+  }
+
+  void
+  MessageHandler::addListener(uint32 messageId, Listener&& listener) {
+    if (m_listeners.size() <= messageId) {
+      m_listeners.resize(messageId + 1);
+    }
+
+    MessageListeners& message = m_listeners[messageId];
+    Subscription& subscription = m_handles[listener.handleIdx];
+    subscription.isPending = false;
+    subscription.listenerIdx = static_cast<uint32>(message.listeners.size());
+    if (subscription.isTyped) {
+      ++message.numTyped;
+    }
+
+    message.listeners.push_back(std::move(listener));
+  }
+
+  void
+  MessageHandler::endDispatch() {
+    for (auto& pending : m_pendingListeners) {
+      if (INVALID_INDEX != pending.second.handleIdx) {
+        addListener(pending.first, std::move(pending.second));
+      }
+    }
+    m_pendingListeners.clear();
+
+    for (uint32 messageId : m_messagesToCompact) {
+      compact(messageId);
+    }
+    m_messagesToCompact.clear();
+  }
+
+  void
+  MessageHandler::compact(uint32 messageId) {
+    MessageListeners& message = m_listeners[messageId];
+    if (0 == message.numRemoved) {
+      return;
+    }
+
+    Vector<Listener>& listeners = message.listeners;
+    uint32 numKept = 0;
+    for (uint32 i = 0; i < static_cast<uint32>(listeners.size()); ++i) {
+      if (INVALID_INDEX == listeners[i].handleIdx) {
+        continue;
+      }
 
-    auto iterFind = m_messageHandlers.find(msgId);
-    if (iterFind != m_messageHandlers.end()) {
-      Vector<MessageHandlerData>& handlerData = iterFind->second;
+      if (numKept != i) {
+        listeners[numKept] = std::move(listeners[i]);
+      }
+      m_handles[listeners[numKept].handleIdx].listenerIdx = numKept;
+      ++numKept;
+    }
 
-      handlerData.erase(remove_if(handlerData.begin(),
-                        handlerData.end(),
-                        [&](MessageHandlerData& x)
-                        {
-                          return x.id == handleId;
-                        }),
-                        handlerData.end());
+    listeners.erase(listeners.begin() + numKept, listeners.end());
+    message.numRemoved = 0;
+  }
+
+  MessageHandler::QueuedMessage&
+  MessageHandler::beginPost(uint32 messageId) {
+    ThreadQueue* queue = static_cast<ThreadQueue*>(t_queue);
+    if (nullptr == queue) {
+      queue = getThreadQueue();
     }
 
-    m_handlerIdToMessageMap.erase(handleId);
+    QueuedMessage& queued = queue->back();
+    queued.messageId = messageId;
+    return queued;
+  }
+
+  void
+  MessageHandler::endPost() {
+    static_cast<ThreadQueue*>(t_queue)->push();
+  }
+
+  MessageHandler::ThreadQueue*
+  MessageHandler::getThreadQueue() {
+    //Needs a destructor to hand the queue back, so GE_THREADLOCAL won't do
+    static thread_local ThreadQueueHolder holder;
+    if (!holder.m_queue) {
+      Lock lock(m_queuesMutex);
+      for (auto& queue : m_queues) {
+        if (queue->m_reusable) {
+          queue->m_reusable = false;
+          queue->m_released.store(false, memory_order_relaxed);
+          holder.m_queue = queue;
+          break;
+        }
+      }
+
+      if (!holder.m_queue) {
+        holder.m_queue = ge_shared_ptr_new<ThreadQueue>();
+        m_queues.push_back(holder.m_queue);
+      }
+    }
+
+    t_queue = holder.m_queue.get();
+    return holder.m_queue.get();
   }
 
   void
   sendMessage(MessageId message) {
     MessageHandler::instance().send(message);
   }
+
+  void
+  postMessage(MessageId message) {
+    MessageHandler::instance().post(message);
+  }
 }
@@ -0,0 +1,72 @@
+/*****************************************************************************/
+/**
+ * @file    geOctreeStats.cpp
+ * @author  Samuel Prince (samuel.prince.quezada@gmail.com)
+ * @date    2018/07/16
+ * @brief   Statistics about the shape of an Octree and its queries.
+ *
+ * Statistics about the shape of an Octree (nodes per depth, elements per
+ * node, pool memory) and counters of the work done by its queries, meant for
+ * tuning the Octree options of each world.
+ *
+ * @bug     No known bugs.
+ */
+/*****************************************************************************/
+
+/*****************************************************************************/
+/**
+ * Includes
+ */
+/*****************************************************************************/
+#include "geOctreeStats.h"
+#include "Externals/json.hpp"
+
+namespace geEngineSDK {
+  using nlohmann::json;
+
+  namespace {
+    json
+    toJSONArray(const Vector<uint32>& values) {
+      json output = json::array();
+      for (auto value : values) {
+        output.push_back(value);
+      }
+      return output;
+    }
+  }
+
+  String
+  OctreeStats::toJSON(int32 indent) const {
+    static const char* queryNames[OCTREE_QUERY::kCount] = {
+      "box", "ray", "volume", "nearest", "radius"
+    };
+
+    json output;
+    output["numNodes"] = numNodes;
+    output["numLeafNodes"] = numLeafNodes;
+    output["numElements"] = numElements;
+    output["numNonLeafElements"] = numNonLeafElements;
+    output["nodesPerDepth"] = toJSONArray(nodesPerDepth);
+    output["elementsPerDepth"] = toJSONArray(elementsPerDepth);
+    output["nodesPerElementCount"] = toJSONArray(nodesPerElementCount);
+
+    json& memory = output["memory"];
+    memory["nodes"] = nodeMemory;
+    memory["elements"] = elementMemory;
+    memory["elementBounds"] = elementBoundsMemory;
+
+    //Leave the counters out when they aren't collected, rather than report zeroes
+    if (queryStatsEnabled) {
+      json& queryOutput = output["queries"];
+      for (uint32 i = 0; i < OCTREE_QUERY::kCount; ++i) {
+        json& entry = queryOutput[queryNames[i]];
+        entry["numQueries"] = queries[i].numQueries;
+        entry["numNodesVisited"] = queries[i].numNodesVisited;
+        entry["numElementsVisited"] = queries[i].numElementsVisited;
+      }
+    }
+
+    std::string text = output.dump(indent);
+    return String(text.c_str(), text.size());
+  }
+}
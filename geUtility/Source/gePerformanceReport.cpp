@@ -0,0 +1,625 @@
+/*****************************************************************************/
+/**
+ * @file    gePerformanceReport.cpp
+ * @author  Samuel Prince (samuel.prince.quezada@gmail.com)
+ * @date    2018/07/23
+ * @brief   Captures performance counters and writes them as HTML reports.
+ *
+ * A capture gathers, over a number of frames, the profiler zone statistics,
+ * the allocation counters, the task scheduler usage and the frame times.
+ * Captures are saved as HTML pages in the style of Debug::saveLog(), and as
+ * JSON so two captures (e.g. from two builds) can be compared later.
+ *
+ * @bug     No known bugs.
+ */
+/*****************************************************************************/
+
+/*****************************************************************************/
+/**
+ * Includes
+ */
+/*****************************************************************************/
+#include "gePerformanceReport.h"
+#include "geProfilerCPU.h"
+#include "geDataStream.h"
+#include "geFileSystem.h"
+#include "Externals/json.hpp"
+
+namespace geEngineSDK {
+  using nlohmann::json;
+
+  namespace {
+    const char* htmlPreStyleHeader =
+R"(<!DOCTYPE HTML PUBLIC '-//W3C//DTD HTML 4.0 Transitional//EN'>
+<html>
+  <head>
+    <title>geEngine: Performance Report</title>
+      <link rel='shortcut icon' href=''>
+      <link rel="stylesheet" type="text/css" href="../css/debug.css">
+  </head>
+  <body>
+)";
+
+    const char* htmlFooter = R"(
+  </body>
+</html>)";
+
+    /**
+     * @brief Escapes the characters of a text that HTML would interpret.
+     */
+    String
+    escapeHtml(const String& text) {
+      String escaped;
+      escaped.reserve(text.size());
+      for (auto c : text) {
+        switch (c) {
+          case '<': escaped += "&lt;"; break;
+          case '>': escaped += "&gt;"; break;
+          case '&': escaped += "&amp;"; break;
+          case '"': escaped += "&quot;"; break;
+          default: escaped += c; break;
+        }
+      }
+      return escaped;
+    }
+
+    /**
+     * @brief Formats a time in nanoseconds with the most readable unit.
+     */
+    String
+    formatTime(uint64 time) {
+      if (time < 1000) {
+        return toString(time) + " ns";
+      }
+
+      auto flags = std::ios::fixed;
+      if (time < 1000000) {
+        return toString(time / 1000.0, 2, 0, ' ', flags) + " us";
+      }
+
+      return toString(time / 1000000.0, 2, 0, ' ', flags) + " ms";
+    }
+
+    /**
+     * @brief Formats a relative change as a signed percentage.
+     */
+    String
+    formatChange(double change) {
+      String text = toString(change * 100.0, 1, 0, ' ', std::ios::fixed) + "%";
+      return change > 0.0 ? "+" + text : text;
+    }
+
+    /**
+     * @brief Returns how much @p current changed relative to @p baseline.
+     */
+    double
+    getChange(double baseline, double current) {
+      if (0.0 == baseline) {
+        return 0.0 == current ? 0.0 : 1.0;
+      }
+      return (current - baseline) / baseline;
+    }
+
+    /**
+     * @brief Row style of a change, where higher values are worse.
+     */
+    const char*
+    getChangeClass(double change, float threshold) {
+      if (change > threshold) {
+        return "row red";
+      }
+      if (change < -threshold) {
+        return "row green";
+      }
+      return "row";
+    }
+
+    void
+    beginTable(StringStream& stream, std::initializer_list<const char*> headers) {
+      stream << R"(    <div class="wrapper">)" << "\n";
+      stream << R"(      <div class="table">)" << "\n";
+      stream << R"(        <div class="row header blue">)" << "\n";
+      for (auto header : headers) {
+        stream << R"(          <div class="cell"> )" << header << " </div>\n";
+      }
+      stream << "        </div>\n";
+    }
+
+    void
+    addRow(StringStream& stream, const char* rowClass, std::initializer_list<String> cells) {
+      stream << R"(        <div class=")" << rowClass << R"(">)" << "\n";
+      for (auto& cell : cells) {
+        stream << R"(          <div class="cell">)" << cell << "</div>\n";
+      }
+      stream << "        </div>\n";
+    }
+
+    void
+    endTable(StringStream& stream) {
+      stream << "      </div>\n";
+      stream << "    </div>\n";
+    }
+
+    /**
+     * @brief Allocations per frame, or in total if no frame was updated.
+     */
+    double
+    getAllocsPerFrame(const PerformanceCapture& capture) {
+      if (0 == capture.frameTimes.numFrames) {
+        return static_cast<double>(capture.numAllocs);
+      }
+      return static_cast<double>(capture.numAllocs) / capture.frameTimes.numFrames;
+    }
+
+    const PerformanceZoneStats*
+    findZone(const PerformanceCapture& capture, const String& name) {
+      for (auto& zone : capture.zones) {
+        if (zone.name == name) {
+          return &zone;
+        }
+      }
+      return nullptr;
+    }
+
+    uint64
+    readUInt(const json& object, const char* key) {
+      auto it = object.find(key);
+      if (object.end() == it || !it->is_number()) {
+        return 0;
+      }
+      return it->get<uint64>();
+    }
+
+    float
+    readFloat(const json& object, const char* key) {
+      auto it = object.find(key);
+      if (object.end() == it || !it->is_number()) {
+        return 0.0f;
+      }
+      return it->get<float>();
+    }
+
+    String
+    readString(const json& object, const char* key) {
+      auto it = object.find(key);
+      if (object.end() == it || !it->is_string()) {
+        return StringUtil::BLANK;
+      }
+      const std::string& text = it->get_ref<const std::string&>();
+      return String(text.c_str(), text.size());
+    }
+  }
+
+  void
+  PerformanceReport::beginCapture() {
+    m_startAllocs = MemoryCounter::getNumAllocs();
+    m_startFrees = MemoryCounter::getNumFrees();
+
+    if (TaskScheduler::isStarted()) {
+      TaskScheduler::instance().resetPeakQueueDepth();
+      m_startSchedulerStats = TaskScheduler::instance().getStats();
+    }
+
+    if (Time::isStarted()) {
+      m_startFrameTimes = g_time().getFrameTimeHistogram();
+    }
+
+    if (ProfilerCPU::isStarted()) {
+      ProfilerCPU::instance().beginCapture();
+    }
+
+    m_timer.reset();
+  }
+
+  PerformanceCapture
+  PerformanceReport::endCapture(const String& name) {
+    PerformanceCapture capture;
+    capture.name = name;
+    capture.duration = m_timer.getMicroseconds();
+    capture.numAllocs = MemoryCounter::getNumAllocs() - m_startAllocs;
+    capture.numFrees = MemoryCounter::getNumFrees() - m_startFrees;
+
+    if (TaskScheduler::isStarted()) {
+      TaskSchedulerStats stats = TaskScheduler::instance().getStats();
+      uint64 numQueued = stats.numQueued - m_startSchedulerStats.numQueued;
+      uint64 depthSum = stats.queueDepthSum - m_startSchedulerStats.queueDepthSum;
+      uint64 busyTime = stats.busyTime - m_startSchedulerStats.busyTime;
+
+      capture.hasTaskScheduler = true;
+      capture.numWorkers = stats.numWorkers;
+      capture.peakQueueDepth = stats.peakQueueDepth;
+      capture.numTasksCompleted = stats.numCompleted - m_startSchedulerStats.numCompleted;
+      if (0 != numQueued) {
+        capture.avgQueueDepth = static_cast<float>(depthSum) / numQueued;
+      }
+      if (0 != capture.duration && 0 != stats.numWorkers) {
+        capture.utilization = static_cast<float>(busyTime) /
+                              (static_cast<float>(capture.duration) * stats.numWorkers);
+      }
+    }
+
+    if (Time::isStarted()) {
+      capture.frameTimes = g_time().getFrameTimeHistogram().since(m_startFrameTimes);
+    }
+
+    if (ProfilerCPU::isStarted()) {
+      ProfilerCPU& profiler = ProfilerCPU::instance();
+      profiler.endCapture();
+
+      //Zones with the same name are reported together
+      UnorderedMap<const ProfilerZone*, Vector<uint64>> zoneTimes;
+      for (auto& span : profiler.getCapturedSpans()) {
+        zoneTimes[span.zone].push_back(span.endTime - span.startTime);
+      }
+
+      Map<String, Vector<uint64>> namedTimes;
+      for (auto& zone : zoneTimes) {
+        auto& times = namedTimes[zone.first->name];
+        times.insert(times.end(), zone.second.begin(), zone.second.end());
+      }
+
+      for (auto& zone : namedTimes) {
+        Vector<uint64>& times = zone.second;
+
+        PerformanceZoneStats stats;
+        stats.name = zone.first;
+        stats.numCalls = times.size();
+        stats.minTime = *std::min_element(times.begin(), times.end());
+        stats.maxTime = *std::max_element(times.begin(), times.end());
+        for (auto time : times) {
+          stats.totalTime += time;
+        }
+        stats.avgTime = stats.totalTime / stats.numCalls;
+
+        SIZE_T rank = static_cast<SIZE_T>(std::ceil(0.99 * times.size())) - 1;
+        std::nth_element(times.begin(), times.begin() + rank, times.end());
+        stats.p99Time = times[rank];
+
+        capture.zones.push_back(std::move(stats));
+      }
+
+      std::sort(capture.zones.begin(),
+                capture.zones.end(),
+                [](const PerformanceZoneStats& lhs, const PerformanceZoneStats& rhs) {
+        return lhs.totalTime > rhs.totalTime;
+      });
+    }
+
+    return capture;
+  }
+
+  String
+  PerformanceReport::toHtml(const PerformanceCapture& capture) {
+    StringStream stream;
+    stream << htmlPreStyleHeader;
+    stream << "<h1>geEngine Performance Report</h1>\n";
+    stream << "<h2>" << escapeHtml(capture.name) << "</h2>\n";
+    stream << "<p>Duration: " << formatTime(capture.duration * 1000) << "<br>\n";
+    stream << "Frames: " << capture.frameTimes.numFrames << "</p>\n";
+
+    //Frame times
+    const FrameTimeHistogram& frameTimes = capture.frameTimes;
+    stream << "<h2>Frame times</h2>\n";
+    beginTable(stream, { "Average", "P99", "Frames" });
+    addRow(stream, "row", { formatTime(frameTimes.getAverage() * 1000),
+                            formatTime(frameTimes.getPercentile(0.99f) * 1000),
+                            toString(frameTimes.numFrames) });
+    endTable(stream);
+
+    uint64 maxCount = 0;
+    uint32 lastBucket = 0;
+    for (uint32 i = 0; i < FrameTimeHistogram::NUM_BUCKETS; ++i) {
+      if (0 != frameTimes.counts[i]) {
+        maxCount = std::max(maxCount, frameTimes.counts[i]);
+        lastBucket = i;
+      }
+    }
+
+    if (0 != maxCount) {
+      beginTable(stream, { "Frame time", "Frames", "" });
+      for (uint32 i = 0; i <= lastBucket; ++i) {
+        uint64 bucketStart = i * FrameTimeHistogram::BUCKET_WIDTH / 1000;
+        String range = toString(bucketStart) + " - " + toString(bucketStart + 1) + " ms";
+        if (FrameTimeHistogram::NUM_BUCKETS - 1 == i) {
+          range = toString(bucketStart) + " ms and longer";
+        }
+
+        uint64 width = frameTimes.counts[i] * 100 / maxCount;
+        String bar = R"(<div style="background: #2980b9; width: )" + toString(width) +
+                     R"(%;">&nbsp;</div>)";
+        addRow(stream, "row", { range, toString(frameTimes.counts[i]), bar });
+      }
+      endTable(stream);
+    }
+
+    //Profiler zones
+    stream << "<h2>CPU zones</h2>\n";
+    beginTable(stream, { "Zone", "Calls", "Total", "Min", "Avg", "Max", "P99" });
+    for (auto& zone : capture.zones) {
+      addRow(stream, "row", { escapeHtml(zone.name),
+                              toString(zone.numCalls),
+                              formatTime(zone.totalTime),
+                              formatTime(zone.minTime),
+                              formatTime(zone.avgTime),
+                              formatTime(zone.maxTime),
+                              formatTime(zone.p99Time) });
+    }
+    endTable(stream);
+
+    //Memory
+    stream << "<h2>Memory</h2>\n";
+    beginTable(stream, { "Allocations", "Frees", "Allocations per frame" });
+    addRow(stream, "row", { toString(capture.numAllocs),
+                            toString(capture.numFrees),
+                            toString(getAllocsPerFrame(capture), 1, 0, ' ', std::ios::fixed) });
+    endTable(stream);
+
+    //Task scheduler
+    if (capture.hasTaskScheduler) {
+      stream << "<h2>Task scheduler</h2>\n";
+      beginTable(stream, { "Workers",
+                           "Tasks completed",
+                           "Average queue depth",
+                           "Peak queue depth",
+                           "Utilization" });
+      addRow(stream, "row", { toString(capture.numWorkers),
+                              toString(capture.numTasksCompleted),
+                              toString(capture.avgQueueDepth, 2, 0, ' ', std::ios::fixed),
+                              toString(capture.peakQueueDepth),
+                              toString(capture.utilization * 100.0f, 1, 0, ' ', std::ios::fixed) + "%" });
+      endTable(stream);
+    }
+
+    stream << htmlFooter;
+    return stream.str();
+  }
+
+  String
+  PerformanceReport::toHtmlDiff(const PerformanceCapture& baseline,
+                                const PerformanceCapture& current,
+                                float threshold) {
+    StringStream stream;
+    stream << htmlPreStyleHeader;
+    stream << "<h1>geEngine Performance Comparison</h1>\n";
+    stream << "<p>Baseline: " << escapeHtml(baseline.name) << "<br>\n";
+    stream << "Current: " << escapeHtml(current.name) << "</p>\n";
+
+    //Summary, every value is worse when higher
+    stream << "<h2>Summary</h2>\n";
+    beginTable(stream, { "Counter", "Baseline", "Current", "Change" });
+
+    auto addTimeRow = [&](const char* counter, uint64 baselineTime, uint64 currentTime) {
+      double change = getChange(static_cast<double>(baselineTime),
+                                static_cast<double>(currentTime));
+      addRow(stream, getChangeClass(change, threshold), { counter,
+                                                          formatTime(baselineTime),
+                                                          formatTime(currentTime),
+                                                          formatChange(change) });
+    };
+
+    auto addValueRow = [&](const char* counter, double baselineValue, double currentValue) {
+      double change = getChange(baselineValue, currentValue);
+      addRow(stream, getChangeClass(change, threshold),
+             { counter,
+               toString(baselineValue, 2, 0, ' ', std::ios::fixed),
+               toString(currentValue, 2, 0, ' ', std::ios::fixed),
+               formatChange(change) });
+    };
+
+    addTimeRow("Average frame time",
+               baseline.frameTimes.getAverage() * 1000,
+               current.frameTimes.getAverage() * 1000);
+    addTimeRow("P99 frame time",
+               baseline.frameTimes.getPercentile(0.99f) * 1000,
+               current.frameTimes.getPercentile(0.99f) * 1000);
+    addValueRow("Allocations per frame",
+                getAllocsPerFrame(baseline),
+                getAllocsPerFrame(current));
+    if (baseline.hasTaskScheduler && current.hasTaskScheduler) {
+      addValueRow("Average queue depth", baseline.avgQueueDepth, current.avgQueueDepth);
+      addValueRow("Utilization", baseline.utilization, current.utilization);
+    }
+    endTable(stream);
+
+    //Zones of either capture, in the order of the current one
+    stream << "<h2>CPU zones</h2>\n";
+    beginTable(stream, { "Zone",
+                         "Baseline avg",
+                         "Current avg",
+                         "Change",
+                         "Baseline P99",
+                         "Current P99",
+                         "Change" });
+
+    for (auto& zone : current.zones) {
+      const PerformanceZoneStats* baselineZone = findZone(baseline, zone.name);
+      if (nullptr == baselineZone) {
+        addRow(stream, "row yellow", { escapeHtml(zone.name),
+                                       "-",
+                                       formatTime(zone.avgTime),
+                                       "New",
+                                       "-",
+                                       formatTime(zone.p99Time),
+                                       "New" });
+        continue;
+      }
+
+      double avgChange = getChange(static_cast<double>(baselineZone->avgTime),
+                                   static_cast<double>(zone.avgTime));
+      double p99Change = getChange(static_cast<double>(baselineZone->p99Time),
+                                   static_cast<double>(zone.p99Time));
+
+      //A regression of either time outweighs an improvement of the other
+      double change = std::max(avgChange, p99Change);
+      if (change <= threshold) {
+        change = std::min(avgChange, p99Change);
+      }
+
+      addRow(stream, getChangeClass(change, threshold), { escapeHtml(zone.name),
+                                                          formatTime(baselineZone->avgTime),
+                                                          formatTime(zone.avgTime),
+                                                          formatChange(avgChange),
+                                                          formatTime(baselineZone->p99Time),
+                                                          formatTime(zone.p99Time),
+                                                          formatChange(p99Change) });
+    }
+
+    for (auto& zone : baseline.zones) {
+      if (nullptr == findZone(current, zone.name)) {
+        addRow(stream, "row yellow", { escapeHtml(zone.name),
+                                       formatTime(zone.avgTime),
+                                       "-",
+                                       "Removed",
+                                       formatTime(zone.p99Time),
+                                       "-",
+                                       "Removed" });
+      }
+    }
+    endTable(stream);
+
+    stream << htmlFooter;
+    return stream.str();
+  }
+
+  void
+  PerformanceReport::saveHtml(const PerformanceCapture& capture, const Path& path) {
+    DataStreamPtr fileStream = FileSystem::createAndOpenFile(path);
+    fileStream->writeString(toHtml(capture));
+  }
+
+  void
+  PerformanceReport::saveHtmlDiff(const PerformanceCapture& baseline,
+                                  const PerformanceCapture& current,
+                                  const Path& path,
+                                  float threshold) {
+    DataStreamPtr fileStream = FileSystem::createAndOpenFile(path);
+    fileStream->writeString(toHtmlDiff(baseline, current, threshold));
+  }
+
+  String
+  PerformanceReport::toJson(const PerformanceCapture& capture) {
+    json root;
+    root["name"] = capture.name.c_str();
+    root["duration"] = capture.duration;
+    root["numAllocs"] = capture.numAllocs;
+    root["numFrees"] = capture.numFrees;
+
+    json zones = json::array();
+    for (auto& zone : capture.zones) {
+      json object;
+      object["name"] = zone.name.c_str();
+      object["numCalls"] = zone.numCalls;
+      object["totalTime"] = zone.totalTime;
+      object["minTime"] = zone.minTime;
+      object["avgTime"] = zone.avgTime;
+      object["maxTime"] = zone.maxTime;
+      object["p99Time"] = zone.p99Time;
+      zones.push_back(std::move(object));
+    }
+    root["zones"] = std::move(zones);
+
+    if (capture.hasTaskScheduler) {
+      json scheduler;
+      scheduler["numWorkers"] = capture.numWorkers;
+      scheduler["peakQueueDepth"] = capture.peakQueueDepth;
+      scheduler["avgQueueDepth"] = capture.avgQueueDepth;
+      scheduler["numTasksCompleted"] = capture.numTasksCompleted;
+      scheduler["utilization"] = capture.utilization;
+      root["taskScheduler"] = std::move(scheduler);
+    }
+
+    json frameTimes;
+    frameTimes["numFrames"] = capture.frameTimes.numFrames;
+    frameTimes["totalTime"] = capture.frameTimes.totalTime;
+    frameTimes["counts"] = json::array();
+    for (auto count : capture.frameTimes.counts) {
+      frameTimes["counts"].push_back(count);
+    }
+    root["frameTimes"] = std::move(frameTimes);
+
+    std::string text = root.dump(2);
+    return String(text.c_str(), text.size());
+  }
+
+  bool
+  PerformanceReport::fromJson(const String& text, PerformanceCapture& capture) {
+    capture = PerformanceCapture();
+
+    json root = json::parse(text.c_str(), nullptr, false);
+    if (root.is_discarded() || !root.is_object()) {
+      return false;
+    }
+
+    auto zones = root.find("zones");
+    auto frameTimes = root.find("frameTimes");
+    if (root.end() == zones || !zones->is_array() ||
+        root.end() == frameTimes || !frameTimes->is_object()) {
+      return false;
+    }
+
+    capture.name = readString(root, "name");
+    capture.duration = readUInt(root, "duration");
+    capture.numAllocs = readUInt(root, "numAllocs");
+    capture.numFrees = readUInt(root, "numFrees");
+
+    for (auto& object : *zones) {
+      if (!object.is_object()) {
+        return false;
+      }
+
+      PerformanceZoneStats zone;
+      zone.name = readString(object, "name");
+      zone.numCalls = readUInt(object, "numCalls");
+      zone.totalTime = readUInt(object, "totalTime");
+      zone.minTime = readUInt(object, "minTime");
+      zone.avgTime = readUInt(object, "avgTime");
+      zone.maxTime = readUInt(object, "maxTime");
+      zone.p99Time = readUInt(object, "p99Time");
+      capture.zones.push_back(std::move(zone));
+    }
+
+    auto scheduler = root.find("taskScheduler");
+    if (root.end() != scheduler && scheduler->is_object()) {
+      capture.hasTaskScheduler = true;
+      capture.numWorkers = static_cast<uint32>(readUInt(*scheduler, "numWorkers"));
+      capture.peakQueueDepth = static_cast<uint32>(readUInt(*scheduler, "peakQueueDepth"));
+      capture.avgQueueDepth = readFloat(*scheduler, "avgQueueDepth");
+      capture.numTasksCompleted = readUInt(*scheduler, "numTasksCompleted");
+      capture.utilization = readFloat(*scheduler, "utilization");
+    }
+
+    capture.frameTimes.numFrames = readUInt(*frameTimes, "numFrames");
+    capture.frameTimes.totalTime = readUInt(*frameTimes, "totalTime");
+    auto counts = frameTimes->find("counts");
+    if (frameTimes->end() != counts && counts->is_array()) {
+      uint32 numBuckets = std::min(static_cast<uint32>(counts->size()),
+                                   FrameTimeHistogram::NUM_BUCKETS);
+      for (uint32 i = 0; i < numBuckets; ++i) {
+        const json& count = (*counts)[i];
+        capture.frameTimes.counts[i] = count.is_number() ? count.get<uint64>() : 0;
+      }
+    }
+
+    return true;
+  }
+
+  void
+  PerformanceReport::saveCapture(const PerformanceCapture& capture, const Path& path) {
+    DataStreamPtr fileStream = FileSystem::createAndOpenFile(path);
+    fileStream->writeString(toJson(capture));
+  }
+
+  bool
+  PerformanceReport::loadCapture(const Path& path, PerformanceCapture& capture) {
+    if (!FileSystem::isFile(path)) {
+      return false;
+    }
+
+    DataStreamPtr fileStream = FileSystem::openFile(path);
+    if (nullptr == fileStream) {
+      return false;
+    }
+
+    return fromJson(fileStream->getAsString(), capture);
+  }
+}
@@ -0,0 +1,513 @@
+/*****************************************************************************/
+/**
+ * @file    geProfilerCPU.cpp
+ * @author  Samuel Prince (samuel.prince.quezada@gmail.com)
+ * @date    2018/07/22
+ * @brief   Hierarchical CPU profiler.
+ *
+ * Code marks the zones it wants measured with GE_PROFILE_SCOPE. Every thread
+ * records the start and end of its zones in a lock-free buffer of its own,
+ * and once per frame the buffers are gathered into a call tree for each
+ * thread. Frames can be captured and exported as Chrome trace JSON.
+ *
+ * @bug     No known bugs.
+ */
+/*****************************************************************************/
+
+/*****************************************************************************/
+/**
+ * Includes
+ */
+/*****************************************************************************/
+#include "geProfilerCPU.h"
+#include "geBitwise.h"
+#include "geDataStream.h"
+#include "geFileSystem.h"
+#include "geTimer.h"
+#include "Externals/json.hpp"
+
+namespace geEngineSDK {
+  using nlohmann::json;
+  using std::memory_order_acquire;
+  using std::memory_order_relaxed;
+  using std::memory_order_release;
+
+  namespace {
+    /**
+     * @brief Profiler measuring zones, set while it is started.
+     */
+    std::atomic<ProfilerCPU*> s_profiler{nullptr};
+
+    /**
+     * @brief Set on the zone of the events that end a zone.
+     */
+    const uintptr_t ZONE_END_FLAG = 1;
+  }
+
+  /**
+   * @brief A zone started by a thread and not ended yet.
+   */
+  struct ProfilerCPU::OpenZone
+  {
+    const ProfilerZone* zone;
+    uint64 startTime;
+
+    /**
+     * @brief Start of the part of the zone that belongs to the current frame.
+     */
+    uint64 frameStartTime;
+    uint32 node;
+  };
+
+  /**
+   * @brief Ring buffer of the zone starts and ends of a single thread, read
+   *        by the thread ending the frames.
+   */
+  struct ProfilerCPU::ThreadEvents
+  {
+    struct Event
+    {
+      uint64 ticks;
+      uintptr_t zone;
+    };
+
+    ThreadEvents(uint32 capacity, uint32 threadIdx)
+      : m_events(capacity),
+        m_threadIdx(threadIdx)
+    {}
+
+    void
+    push(uint64 ticks, uintptr_t zone) {
+      const uint64 head = m_head.load(memory_order_relaxed);
+      if (head - m_tail.load(memory_order_acquire) >= m_events.size()) {
+        m_numDropped.fetch_add(1, memory_order_relaxed);
+        return;
+      }
+
+      Event& event = m_events[static_cast<SIZE_T>(head) & (m_events.size() - 1)];
+      event.ticks = ticks;
+      event.zone = zone;
+      m_head.store(head + 1, memory_order_release);
+    }
+
+    Vector<Event> m_events;
+    uint32 m_threadIdx;
+
+    /**
+     * @brief Name of the thread, guarded by the profiler thread list mutex.
+     */
+    String m_name;
+
+    //Keep the positions written by each thread on their own cache line
+    uint8 m_padding0[64];
+    std::atomic<uint64> m_head{0};
+    std::atomic<uint64> m_numDropped{0};
+    uint8 m_padding1[64];
+    std::atomic<uint64> m_tail{0};
+    uint8 m_padding2[64];
+
+    /**
+     * @brief Set once the owner thread exits.
+     */
+    std::atomic<bool> m_released{false};
+
+    /**
+     * @brief Set once the buffer of an exited thread is fully processed, so a
+     *        new thread can take it.
+     */
+    std::atomic<bool> m_reusable{false};
+
+    /**
+     * @brief Zones started and not ended yet, only used while ending frames.
+     */
+    Vector<OpenZone> m_openZones;
+  };
+
+  /**
+   * @brief Thread local reference to the events of a thread. Hands the
+   *        buffer back when the thread exits.
+   */
+  struct ProfilerCPU::ThreadEventsHolder
+  {
+    ~ThreadEventsHolder() {
+      if (m_events) {
+        m_events->m_released.store(true, memory_order_release);
+      }
+    }
+
+    SPtr<ThreadEvents> m_events;
+  };
+
+  namespace {
+    /**
+     * @brief Events of the calling thread. Kept apart from the holder, which
+     *        has a destructor, so zones only read a plain pointer.
+     */
+    thread_local void* t_events = nullptr;
+  }
+
+  ProfilerCPU::ProfilerCPU(uint32 eventsPerThread)
+    : m_eventsPerThread(Bitwise::nextPow2(std::max(eventsPerThread, 1024u))) {
+    CycleTimer::calibrate();
+    m_startTicks = CycleTimer::now();
+  }
+
+  ProfilerCPU::~ProfilerCPU() = default;
+
+  void
+  ProfilerCPU::onStartUp() {
+    s_profiler.store(this, memory_order_release);
+  }
+
+  void
+  ProfilerCPU::onShutDown() {
+    s_profiler.store(nullptr, memory_order_release);
+  }
+
+  bool
+  ProfilerCPU::beginZone(const ProfilerZone* zone) {
+    ProfilerCPU* profiler = s_profiler.load(memory_order_acquire);
+    if (nullptr == profiler || !profiler->m_enabled.load(memory_order_relaxed)) {
+      return false;
+    }
+
+    ThreadEvents* events = static_cast<ThreadEvents*>(t_events);
+    if (nullptr == events) {
+      events = profiler->getThreadEvents();
+    }
+
+    //The flight recorder shares the time stamp, reading it is most of the cost
+    const uint64 time = CycleTimer::now();
+    events->push(time, reinterpret_cast<uintptr_t>(zone));
+    FlightRecorder::beginZone(zone, time);
+    return true;
+  }
+
+  void
+  ProfilerCPU::endZone(const ProfilerZone* zone) {
+    ThreadEvents* events = static_cast<ThreadEvents*>(t_events);
+    if (nullptr == events || nullptr == s_profiler.load(memory_order_acquire)) {
+      FlightRecorder::endZone(zone);
+      return;
+    }
+
+    const uint64 time = CycleTimer::now();
+    events->push(time, reinterpret_cast<uintptr_t>(zone) | ZONE_END_FLAG);
+    FlightRecorder::endZone(zone, time);
+  }
+
+  void
+  ProfilerCPU::setEnabled(bool enabled) {
+    m_enabled.store(enabled, memory_order_relaxed);
+  }
+
+  void
+  ProfilerCPU::setThreadName(const String& name) {
+    ThreadEvents* events = getThreadEvents();
+
+    Lock lock(m_threadsMutex);
+    events->m_name = name;
+  }
+
+  ProfilerCPU::ThreadEvents*
+  ProfilerCPU::getThreadEvents() {
+    //Needs a destructor to hand the buffer back, so GE_THREADLOCAL won't do
+    static thread_local ThreadEventsHolder holder;
+    if (holder.m_events) {
+      return holder.m_events.get();
+    }
+
+    Lock lock(m_threadsMutex);
+    for (auto& events : m_threads) {
+      if (events->m_reusable.load(memory_order_acquire)) {
+        events->m_reusable.store(false, memory_order_relaxed);
+        events->m_released.store(false, memory_order_relaxed);
+        holder.m_events = events;
+        break;
+      }
+    }
+
+    if (!holder.m_events) {
+      holder.m_events = ge_shared_ptr_new<ThreadEvents>(m_eventsPerThread,
+                                                        static_cast<uint32>(m_threads.size()));
+      m_threads.push_back(holder.m_events);
+    }
+
+    holder.m_events->m_name = "Thread " + toString(holder.m_events->m_threadIdx);
+    t_events = holder.m_events.get();
+    return holder.m_events.get();
+  }
+
+  uint64
+  ProfilerCPU::toNanoseconds(uint64 ticks) const {
+    if (ticks <= m_startTicks) {
+      return 0;
+    }
+
+    return CycleTimer::toNanoseconds(ticks - m_startTicks);
+  }
+
+  uint64
+  ProfilerCPU::getTime() const {
+    return toNanoseconds(CycleTimer::now());
+  }
+
+  void
+  ProfilerCPU::endFrame() {
+    Vector<SPtr<ThreadEvents>> threads;
+    {
+      Lock lock(m_threadsMutex);
+      threads = m_threads;
+    }
+
+    Lock lock(m_frameMutex);
+    const uint64 frameEnd = getTime();
+
+    ProfilerFrame frame;
+    frame.frameIdx = m_frameIdx++;
+    frame.startTime = m_frameStart;
+    frame.endTime = frameEnd;
+
+    for (auto& events : threads) {
+      ProfilerThreadFrame threadFrame;
+      threadFrame.threadIdx = events->m_threadIdx;
+      processEvents(*events, threadFrame, m_frameStart, frameEnd);
+
+      if (!threadFrame.nodes.empty()) {
+        {
+          Lock threadsLock(m_threadsMutex);
+          threadFrame.threadName = events->m_name;
+        }
+        frame.threads.push_back(std::move(threadFrame));
+      }
+    }
+
+    if (m_capturing) {
+      m_capturedFrames.push_back(frameEnd);
+    }
+
+    m_lastFrame = std::move(frame);
+    m_frameStart = frameEnd;
+  }
+
+  void
+  ProfilerCPU::processEvents(ThreadEvents& events,
+                             ProfilerThreadFrame& frame,
+                             uint64 frameStart,
+                             uint64 frameEnd) {
+    Vector<OpenZone>& openZones = events.m_openZones;
+
+    //Zones still running from the previous frame continue in this one
+    for (SIZE_T i = 0; i < openZones.size(); ++i) {
+      uint32 parent = 0 == i ? ProfilerNode::INVALID_IDX : openZones[i - 1].node;
+      openZones[i].node = findOrAddNode(frame, parent, openZones[i].zone);
+      openZones[i].frameStartTime = frameStart;
+    }
+
+    const SIZE_T mask = events.m_events.size() - 1;
+    const uint64 head = events.m_head.load(memory_order_acquire);
+    uint64 tail = events.m_tail.load(memory_order_relaxed);
+    for (; tail != head; ++tail) {
+      const ThreadEvents::Event& event = events.m_events[static_cast<SIZE_T>(tail) & mask];
+      const uint64 time = toNanoseconds(event.ticks);
+
+      //Events recorded after the frame ended belong to the next one
+      if (time > frameEnd) {
+        break;
+      }
+
+      const ProfilerZone* zone =
+        reinterpret_cast<const ProfilerZone*>(event.zone & ~ZONE_END_FLAG);
+
+      if (0 == (event.zone & ZONE_END_FLAG)) {
+        uint32 parent = openZones.empty() ? ProfilerNode::INVALID_IDX : openZones.back().node;
+        uint32 node = findOrAddNode(frame, parent, zone);
+        ++frame.nodes[node].numCalls;
+        openZones.push_back({ zone, time, time, node });
+        continue;
+      }
+
+      //Zones whose end was dropped are closed along with their parent
+      auto openIter = std::find_if(openZones.rbegin(), openZones.rend(),
+                                   [zone](const OpenZone& open) {
+                                     return open.zone == zone;
+                                   });
+      if (openIter == openZones.rend()) {
+        continue;
+      }
+
+      SIZE_T first = static_cast<SIZE_T>(openZones.rend() - openIter) - 1;
+      for (SIZE_T i = openZones.size(); i > first; --i) {
+        const OpenZone& open = openZones[i - 1];
+        ProfilerNode& node = frame.nodes[open.node];
+        node.totalTime += time - open.frameStartTime;
+        node.minTime = std::min(node.minTime, time - open.startTime);
+        node.maxTime = std::max(node.maxTime, time - open.startTime);
+
+        if (m_capturing) {
+          m_capturedSpans.push_back({ open.zone, events.m_threadIdx, open.startTime, time });
+        }
+      }
+
+      openZones.resize(first);
+    }
+
+    events.m_tail.store(tail, memory_order_release);
+
+    //Zones still running are measured up to the end of the frame
+    for (auto& open : openZones) {
+      frame.nodes[open.node].totalTime += frameEnd - open.frameStartTime;
+    }
+
+    //Parents come before their children, so walk back to subtract them
+    for (auto& node : frame.nodes) {
+      node.selfTime = node.totalTime;
+    }
+
+    for (SIZE_T i = frame.nodes.size(); i > 0; --i) {
+      const ProfilerNode& node = frame.nodes[i - 1];
+      if (ProfilerNode::INVALID_IDX != node.parent) {
+        ProfilerNode& parent = frame.nodes[node.parent];
+        parent.selfTime -= std::min(parent.selfTime, node.totalTime);
+      }
+    }
+
+    if (events.m_released.load(memory_order_acquire) &&
+        tail == events.m_head.load(memory_order_acquire) &&
+        openZones.empty()) {
+      events.m_reusable.store(true, memory_order_release);
+    }
+  }
+
+  uint32
+  ProfilerCPU::findOrAddNode(ProfilerThreadFrame& frame,
+                             uint32 parent,
+                             const ProfilerZone* zone) {
+    uint32 firstSibling = ProfilerNode::INVALID_IDX;
+    if (ProfilerNode::INVALID_IDX != parent) {
+      firstSibling = frame.nodes[parent].firstChild;
+    }
+    else if (!frame.nodes.empty()) {
+      firstSibling = 0;
+    }
+
+    uint32 lastSibling = ProfilerNode::INVALID_IDX;
+    for (uint32 i = firstSibling; ProfilerNode::INVALID_IDX != i; i = frame.nodes[i].nextSibling) {
+      if (frame.nodes[i].zone == zone) {
+        return i;
+      }
+      lastSibling = i;
+    }
+
+    const uint32 nodeIdx = static_cast<uint32>(frame.nodes.size());
+    ProfilerNode node;
+    node.zone = zone;
+    node.parent = parent;
+    frame.nodes.push_back(node);
+
+    if (ProfilerNode::INVALID_IDX != lastSibling) {
+      frame.nodes[lastSibling].nextSibling = nodeIdx;
+    }
+    else if (ProfilerNode::INVALID_IDX != parent) {
+      frame.nodes[parent].firstChild = nodeIdx;
+    }
+
+    return nodeIdx;
+  }
+
+  ProfilerFrame
+  ProfilerCPU::getLastFrame() const {
+    Lock lock(m_frameMutex);
+    return m_lastFrame;
+  }
+
+  void
+  ProfilerCPU::beginCapture() {
+    Lock lock(m_frameMutex);
+    m_capturing = true;
+    m_capturedSpans.clear();
+    m_capturedFrames.clear();
+    m_capturedFrames.push_back(m_frameStart);
+  }
+
+  void
+  ProfilerCPU::endCapture() {
+    Lock lock(m_frameMutex);
+    m_capturing = false;
+  }
+
+  Vector<ProfilerSpan>
+  ProfilerCPU::getCapturedSpans() const {
+    Lock lock(m_frameMutex);
+    return m_capturedSpans;
+  }
+
+  String
+  ProfilerCPU::getChromeTrace() const {
+    json events = json::array();
+
+    {
+      Lock lock(m_threadsMutex);
+      for (auto& threadEvents : m_threads) {
+        json event;
+        event["name"] = "thread_name";
+        event["ph"] = "M";
+        event["pid"] = 0;
+        event["tid"] = threadEvents->m_threadIdx;
+        event["args"]["name"] = threadEvents->m_name.c_str();
+        events.push_back(std::move(event));
+      }
+    }
+
+    Lock lock(m_frameMutex);
+
+    //Trace times are in microseconds
+    for (auto& span : m_capturedSpans) {
+      json event;
+      event["name"] = span.zone->name;
+      event["cat"] = "cpu";
+      event["ph"] = "X";
+      event["ts"] = static_cast<double>(span.startTime) / 1000.0;
+      event["dur"] = static_cast<double>(span.endTime - span.startTime) / 1000.0;
+      event["pid"] = 0;
+      event["tid"] = span.threadIdx;
+      events.push_back(std::move(event));
+    }
+
+    for (auto frameTime : m_capturedFrames) {
+      json event;
+      event["name"] = "Frame";
+      event["ph"] = "i";
+      event["s"] = "g";
+      event["ts"] = static_cast<double>(frameTime) / 1000.0;
+      event["pid"] = 0;
+      event["tid"] = 0;
+      events.push_back(std::move(event));
+    }
+
+    json trace;
+    trace["traceEvents"] = std::move(events);
+    trace["displayTimeUnit"] = "ns";
+
+    std::string text = trace.dump();
+    return String(text.c_str(), text.size());
+  }
+
+  void
+  ProfilerCPU::saveChromeTrace(const Path& path) const {
+    DataStreamPtr fileStream = FileSystem::createAndOpenFile(path);
+    fileStream->writeString(getChromeTrace());
+  }
+
+  uint64
+  ProfilerCPU::getNumDroppedEvents() const {
+    uint64 numDropped = 0;
+
+    Lock lock(m_threadsMutex);
+    for (auto& events : m_threads) {
+      numDropped += events->m_numDropped.load(memory_order_relaxed);
+    }
+
+    return numDropped;
+  }
+}
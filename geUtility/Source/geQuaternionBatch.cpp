@@ -0,0 +1,342 @@
+/*****************************************************************************/
+/**
+ * @file    geQuaternionBatch.cpp
+ * @author  Samuel Prince (samuel.prince.quezada@gmail.com)
+ * @date    2018/07/02
+ * @brief   SIMD kernels that operate over arrays of quaternions.
+ *
+ * SIMD kernels that operate over arrays of quaternions. Input and output
+ * arrays use the regular Quaternion / Vector3 layout, the kernels transpose
+ * groups of four elements into SoA registers internally.
+ *
+ * @bug     No known bugs.
+ */
+/*****************************************************************************/
+
+/*****************************************************************************/
+/**
+ * Includes
+ */
+/*****************************************************************************/
+#include "geQuaternionBatch.h"
+#include "geSIMD.h"
+
+namespace geEngineSDK {
+  using simd::float32x4;
+  using simd::mask_float32x4;
+
+  namespace {
+    /**
+     * @brief Four quaternions stored in SoA form.
+     */
+    struct Quaternion4
+    {
+      float32x4 x, y, z, w;
+    };
+
+    /**
+     * @brief Four vectors stored in SoA form.
+     */
+    struct Vector3x4
+    {
+      float32x4 x, y, z;
+    };
+
+    /**
+     * @brief Loads up to four quaternions. Missing lanes are filled with
+     *        identity so they never produce NaNs.
+     */
+    FORCEINLINE Quaternion4
+    loadQuaternions(const Quaternion* src, uint32 count) {
+      Quaternion4 out;
+      if (4 <= count) {
+        out.x = simd::load_u(&src[0].x);
+        out.y = simd::load_u(&src[1].x);
+        out.z = simd::load_u(&src[2].x);
+        out.w = simd::load_u(&src[3].x);
+      }
+      else {
+        Quaternion tmp[4] = { Quaternion::IDENTITY, Quaternion::IDENTITY,
+                              Quaternion::IDENTITY, Quaternion::IDENTITY };
+        memcpy(tmp, src, sizeof(Quaternion) * count);
+
+        out.x = simd::load_u(&tmp[0].x);
+        out.y = simd::load_u(&tmp[1].x);
+        out.z = simd::load_u(&tmp[2].x);
+        out.w = simd::load_u(&tmp[3].x);
+      }
+
+      simd::transpose4(out.x, out.y, out.z, out.w);
+      return out;
+    }
+
+    FORCEINLINE void
+    storeQuaternions(Quaternion* dst, Quaternion4 q, uint32 count) {
+      simd::transpose4(q.x, q.y, q.z, q.w);
+      if (4 <= count) {
+        simd::store_u(&dst[0].x, q.x);
+        simd::store_u(&dst[1].x, q.y);
+        simd::store_u(&dst[2].x, q.z);
+        simd::store_u(&dst[3].x, q.w);
+      }
+      else {
+        Quaternion tmp[4];
+        simd::store_u(&tmp[0].x, q.x);
+        simd::store_u(&tmp[1].x, q.y);
+        simd::store_u(&tmp[2].x, q.z);
+        simd::store_u(&tmp[3].x, q.w);
+        memcpy(dst, tmp, sizeof(Quaternion) * count);
+      }
+    }
+
+    /**
+     * @brief Loads up to four vectors. Vector3 is not aligned so the data
+     *        goes through an aligned scratch buffer before de-interleaving.
+     */
+    FORCEINLINE Vector3x4
+    loadVectors(const Vector3* src, uint32 count) {
+      SIMDPP_ALIGN(16) float tmp[12] = { 0.0f };
+      memcpy(tmp, src, sizeof(Vector3) * Math::min(count, 4U));
+
+      Vector3x4 out;
+      simd::load_packed3(out.x, out.y, out.z, tmp);
+      return out;
+    }
+
+    FORCEINLINE void
+    storeVectors(Vector3* dst, const Vector3x4& v, uint32 count) {
+      SIMDPP_ALIGN(16) float tmp[12];
+      simd::store_packed3(tmp, v.x, v.y, v.z);
+      memcpy(dst, tmp, sizeof(Vector3) * Math::min(count, 4U));
+    }
+
+    FORCEINLINE float32x4
+    dot(const Quaternion4& a, const Quaternion4& b) {
+      return a.x * b.x + a.y * b.y + a.z * b.z + a.w * b.w;
+    }
+
+    FORCEINLINE Quaternion4
+    multiply(const Quaternion4& a, const Quaternion4& b) {
+      Quaternion4 r;
+      r.x = a.w * b.x + a.x * b.w + a.y * b.z - a.z * b.y;
+      r.y = a.w * b.y - a.x * b.z + a.y * b.w + a.z * b.x;
+      r.z = a.w * b.z + a.x * b.y - a.y * b.x + a.z * b.w;
+      r.w = a.w * b.w - a.x * b.x - a.y * b.y - a.z * b.z;
+      return r;
+    }
+
+    FORCEINLINE Quaternion4
+    normalize(const Quaternion4& q, const float32x4& tolerance) {
+      float32x4 squareSum = dot(q, q);
+      mask_float32x4 valid = simd::cmp_ge(squareSum, tolerance);
+
+      //Estimate plus one Newton-Raphson step: r' = r * (1.5 - 0.5 * s * r^2)
+      float32x4 scale = simd::rsqrt_e(squareSum);
+      float32x4 halfSum = squareSum * simd::splat<float32x4>(0.5f);
+      scale = scale * (simd::splat<float32x4>(1.5f) - halfSum * scale * scale);
+
+      float32x4 zero = simd::splat<float32x4>(0.0f);
+      float32x4 one = simd::splat<float32x4>(1.0f);
+
+      Quaternion4 r;
+      r.x = simd::blend(q.x * scale, zero, valid);
+      r.y = simd::blend(q.y * scale, zero, valid);
+      r.z = simd::blend(q.z * scale, zero, valid);
+      r.w = simd::blend(q.w * scale, one, valid);
+      return r;
+    }
+
+    /**
+     * @brief V' = V + w * T + (Q x T), where T = 2 * (Q x V)
+     */
+    FORCEINLINE Vector3x4
+    rotate(const float32x4& qx,
+           const float32x4& qy,
+           const float32x4& qz,
+           const float32x4& qw,
+           const Vector3x4& v) {
+      float32x4 two = simd::splat<float32x4>(2.0f);
+      float32x4 tx = two * (qy * v.z - qz * v.y);
+      float32x4 ty = two * (qz * v.x - qx * v.z);
+      float32x4 tz = two * (qx * v.y - qy * v.x);
+
+      Vector3x4 r;
+      r.x = v.x + qw * tx + (qy * tz - qz * ty);
+      r.y = v.y + qw * ty + (qz * tx - qx * tz);
+      r.z = v.z + qw * tz + (qx * ty - qy * tx);
+      return r;
+    }
+
+    FORCEINLINE float32x4
+    loadAlpha(const float* src, uint32 count) {
+      if (4 <= count) {
+        return simd::load_u(src);
+      }
+
+      float tmp[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+      memcpy(tmp, src, sizeof(float) * count);
+      return simd::load_u(tmp);
+    }
+
+    /**
+     * @brief Evaluates the polynomial approximation of the slerp weight
+     *        sin(t * omega) / sin(omega) for cosOmega in [0, 1].
+     *        See David Eberly, "A Fast and Accurate Algorithm for Computing
+     *        SLERP", Journal of Graphics, GPU, and Game Tools, 2011.
+     */
+    FORCEINLINE float32x4
+    slerpWeight(const float32x4& t, const float32x4& cosOmegaMinusOne) {
+      static constexpr float onePlusMu = 1.90110745351730037f;
+      static constexpr float u[8] = { 1.0f / (1 * 3),
+                                      1.0f / (2 * 5),
+                                      1.0f / (3 * 7),
+                                      1.0f / (4 * 9),
+                                      1.0f / (5 * 11),
+                                      1.0f / (6 * 13),
+                                      1.0f / (7 * 15),
+                                      onePlusMu / (8 * 17) };
+      static constexpr float v[8] = { 1.0f / 3,
+                                      2.0f / 5,
+                                      3.0f / 7,
+                                      4.0f / 9,
+                                      5.0f / 11,
+                                      6.0f / 13,
+                                      7.0f / 15,
+                                      onePlusMu * 8 / 17 };
+
+      float32x4 one = simd::splat<float32x4>(1.0f);
+      float32x4 sqrT = t * t;
+
+      float32x4 result = one;
+      for (int32 i = 7; i >= 0; --i) {
+        float32x4 b = (simd::splat<float32x4>(u[i]) * sqrT -
+                       simd::splat<float32x4>(v[i])) * cosOmegaMinusOne;
+        result = one + b * result;
+      }
+
+      return t * result;
+    }
+  }
+
+  void
+  QuaternionBatch::multiply(const Quaternion* A,
+                            const Quaternion* B,
+                            Quaternion* output,
+                            uint32 count) {
+    for (uint32 i = 0; i < count; i += 4) {
+      const uint32 num = count - i;
+      Quaternion4 a = loadQuaternions(A + i, num);
+      Quaternion4 b = loadQuaternions(B + i, num);
+      storeQuaternions(output + i, geEngineSDK::multiply(a, b), num);
+    }
+  }
+
+  void
+  QuaternionBatch::normalize(const Quaternion* input,
+                             Quaternion* output,
+                             uint32 count,
+                             float tolerance) {
+    float32x4 tol = simd::splat<float32x4>(tolerance);
+    for (uint32 i = 0; i < count; i += 4) {
+      const uint32 num = count - i;
+      Quaternion4 q = loadQuaternions(input + i, num);
+      storeQuaternions(output + i, geEngineSDK::normalize(q, tol), num);
+    }
+  }
+
+  void
+  QuaternionBatch::nlerp(const Quaternion* A,
+                         const Quaternion* B,
+                         const float* alpha,
+                         Quaternion* output,
+                         uint32 count) {
+    float32x4 zero = simd::splat<float32x4>(0.0f);
+    float32x4 one = simd::splat<float32x4>(1.0f);
+    float32x4 minusOne = simd::splat<float32x4>(-1.0f);
+    float32x4 tol = simd::splat<float32x4>(Math::SMALL_NUMBER);
+
+    for (uint32 i = 0; i < count; i += 4) {
+      const uint32 num = count - i;
+      Quaternion4 a = loadQuaternions(A + i, num);
+      Quaternion4 b = loadQuaternions(B + i, num);
+      float32x4 t = loadAlpha(alpha + i, num);
+
+      //Same as Quaternion::fastLerp(), flip A to take the shortest route
+      float32x4 bias = simd::blend(one, minusOne, simd::cmp_ge(dot(a, b), zero));
+      float32x4 scaleA = bias * (one - t);
+
+      Quaternion4 r;
+      r.x = b.x * t + a.x * scaleA;
+      r.y = b.y * t + a.y * scaleA;
+      r.z = b.z * t + a.z * scaleA;
+      r.w = b.w * t + a.w * scaleA;
+
+      storeQuaternions(output + i, geEngineSDK::normalize(r, tol), num);
+    }
+  }
+
+  void
+  QuaternionBatch::slerp(const Quaternion* A,
+                         const Quaternion* B,
+                         const float* alpha,
+                         Quaternion* output,
+                         uint32 count) {
+    float32x4 zero = simd::splat<float32x4>(0.0f);
+    float32x4 one = simd::splat<float32x4>(1.0f);
+    float32x4 minusOne = simd::splat<float32x4>(-1.0f);
+    float32x4 tol = simd::splat<float32x4>(Math::SMALL_NUMBER);
+
+    for (uint32 i = 0; i < count; i += 4) {
+      const uint32 num = count - i;
+      Quaternion4 a = loadQuaternions(A + i, num);
+      Quaternion4 b = loadQuaternions(B + i, num);
+      float32x4 t = loadAlpha(alpha + i, num);
+
+      //Unaligned quaternions - compensate, results in taking shorter route
+      float32x4 rawCosom = dot(a, b);
+      float32x4 sign = simd::blend(one, minusOne, simd::cmp_ge(rawCosom, zero));
+      float32x4 cosomMinusOne = simd::min(rawCosom * sign, one) - one;
+
+      float32x4 scaleA = slerpWeight(one - t, cosomMinusOne);
+      float32x4 scaleB = slerpWeight(t, cosomMinusOne) * sign;
+
+      Quaternion4 r;
+      r.x = a.x * scaleA + b.x * scaleB;
+      r.y = a.y * scaleA + b.y * scaleB;
+      r.z = a.z * scaleA + b.z * scaleB;
+      r.w = a.w * scaleA + b.w * scaleB;
+
+      storeQuaternions(output + i, geEngineSDK::normalize(r, tol), num);
+    }
+  }
+
+  void
+  QuaternionBatch::rotateVectors(const Quaternion& rotation,
+                                 const Vector3* input,
+                                 Vector3* output,
+                                 uint32 count) {
+    float32x4 qx = simd::splat<float32x4>(rotation.x);
+    float32x4 qy = simd::splat<float32x4>(rotation.y);
+    float32x4 qz = simd::splat<float32x4>(rotation.z);
+    float32x4 qw = simd::splat<float32x4>(rotation.w);
+
+    for (uint32 i = 0; i < count; i += 4) {
+      const uint32 num = count - i;
+      Vector3x4 v = loadVectors(input + i, num);
+      storeVectors(output + i, rotate(qx, qy, qz, qw, v), num);
+    }
+  }
+
+  void
+  QuaternionBatch::rotateVectors(const Quaternion* rotations,
+                                 const Vector3* input,
+                                 Vector3* output,
+                                 uint32 count) {
+    for (uint32 i = 0; i < count; i += 4) {
+      const uint32 num = count - i;
+      Quaternion4 q = loadQuaternions(rotations + i, num);
+      Vector3x4 v = loadVectors(input + i, num);
+      storeVectors(output + i, rotate(q.x, q.y, q.z, q.w, v), num);
+    }
+  }
+}
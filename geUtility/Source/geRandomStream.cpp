@@ -0,0 +1,380 @@
+/*****************************************************************************/
+/**
+ * @file    geRandomStream.cpp
+ * @author  Samuel Prince (samuel.prince.quezada@gmail.com)
+ * @date    2018/07/05
+ * @brief   Counter based pseudo random number generator (Philox4x32-10).
+ *
+ * Counter based pseudo random number generator. Every output is a pure
+ * function of the seed, the stream index and its position in the stream, so
+ * any number of independent and reproducible streams can be created (one per
+ * task, per particle emitter, per chunk...) and any stream can jump to any
+ * position in constant time.
+ *
+ * @bug     No known bugs.
+ */
+/*****************************************************************************/
+
+/*****************************************************************************/
+/**
+ * Includes
+ */
+/*****************************************************************************/
+#include "geRandomStream.h"
+#include "geMath.h"
+#include "geNumericLimits.h"
+#include "geSIMD.h"
+
+namespace geEngineSDK {
+  using simd::float32x4;
+  using simd::uint32x4;
+  using simd::int32x4;
+  using simd::uint64x4;
+  using simd::mask_float32x4;
+
+  namespace {
+    /**
+     * Philox4x32 multipliers and Weyl sequence constants.
+     */
+    constexpr uint32 PHILOX_M0 = 0xD2511F53;
+    constexpr uint32 PHILOX_M1 = 0xCD9E8D57;
+    constexpr uint32 PHILOX_W0 = 0x9E3779B9;
+    constexpr uint32 PHILOX_W1 = 0xBB67AE85;
+    constexpr uint32 PHILOX_ROUNDS = 10;
+
+    /**
+     * @brief Number of vectors generated per chunk by the batch methods.
+     */
+    constexpr SIZE_T VECTOR_CHUNK = 256;
+
+    FORCEINLINE void
+    mulHiLo(uint32 a, uint32 b, uint32& hi, uint32& lo) {
+      const uint64 product = static_cast<uint64>(a) * b;
+      hi = static_cast<uint32>(product >> 32);
+      lo = static_cast<uint32>(product);
+    }
+
+    /**
+     * @brief Multiplies four lanes by a constant and returns both halves of
+     *        the 64 bit products.
+     */
+    FORCEINLINE void
+    mulHiLo(const uint32x4& a, uint32 b, uint32x4& hi, uint32x4& lo) {
+      uint64x4 product = simd::mull(a, simd::splat<uint32x4>(b));
+      uint32x4 first = simd::bit_cast<uint32x4>(product.vec(0));
+      uint32x4 second = simd::bit_cast<uint32x4>(product.vec(1));
+      lo = simd::unzip4_lo(first, second);
+      hi = simd::unzip4_hi(first, second);
+    }
+
+    FORCEINLINE float32x4
+    toUNorm4(const uint32x4& value) {
+      int32x4 mantissa = simd::shift_r<8>(value);
+      return simd::to_float32(mantissa) * simd::splat<float32x4>(1.0f / 16777216.0f);
+    }
+
+    /**
+     * @brief Same approximation as Math::sin_cos(), for angles in [-pi, pi].
+     */
+    FORCEINLINE void
+    sinCos(const float32x4& angle, float32x4& outSin, float32x4& outCos) {
+      const float32x4 pi = simd::splat<float32x4>(Math::PI);
+      const float32x4 halfPi = simd::splat<float32x4>(Math::HALF_PI);
+
+      //Map the angle to [-pi/2,pi/2] with the same sine
+      mask_float32x4 above = simd::cmp_gt(angle, halfPi);
+      mask_float32x4 below = simd::cmp_lt(angle, simd::splat<float32x4>(-Math::HALF_PI));
+
+      float32x4 y = simd::blend(pi - angle, angle, above);
+      y = simd::blend(simd::splat<float32x4>(-Math::PI) - angle, y, below);
+      float32x4 sign = simd::blend(simd::splat<float32x4>(-1.0f),
+                                   simd::splat<float32x4>(1.0f),
+                                   above | below);
+
+      float32x4 y2 = y * y;
+
+      //11-degree minimax approximation
+      float32x4 s = simd::splat<float32x4>(-2.3889859e-08f);
+      s = s * y2 + simd::splat<float32x4>(2.7525562e-06f);
+      s = s * y2 - simd::splat<float32x4>(0.00019840874f);
+      s = s * y2 + simd::splat<float32x4>(0.0083333310f);
+      s = s * y2 - simd::splat<float32x4>(0.16666667f);
+      outSin = (s * y2 + simd::splat<float32x4>(1.0f)) * y;
+
+      //10-degree minimax approximation
+      float32x4 c = simd::splat<float32x4>(-2.6051615e-07f);
+      c = c * y2 + simd::splat<float32x4>(2.4760495e-05f);
+      c = c * y2 - simd::splat<float32x4>(0.0013888378f);
+      c = c * y2 + simd::splat<float32x4>(0.041666638f);
+      c = c * y2 - simd::splat<float32x4>(0.5f);
+      outCos = (c * y2 + simd::splat<float32x4>(1.0f)) * sign;
+    }
+
+    /**
+     * @brief Cube root of values in range [0, 1].
+     */
+    FORCEINLINE float32x4
+    cubeRoot(const float32x4& value) {
+      //Initial guess dividing the exponent by three, then Newton-Raphson
+      int32x4 bits = simd::bit_cast<int32x4>(value);
+      float32x4 third = simd::to_float32(bits) * simd::splat<float32x4>(1.0f / 3.0f);
+      bits = simd::to_int32(third) + simd::splat<int32x4>(0x2A5137A0);
+      float32x4 y = simd::bit_cast<float32x4>(bits);
+
+      const float32x4 oneThird = simd::splat<float32x4>(1.0f / 3.0f);
+      for (uint32 i = 0; i < 3; ++i) {
+        y = (y + y + value / (y * y)) * oneThird;
+      }
+
+      return simd::blend(simd::splat<float32x4>(0.0f),
+                         y,
+                         simd::cmp_eq(value, simd::splat<float32x4>(0.0f)));
+    }
+
+    /**
+     * @brief Builds unit vectors from two random values per vector.
+     */
+    FORCEINLINE void
+    unitVectors(const uint32x4& zValue,
+                const uint32x4& angleValue,
+                float32x4& x,
+                float32x4& y,
+                float32x4& z) {
+      const float32x4 one = simd::splat<float32x4>(1.0f);
+      z = toUNorm4(zValue) * simd::splat<float32x4>(2.0f) - one;
+
+      float32x4 angle = (toUNorm4(angleValue) - simd::splat<float32x4>(0.5f)) *
+                        simd::splat<float32x4>(Math::TWO_PI);
+      float32x4 sinAngle, cosAngle;
+      sinCos(angle, sinAngle, cosAngle);
+
+      float32x4 radius = simd::sqrt(simd::max(one - z * z, simd::splat<float32x4>(0.0f)));
+      x = radius * cosAngle;
+      y = radius * sinAngle;
+    }
+
+    FORCEINLINE void
+    storeVectors(Vector3* dst,
+                 const float32x4& x,
+                 const float32x4& y,
+                 const float32x4& z) {
+      SIMDPP_ALIGN(16) float tmp[12];
+      simd::store_packed3(tmp, x, y, z);
+      memcpy(dst, tmp, sizeof(Vector3) * 4);
+    }
+
+    FORCEINLINE Vector3
+    unitVector(uint32 zValue, uint32 angleValue) {
+      const float z = RandomStream::toUNorm(zValue) * 2.0f - 1.0f;
+      const float angle = (RandomStream::toUNorm(angleValue) - 0.5f) * Math::TWO_PI;
+
+      float sinAngle, cosAngle;
+      Math::sin_cos(&sinAngle, &cosAngle, angle);
+
+      const float radius = Math::sqrt(Math::max(1.0f - z * z, 0.0f));
+      return Vector3(radius * cosAngle, radius * sinAngle, z);
+    }
+  }
+
+  void
+  RandomStream::setSeed(uint64 seed, uint64 stream) {
+    m_key[0] = static_cast<uint32>(seed);
+    m_key[1] = static_cast<uint32>(seed >> 32);
+    m_stream[0] = static_cast<uint32>(stream);
+    m_stream[1] = static_cast<uint32>(stream >> 32);
+    m_position = 0;
+
+    //Make sure the first call to get() generates the block
+    m_cachedBlock = std::numeric_limits<uint64>::max();
+  }
+
+  Vector3
+  RandomStream::getUnitVector() {
+    const uint32 zValue = get();
+    const uint32 angleValue = get();
+    return unitVector(zValue, angleValue);
+  }
+
+  Vector3
+  RandomStream::getPointInSphere() {
+    const Vector3 dir = getUnitVector();
+    return dir * Math::pow(getUNorm(), 1.0f / 3.0f);
+  }
+
+  void
+  RandomStream::fill(uint32* output, SIZE_T count) {
+    SIZE_T i = 0;
+
+    //Finish the current block so the rest starts at a block boundary
+    for (; i < count && (m_position & 3); ++i) {
+      output[i] = get();
+    }
+
+    const SIZE_T blockCount = (count - i) >> 2;
+    generateBlocks(m_position >> 2, blockCount, output + i);
+    m_position += blockCount * 4;
+    i += blockCount * 4;
+
+    for (; i < count; ++i) {
+      output[i] = get();
+    }
+  }
+
+  void
+  RandomStream::fill(float* output, SIZE_T count) {
+    uint32* bits = reinterpret_cast<uint32*>(output);
+    fill(bits, count);
+
+    SIZE_T i = 0;
+    for (; i + 4 <= count; i += 4) {
+      uint32x4 value = simd::load_u(bits + i);
+      simd::store_u(output + i, toUNorm4(value));
+    }
+
+    for (; i < count; ++i) {
+      output[i] = toUNorm(bits[i]);
+    }
+  }
+
+  void
+  RandomStream::fillUnitVectors(Vector3* output, SIZE_T count) {
+    uint32 values[VECTOR_CHUNK * 2];
+
+    SIZE_T i = 0;
+    while (i < count) {
+      const SIZE_T chunk = Math::min(count - i, VECTOR_CHUNK);
+      fill(values, chunk * 2);
+
+      SIZE_T j = 0;
+      for (; j + 4 <= chunk; j += 4) {
+        uint32x4 first = simd::load_u(values + j * 2);
+        uint32x4 second = simd::load_u(values + j * 2 + 4);
+
+        float32x4 x, y, z;
+        unitVectors(simd::unzip4_lo(first, second),
+                    simd::unzip4_hi(first, second),
+                    x, y, z);
+        storeVectors(output + i + j, x, y, z);
+      }
+
+      for (; j < chunk; ++j) {
+        output[i + j] = unitVector(values[j * 2], values[j * 2 + 1]);
+      }
+
+      i += chunk;
+    }
+  }
+
+  void
+  RandomStream::fillInSphere(Vector3* output, SIZE_T count) {
+    SIMDPP_ALIGN(16) uint32 values[VECTOR_CHUNK * 3];
+
+    SIZE_T i = 0;
+    while (i < count) {
+      const SIZE_T chunk = Math::min(count - i, VECTOR_CHUNK);
+      fill(values, chunk * 3);
+
+      SIZE_T j = 0;
+      for (; j + 4 <= chunk; j += 4) {
+        uint32x4 zValue, angleValue, radiusValue;
+        simd::load_packed3(zValue, angleValue, radiusValue, values + j * 3);
+
+        float32x4 x, y, z;
+        unitVectors(zValue, angleValue, x, y, z);
+
+        float32x4 radius = cubeRoot(toUNorm4(radiusValue));
+        storeVectors(output + i + j, x * radius, y * radius, z * radius);
+      }
+
+      for (; j < chunk; ++j) {
+        const float radius = Math::pow(toUNorm(values[j * 3 + 2]), 1.0f / 3.0f);
+        output[i + j] = unitVector(values[j * 3], values[j * 3 + 1]) * radius;
+      }
+
+      i += chunk;
+    }
+  }
+
+  void
+  RandomStream::philox(const uint32 key[2], const uint32 counter[4], uint32 output[4]) {
+    uint32 k0 = key[0], k1 = key[1];
+    uint32 c0 = counter[0], c1 = counter[1], c2 = counter[2], c3 = counter[3];
+
+    for (uint32 round = 0; round < PHILOX_ROUNDS; ++round) {
+      uint32 hi0, lo0, hi1, lo1;
+      mulHiLo(PHILOX_M0, c0, hi0, lo0);
+      mulHiLo(PHILOX_M1, c2, hi1, lo1);
+
+      c0 = hi1 ^ c1 ^ k0;
+      c1 = lo1;
+      c2 = hi0 ^ c3 ^ k1;
+      c3 = lo0;
+
+      k0 += PHILOX_W0;
+      k1 += PHILOX_W1;
+    }
+
+    output[0] = c0;
+    output[1] = c1;
+    output[2] = c2;
+    output[3] = c3;
+  }
+
+  void
+  RandomStream::generateBlock(uint64 block, uint32 output[4]) const {
+    const uint32 counter[4] = { static_cast<uint32>(block),
+                                static_cast<uint32>(block >> 32),
+                                m_stream[0],
+                                m_stream[1] };
+    philox(m_key, counter, output);
+  }
+
+  void
+  RandomStream::generateBlocks(uint64 firstBlock,
+                               SIZE_T blockCount,
+                               uint32* output) const {
+    SIZE_T i = 0;
+    for (; i + 4 <= blockCount; i += 4) {
+      //One lane per block
+      SIMDPP_ALIGN(16) uint32 blockLo[4];
+      SIMDPP_ALIGN(16) uint32 blockHi[4];
+      for (uint32 lane = 0; lane < 4; ++lane) {
+        const uint64 block = firstBlock + i + lane;
+        blockLo[lane] = static_cast<uint32>(block);
+        blockHi[lane] = static_cast<uint32>(block >> 32);
+      }
+
+      uint32x4 c0 = simd::load(blockLo);
+      uint32x4 c1 = simd::load(blockHi);
+      uint32x4 c2 = simd::splat<uint32x4>(m_stream[0]);
+      uint32x4 c3 = simd::splat<uint32x4>(m_stream[1]);
+      uint32 k0 = m_key[0], k1 = m_key[1];
+
+      for (uint32 round = 0; round < PHILOX_ROUNDS; ++round) {
+        uint32x4 hi0, lo0, hi1, lo1;
+        mulHiLo(c0, PHILOX_M0, hi0, lo0);
+        mulHiLo(c2, PHILOX_M1, hi1, lo1);
+
+        c0 = hi1 ^ c1 ^ simd::splat<uint32x4>(k0);
+        c1 = lo1;
+        c2 = hi0 ^ c3 ^ simd::splat<uint32x4>(k1);
+        c3 = lo0;
+
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+      }
+
+      //Back to one register per block, in stream order
+      simd::transpose4(c0, c1, c2, c3);
+      uint32* dst = output + i * 4;
+      simd::store_u(dst, c0);
+      simd::store_u(dst + 4, c1);
+      simd::store_u(dst + 8, c2);
+      simd::store_u(dst + 12, c3);
+    }
+
+    for (; i < blockCount; ++i) {
+      generateBlock(firstBlock + i, output + i * 4);
+    }
+  }
+}
@@ -19,22 +19,23 @@
 #include "geSphere.h"
 #include "geBox.h"
 #include "geMatrix4.h"
+#include "geVector3Stream.h"
 
 namespace geEngineSDK {
 
   Sphere::Sphere(const Vector3* Pts, SIZE_T Count) : m_center(0, 0, 0), m_radius(0) {
     if (Count) {
-      const AABox Box(Pts, Count);
-      *this = Sphere((Box.m_min + Box.m_max) / 2, 0);
-
-      for (SIZE_T i = 0; i < Count; ++i) {
-        const float Dist = Vector3::distSquared(Pts[i], m_center);
-        if (Dist > m_radius) {
-          m_radius = Dist;
-        }
-      }
+      const AABox Box = Vector3Stream::getBounds(Pts, Count);
+      m_center = (Box.m_min + Box.m_max) / 2;
+      m_radius = Math::sqrt(Vector3Stream::getMaxDistSquared(Pts, Count, m_center)) * 1.001f;
+    }
+  }
 
-      m_radius = Math::sqrt(m_radius) * 1.001f;
+  Sphere::Sphere(const Vector3Stream& Pts) : m_center(0, 0, 0), m_radius(0) {
+    if (!Pts.empty()) {
+      const AABox Box = Pts.getBounds();
+      m_center = (Box.m_min + Box.m_max) / 2;
+      m_radius = Math::sqrt(Pts.getMaxDistSquared(m_center)) * 1.001f;
     }
   }
 
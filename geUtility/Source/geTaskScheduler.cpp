@@ -19,7 +19,10 @@
  */
 /*****************************************************************************/
 #include "geTaskScheduler.h"
+#include "geFlightRecorder.h"
+#include "geProfilerCPU.h"
 #include "geThreadPool.h"
+#include "geTimer.h"
 
 namespace geEngineSDK {
   using std::bind;
@@ -117,9 +120,20 @@ namespace geEngineSDK {
     task->m_taskId = m_nextTaskId++;
     task->m_state.store(0); //Reset state in case the task is getting re-queued
 
+    FlightRecorder::record(FLIGHT_RECORD::kTaskQueued,
+                           nullptr,
+                           task->m_taskId,
+                           task->m_name.c_str(),
+                           task->m_name.size());
+
     m_checkTasks = true;
     m_taskQueue.insert(std::move(task));
 
+    auto queueDepth = static_cast<uint32>(m_taskQueue.size());
+    m_peakQueueDepth = std::max(m_peakQueueDepth, queueDepth);
+    m_queueDepthSum += queueDepth;
+    ++m_numQueued;
+
     //Wake main scheduler thread
     m_taskReadyCond.notify_one();
   }
@@ -158,6 +172,7 @@ namespace geEngineSDK {
         break;
       }
 
+      GE_PROFILE_SCOPE("TaskScheduler::schedule");
       for (auto iter = m_taskQueue.begin(); iter != m_taskQueue.end();) {
         if ((uint32)m_activeTasks.size() >= m_maxActiveTasks) {
           break;
@@ -189,7 +204,25 @@ namespace geEngineSDK {
 
   void
   TaskScheduler::runTask(SPtr<Task> task) {
-    task->m_taskWorker();
+    {
+      GE_PROFILE_SCOPE("TaskScheduler::runTask");
+      FlightRecorder::record(FLIGHT_RECORD::kTaskBegin,
+                             nullptr,
+                             task->m_taskId,
+                             task->m_name.c_str(),
+                             task->m_name.size());
+
+      //Counts rather than microseconds, most tasks take less than one
+      CycleTimer timer;
+      task->m_taskWorker();
+      m_busyCycles.fetch_add(timer.getCycles(), std::memory_order_relaxed);
+
+      FlightRecorder::record(FLIGHT_RECORD::kTaskEnd,
+                             nullptr,
+                             task->m_taskId,
+                             task->m_name.c_str(),
+                             task->m_name.size());
+    }
 
     {
       Lock lock(m_readyMutex);
@@ -203,6 +236,7 @@ namespace geEngineSDK {
     {
       Lock lock(m_completeMutex);
       task->m_state.store(2);
+      m_numCompleted.fetch_add(1, std::memory_order_relaxed);
 
       m_taskCompleteCond.notify_all();
     }
@@ -217,6 +251,32 @@ namespace geEngineSDK {
     }
   }
 
+  TaskSchedulerStats
+  TaskScheduler::getStats() const {
+    TaskSchedulerStats stats;
+
+    {
+      Lock lock(m_readyMutex);
+      stats.numWorkers = m_maxActiveTasks;
+      stats.queueDepth = static_cast<uint32>(m_taskQueue.size());
+      stats.numActiveTasks = static_cast<uint32>(m_activeTasks.size());
+      stats.peakQueueDepth = m_peakQueueDepth;
+      stats.numQueued = m_numQueued;
+      stats.queueDepthSum = m_queueDepthSum;
+    }
+
+    stats.numCompleted = m_numCompleted.load(std::memory_order_relaxed);
+    stats.busyTime = CycleTimer::toNanoseconds(
+      m_busyCycles.load(std::memory_order_relaxed)) / 1000;
+    return stats;
+  }
+
+  void
+  TaskScheduler::resetPeakQueueDepth() {
+    Lock lock(m_readyMutex);
+    m_peakQueueDepth = static_cast<uint32>(m_taskQueue.size());
+  }
+
   void
   TaskScheduler::waitUntilComplete(const Task* task) {
     if (task->isCanceled()) {
@@ -18,6 +18,7 @@
 /*****************************************************************************/
 #include "geTime.h"
 #include "geTimer.h"
+#include "geMath.h"
 
 namespace geEngineSDK {
   using std::memory_order_relaxed;
@@ -25,6 +26,7 @@ namespace geEngineSDK {
   const double Time::MICROSEC_TO_SEC = 1.0 / 1000000.0;
 
   Time::Time() {
+    CycleTimer::calibrate();
     m_timer = ge_new<Timer>();
     m_appStartTime = m_timer->getStartMs();
     m_lastFrameTime = m_timer->getMicroseconds();
@@ -37,18 +39,165 @@ namespace geEngineSDK {
   void
   Time::_update() {
     uint64 currentFrameTime = m_timer->getMicroseconds();
-    m_frameDelta = static_cast<float>((currentFrameTime - m_lastFrameTime) * MICROSEC_TO_SEC);
-    m_timeSinceStartMs = static_cast<uint64>(currentFrameTime / 1000);
-    m_timeSinceStart = m_timeSinceStartMs / 1000.0f;
+    m_frameDelta = currentFrameTime - m_lastFrameTime;
+    m_timeSinceStart = currentFrameTime;
+    m_frameTimes.addFrame(m_frameDelta);
+    m_frameTimeStats.addFrame(m_frameDelta);
+    m_gameClock.advance(m_frameDelta);
+
+    //Advance the created clocks, and forget the ones only held here
+    SIZE_T numClocks = 0;
+    for (auto& clock : m_clocks) {
+      if (1 < clock.use_count()) {
+        clock->advance(m_frameDelta);
+        m_clocks[numClocks++] = std::move(clock);
+      }
+    }
+    m_clocks.resize(numClocks);
+
     m_lastFrameTime = currentFrameTime;
     m_currentFrame.fetch_add(1, memory_order_relaxed);
   }
 
+  SPtr<Clock>
+  Time::createClock() {
+    SPtr<Clock> clock = ge_shared_ptr_new<Clock>();
+    m_clocks.push_back(clock);
+    return clock;
+  }
+
   uint64
   Time::getTimePrecise() const {
     return m_timer->getMicroseconds();
   }
 
+  void
+  FrameTimeHistogram::addFrame(uint64 frameTime) {
+    uint64 bucket = std::min(frameTime / BUCKET_WIDTH, static_cast<uint64>(NUM_BUCKETS - 1));
+    ++counts[bucket];
+    ++numFrames;
+    totalTime += frameTime;
+  }
+
+  FrameTimeHistogram
+  FrameTimeHistogram::since(const FrameTimeHistogram& earlier) const {
+    FrameTimeHistogram histogram;
+    for (uint32 i = 0; i < NUM_BUCKETS; ++i) {
+      histogram.counts[i] = counts[i] - earlier.counts[i];
+    }
+    histogram.numFrames = numFrames - earlier.numFrames;
+    histogram.totalTime = totalTime - earlier.totalTime;
+    return histogram;
+  }
+
+  uint64
+  FrameTimeHistogram::getAverage() const {
+    return 0 == numFrames ? 0 : totalTime / numFrames;
+  }
+
+  uint64
+  FrameTimeHistogram::getPercentile(float percentile) const {
+    if (0 == numFrames) {
+      return 0;
+    }
+
+    auto rank = static_cast<uint64>(std::ceil(percentile * numFrames));
+    rank = std::max(rank, static_cast<uint64>(1));
+
+    uint64 numBelow = 0;
+    for (uint32 i = 0; i < NUM_BUCKETS; ++i) {
+      numBelow += counts[i];
+      if (numBelow >= rank) {
+        return (i + 1) * BUCKET_WIDTH;
+      }
+    }
+
+    return NUM_BUCKETS * BUCKET_WIDTH;
+  }
+
+  void
+  FrameTimeStats::addFrame(uint64 frameTime) {
+    frameTimes[numAdded % CAPACITY] =
+      static_cast<uint32>(std::min<uint64>(frameTime, NumLimit::MAX_UINT32));
+    ++numAdded;
+  }
+
+  uint64
+  FrameTimeStats::getMin() const {
+    const uint32 numFrames = getNumFrames();
+    return 0 == numFrames ? 0 : *std::min_element(frameTimes, frameTimes + numFrames);
+  }
+
+  uint64
+  FrameTimeStats::getMax() const {
+    const uint32 numFrames = getNumFrames();
+    return 0 == numFrames ? 0 : *std::max_element(frameTimes, frameTimes + numFrames);
+  }
+
+  uint64
+  FrameTimeStats::getAverage() const {
+    const uint32 numFrames = getNumFrames();
+    if (0 == numFrames) {
+      return 0;
+    }
+
+    uint64 total = 0;
+    for (uint32 i = 0; i < numFrames; ++i) {
+      total += frameTimes[i];
+    }
+    return total / numFrames;
+  }
+
+  uint64
+  FrameTimeStats::getPercentile(float percentile) const {
+    const uint32 numFrames = getNumFrames();
+    if (0 == numFrames) {
+      return 0;
+    }
+
+    auto rank = static_cast<uint32>(std::ceil(Math::clamp(percentile, 0.0f, 1.0f) * numFrames));
+    rank = std::max(rank, 1u);
+
+    uint32 sorted[CAPACITY];
+    std::copy(frameTimes, frameTimes + numFrames, sorted);
+    std::nth_element(sorted, sorted + rank - 1, sorted + numFrames);
+    return sorted[rank - 1];
+  }
+
+  void
+  Clock::advance(uint64 realDelta) {
+    if (m_paused) {
+      m_frameDelta = 0;
+      return;
+    }
+
+    uint64 delta = realDelta;
+    if (1.0 != m_scale) {
+      //Carry the fraction of a microsecond so scaled clocks don't drift
+      const double scaledDelta = realDelta * m_scale + m_scaleRemainder;
+      delta = static_cast<uint64>(scaledDelta);
+      m_scaleRemainder = scaledDelta - static_cast<double>(delta);
+    }
+
+    m_time += delta;
+    m_frameDelta = delta;
+    m_fixedAccumulator += delta;
+  }
+
+  uint32
+  Clock::consumeFixedSteps() {
+    uint64 numSteps = m_fixedAccumulator / m_fixedStep;
+    if (m_maxFixedSteps < numSteps) {
+      numSteps = m_maxFixedSteps;
+      m_fixedAccumulator %= m_fixedStep;
+    }
+    else {
+      m_fixedAccumulator -= numSteps * m_fixedStep;
+    }
+
+    return static_cast<uint32>(numSteps);
+  }
+
   Time&
   g_time() {
     return Time::instance();
@@ -32,16 +32,12 @@ namespace geEngineSDK {
 
   uint64
   Timer::getMilliseconds() const {
-    auto newTime = m_highResClock.now();
-    duration<double> dur = newTime - m_startTime;
-    return duration_cast<milliseconds>(dur).count();
+    return duration_cast<milliseconds>(m_highResClock.now() - m_startTime).count();
   }
 
   uint64
   Timer::getMicroseconds() const {
-    auto newTime = m_highResClock.now();
-    duration<double> dur = newTime - m_startTime;
-    return duration_cast<microseconds>(dur).count();
+    return duration_cast<microseconds>(m_highResClock.now() - m_startTime).count();
   }
 
   uint64
@@ -49,4 +45,74 @@ namespace geEngineSDK {
     nanoseconds startTimeNs = m_startTime.time_since_epoch();
     return duration_cast<milliseconds>(startTimeNs).count();
   }
+
+  bool
+  CycleTimer::hasInvariantTsc() {
+#if GE_CYCLE_TIMER_TSC
+    uint32 regs[4] = {};
+# if GE_COMPILER == GE_COMPILER_MSVC
+    __cpuid(reinterpret_cast<int*>(regs), 0x80000000);
+    if (regs[0] < 0x80000007) {
+      return false;
+    }
+    __cpuid(reinterpret_cast<int*>(regs), 0x80000007);
+# else
+    __asm__ __volatile__("cpuid"
+                         : "=a"(regs[0]), "=b"(regs[1]), "=c"(regs[2]), "=d"(regs[3])
+                         : "a"(0x80000000), "c"(0));
+    if (regs[0] < 0x80000007) {
+      return false;
+    }
+    __asm__ __volatile__("cpuid"
+                         : "=a"(regs[0]), "=b"(regs[1]), "=c"(regs[2]), "=d"(regs[3])
+                         : "a"(0x80000007), "c"(0));
+# endif
+    return 0 != (regs[3] & (1 << 8));
+#else
+    return false;
+#endif
+  }
+
+  const CycleTimer::Rate CycleTimer::s_uncalibratedRate = { 1ULL << 32, 32 };
+  std::atomic<const CycleTimer::Rate*> CycleTimer::s_rate{&s_uncalibratedRate};
+
+  void
+  CycleTimer::calibrate() {
+    //Measured by the first call, concurrent ones wait for it
+    static const Rate rate = []() {
+      if (!isUsingTsc()) {
+        return s_uncalibratedRate;
+      }
+
+      //Measure the counter against the monotonic clock
+      const uint64 clockStart = readClock();
+      const uint64 cyclesStart = now();
+      uint64 clockEnd;
+      do {
+        clockEnd = readClock();
+      } while (clockEnd - clockStart < 10000000);
+      const uint64 cyclesEnd = now();
+
+      const double nsPerCycle = static_cast<double>(clockEnd - clockStart) /
+        static_cast<double>(std::max<uint64>(cyclesEnd - cyclesStart, 1));
+
+      //Keep as many fractional bits as fit under 2^32
+      Rate measured = { 0, 32 };
+      while (0 < measured.shift &&
+             4294967296.0 <= nsPerCycle * static_cast<double>(1ULL << measured.shift)) {
+        --measured.shift;
+      }
+      measured.multiplier = static_cast<uint64>(
+        nsPerCycle * static_cast<double>(1ULL << measured.shift) + 0.5);
+      return measured;
+    }();
+
+    s_rate.store(&rate, std::memory_order_release);
+  }
+
+  double
+  CycleTimer::getNanosecondsPerCycle() {
+    const Rate& rate = *s_rate.load(std::memory_order_acquire);
+    return static_cast<double>(rate.multiplier) / static_cast<double>(1ULL << rate.shift);
+  }
 }
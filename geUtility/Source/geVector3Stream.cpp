@@ -0,0 +1,415 @@
+/*****************************************************************************/
+/**
+ * @file    geVector3Stream.cpp
+ * @author  Samuel Prince (samuel.prince.quezada@gmail.com)
+ * @date    2018/07/04
+ * @brief   Structure of arrays container for 3D vectors.
+ *
+ * Stores a list of 3D vectors as three separate arrays of components so the
+ * common sweeps over point clouds (bounds, centroids, dot products,
+ * transformations) can run on SIMD registers four vectors at a time.
+ *
+ * @bug     No known bugs.
+ */
+/*****************************************************************************/
+
+/*****************************************************************************/
+/**
+ * Includes
+ */
+/*****************************************************************************/
+#include "geVector3Stream.h"
+#include "geBox.h"
+#include "geMatrix4.h"
+#include "geSIMD.h"
+
+namespace geEngineSDK {
+  using simd::float32x4;
+  using simd::mask_float32x4;
+
+  namespace {
+    /**
+     * @brief Loads four consecutive vectors from an array and transposes them
+     *        into SoA registers.
+     */
+    FORCEINLINE void
+    loadVectors(const Vector3* src, float32x4& x, float32x4& y, float32x4& z) {
+      SIMDPP_ALIGN(16) float tmp[12];
+      memcpy(tmp, src, sizeof(Vector3) * 4);
+      simd::load_packed3(x, y, z, tmp);
+    }
+
+    FORCEINLINE float32x4
+    distSquared(const float32x4& x,
+                const float32x4& y,
+                const float32x4& z,
+                const Vector3& point) {
+      float32x4 dx = x - simd::splat<float32x4>(point.x);
+      float32x4 dy = y - simd::splat<float32x4>(point.y);
+      float32x4 dz = z - simd::splat<float32x4>(point.z);
+      return dx * dx + dy * dy + dz * dz;
+    }
+
+    /**
+     * @brief Shared implementation of transformPosition / transformVector.
+     */
+    void
+    transformStream(const float* inX,
+                    const float* inY,
+                    const float* inZ,
+                    float* outX,
+                    float* outY,
+                    float* outZ,
+                    SIZE_T count,
+                    const Matrix4& m,
+                    float w) {
+      const float32x4 m00 = simd::splat<float32x4>(m.m[0][0]);
+      const float32x4 m01 = simd::splat<float32x4>(m.m[0][1]);
+      const float32x4 m02 = simd::splat<float32x4>(m.m[0][2]);
+      const float32x4 m10 = simd::splat<float32x4>(m.m[1][0]);
+      const float32x4 m11 = simd::splat<float32x4>(m.m[1][1]);
+      const float32x4 m12 = simd::splat<float32x4>(m.m[1][2]);
+      const float32x4 m20 = simd::splat<float32x4>(m.m[2][0]);
+      const float32x4 m21 = simd::splat<float32x4>(m.m[2][1]);
+      const float32x4 m22 = simd::splat<float32x4>(m.m[2][2]);
+      const float32x4 m30 = simd::splat<float32x4>(m.m[3][0] * w);
+      const float32x4 m31 = simd::splat<float32x4>(m.m[3][1] * w);
+      const float32x4 m32 = simd::splat<float32x4>(m.m[3][2] * w);
+
+      SIZE_T i = 0;
+      for (; i + 4 <= count; i += 4) {
+        float32x4 x = simd::load_u(inX + i);
+        float32x4 y = simd::load_u(inY + i);
+        float32x4 z = simd::load_u(inZ + i);
+
+        simd::store_u(outX + i, x * m00 + y * m10 + z * m20 + m30);
+        simd::store_u(outY + i, x * m01 + y * m11 + z * m21 + m31);
+        simd::store_u(outZ + i, x * m02 + y * m12 + z * m22 + m32);
+      }
+
+      for (; i < count; ++i) {
+        const float x = inX[i], y = inY[i], z = inZ[i];
+        outX[i] = x * m.m[0][0] + y * m.m[1][0] + z * m.m[2][0] + m.m[3][0] * w;
+        outY[i] = x * m.m[0][1] + y * m.m[1][1] + z * m.m[2][1] + m.m[3][1] * w;
+        outZ[i] = x * m.m[0][2] + y * m.m[1][2] + z * m.m[2][2] + m.m[3][2] * w;
+      }
+    }
+  }
+
+  Vector3Stream::Vector3Stream(SIZE_T count)
+    : m_x(count, 0.0f),
+      m_y(count, 0.0f),
+      m_z(count, 0.0f)
+  {}
+
+  Vector3Stream::Vector3Stream(const Vector3* points, SIZE_T count) {
+    assign(points, count);
+  }
+
+  Vector3Stream::Vector3Stream(const Vector<Vector3>& points) {
+    assign(points.data(), points.size());
+  }
+
+  void
+  Vector3Stream::assign(const Vector3* points, SIZE_T count) {
+    m_x.resize(count);
+    m_y.resize(count);
+    m_z.resize(count);
+
+    SIZE_T i = 0;
+    for (; i + 4 <= count; i += 4) {
+      float32x4 x, y, z;
+      loadVectors(points + i, x, y, z);
+      simd::store_u(&m_x[i], x);
+      simd::store_u(&m_y[i], y);
+      simd::store_u(&m_z[i], z);
+    }
+
+    for (; i < count; ++i) {
+      set(i, points[i]);
+    }
+  }
+
+  void
+  Vector3Stream::copyTo(Vector3* output) const {
+    const SIZE_T count = size();
+
+    SIZE_T i = 0;
+    for (; i + 4 <= count; i += 4) {
+      SIMDPP_ALIGN(16) float tmp[12];
+      simd::store_packed3(tmp,
+                          float32x4(simd::load_u(&m_x[i])),
+                          float32x4(simd::load_u(&m_y[i])),
+                          float32x4(simd::load_u(&m_z[i])));
+      memcpy(output + i, tmp, sizeof(Vector3) * 4);
+    }
+
+    for (; i < count; ++i) {
+      output[i] = get(i);
+    }
+  }
+
+  AABox
+  Vector3Stream::getBounds() const {
+    const SIZE_T count = size();
+    if (0 == count) {
+      return AABox(FORCE_INIT::kForceInit);
+    }
+
+    Vector3 minPoint = get(0);
+    Vector3 maxPoint = minPoint;
+
+    SIZE_T i = 0;
+    if (4 <= count) {
+      float32x4 minX = simd::load_u(&m_x[0]), maxX = minX;
+      float32x4 minY = simd::load_u(&m_y[0]), maxY = minY;
+      float32x4 minZ = simd::load_u(&m_z[0]), maxZ = minZ;
+
+      for (i = 4; i + 4 <= count; i += 4) {
+        float32x4 x = simd::load_u(&m_x[i]);
+        float32x4 y = simd::load_u(&m_y[i]);
+        float32x4 z = simd::load_u(&m_z[i]);
+
+        minX = simd::min(minX, x);
+        minY = simd::min(minY, y);
+        minZ = simd::min(minZ, z);
+        maxX = simd::max(maxX, x);
+        maxY = simd::max(maxY, y);
+        maxZ = simd::max(maxZ, z);
+      }
+
+      minPoint = Vector3(simd::reduce_min(minX),
+                         simd::reduce_min(minY),
+                         simd::reduce_min(minZ));
+      maxPoint = Vector3(simd::reduce_max(maxX),
+                         simd::reduce_max(maxY),
+                         simd::reduce_max(maxZ));
+    }
+
+    for (; i < count; ++i) {
+      minPoint = minPoint.componentMin(get(i));
+      maxPoint = maxPoint.componentMax(get(i));
+    }
+
+    return AABox(minPoint, maxPoint);
+  }
+
+  Vector3
+  Vector3Stream::getSum() const {
+    const SIZE_T count = size();
+    float32x4 sumX = simd::splat<float32x4>(0.0f);
+    float32x4 sumY = sumX;
+    float32x4 sumZ = sumX;
+
+    SIZE_T i = 0;
+    for (; i + 4 <= count; i += 4) {
+      sumX = sumX + float32x4(simd::load_u(&m_x[i]));
+      sumY = sumY + float32x4(simd::load_u(&m_y[i]));
+      sumZ = sumZ + float32x4(simd::load_u(&m_z[i]));
+    }
+
+    Vector3 sum(simd::reduce_add(sumX),
+                simd::reduce_add(sumY),
+                simd::reduce_add(sumZ));
+    for (; i < count; ++i) {
+      sum += get(i);
+    }
+
+    return sum;
+  }
+
+  Vector3
+  Vector3Stream::getCentroid() const {
+    if (empty()) {
+      return Vector3(0.0f, 0.0f, 0.0f);
+    }
+
+    return getSum() / static_cast<float>(size());
+  }
+
+  float
+  Vector3Stream::getMaxDistSquared(const Vector3& point) const {
+    const SIZE_T count = size();
+    float32x4 maxDist = simd::splat<float32x4>(0.0f);
+
+    SIZE_T i = 0;
+    for (; i + 4 <= count; i += 4) {
+      maxDist = simd::max(maxDist, distSquared(simd::load_u(&m_x[i]),
+                                               simd::load_u(&m_y[i]),
+                                               simd::load_u(&m_z[i]),
+                                               point));
+    }
+
+    float result = simd::reduce_max(maxDist);
+    for (; i < count; ++i) {
+      result = Math::max(result, Vector3::distSquared(get(i), point));
+    }
+
+    return result;
+  }
+
+  void
+  Vector3Stream::normalize(float tolerance) {
+    const SIZE_T count = size();
+    const float32x4 tol = simd::splat<float32x4>(tolerance);
+    const float32x4 one = simd::splat<float32x4>(1.0f);
+
+    SIZE_T i = 0;
+    for (; i + 4 <= count; i += 4) {
+      float32x4 x = simd::load_u(&m_x[i]);
+      float32x4 y = simd::load_u(&m_y[i]);
+      float32x4 z = simd::load_u(&m_z[i]);
+
+      float32x4 squareSum = x * x + y * y + z * z;
+      mask_float32x4 valid = simd::cmp_gt(squareSum, tol);
+      float32x4 scale = simd::blend(one / simd::sqrt(squareSum), one, valid);
+
+      simd::store_u(&m_x[i], float32x4(x * scale));
+      simd::store_u(&m_y[i], float32x4(y * scale));
+      simd::store_u(&m_z[i], float32x4(z * scale));
+    }
+
+    for (; i < count; ++i) {
+      Vector3 point = get(i);
+      point.normalize(tolerance);
+      set(i, point);
+    }
+  }
+
+  void
+  Vector3Stream::dot(const Vector3& v, float* output) const {
+    const SIZE_T count = size();
+    const float32x4 vx = simd::splat<float32x4>(v.x);
+    const float32x4 vy = simd::splat<float32x4>(v.y);
+    const float32x4 vz = simd::splat<float32x4>(v.z);
+
+    SIZE_T i = 0;
+    for (; i + 4 <= count; i += 4) {
+      float32x4 x = simd::load_u(&m_x[i]);
+      float32x4 y = simd::load_u(&m_y[i]);
+      float32x4 z = simd::load_u(&m_z[i]);
+      simd::store_u(output + i, float32x4(x * vx + y * vy + z * vz));
+    }
+
+    for (; i < count; ++i) {
+      output[i] = m_x[i] * v.x + m_y[i] * v.y + m_z[i] * v.z;
+    }
+  }
+
+  void
+  Vector3Stream::cross(const Vector3& v, Vector3Stream& output) const {
+    const SIZE_T count = size();
+    output.resize(count);
+
+    const float32x4 vx = simd::splat<float32x4>(v.x);
+    const float32x4 vy = simd::splat<float32x4>(v.y);
+    const float32x4 vz = simd::splat<float32x4>(v.z);
+
+    SIZE_T i = 0;
+    for (; i + 4 <= count; i += 4) {
+      float32x4 x = simd::load_u(&m_x[i]);
+      float32x4 y = simd::load_u(&m_y[i]);
+      float32x4 z = simd::load_u(&m_z[i]);
+
+      simd::store_u(&output.m_x[i], float32x4(y * vz - z * vy));
+      simd::store_u(&output.m_y[i], float32x4(z * vx - x * vz));
+      simd::store_u(&output.m_z[i], float32x4(x * vy - y * vx));
+    }
+
+    for (; i < count; ++i) {
+      output.set(i, get(i) ^ v);
+    }
+  }
+
+  void
+  Vector3Stream::transformPosition(const Matrix4& m, Vector3Stream& output) const {
+    output.resize(size());
+    transformStream(getX(), getY(), getZ(),
+                    output.getX(), output.getY(), output.getZ(),
+                    size(), m, 1.0f);
+  }
+
+  void
+  Vector3Stream::transformVector(const Matrix4& m, Vector3Stream& output) const {
+    output.resize(size());
+    transformStream(getX(), getY(), getZ(),
+                    output.getX(), output.getY(), output.getZ(),
+                    size(), m, 0.0f);
+  }
+
+  AABox
+  Vector3Stream::getBounds(const Vector3* points, SIZE_T count) {
+    if (0 == count) {
+      return AABox(FORCE_INIT::kForceInit);
+    }
+
+    Vector3 minPoint = points[0];
+    Vector3 maxPoint = minPoint;
+
+    SIZE_T i = 0;
+    if (4 <= count) {
+      //Four vectors fill three registers as xyzx, yzxy, zxyz. Min / max are
+      //per component so they can be accumulated in that layout and the four
+      //partial results are unpacked at the end.
+      const float* src = &points[0].x;
+      float32x4 minA = simd::load_u(src), maxA = minA;
+      float32x4 minB = simd::load_u(src + 4), maxB = minB;
+      float32x4 minC = simd::load_u(src + 8), maxC = minC;
+
+      for (i = 4; i + 4 <= count; i += 4) {
+        src = &points[i].x;
+        float32x4 a = simd::load_u(src);
+        float32x4 b = simd::load_u(src + 4);
+        float32x4 c = simd::load_u(src + 8);
+
+        minA = simd::min(minA, a);
+        minB = simd::min(minB, b);
+        minC = simd::min(minC, c);
+        maxA = simd::max(maxA, a);
+        maxB = simd::max(maxB, b);
+        maxC = simd::max(maxC, c);
+      }
+
+      Vector3 partialMin[4], partialMax[4];
+      simd::store_u(&partialMin[0].x, minA);
+      simd::store_u(&partialMin[1].y, minB);
+      simd::store_u(&partialMin[2].z, minC);
+      simd::store_u(&partialMax[0].x, maxA);
+      simd::store_u(&partialMax[1].y, maxB);
+      simd::store_u(&partialMax[2].z, maxC);
+
+      for (uint32 j = 0; j < 4; ++j) {
+        minPoint = minPoint.componentMin(partialMin[j]);
+        maxPoint = maxPoint.componentMax(partialMax[j]);
+      }
+    }
+
+    for (; i < count; ++i) {
+      minPoint = minPoint.componentMin(points[i]);
+      maxPoint = maxPoint.componentMax(points[i]);
+    }
+
+    return AABox(minPoint, maxPoint);
+  }
+
+  float
+  Vector3Stream::getMaxDistSquared(const Vector3* points,
+                                   SIZE_T count,
+                                   const Vector3& point) {
+    float32x4 maxDist = simd::splat<float32x4>(0.0f);
+
+    SIZE_T i = 0;
+    for (; i + 4 <= count; i += 4) {
+      float32x4 x, y, z;
+      loadVectors(points + i, x, y, z);
+      maxDist = simd::max(maxDist, distSquared(x, y, z, point));
+    }
+
+    float result = simd::reduce_max(maxDist);
+    for (; i < count; ++i) {
+      result = Math::max(result, Vector3::distSquared(points[i], point));
+    }
+
+    return result;
+  }
+}
@@ -0,0 +1,235 @@
+#include <vld.h>
+
+#define GTEST_HAS_TR1_TUPLE 0
+#define GTEST_USE_OWN_TR1_TUPLE 0
+#include <gtest/gtest.h>
+
+#include <gePrerequisitesUtil.h>
+#include <geAsyncLog.h>
+#include <geDebug.h>
+#include <geFlightRecorder.h>
+#include <geTimer.h>
+
+using namespace geEngineSDK;
+
+namespace {
+  /**
+   * @brief Starts the asynchronous log the first time a test needs it.
+   *        Modules can't be restarted, so it keeps running until all tests
+   *        are done. The buffers are kept small so they fill up easily.
+   */
+  void
+  startAsyncLog() {
+    if (!AsyncLog::isStarted()) {
+      AsyncLogDesc desc;
+      desc.bufferSize = 16 * 1024;
+      desc.overflow = ASYNC_LOG_OVERFLOW::kDrop;
+      desc.flushIntervalMs = 1;
+      desc.writeToConsole = false;
+      AsyncLog::startUp(desc);
+    }
+  }
+
+  class AsyncLogEnvironment : public ::testing::Environment
+  {
+   public:
+    void
+    TearDown() override {
+      if (AsyncLog::isStarted()) {
+        AsyncLog::shutDown();
+      }
+    }
+  };
+
+  ::testing::Environment* const asyncLogEnvironment =
+    ::testing::AddGlobalTestEnvironment(new AsyncLogEnvironment());
+
+  /**
+   * @brief Removes and returns the entries added to the Debug log since the
+   *        last call.
+   */
+  Vector<LogEntry>
+  takeLogEntries() {
+    Vector<LogEntry> entries;
+    LogEntry entry;
+    while (g_Debug().getLog().getUnreadEntry(entry)) {
+      entries.push_back(entry);
+    }
+    g_Debug().getLog().clear();
+    return entries;
+  }
+
+  /**
+   * @brief Stream buffer discarding everything, to time console logging
+   *        without flooding the test output.
+   */
+  class NullBuffer : public std::streambuf
+  {
+   protected:
+    int
+    overflow(int c) override {
+      return c;
+    }
+
+    std::streamsize
+    xsputn(const char*, std::streamsize count) override {
+      return count;
+    }
+  };
+}
+
+TEST(geAsyncLog, Benchmark_Log) {
+  const uint32 numMessages = 20480;
+
+  NullBuffer nullBuffer;
+  std::streambuf* coutBuffer = std::cout.rdbuf(&nullBuffer);
+
+  //Same work as Debug does without the asynchronous log, on a log of its
+  //own, so it's timed whether or not another test started the asynchronous log
+  Log syncLog;
+  Timer timer;
+  for (uint32 i = 0; i < numMessages; ++i) {
+    String message = "Benchmark message " + toString(i);
+    FlightRecorder::recordLog(message, DEBUG_CHANNEL::kDebug, nullptr);
+
+    LogEntry entry(message,
+                   DEBUG_CHANNEL::kDebug,
+                   Log::getCurrentTime(),
+                   Log::getCurrentThreadId());
+    std::cout << entry.getFormattedMessage() << std::endl;
+    syncLog.addEntry(std::move(entry));
+  }
+  uint64 syncTime = timer.getMicroseconds();
+
+  startAsyncLog();
+  takeLogEntries();
+  AsyncLogStats startStats = AsyncLog::instance().getStats();
+
+  //Only the logging threads are timed, flushing between chunks keeps the
+  //buffer from filling up
+  const uint32 chunkSize = 64;
+  uint64 asyncTime = 0;
+  for (uint32 i = 0; i < numMessages; i += chunkSize) {
+    timer.reset();
+    for (uint32 j = i; j < i + chunkSize; ++j) {
+      LOGDBG("Benchmark message " + toString(j));
+    }
+    asyncTime += timer.getMicroseconds();
+    AsyncLog::instance().flush();
+  }
+
+  uint64 deferredTime = 0;
+  for (uint32 i = 0; i < numMessages; i += chunkSize) {
+    timer.reset();
+    for (uint32 j = i; j < i + chunkSize; ++j) {
+      GE_LOG_ASYNC(DEBUG_CHANNEL::kDebug, "Benchmark message {0} [{1}:{2}]", j, __FILE__, __LINE__);
+    }
+    deferredTime += timer.getMicroseconds();
+    AsyncLog::instance().flush();
+  }
+
+  AsyncLog::instance().flush();
+  std::cout.rdbuf(coutBuffer);
+
+  AsyncLogStats stats = AsyncLog::instance().getStats();
+  std::cout << numMessages << " messages, synchronous log: " << syncTime << "us, "
+            << "asynchronous LOGDBG: " << asyncTime << "us, "
+            << "GE_LOG_ASYNC: " << deferredTime << "us ("
+            << stats.numBatches - startStats.numBatches << " batches)" << std::endl;
+
+  EXPECT_EQ(numMessages * 2, stats.numWritten - startStats.numWritten);
+  EXPECT_EQ(numMessages * 2, takeLogEntries().size());
+}
+
+TEST(geAsyncLog, Log_Records) {
+  startAsyncLog();
+  takeLogEntries();
+  AsyncLogStats startStats = AsyncLog::instance().getStats();
+
+  const uint32 numThreads = 4;
+  const uint32 numRecords = 500;
+
+  Vector<Thread> threads;
+  for (uint32 t = 0; t < numThreads; ++t) {
+    threads.emplace_back([t, numRecords]() {
+      for (uint32 i = 0; i < numRecords; ++i) {
+        GE_LOG_ASYNC(DEBUG_CHANNEL::kWarning,
+                     "Thread {0} record {1} value {2} \\{3} {3}",
+                     t, i, 0.5f, i % 2 == 0);
+
+        //Never let the buffer fill up, so nothing is dropped
+        if (0 == (i % 16)) {
+          AsyncLog::instance().flush();
+        }
+      }
+    });
+  }
+
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  //Already formatted messages go through the same buffers
+  LOGERR("Logged through Debug");
+
+  AsyncLog::instance().flush();
+
+  Vector<LogEntry> entries = takeLogEntries();
+  ASSERT_EQ(numThreads * numRecords + 1, entries.size());
+
+  //Records of each thread come out in order, but not between threads
+  auto debugEntry = std::find_if(entries.begin(), entries.end(), [](const LogEntry& entry) {
+    return static_cast<uint32>(DEBUG_CHANNEL::kError) == entry.getLogChannel();
+  });
+  ASSERT_NE(entries.end(), debugEntry);
+  EXPECT_EQ(0U, debugEntry->getLogMessage().find("Logged through Debug"));
+  entries.erase(debugEntry);
+
+  Vector<uint32> nextRecord(numThreads, 0);
+  for (auto& entry : entries) {
+    EXPECT_EQ(static_cast<uint32>(DEBUG_CHANNEL::kWarning), entry.getLogChannel());
+
+    uint32 t = static_cast<uint32>(entry.getLogMessage()[7] - '0');
+    ASSERT_LT(t, numThreads);
+
+    uint32 record = nextRecord[t]++;
+    String expected = "Thread " + toString(t) + " record " + toString(record) +
+                      " value " + toString(0.5) + " {3} " + toString(record % 2 == 0);
+    EXPECT_EQ(expected, entry.getLogMessage());
+  }
+
+  AsyncLogStats stats = AsyncLog::instance().getStats();
+  EXPECT_EQ(numThreads * numRecords + 1, stats.numWritten - startStats.numWritten);
+  EXPECT_EQ(startStats.numDropped, stats.numDropped);
+  EXPECT_GE(stats.numThreadBuffers, 1U);
+}
+
+TEST(geAsyncLog, Drop_When_Full) {
+  startAsyncLog();
+  takeLogEntries();
+  AsyncLogStats startStats = AsyncLog::instance().getStats();
+
+  //Much more than a 16KB buffer holds, without waiting for the writer
+  const uint32 numRecords = 20000;
+  uint32 numAccepted = 0;
+  for (uint32 i = 0; i < numRecords; ++i) {
+    numAccepted += AsyncLog::instance().logMessage("Record " + toString(i),
+                                                   DEBUG_CHANNEL::kDebug) ? 1 : 0;
+  }
+  AsyncLog::instance().flush();
+
+  AsyncLogStats stats = AsyncLog::instance().getStats();
+  EXPECT_EQ(numAccepted, stats.numWritten - startStats.numWritten);
+  EXPECT_EQ(numRecords - numAccepted, stats.numDropped - startStats.numDropped);
+  EXPECT_EQ(numAccepted, takeLogEntries().size());
+
+  //Strings larger than a quarter of the buffer are truncated
+  String longMessage(16 * 1024, 'x');
+  EXPECT_TRUE(AsyncLog::instance().logMessage(longMessage, DEBUG_CHANNEL::kDebug));
+  AsyncLog::instance().flush();
+
+  Vector<LogEntry> entries = takeLogEntries();
+  ASSERT_EQ(1U, entries.size());
+  EXPECT_LT(entries[0].getLogMessage().size(), 4096U);
+  EXPECT_EQ(String(entries[0].getLogMessage().size(), 'x'), entries[0].getLogMessage());
+}
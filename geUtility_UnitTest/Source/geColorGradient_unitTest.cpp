@@ -0,0 +1,155 @@
+#include <vld.h>
+#include <DirectXMath.h>
+
+#define GTEST_HAS_TR1_TUPLE 0
+#define GTEST_USE_OWN_TR1_TUPLE 0
+#include <gtest/gtest.h>
+
+#include <gePrerequisitesUtil.h>
+#include <geColorGradient.h>
+#include <geTimer.h>
+
+using namespace geEngineSDK;
+
+namespace {
+  ColorGradient
+  makeGradient() {
+    Vector<ColorGradientKey> keys = {
+      { LinearColor(1.0f, 0.0f, 0.0f, 1.0f), 0.0f },
+      { LinearColor(1.0f, 1.0f, 0.0f, 1.0f), 0.5f },
+      { LinearColor(0.0f, 1.0f, 0.0f, 0.5f), 1.0f },
+      { LinearColor(0.0f, 1.0f, 1.0f, 0.5f), 1.0f },  //Zero length segment
+      { LinearColor(0.0f, 0.0f, 1.0f, 0.0f), 1.5f },
+      { LinearColor(4.0f, 2.0f, 1.0f, 0.0f), 2.0f }
+    };
+
+    ColorGradient gradient;
+    gradient.setKeys(keys, 2.0f);
+    return gradient;
+  }
+
+  void
+  expectColorNear(const LinearColor& a, const LinearColor& b, float tolerance) {
+    EXPECT_NEAR(a.r, b.r, tolerance);
+    EXPECT_NEAR(a.g, b.g, tolerance);
+    EXPECT_NEAR(a.b, b.b, tolerance);
+    EXPECT_NEAR(a.a, b.a, tolerance);
+  }
+
+  Vector<float>
+  makeTimes(SIZE_T count) {
+    Vector<float> times(count);
+    for (auto& time : times) {
+      //Also covers times outside of the gradient range
+      time = (rand() / static_cast<float>(RAND_MAX)) * 1.2f - 0.1f;
+    }
+    return times;
+  }
+}
+
+TEST(geColorGradient, Batch_Evaluate) {
+  ColorGradient gradient = makeGradient();
+  Vector<float> times = makeTimes(1027);
+  times[0] = 0.5f;
+  times[1] = 0.25f;
+  times[2] = 0.75f;
+
+  Vector<LinearColor> colors(times.size());
+  gradient.evaluate(times.data(), colors.data(), times.size());
+  for (SIZE_T i = 0; i < times.size(); ++i) {
+    expectColorNear(colors[i], gradient.evaluate(times[i]), 1.e-5f);
+  }
+
+  ColorGradient constant;
+  constant.setConstant(LinearColor(0.1f, 0.2f, 0.3f, 0.4f));
+  constant.evaluate(times.data(), colors.data(), 5);
+  for (SIZE_T i = 0; i < 5; ++i) {
+    EXPECT_TRUE(colors[i] == LinearColor(0.1f, 0.2f, 0.3f, 0.4f));
+  }
+}
+
+TEST(geColorGradient, Cursor_Evaluate) {
+  ColorGradient gradient = makeGradient();
+
+  uint32 cursor = 0;
+  for (uint32 i = 0; i <= 200; ++i) {
+    const float time = i / 200.0f;
+    expectColorNear(gradient.evaluate(time, cursor), gradient.evaluate(time), 1.e-5f);
+  }
+
+  //Going back in time is still correct
+  expectColorNear(gradient.evaluate(0.1f, cursor), gradient.evaluate(0.1f), 1.e-5f);
+  expectColorNear(gradient.evaluate(0.9f, cursor), gradient.evaluate(0.9f), 1.e-5f);
+  expectColorNear(gradient.evaluate(0.6f, cursor), gradient.evaluate(0.6f), 1.e-5f);
+}
+
+TEST(geColorGradient, Baked_Evaluate) {
+  ColorGradient gradient = makeGradient();
+  Vector<float> times = makeTimes(1027);
+
+  //Without a table evaluateBaked falls back to the exact path
+  EXPECT_TRUE(gradient.evaluateBaked(0.3f) == gradient.evaluate(0.3f));
+
+  gradient.bake(256);
+  Vector<LinearColor> colors(times.size());
+  gradient.evaluateBaked(times.data(), colors.data(), times.size());
+  for (SIZE_T i = 0; i < times.size(); ++i) {
+    //The table can't represent the hard edge of the zero length segment
+    if (Math::abs(times[i] - 0.5f) > 1.0f / 256.0f) {
+      expectColorNear(colors[i], gradient.evaluate(times[i]), 1.e-4f);
+    }
+    expectColorNear(colors[i], gradient.evaluateBaked(times[i]), 1.e-5f);
+  }
+
+  //Changing the keys rebuilds the table
+  gradient.setConstant(LinearColor(0.1f, 0.2f, 0.3f, 0.4f));
+  EXPECT_TRUE(gradient.evaluateBaked(0.3f) == LinearColor(0.1f, 0.2f, 0.3f, 0.4f));
+}
+
+TEST(geColorGradient, Benchmark_Evaluate) {
+  const SIZE_T count = 1024 * 1024;
+  ColorGradient gradient = makeGradient();
+  Vector<float> times = makeTimes(count);
+  Vector<LinearColor> colors(count);
+
+  Timer timer;
+  for (SIZE_T i = 0; i < count; ++i) {
+    colors[i] = gradient.evaluate(times[i]);
+  }
+  uint64 scalarTime = timer.getMicroseconds();
+
+  timer.reset();
+  gradient.evaluate(times.data(), colors.data(), count);
+  uint64 batchTime = timer.getMicroseconds();
+
+  gradient.bake(1024);
+  timer.reset();
+  gradient.evaluateBaked(times.data(), colors.data(), count);
+  uint64 bakedTime = timer.getMicroseconds();
+
+  //Monotonic times, as when following a particle through its lifetime
+  for (SIZE_T i = 0; i < count; ++i) {
+    times[i] = i / static_cast<float>(count);
+  }
+
+  timer.reset();
+  for (SIZE_T i = 0; i < count; ++i) {
+    colors[i] = gradient.evaluate(times[i]);
+  }
+  uint64 scalarMonotonicTime = timer.getMicroseconds();
+
+  uint32 cursor = 0;
+  timer.reset();
+  for (SIZE_T i = 0; i < count; ++i) {
+    colors[i] = gradient.evaluate(times[i], cursor);
+  }
+  uint64 cursorTime = timer.getMicroseconds();
+
+  std::cout << "ColorGradient::evaluate loop: " << scalarTime << "us, "
+            << "batch: " << batchTime << "us, "
+            << "baked batch: " << bakedTime << "us; "
+            << "monotonic loop: " << scalarMonotonicTime << "us, "
+            << "cursor: " << cursorTime << "us" << std::endl;
+
+  EXPECT_FALSE(Math::isNaN(colors[count / 2].r));
+}
@@ -0,0 +1,336 @@
+#include <vld.h>
+
+#define GTEST_HAS_TR1_TUPLE 0
+#define GTEST_USE_OWN_TR1_TUPLE 0
+#include <gtest/gtest.h>
+
+#include <gePrerequisitesUtil.h>
+#include <geEvent.h>
+#include <geTimer.h>
+
+using namespace geEngineSDK;
+
+namespace {
+  /**
+   * @brief Event that locks a mutex on every trigger, as events used to, to
+   *        compare against in the benchmark.
+   */
+  class LockedEvent
+  {
+   public:
+    void
+    connect(function<void(uint64&)> func) {
+      RecursiveLock lock(m_mutex);
+      m_funcs.push_back(std::move(func));
+    }
+
+    void
+    operator()(uint64& value) {
+      RecursiveLock lock(m_mutex);
+      for (auto& func : m_funcs) {
+        func(value);
+      }
+    }
+
+   private:
+    Vector<function<void(uint64&)>> m_funcs;
+    RecursiveMutex m_mutex;
+  };
+
+  /**
+   * @brief Triggers @p event @p numTriggers times from each of @p numThreads
+   *        threads at once and returns the time per trigger of all threads
+   *        together, in nanoseconds.
+   */
+  template<class EventType>
+  double
+  timeTriggers(EventType& event, uint32 numThreads, uint32 numTriggers) {
+    std::atomic<uint32> numReady{0};
+    std::atomic<bool> start{false};
+
+    Vector<Thread> threads;
+    for (uint32 t = 0; t < numThreads; ++t) {
+      threads.emplace_back([&]() {
+        //Start all threads together so they contend
+        ++numReady;
+        while (!start.load()) {
+          std::this_thread::yield();
+        }
+
+        uint64 value = 0;
+        for (uint32 i = 0; i < numTriggers; ++i) {
+          event(value);
+        }
+        EXPECT_GT(value, 0U);
+      });
+    }
+
+    while (numReady.load() < numThreads) {
+      std::this_thread::yield();
+    }
+
+    Timer timer;
+    start = true;
+    for (auto& thread : threads) {
+      thread.join();
+    }
+
+    return timer.getMicroseconds() * 1000.0 / (static_cast<double>(numTriggers) * numThreads);
+  }
+}
+
+TEST(geEvent, Connect_Trigger) {
+  Event<void(int32&)> event;
+  EXPECT_TRUE(event.empty());
+
+  int32 value = 0;
+  event(value);
+  EXPECT_EQ(0, value);
+
+  HEvent first = event.connect([](int32& v) { v += 1; });
+  HEvent second = event.connect([](int32& v) { v += 10; });
+  HEvent third = event.connect([](int32& v) { v += 100; });
+  EXPECT_FALSE(event.empty());
+  EXPECT_TRUE(first);
+
+  event(value);
+  EXPECT_EQ(111, value);
+
+  second.disconnect();
+  EXPECT_FALSE(second);
+  value = 0;
+  event(value);
+  EXPECT_EQ(101, value);
+
+  event.clear();
+  EXPECT_TRUE(event.empty());
+  value = 0;
+  event(value);
+  EXPECT_EQ(0, value);
+
+  //Disconnecting after a clear is harmless
+  first.disconnect();
+}
+
+TEST(geEvent, Change_During_Trigger) {
+  Event<void()> event;
+  Vector<String> calls;
+
+  HEvent late;
+  HEvent self;
+  HEvent victim;
+
+  HEvent adder = event.connect([&]() {
+    calls.push_back("adder");
+    if (!late) {
+      late = event.connect([&]() { calls.push_back("late"); });
+    }
+  });
+
+  self = event.connect([&]() {
+    calls.push_back("self");
+    self.disconnect();
+    victim.disconnect();
+  });
+
+  victim = event.connect([&]() { calls.push_back("victim"); });
+
+  //Connections made during the trigger wait for the next one, disconnected
+  //ones are skipped right away
+  event();
+  ASSERT_EQ(2U, calls.size());
+  EXPECT_EQ("adder", calls[0]);
+  EXPECT_EQ("self", calls[1]);
+
+  calls.clear();
+  event();
+  ASSERT_EQ(2U, calls.size());
+  EXPECT_EQ("adder", calls[0]);
+  EXPECT_EQ("late", calls[1]);
+}
+
+TEST(geEvent, Handles) {
+  uint32 numCalls = 0;
+  HEvent survivor;
+
+  {
+    Event<void()> event;
+    HEvent handle = event.connect([&]() { ++numCalls; });
+
+    //Dropping handles keeps the connection
+    {
+      HEvent copy = handle;
+      HEvent assigned;
+      assigned = copy;
+      assigned = handle;
+      EXPECT_TRUE(assigned);
+    }
+    event();
+    EXPECT_EQ(1U, numCalls);
+
+    //Any copy disconnects
+    HEvent copy = handle;
+    copy.disconnect();
+    event();
+    EXPECT_EQ(1U, numCalls);
+
+    survivor = event.connect([&]() { ++numCalls; });
+    event();
+    EXPECT_EQ(2U, numCalls);
+  }
+
+  //The event is gone, its handles are still safe to use
+  EXPECT_TRUE(survivor);
+  survivor.disconnect();
+
+  //An event destroyed by its own callback ends the trigger safely, the
+  //callbacks after it are disconnected
+  auto event = ge_new<Event<void()>>();
+  event->connect([&]() {
+    ge_delete(event);
+    ++numCalls;
+  });
+  event->connect([&]() { ++numCalls; });
+  (*event)();
+  EXPECT_EQ(3U, numCalls);
+}
+
+TEST(geEvent, Pooled_Connections) {
+  Event<void(uint64&)> event;
+  HEvent persistent = event.connect([](uint64& v) { ++v; });
+
+  //Fill the pools once
+  for (uint32 i = 0; i < 4; ++i) {
+    HEvent handle = event.connect([](uint64& v) { v += 2; });
+    handle.disconnect();
+  }
+
+  uint64 startAllocs = MemoryCounter::getNumAllocs();
+
+  uint64 value = 0;
+  for (uint32 i = 0; i < 1000; ++i) {
+    HEvent handle = event.connect([](uint64& v) { v += 2; });
+    event(value);
+    handle.disconnect();
+  }
+
+  EXPECT_EQ(3000U, value);
+  EXPECT_EQ(startAllocs, MemoryCounter::getNumAllocs());
+}
+
+TEST(geEvent, Concurrent_Trigger) {
+  Event<void(uint64&)> event;
+
+  std::atomic<uint64> numCalls{0};
+  HEvent persistent = event.connect([&numCalls](uint64&) { ++numCalls; });
+
+  const uint32 numThreads = 4;
+  const uint32 numTriggers = 20000;
+
+  std::atomic<uint32> numDone{0};
+
+  Vector<Thread> threads;
+  for (uint32 t = 0; t < numThreads; ++t) {
+    threads.emplace_back([&]() {
+      uint64 value = 0;
+      for (uint32 i = 0; i < numTriggers; ++i) {
+        event(value);
+      }
+      ++numDone;
+    });
+  }
+
+  //Connections come and go while the other threads trigger
+  uint32 numChanges = 0;
+  while (numDone.load() < numThreads) {
+    auto counter = ge_shared_ptr_new<uint64>(0);
+    HEvent handle = event.connect([counter](uint64& v) { v += *counter; });
+    handle.disconnect();
+    ++numChanges;
+  }
+
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  EXPECT_EQ(static_cast<uint64>(numThreads) * numTriggers, numCalls.load());
+  EXPECT_GT(numChanges, 0U);
+}
+
+TEST(geEvent, Bounded_Retired) {
+  Event<void(uint64&)> event;
+  HEvent persistent = event.connect([](uint64& v) { ++v; });
+
+  //Some trigger is always in progress, what is retired must still be
+  //reclaimed once the triggers that started before it are done
+  std::atomic<bool> triggering{true};
+  Vector<Thread> threads;
+  for (uint32 t = 0; t < 4; ++t) {
+    threads.emplace_back([&]() {
+      uint64 value = 0;
+      while (triggering.load()) {
+        event(value);
+      }
+      EXPECT_GT(value, 0U);
+    });
+  }
+
+  for (uint32 round = 0; round < 20; ++round) {
+    for (uint32 i = 0; i < 1000; ++i) {
+      HEvent handle = event.connect([](uint64& v) { v += 2; });
+      handle.disconnect();
+    }
+
+    //The triggers alone make the round reusable, nothing piles up across
+    //rounds
+    Timer timer;
+    while (0 != event.getNumRetired() && timer.getMilliseconds() < 1000) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    EXPECT_EQ(0U, event.getNumRetired());
+  }
+
+  triggering = false;
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
+TEST(geEvent, Benchmark_Trigger) {
+  const uint32 numCalls = 2000000;
+  const uint32 numThreads = 4;
+
+  for (uint32 numListeners : { 1U, 10U, 1000U }) {
+    const uint32 numTriggers = numCalls / numListeners;
+
+    Event<void(uint64&)> event;
+    LockedEvent lockedEvent;
+    Vector<HEvent> handles;
+    for (uint32 i = 0; i < numListeners; ++i) {
+      handles.push_back(event.connect([](uint64& v) { ++v; }));
+      lockedEvent.connect([](uint64& v) { ++v; });
+    }
+
+    double singleTime = timeTriggers(event, 1, numTriggers);
+    double singleLockedTime = timeTriggers(lockedEvent, 1, numTriggers);
+    double contendedTime = timeTriggers(event, numThreads, numTriggers);
+    double lockedTime = timeTriggers(lockedEvent, numThreads, numTriggers);
+
+    //And with a thread connecting and disconnecting meanwhile
+    std::atomic<bool> churning{true};
+    Thread churn([&]() {
+      while (churning.load()) {
+        HEvent handle = event.connect([](uint64& v) { v += 2; });
+        handle.disconnect();
+      }
+    });
+    double churnTime = timeTriggers(event, numThreads, numTriggers);
+    churning = false;
+    churn.join();
+
+    std::cout << numListeners << " listeners, ns per trigger: "
+              << "1 thread: " << singleTime << " (mutex: " << singleLockedTime << "), "
+              << numThreads << " threads: " << contendedTime << " (mutex: " << lockedTime << "), "
+              << numThreads << " threads while connecting: " << churnTime << std::endl;
+  }
+}
@@ -0,0 +1,275 @@
+#include <vld.h>
+
+#define GTEST_HAS_TR1_TUPLE 0
+#define GTEST_USE_OWN_TR1_TUPLE 0
+#include <gtest/gtest.h>
+
+#include <gePrerequisitesUtil.h>
+#include <geDebug.h>
+#include <geFlightRecorder.h>
+#include <geLog.h>
+#include <geProfilerCPU.h>
+#include <geTimer.h>
+
+using namespace geEngineSDK;
+
+namespace {
+  /**
+   * @brief Returns the records of the thread with the given ID. Exited
+   *        threads may have had the same ID, the latest records are used.
+   */
+  FlightRecorderThread
+  getThreadRecords(uint64 threadId) {
+    FlightRecorderThread output;
+    for (auto& thread : FlightRecorder::getRecords()) {
+      if (thread.threadId == threadId && !thread.records.empty() &&
+          (output.records.empty() ||
+           output.records.back().time < thread.records.back().time)) {
+        output = thread;
+      }
+    }
+
+    return output;
+  }
+
+  String
+  getText(const FlightRecord& record) {
+    return String(record.text, record.textSize);
+  }
+
+  /**
+   * @brief Keeps the profiler from measuring zones while it exists, in case
+   *        other tests left it running.
+   */
+  class ProfilerPause
+  {
+   public:
+    ProfilerPause() : m_started(ProfilerCPU::isStarted()) {
+      if (m_started) {
+        ProfilerCPU::instance().setEnabled(false);
+      }
+    }
+
+    ~ProfilerPause() {
+      if (m_started) {
+        ProfilerCPU::instance().setEnabled(true);
+      }
+    }
+
+   private:
+    bool m_started;
+  };
+}
+
+TEST(geFlightRecorder, Records) {
+  uint64 threadId = 0;
+  static const ProfilerZone zone = { "FlightZone", __FILE__, __LINE__ };
+
+  //Before the other thread exits, or this one would take its buffer
+  FlightRecorder::addMarker("reading");
+
+  ProfilerPause profilerPause;
+
+  Thread thread([&]() {
+    threadId = Log::getCurrentThreadId();
+    FlightRecorder::addMarker("first", 1);
+    {
+      ProfilerScope scope(&zone);
+      g_Debug().logMessage("logged", 70);
+    }
+    FlightRecorder::addMarker("a marker text much longer than what a single record of "
+                              "the flight recorder can keep, which gets cut", 2);
+  });
+  thread.join();
+
+  FlightRecorderThread records = getThreadRecords(threadId);
+  ASSERT_EQ(5U, records.records.size());
+
+  auto& first = records.records[0];
+  EXPECT_EQ(FLIGHT_RECORD::kMarker, first.type);
+  EXPECT_EQ(1U, first.value);
+  EXPECT_EQ("first", getText(first));
+
+  //The profiler isn't running, so zones take the time of the previous record
+  EXPECT_EQ(FLIGHT_RECORD::kZoneBegin, records.records[1].type);
+  EXPECT_EQ(&zone, records.records[1].source);
+  EXPECT_EQ(first.time, records.records[1].time);
+
+  auto& log = records.records[2];
+  EXPECT_EQ(FLIGHT_RECORD::kLog, log.type);
+  EXPECT_EQ(70U, log.value);
+  EXPECT_EQ("logged", getText(log));
+
+  EXPECT_EQ(FLIGHT_RECORD::kZoneEnd, records.records[3].type);
+  EXPECT_EQ(log.time, records.records[3].time);
+
+  auto& last = records.records[4];
+  EXPECT_EQ(FlightRecord::MAX_TEXT_SIZE, last.textSize);
+  EXPECT_EQ(0U, getText(last).find("a marker text much longer"));
+
+  for (SIZE_T i = 1; i < records.records.size(); ++i) {
+    EXPECT_LE(records.records[i - 1].time, records.records[i].time);
+  }
+
+  String text = FlightRecorder::getText();
+  EXPECT_NE(String::npos, text.find("FlightZone"));
+  EXPECT_NE(String::npos, text.find("Marker  (1) first"));
+  EXPECT_NE(String::npos, text.find("[70] logged"));
+  EXPECT_NE(String::npos, text.find(", current thread"));
+
+  //A new thread takes the buffer of an exited one, without its records
+  Thread nextThread([&]() {
+    FlightRecorder::addMarker("second");
+  });
+  nextThread.join();
+
+  uint32 numFound = 0;
+  for (auto& thread : FlightRecorder::getRecords()) {
+    if (!thread.records.empty() && "second" == getText(thread.records.back())) {
+      EXPECT_EQ(1U, thread.records.size());
+      ++numFound;
+    }
+  }
+  EXPECT_EQ(1U, numFound);
+}
+
+TEST(geFlightRecorder, Wrap_Disable) {
+  const uint32 numRecords = FlightRecorder::RECORDS_PER_THREAD * 3 + 10;
+  uint64 threadId = 0;
+
+  Thread thread([&]() {
+    threadId = Log::getCurrentThreadId();
+    for (uint32 i = 0; i < numRecords; ++i) {
+      FlightRecorder::addMarker("wrap", i);
+    }
+
+    FlightRecorder::setEnabled(false);
+    EXPECT_FALSE(FlightRecorder::isEnabled());
+    FlightRecorder::addMarker("disabled");
+    FlightRecorder::setEnabled(true);
+  });
+  thread.join();
+
+  //Only the newest records are kept, oldest first
+  FlightRecorderThread records = getThreadRecords(threadId);
+  ASSERT_EQ(FlightRecorder::RECORDS_PER_THREAD, records.records.size());
+  for (uint32 i = 0; i < FlightRecorder::RECORDS_PER_THREAD; ++i) {
+    EXPECT_EQ(numRecords - FlightRecorder::RECORDS_PER_THREAD + i, records.records[i].value);
+  }
+}
+
+TEST(geFlightRecorder, Concurrent_Read) {
+  std::atomic<bool> writing{true};
+  std::atomic<bool> started{false};
+
+  //Tagged with a source of their own, as exited threads may have had the
+  //same ID and a busy buffer may be read with all its records overwritten
+  Thread thread([&]() {
+    char text[32];
+    for (uint64 i = 0; 0 == i || writing.load(); ++i) {
+      int32 size = snprintf(text, sizeof(text), "%llu", static_cast<unsigned long long>(i));
+      FlightRecorder::record(FLIGHT_RECORD::kMarker, &writing, i, text, size);
+      started = true;
+    }
+  });
+
+  while (!started.load()) {
+    std::this_thread::yield();
+  }
+
+  //Records overwritten while they are copied are skipped, the rest are whole
+  uint32 numRead = 0;
+  for (uint32 i = 0; i < 200; ++i) {
+    for (auto& records : FlightRecorder::getRecords()) {
+      if (records.records.empty() || &writing != records.records.back().source) {
+        continue;
+      }
+
+      for (SIZE_T j = 0; j < records.records.size(); ++j) {
+        auto& record = records.records[j];
+        ASSERT_EQ(&writing, record.source);
+        ASSERT_EQ(toString(record.value), getText(record));
+        if (j > 0) {
+          ASSERT_LT(records.records[j - 1].value, record.value);
+        }
+      }
+      numRead += static_cast<uint32>(records.records.size());
+    }
+  }
+
+  writing = false;
+  thread.join();
+  EXPECT_GT(numRead, 0U);
+}
+
+TEST(geFlightRecorder, Benchmark_Record) {
+  CycleTimer::calibrate();
+  ProfilerPause profilerPause;
+  const uint32 numRecords = 1000000;
+  static const ProfilerZone zone = { "Benchmark", __FILE__, __LINE__ };
+
+  //Reading the counter costs what the processor (or hypervisor) makes it
+  //cost, writing a record must stay within a few nanoseconds on top
+  const double writeBudget = 15.0;
+
+  auto runRound = [&](auto func) {
+    CycleTimer timer;
+    for (uint32 i = 0; i < numRecords; ++i) {
+      func(i);
+    }
+    return timer.getNanoseconds() / static_cast<double>(numRecords);
+  };
+
+  //Best of a few rounds, so other processes don't make the test fail
+  auto measure = [&](auto func) {
+    double best = std::numeric_limits<double>::max();
+    for (uint32 round = 0; round < 5; ++round) {
+      best = std::min(best, runRound(func));
+    }
+    return best;
+  };
+
+  //The cost of the counter drifts, each round measures the counter reads
+  //right before the markers so both see the same cost
+  uint64 sum = 0;
+  double counterTime = 0.0;
+  double markerTime = std::numeric_limits<double>::max();
+  for (uint32 round = 0; round < 5; ++round) {
+    const double roundCounterTime = runRound([&](uint32) {
+      sum += CycleTimer::now();
+    });
+    const double roundMarkerTime = runRound([](uint32 i) {
+      FlightRecorder::addMarker("benchmark", i);
+    });
+
+    if (roundMarkerTime - roundCounterTime < markerTime - counterTime) {
+      counterTime = roundCounterTime;
+      markerTime = roundMarkerTime;
+    }
+  }
+  EXPECT_GT(sum, 0U);
+  EXPECT_LT(markerTime - counterTime, writeBudget);
+
+  //Two untimed records per zone, with the profiler not running
+  const double zoneTime = measure([](uint32) {
+    ProfilerScope scope(&zone);
+  });
+  EXPECT_LT(zoneTime, writeBudget * 2);
+
+  FlightRecorder::setEnabled(false);
+  const double disabledZoneTime = measure([](uint32) {
+    ProfilerScope scope(&zone);
+  });
+  FlightRecorder::setEnabled(true);
+
+  CycleTimer timer;
+  String text = FlightRecorder::getText();
+  const uint64 textTime = timer.getMicroseconds();
+
+  std::cout << "ns per counter read: " << counterTime
+            << ", per marker: " << markerTime
+            << " (write: " << markerTime - counterTime << ")"
+            << ", per zone: " << zoneTime << " (disabled: " << disabledZoneTime << ")"
+            << ", text of all threads: " << textTime << "us, "
+            << text.size() << " bytes" << std::endl;
+}
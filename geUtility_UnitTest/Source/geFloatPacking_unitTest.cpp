@@ -0,0 +1,166 @@
+#include <vld.h>
+#include <DirectXMath.h>
+
+#define GTEST_HAS_TR1_TUPLE 0
+#define GTEST_USE_OWN_TR1_TUPLE 0
+#include <gtest/gtest.h>
+
+#include <gePrerequisitesUtil.h>
+#include <geFloatPacking.h>
+#include <geFloat10.h>
+#include <geFloat11.h>
+#include <geColor.h>
+#include <geVector3.h>
+#include <geNumericLimits.h>
+#include <geTimer.h>
+
+using namespace geEngineSDK;
+
+namespace {
+  /**
+   * Random floats over a wide exponent range, plus the values that take
+   * special paths in the scalar conversions.
+   */
+  Vector<float>
+  makeTestValues(uint32 count) {
+    Vector<float> values;
+    values.reserve(count);
+
+    const float specials[] = { 0.0f, -0.0f, 1.0f, -1.0f, 65504.0f, 70000.0f,
+                               -70000.0f, 6.1e-5f, 3.0e-5f, 1.0e-7f, -1.0e-7f,
+                               65024.0f, 64512.0f, 1.0e30f, -1.0e30f,
+                               std::numeric_limits<float>::infinity(),
+                               -std::numeric_limits<float>::infinity(),
+                               std::numeric_limits<float>::quiet_NaN() };
+    for (auto value : specials) {
+      values.push_back(value);
+    }
+
+    while (values.size() < count) {
+      float mantissa = (rand() / static_cast<float>(RAND_MAX)) * 2.0f - 1.0f;
+      int32 exponent = (rand() % 48) - 24;
+      values.push_back(std::ldexp(mantissa, exponent));
+    }
+
+    return values;
+  }
+}
+
+TEST(geFloatPacking, Half_Matches_Scalar) {
+  Vector<float> values = makeTestValues(4099);
+  const SIZE_T count = values.size();
+
+  Vector<Float16> halves(count);
+  FloatPacking::floatToHalf(values.data(), halves.data(), count);
+  for (SIZE_T i = 0; i < count; ++i) {
+    EXPECT_EQ(halves[i].encoded, Float16(values[i]).encoded);
+  }
+
+  //Every possible half value
+  Vector<Float16> allHalves(65536);
+  for (uint32 i = 0; i < 65536; ++i) {
+    allHalves[i].encoded = static_cast<uint16>(i);
+  }
+
+  Vector<float> floats(65536);
+  FloatPacking::halfToFloat(allHalves.data(), floats.data(), 65536);
+  for (uint32 i = 0; i < 65536; ++i) {
+    EXPECT_EQ(Float32(floats[i]).integerValue,
+              Float32(allHalves[i].getFloat()).integerValue);
+  }
+
+  Vector<LinearColor> colors(33);
+  for (SIZE_T i = 0; i < colors.size(); ++i) {
+    colors[i] = LinearColor(values[i * 4], values[i * 4 + 1], 0.5f, 1.0f);
+  }
+
+  Vector<Float16Color> halfColors(colors.size());
+  FloatPacking::colorToHalf(colors.data(), halfColors.data(), colors.size());
+  for (SIZE_T i = 0; i < colors.size(); ++i) {
+    EXPECT_TRUE(halfColors[i] == Float16Color(colors[i]));
+  }
+
+  Vector<LinearColor> unpackedColors(colors.size());
+  FloatPacking::halfToColor(halfColors.data(), unpackedColors.data(), colors.size());
+  for (SIZE_T i = 0; i < colors.size(); ++i) {
+    EXPECT_FLOAT_EQ(unpackedColors[i].b, 0.5f);
+    EXPECT_FLOAT_EQ(unpackedColors[i].a, 1.0f);
+  }
+}
+
+TEST(geFloatPacking, R11G11B10_Matches_Scalar) {
+  Vector<float> values = makeTestValues(3 * 1027);
+  const SIZE_T count = values.size() / 3;
+
+  Vector<Vector3> vectors(count);
+  for (SIZE_T i = 0; i < count; ++i) {
+    //Keep the specials spread among all three channels and most groups
+    //free of them, so both the SIMD and the scalar paths get exercised
+    if (i < 6) {
+      vectors[i] = Vector3(values[i * 3], values[i * 3 + 1], values[i * 3 + 2]);
+    }
+    else {
+      vectors[i] = Vector3(Math::abs(values[i * 3]) + 1.0f,
+                           Math::abs(values[i * 3 + 1]) + 0.001f,
+                           Math::abs(values[i * 3 + 2]) + 2.0f);
+    }
+  }
+
+  Vector<uint32> packed(count);
+  FloatPacking::vectorToR11G11B10(vectors.data(), packed.data(), count);
+  for (SIZE_T i = 0; i < count; ++i) {
+    uint32 expected = Float11(vectors[i].x).encoded |
+                     (Float11(vectors[i].y).encoded << 11) |
+                     (Float10(vectors[i].z).encoded << 22);
+    EXPECT_EQ(packed[i], expected);
+  }
+
+  //Every possible packed channel value
+  Vector<uint32> allPacked(2048);
+  for (uint32 i = 0; i < 2048; ++i) {
+    allPacked[i] = i | (i << 11) | ((i & 1023) << 22);
+  }
+
+  Vector<Vector3> unpacked(2048);
+  FloatPacking::r11g11b10ToVector(allPacked.data(), unpacked.data(), 2048);
+  for (uint32 i = 0; i < 2048; ++i) {
+    Float11 x;
+    Float10 z;
+    x.encoded = i;
+    z.encoded = i & 1023;
+    EXPECT_EQ(Float32(unpacked[i].x).integerValue, Float32(x.getFloat()).integerValue);
+    EXPECT_EQ(Float32(unpacked[i].y).integerValue, Float32(x.getFloat()).integerValue);
+    EXPECT_EQ(Float32(unpacked[i].z).integerValue, Float32(z.getFloat()).integerValue);
+  }
+}
+
+TEST(geFloatPacking, Benchmark_Half) {
+  const SIZE_T count = 1024 * 1024 * 4;
+  Vector<float> values = makeTestValues(static_cast<uint32>(count));
+  Vector<Float16> halves(count);
+
+  Timer timer;
+  for (SIZE_T i = 0; i < count; ++i) {
+    halves[i].set(values[i]);
+  }
+  uint64 scalarTime = timer.getMicroseconds();
+
+  timer.reset();
+  FloatPacking::floatToHalf(values.data(), halves.data(), count);
+  uint64 batchTime = timer.getMicroseconds();
+
+  timer.reset();
+  for (SIZE_T i = 0; i < count; ++i) {
+    values[i] = halves[i].getFloat();
+  }
+  uint64 scalarDecodeTime = timer.getMicroseconds();
+
+  timer.reset();
+  FloatPacking::halfToFloat(halves.data(), values.data(), count);
+  uint64 batchDecodeTime = timer.getMicroseconds();
+
+  std::cout << "float->half scalar: " << scalarTime << "us, "
+            << "FloatPacking: " << batchTime << "us; "
+            << "half->float scalar: " << scalarDecodeTime << "us, "
+            << "FloatPacking: " << batchDecodeTime << "us" << std::endl;
+}
@@ -0,0 +1,206 @@
+#include <vld.h>
+
+#define GTEST_HAS_TR1_TUPLE 0
+#define GTEST_USE_OWN_TR1_TUPLE 0
+#include <gtest/gtest.h>
+
+#include <gePrerequisitesUtil.h>
+#include <geAsyncLog.h>
+#include <geDataStream.h>
+#include <geDebug.h>
+#include <geLog.h>
+#include <geTimer.h>
+
+using namespace geEngineSDK;
+
+namespace {
+  /**
+   * @brief Removes and returns the entries added to the Debug log since the
+   *        last call, waiting for the asynchronous log if it's running.
+   */
+  Vector<LogEntry>
+  takeLogEntries() {
+    if (AsyncLog::isStarted()) {
+      AsyncLog::instance().flush();
+    }
+
+    Vector<LogEntry> entries;
+    LogEntry entry;
+    while (g_Debug().getLog().getUnreadEntry(entry)) {
+      entries.push_back(entry);
+    }
+    g_Debug().getLog().clear();
+    return entries;
+  }
+
+  /**
+   * @brief Builds a log message, counting how many times it was called.
+   */
+  String
+  countedMessage(uint32& numCalls) {
+    ++numCalls;
+    return "Message " + toString(numCalls);
+  }
+}
+
+TEST(geLog, Filter_Before_Evaluation) {
+  takeLogEntries();
+  uint32 numCalls = 0;
+
+  g_Debug().setChannelEnabled(DEBUG_CHANNEL::kDebug, false);
+  LOGDBG(countedMessage(numCalls));
+  EXPECT_EQ(0U, numCalls);
+  EXPECT_FALSE(g_Debug().isLogEnabled(LOG_LEVEL::kDebug, DEBUG_CHANNEL::kDebug));
+
+  //Other channels are not affected
+  LOGWRN(countedMessage(numCalls));
+  EXPECT_EQ(1U, numCalls);
+
+  g_Debug().setChannelEnabled(DEBUG_CHANNEL::kDebug, true);
+  LOGDBG(countedMessage(numCalls));
+  EXPECT_EQ(2U, numCalls);
+
+  //Verbose messages are disabled until the level is lowered
+  LOGDBG_VERBOSE(countedMessage(numCalls));
+  EXPECT_EQ(2U, numCalls);
+
+  g_Debug().setMinLogLevel(LOG_LEVEL::kVerbose);
+  LOGDBG_VERBOSE(countedMessage(numCalls));
+#if GE_LOG_MIN_LEVEL <= GE_LOG_LEVEL_VERBOSE
+  EXPECT_EQ(3U, numCalls);
+#else
+  EXPECT_EQ(2U, numCalls);
+#endif
+
+  g_Debug().setMinLogLevel(LOG_LEVEL::kError);
+  LOGWRN(countedMessage(numCalls));
+  LOGERR("Still logged");
+  g_Debug().setMinLogLevel(LOG_LEVEL::kDebug);
+
+  //Custom channels past the mask are always enabled
+  EXPECT_TRUE(g_Debug().isChannelEnabled(100));
+  g_Debug().setChannelEnabled(100, false);
+  EXPECT_TRUE(g_Debug().isChannelEnabled(100));
+
+  //Direct calls are filtered too
+  g_Debug().setChannelEnabled(DEBUG_CHANNEL::kWarning, false);
+  g_Debug().logWarning("Filtered");
+  g_Debug().setChannelEnabled(DEBUG_CHANNEL::kWarning, true);
+
+  Vector<LogEntry> entries = takeLogEntries();
+  ASSERT_EQ(static_cast<SIZE_T>(numCalls) + 1, entries.size());
+  EXPECT_EQ("Still logged", entries.back().getLogMessage());
+}
+
+TEST(geLog, Structured_Records) {
+  takeLogEntries();
+
+  const uint32 line = __LINE__ + 1;
+  LOGWRN("Structured " + toString(1));
+
+  Thread thread([]() { LOGERR("From another thread"); });
+  thread.join();
+
+  Vector<LogEntry> entries = takeLogEntries();
+  ASSERT_EQ(2U, entries.size());
+
+  const LogEntry& entry = entries[0];
+  EXPECT_EQ("Structured 1", entry.getLogMessage());
+  EXPECT_EQ(static_cast<uint32>(DEBUG_CHANNEL::kWarning), entry.getLogChannel());
+  EXPECT_EQ(Log::getCurrentThreadId(), entry.getThreadId());
+
+  const LogSourceLocation* location = entry.getSourceLocation();
+  ASSERT_NE(nullptr, location);
+  EXPECT_EQ(line, location->line);
+  EXPECT_STREQ(__FILE__, location->file);
+  EXPECT_NE(String::npos, String(location->function).find("Structured_Records"));
+
+  String formatted = entry.getFormattedMessage();
+  EXPECT_EQ(0U, formatted.find("Structured 1"));
+  EXPECT_NE(String::npos, formatted.find(":" + toString(line) + "]"));
+
+  EXPECT_NE(entry.getThreadId(), entries[1].getThreadId());
+  EXPECT_NE(location, entries[1].getSourceLocation());
+}
+
+TEST(geLog, Binary_Archive) {
+  static const LogSourceLocation locations[] = {
+    { "geFirst.cpp", "void first()", 10 },
+    { "geSecond.cpp", "void second()", 20 }
+  };
+
+  Vector<LogEntry> entries;
+  SIZE_T textSize = 0;
+  for (uint32 i = 0; i < 1000; ++i) {
+    //Times go slightly backwards now and then, as with several threads
+    uint64 time = 1000000 + i * 50 - (i % 7 == 0 ? 30 : 0);
+    entries.emplace_back("Entry " + toString(i),
+                         i % 3,
+                         time,
+                         0x1234567890ULL + (i % 4),
+                         (i % 5 == 0) ? nullptr : &locations[i % 2]);
+    textSize += entries.back().getFormattedMessage().size();
+  }
+
+  MemoryDataStream stream(1024 * 1024);
+  LogArchive::write(entries, stream);
+  SIZE_T archiveSize = stream.tell();
+  EXPECT_LT(archiveSize, textSize);
+
+  stream.seek(0);
+  MemoryDataStream archiveData(stream.getPtr(), archiveSize, false);
+
+  LogArchive archive;
+  ASSERT_TRUE(archive.read(archiveData));
+
+  const Vector<LogEntry>& readEntries = archive.getEntries();
+  ASSERT_EQ(entries.size(), readEntries.size());
+  for (SIZE_T i = 0; i < entries.size(); ++i) {
+    EXPECT_EQ(entries[i].getLogMessage(), readEntries[i].getLogMessage());
+    EXPECT_EQ(entries[i].getLogChannel(), readEntries[i].getLogChannel());
+    EXPECT_EQ(entries[i].getTime(), readEntries[i].getTime());
+    EXPECT_EQ(entries[i].getThreadId(), readEntries[i].getThreadId());
+    EXPECT_EQ(entries[i].getFormattedMessage(), readEntries[i].getFormattedMessage());
+    EXPECT_EQ(nullptr == entries[i].getSourceLocation(),
+              nullptr == readEntries[i].getSourceLocation());
+  }
+
+  //Truncated archives are rejected
+  MemoryDataStream truncated(stream.getPtr(), archiveSize / 2, false);
+  EXPECT_FALSE(archive.read(truncated));
+  EXPECT_TRUE(archive.getEntries().empty());
+
+  uint8 garbage[16] = { 1, 2, 3, 4 };
+  MemoryDataStream invalid(garbage, sizeof(garbage), false);
+  EXPECT_FALSE(archive.read(invalid));
+}
+
+TEST(geLog, Benchmark_Filtered) {
+  const uint32 numMessages = 200000;
+  uint32 numCalls = 0;
+
+  g_Debug().setChannelEnabled(DEBUG_CHANNEL::kDebug, false);
+
+  Timer timer;
+  for (uint32 i = 0; i < numMessages; ++i) {
+    LOGDBG("Filtered message " + toString(i) + ": " + countedMessage(numCalls));
+  }
+  uint64 filteredTime = timer.getMicroseconds();
+
+  g_Debug().setChannelEnabled(DEBUG_CHANNEL::kDebug, true);
+
+  //What the message costs to build, without logging it
+  SIZE_T totalSize = 0;
+  timer.reset();
+  for (uint32 i = 0; i < numMessages; ++i) {
+    String message = "Filtered message " + toString(i) + ": " + countedMessage(numCalls);
+    totalSize += message.size();
+  }
+  uint64 buildTime = timer.getMicroseconds();
+
+  std::cout << numMessages << " disabled LOGDBG: " << filteredTime << "us, "
+            << "building the messages alone: " << buildTime << "us ("
+            << totalSize << " bytes)" << std::endl;
+
+  EXPECT_EQ(numMessages, numCalls);
+}
@@ -0,0 +1,466 @@
+#include <vld.h>
+
+#define GTEST_HAS_TR1_TUPLE 0
+#define GTEST_USE_OWN_TR1_TUPLE 0
+#include <gtest/gtest.h>
+
+#include <gePrerequisitesUtil.h>
+#include <geMessageHandler.h>
+#include <geTimer.h>
+
+using namespace geEngineSDK;
+
+namespace {
+  /**
+   * @brief Starts the handler the first time a test needs it. Modules can't
+   *        be restarted, so it keeps running until all tests are done.
+   */
+  MessageHandler&
+  startHandler() {
+    if (!MessageHandler::isStarted()) {
+      MessageHandler::startUp();
+    }
+
+    return MessageHandler::instance();
+  }
+
+  class MessageHandlerEnvironment : public ::testing::Environment
+  {
+   public:
+    void
+    TearDown() override {
+      if (MessageHandler::isStarted()) {
+        MessageHandler::shutDown();
+      }
+    }
+  };
+
+  ::testing::Environment* const messageHandlerEnvironment =
+    ::testing::AddGlobalTestEnvironment(new MessageHandlerEnvironment());
+
+  struct Damage
+  {
+    uint32 target;
+    float amount;
+  };
+
+  struct LargePayload
+  {
+    uint64 values[16];
+  };
+
+  /**
+   * @brief Payloads aligned like SIMD registers, stored in place, allocated,
+   *        and more aligned than the in place storage.
+   */
+  struct alignas(16) AlignedPayload
+  {
+    float values[4];
+  };
+
+  struct alignas(16) LargeAlignedPayload
+  {
+    float values[32];
+  };
+
+  struct alignas(32) WideAlignedPayload
+  {
+    float values[8];
+  };
+
+  bool
+  isAligned(const void* ptr, SIZE_T alignment) {
+    return 0 == (reinterpret_cast<SIZE_T>(ptr) & (alignment - 1));
+  }
+
+  /**
+   * @brief Handler looking listeners up in a map, as the MessageHandler used
+   *        to, to compare against in the benchmark.
+   */
+  class MapHandler
+  {
+   public:
+    void
+    listen(uint32 messageId, function<void()> callback) {
+      m_handlers[messageId].push_back(std::move(callback));
+    }
+
+    void
+    send(uint32 messageId) {
+      auto iterFind = m_handlers.find(messageId);
+      if (iterFind != m_handlers.end()) {
+        for (auto& callback : iterFind->second) {
+          callback();
+        }
+      }
+    }
+
+   private:
+    Map<uint32, Vector<function<void()>>> m_handlers;
+  };
+}
+
+TEST(geMessageHandler, Message_Ids) {
+  MessageId invalid;
+  EXPECT_EQ(0U, invalid.getId());
+
+  MessageId first("MessageIds.First");
+  MessageId again("MessageIds.First");
+  MessageId second("MessageIds.Second");
+  EXPECT_NE(0U, first.getId());
+  EXPECT_TRUE(first == again);
+  EXPECT_FALSE(first == second);
+
+  //A typed name keeps its payload type
+  TMessageId<Damage> typed("MessageIds.Typed");
+  TMessageId<Damage> typedAgain("MessageIds.Typed");
+  EXPECT_TRUE(typed == typedAgain);
+
+  //Registered from many threads at once, every name gets a single id
+  const uint32 numThreads = 4;
+  const uint32 numNames = 200;
+  Vector<Vector<uint32>> ids(numThreads);
+  Vector<Thread> threads;
+  for (uint32 t = 0; t < numThreads; ++t) {
+    threads.emplace_back([&ids, t]() {
+      for (uint32 i = 0; i < numNames; ++i) {
+        ids[t].push_back(MessageId("MessageIds.Thread" + toString(i)).getId());
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  Set<uint32> uniqueIds(ids[0].begin(), ids[0].end());
+  EXPECT_EQ(numNames, uniqueIds.size());
+  for (uint32 t = 1; t < numThreads; ++t) {
+    EXPECT_EQ(ids[0], ids[t]);
+  }
+}
+
+TEST(geMessageHandler, Send_Listen) {
+  MessageHandler& handler = startHandler();
+
+  MessageId message("SendListen.Message");
+  TMessageId<Damage> damage("SendListen.Damage");
+
+  uint32 numCalls = 0;
+  float totalDamage = 0.0f;
+  HMessage first = handler.listen(message, [&]() { ++numCalls; });
+  HMessage second = handler.listen(message, [&]() { numCalls += 10; });
+  HMessage typed = handler.listen(damage, [&](const Damage& d) { totalDamage += d.amount; });
+
+  //Listening to a typed message without reading its payload is fine
+  HMessage untyped = handler.listen(damage, [&]() { numCalls += 100; });
+
+  sendMessage(message);
+  EXPECT_EQ(11U, numCalls);
+
+  handler.send(damage, Damage{ 1, 2.5f });
+  EXPECT_EQ(2.5f, totalDamage);
+  EXPECT_EQ(111U, numCalls);
+
+  first.disconnect();
+  sendMessage(message);
+  EXPECT_EQ(121U, numCalls);
+
+  //Disconnecting twice, or through a stale copy, does nothing
+  HMessage stale = second;
+  second.disconnect();
+  second.disconnect();
+  HMessage reused = handler.listen(message, [&]() { numCalls += 1000; });
+  stale.disconnect();
+  sendMessage(message);
+  EXPECT_EQ(1121U, numCalls);
+
+  reused.disconnect();
+  typed.disconnect();
+  untyped.disconnect();
+  handler.send(damage);
+  EXPECT_EQ(1121U, numCalls);
+}
+
+TEST(geMessageHandler, Change_During_Send) {
+  MessageHandler& handler = startHandler();
+
+  MessageId message("ChangeDuringSend.Message");
+  MessageId nested("ChangeDuringSend.Nested");
+  Vector<String> calls;
+
+  HMessage late;
+  HMessage self;
+  HMessage victim;
+
+  HMessage adder = handler.listen(message, [&]() {
+    calls.push_back("adder");
+    if (!late.isConnected()) {
+      late = handler.listen(message, [&]() { calls.push_back("late"); });
+    }
+  });
+
+  self = handler.listen(message, [&]() {
+    calls.push_back("self");
+    self.disconnect();
+    victim.disconnect();
+    handler.send(nested);
+  });
+
+  victim = handler.listen(message, [&]() { calls.push_back("victim"); });
+  HMessage nestedListener = handler.listen(nested, [&]() { calls.push_back("nested"); });
+
+  //Listeners added while sending wait for the next message, removed ones
+  //are skipped right away
+  handler.send(message);
+  ASSERT_EQ(3U, calls.size());
+  EXPECT_EQ("adder", calls[0]);
+  EXPECT_EQ("self", calls[1]);
+  EXPECT_EQ("nested", calls[2]);
+
+  calls.clear();
+  handler.send(message);
+  ASSERT_EQ(2U, calls.size());
+  EXPECT_EQ("adder", calls[0]);
+  EXPECT_EQ("late", calls[1]);
+
+  adder.disconnect();
+  late.disconnect();
+  nestedListener.disconnect();
+}
+
+TEST(geMessageHandler, Post_Process) {
+  MessageHandler& handler = startHandler();
+
+  TMessageId<uint64> counter("PostProcess.Counter");
+  TMessageId<LargePayload> large("PostProcess.Large");
+  TMessageId<SPtr<uint32>> shared("PostProcess.Shared");
+
+  const uint32 numThreads = 4;
+  const uint32 numPosts = 5000;
+
+  //Each thread's messages arrive in the order it posted them
+  Vector<uint64> lastValue(numThreads, 0);
+  uint32 numOutOfOrder = 0;
+  uint32 numReceived = 0;
+  HMessage counterListener = handler.listen(counter, [&](const uint64& value) {
+    const uint32 thread = static_cast<uint32>(value >> 32);
+    const uint64 index = value & 0xFFFFFFFF;
+    if (index != lastValue[thread]) {
+      ++numOutOfOrder;
+    }
+    lastValue[thread] = index + 1;
+    ++numReceived;
+  });
+
+  uint64 largeSum = 0;
+  HMessage largeListener = handler.listen(large, [&](const LargePayload& payload) {
+    largeSum += payload.values[15];
+  });
+
+  //Nothing is sent until the messages are processed
+  handler.post(counter, 0);
+  EXPECT_EQ(0U, numReceived);
+  EXPECT_EQ(1U, handler.processQueued());
+  EXPECT_EQ(1U, numReceived);
+  lastValue[0] = 0;
+  numReceived = 0;
+
+  std::atomic<uint32> numDone{ 0 };
+  Vector<Thread> threads;
+  for (uint32 t = 0; t < numThreads; ++t) {
+    threads.emplace_back([&handler, &counter, &large, &numDone, t]() {
+      for (uint32 i = 0; i < numPosts; ++i) {
+        handler.post(counter, (static_cast<uint64>(t) << 32) | i);
+        if (0 == i % 100) {
+          LargePayload payload;
+          payload.values[15] = 1;
+          handler.post(large, payload);
+        }
+      }
+      ++numDone;
+    });
+  }
+
+  //Process while the threads post
+  while (numDone.load() < numThreads) {
+    handler.processQueued();
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  handler.processQueued();
+
+  EXPECT_EQ(numThreads * numPosts, numReceived);
+  EXPECT_EQ(0U, numOutOfOrder);
+  EXPECT_EQ(numThreads * numPosts / 100, largeSum);
+
+  //Exited threads hand their queues to new ones
+  Thread([&]() { handler.post(counter, 0); }).join();
+  handler.processQueued();
+  handler.processQueued();
+  Thread([&]() { handler.post(counter, 1); }).join();
+  EXPECT_EQ(1U, handler.processQueued());
+
+  //Payloads are destroyed once sent
+  auto value = ge_shared_ptr_new<uint32>(7);
+  HMessage sharedListener = handler.listen(shared, [](const SPtr<uint32>& v) {
+    EXPECT_EQ(7U, *v);
+  });
+  handler.post(shared, value);
+  handler.post(shared, value);
+  EXPECT_EQ(3, value.use_count());
+  handler.processQueued();
+  EXPECT_EQ(1, value.use_count());
+
+  counterListener.disconnect();
+  largeListener.disconnect();
+  sharedListener.disconnect();
+}
+
+TEST(geMessageHandler, Post_Aligned) {
+  MessageHandler& handler = startHandler();
+
+  TMessageId<AlignedPayload> aligned("PostAligned.Aligned");
+  TMessageId<LargeAlignedPayload> largeAligned("PostAligned.LargeAligned");
+  TMessageId<WideAlignedPayload> wideAligned("PostAligned.WideAligned");
+
+  uint32 numReceived = 0;
+  uint32 numMisaligned = 0;
+  HMessage alignedListener = handler.listen(aligned, [&](const AlignedPayload& payload) {
+    numMisaligned += isAligned(&payload, 16) ? 0 : 1;
+    ++numReceived;
+  });
+  HMessage largeListener = handler.listen(largeAligned,
+                                          [&](const LargeAlignedPayload& payload) {
+    numMisaligned += isAligned(&payload, 16) ? 0 : 1;
+    ++numReceived;
+  });
+  HMessage wideListener = handler.listen(wideAligned, [&](const WideAlignedPayload& payload) {
+    numMisaligned += isAligned(&payload, 32) ? 0 : 1;
+    ++numReceived;
+  });
+
+  //Enough messages to fill several chunks of the queue
+  const uint32 numPosts = 1000;
+  for (uint32 i = 0; i < numPosts; ++i) {
+    handler.post(aligned, AlignedPayload());
+    handler.post(largeAligned, LargeAlignedPayload());
+    handler.post(wideAligned, WideAlignedPayload());
+  }
+  handler.processQueued();
+
+  EXPECT_EQ(numPosts * 3, numReceived);
+  EXPECT_EQ(0U, numMisaligned);
+
+  alignedListener.disconnect();
+  largeListener.disconnect();
+  wideListener.disconnect();
+}
+
+TEST(geMessageHandler, Post_Without_Allocations) {
+  MessageHandler& handler = startHandler();
+
+  TMessageId<Damage> damage("PostWithoutAllocations.Damage");
+  MessageId message("PostWithoutAllocations.Message");
+
+  float total = 0.0f;
+  HMessage damageListener = handler.listen(damage, [&](const Damage& d) { total += d.amount; });
+  HMessage listener = handler.listen(message, [&]() { total += 1.0f; });
+
+  //Fill the chunks once
+  for (uint32 i = 0; i < 1000; ++i) {
+    handler.post(damage, Damage{ i, 1.0f });
+  }
+  handler.processQueued();
+
+  const uint64 startAllocs = MemoryCounter::getNumAllocs();
+  for (uint32 frame = 0; frame < 100; ++frame) {
+    for (uint32 i = 0; i < 300; ++i) {
+      handler.post(damage, Damage{ i, 1.0f });
+      postMessage(message);
+    }
+    handler.processQueued();
+  }
+  EXPECT_EQ(startAllocs, MemoryCounter::getNumAllocs());
+  EXPECT_EQ(1000.0f + 60000.0f, total);
+
+  damageListener.disconnect();
+  listener.disconnect();
+}
+
+TEST(geMessageHandler, Benchmark_Send) {
+  MessageHandler& handler = startHandler();
+
+  const uint32 numMessages = 100;
+  const uint32 numSends = 2000000;
+
+  MapHandler mapHandler;
+  Vector<MessageId> messages;
+  Vector<HMessage> listeners;
+  uint64 numCalls = 0;
+  for (uint32 i = 0; i < numMessages; ++i) {
+    messages.emplace_back("BenchmarkSend.Message" + toString(i));
+    listeners.push_back(handler.listen(messages.back(), [&numCalls]() { ++numCalls; }));
+    mapHandler.listen(messages.back().getId(), [&numCalls]() { ++numCalls; });
+  }
+
+  Timer timer;
+  for (uint32 i = 0; i < numSends; ++i) {
+    handler.send(messages[i % numMessages]);
+  }
+  const double sendTime = timer.getMicroseconds() * 1000.0 / numSends;
+
+  timer.reset();
+  for (uint32 i = 0; i < numSends; ++i) {
+    mapHandler.send(messages[i % numMessages].getId());
+  }
+  const double mapTime = timer.getMicroseconds() * 1000.0 / numSends;
+  EXPECT_EQ(2ULL * numSends, numCalls);
+
+  //Posted from this thread and from 4 threads at once, processed here
+  TMessageId<Damage> damage("BenchmarkSend.Damage");
+  float total = 0.0f;
+  listeners.push_back(handler.listen(damage, [&](const Damage& d) { total += d.amount; }));
+
+  timer.reset();
+  for (uint32 i = 0; i < numSends; ++i) {
+    handler.post(damage, Damage{ i, 1.0f });
+    if (0 == i % 1000) {
+      handler.processQueued();
+    }
+  }
+  handler.processQueued();
+  const double postTime = timer.getMicroseconds() * 1000.0 / numSends;
+
+  const uint32 numThreads = 4;
+  std::atomic<uint32> numDone{ 0 };
+  timer.reset();
+  Vector<Thread> threads;
+  for (uint32 t = 0; t < numThreads; ++t) {
+    threads.emplace_back([&]() {
+      for (uint32 i = 0; i < numSends / numThreads; ++i) {
+        handler.post(damage, Damage{ i, 1.0f });
+      }
+      ++numDone;
+    });
+  }
+  while (numDone.load() < numThreads) {
+    handler.processQueued();
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  handler.processQueued();
+  const double threadedPostTime = timer.getMicroseconds() * 1000.0 / numSends;
+  EXPECT_EQ(2.0f * numSends, total);
+
+  std::cout << "ns per message: send: " << sendTime
+            << " (map lookup: " << mapTime << "), "
+            << "post + process: " << postTime << ", "
+            << "post from " << numThreads << " threads + process: " << threadedPostTime
+            << std::endl;
+
+  for (auto& listener : listeners) {
+    listener.disconnect();
+  }
+}
@@ -6,9 +6,19 @@
 #include <gtest/gtest.h>
 
 #include <gePrerequisitesUtil.h>
+#include <geBakedOctree.h>
+#include <geDataStream.h>
+#include <json.hpp>
 #include <geOctree.h>
+#include <gePlane.h>
+#include <geTaskScheduler.h>
+#include <geThreadPool.h>
+#include <geTimer.h>
+
+#include "geSpatialTestUtil.h"
 
 using namespace geEngineSDK;
+using namespace geSpatialTest;
 
 struct DebugOctreeElem
 {
@@ -43,6 +53,162 @@ struct DebugOctreeOptions
 
 typedef Octree<uint32, DebugOctreeOptions> DebugOctree;
 
+namespace {
+  /**
+   * @brief Fills the octree with randomly placed boxes of mixed sizes.
+   */
+  void
+  populateOctree(DebugOctree& octree, DebugOctreeData& octreeData, uint32 count) {
+    uint32 firstIdx = static_cast<uint32>(octreeData.elements.size());
+    generateElements(octreeData, count);
+
+    for (uint32 i = firstIdx; i < firstIdx + count; ++i) {
+      octree.addElement(i);
+    }
+  }
+
+  /**
+   * @brief Lists the child nodes and sorted elements of every node, so two
+   *        octrees can be compared node by node.
+   */
+  Vector<uint32>
+  getNodeLayout(const DebugOctree& octree) {
+    Vector<uint32> layout;
+
+    DebugOctree::NodeIterator nodeIter(octree);
+    while (nodeIter.moveNext()) {
+      const DebugOctree::Node* node = nodeIter.getCurrent().getNode();
+
+      uint32 childMask = 0;
+      for (uint32 i = 0; i < 8; ++i) {
+        if (node->hasChild(DebugOctree::HChildNode(i))) {
+          childMask |= 1 << i;
+          nodeIter.pushChild(DebugOctree::HChildNode(i));
+        }
+      }
+
+      Vector<uint32> elements;
+      DebugOctree::ElementIterator elemIter(node);
+      while (elemIter.moveNext()) {
+        elements.push_back(elemIter.getCurrentElem());
+      }
+      std::sort(elements.begin(), elements.end());
+
+      layout.push_back(childMask);
+      layout.push_back(static_cast<uint32>(elements.size()));
+      layout.insert(layout.end(), elements.begin(), elements.end());
+    }
+
+    return layout;
+  }
+
+  /**
+   * @brief Checks that box queries on the octree match a brute force search.
+   */
+  void
+  expectBoxQueriesMatch(const DebugOctree& octree,
+                        const DebugOctreeData& octreeData,
+                        uint32 numQueries) {
+    Vector<bool> inOctree(octreeData.elements.size(), true);
+    expectQueryResultsMatch(octreeData, inOctree, numQueries,
+                            [&](const AABox& queryBounds, Vector<uint32>& found) {
+      DebugOctree::BoxIntersectIterator interIter(octree, queryBounds);
+      while (interIter.moveNext()) {
+        found.push_back(interIter.getElement());
+      }
+    });
+  }
+
+  /**
+   * @brief Returns the sorted elements found by a BoxIntersectIterator for
+   *        each of the provided bounds.
+   */
+  Vector<Vector<uint32>>
+  getSortedBoxResults(const DebugOctree& octree, const Vector<AABox>& boxes) {
+    Vector<Vector<uint32>> results(boxes.size());
+    for (SIZE_T i = 0; i < boxes.size(); ++i) {
+      DebugOctree::BoxIntersectIterator interIter(octree, boxes[i]);
+      while (interIter.moveNext()) {
+        results[i].push_back(interIter.getElement());
+      }
+      std::sort(results[i].begin(), results[i].end());
+    }
+    return results;
+  }
+
+  /**
+   * @brief Returns the planes of a frustum at the origin looking down the
+   *        positive X axis, with a 90 degree field of view.
+   */
+  Vector<Plane>
+  makeFrustum(float nearDist, float farDist) {
+    const float invSqrt2 = 1.0f / Math::sqrt(2.0f);
+    return {
+      Plane(-1.0f, 0.0f, 0.0f, -nearDist),
+      Plane(1.0f, 0.0f, 0.0f, farDist),
+      Plane(-invSqrt2, invSqrt2, 0.0f, 0.0f),
+      Plane(-invSqrt2, -invSqrt2, 0.0f, 0.0f),
+      Plane(-invSqrt2, 0.0f, invSqrt2, 0.0f),
+      Plane(-invSqrt2, 0.0f, -invSqrt2, 0.0f)
+    };
+  }
+
+  /**
+   * @brief Checks if a box isn't completely in front of any of the planes.
+   */
+  bool
+  intersectsVolume(const AABox& box, const Vector<Plane>& planes) {
+    Vector3 center, extents;
+    box.getCenterAndExtents(center, extents);
+    for (auto& plane : planes) {
+      if (plane.planeDot(center) > (extents | plane.getAbs())) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  /**
+   * @brief Returns random segments with the specified length.
+   */
+  Vector<std::pair<Vector3, Vector3>>
+  makeSegments(uint32 count, float length) {
+    Vector<std::pair<Vector3, Vector3>> segments(count);
+    for (auto& segment : segments) {
+      Vector3 direction(randomUnit(), randomUnit(), randomUnit());
+      direction.normalize();
+
+      segment.first = Vector3(randomUnit() * 700.0f,
+                              randomUnit() * 700.0f,
+                              randomUnit() * 700.0f);
+      segment.second = segment.first + direction * length;
+    }
+    return segments;
+  }
+
+  /**
+   * @brief Scalar slab test of a segment against a box, kept apart from the
+   *        octree code on purpose.
+   * @return Time in range [0, 1] at which the segment enters the box, zero if
+   *         it starts inside, or a negative value if it misses the box.
+   */
+  float
+  segmentEntryTime(const AABox& box, const Vector3& start, const Vector3& end) {
+    const Vector3 direction = end - start;
+    float tNear = 0.0f;
+    float tFar = 1.0f;
+
+    for (uint32 axis = 0; axis < 3; ++axis) {
+      const float t0 = (box.m_min[axis] - start[axis]) / direction[axis];
+      const float t1 = (box.m_max[axis] - start[axis]) / direction[axis];
+      tNear = Math::max(tNear, Math::min(t0, t1));
+      tFar = Math::min(tFar, Math::max(t0, t1));
+    }
+
+    return tNear <= tFar ? tNear : -1.0f;
+  }
+}
+
 TEST(geOctree, Construct_Octree) {
   DebugOctreeData octreeData;
   DebugOctree octree(Vector3::ZERO, 800.0f, &octreeData);
@@ -122,3 +288,1157 @@ TEST(geOctree, Construct_Octree) {
     octree.removeElement(entry.octreeId);
   }
 }
+
+TEST(geOctree, Child_Placement) {
+  DebugOctreeData octreeData;
+  DebugOctree octree(Vector3::ZERO, 100.0f, &octreeData);
+
+  //Enough small elements around the center for the root to split
+  for (uint32 i = 0; i < 40; ++i) {
+    Vector3 position(((rand() / (float)RAND_MAX) * 2.0f - 1.0f) * 20.0f,
+                     ((rand() / (float)RAND_MAX) * 2.0f - 1.0f) * 20.0f,
+                     ((rand() / (float)RAND_MAX) * 2.0f - 1.0f) * 20.0f);
+
+    DebugOctreeElem elem;
+    elem.box = AABox(position - Vector3(1.0f, 1.0f, 1.0f), position + Vector3(1.0f, 1.0f, 1.0f));
+    octreeData.elements.push_back(elem);
+  }
+
+  //Centered past the center of the positive X children, and sticking out of
+  //their outer side, so they can't hold it
+  DebugOctreeElem outerElem;
+  outerElem.box = AABox(Vector3(97.0f, 8.0f, 8.0f), Vector3(101.0f, 12.0f, 12.0f));
+  octreeData.elements.push_back(outerElem);
+
+  for (uint32 i = 0; i < static_cast<uint32>(octreeData.elements.size()); ++i) {
+    octree.addElement(i);
+  }
+
+  //Elements below the root must fit in the bounds of their node
+  uint32 numChildElements = 0;
+  uint32 numOuterInChildren = 0;
+  DebugOctree::NodeIterator nodeIter(octree);
+  bool isRoot = true;
+  while (nodeIter.moveNext()) {
+    const DebugOctree::HNode& node = nodeIter.getCurrent();
+    const simd::AABox& nodeBounds = node.getBounds().getBounds();
+
+    DebugOctree::ElementIterator elemIter(node.getNode());
+    while (elemIter.moveNext()) {
+      uint32 elem = elemIter.getCurrentElem();
+      if (isRoot) {
+        continue;
+      }
+
+      ++numChildElements;
+      if (elem == octreeData.elements.size() - 1) {
+        ++numOuterInChildren;
+      }
+
+      const AABox& box = octreeData.elements[elem].box;
+      Vector3 nodeMin(nodeBounds.m_center.x - nodeBounds.m_extents.x,
+                      nodeBounds.m_center.y - nodeBounds.m_extents.y,
+                      nodeBounds.m_center.z - nodeBounds.m_extents.z);
+      Vector3 nodeMax(nodeBounds.m_center.x + nodeBounds.m_extents.x,
+                      nodeBounds.m_center.y + nodeBounds.m_extents.y,
+                      nodeBounds.m_center.z + nodeBounds.m_extents.z);
+      EXPECT_TRUE(AABox(nodeMin, nodeMax).isInside(box));
+    }
+
+    isRoot = false;
+    for (uint32 i = 0; i < 8; ++i) {
+      if (node.getNode()->hasChild(i)) {
+        nodeIter.pushChild(i);
+      }
+    }
+  }
+
+  EXPECT_GT(numChildElements, 0U);
+  EXPECT_EQ(0U, numOuterInChildren);
+
+  for (auto& entry : octreeData.elements) {
+    octree.removeElement(entry.octreeId);
+  }
+}
+
+TEST(geOctree, Ray_Intersect) {
+  DebugOctreeData octreeData;
+  DebugOctree octree(Vector3::ZERO, 800.0f, &octreeData);
+  populateOctree(octree, octreeData, 20000);
+
+  //Elements outside of the root bounds stay in the root node
+  DebugOctreeElem outside;
+  outside.box = AABox(Vector3(900.0f, -5.0f, -5.0f), Vector3(910.0f, 5.0f, 5.0f));
+  octreeData.elements.push_back(outside);
+  octree.addElement(static_cast<uint32>(octreeData.elements.size() - 1));
+
+  auto segments = makeSegments(64, 400.0f);
+  segments.emplace_back(Vector3(0.0f, 0.0f, 0.0f), Vector3(1000.0f, 0.0f, 0.0f));
+  segments.emplace_back(Vector3(-700.0f, 10.0f, 10.0f), Vector3(700.0f, 10.0f, 10.0f));
+  segments.emplace_back(Vector3(5.0f, 5.0f, 5.0f), Vector3(5.0f, 5.0f, 5.0f));
+
+  for (auto& segment : segments) {
+    const Vector3& start = segment.first;
+    const Vector3& end = segment.second;
+    const Vector3 direction = end - start;
+
+    Vector<uint32> hits;
+    DebugOctree::RayIntersectIterator rayIter(octree, start, end);
+    while (rayIter.moveNext()) {
+      uint32 element = rayIter.getElement();
+      hits.push_back(element);
+
+      const AABox& box = octreeData.elements[element].box;
+      EXPECT_TRUE(Math::lineBoxIntersection(box, start, end, direction));
+      EXPECT_GE(rayIter.getTime(), 0.0f);
+      EXPECT_LE(rayIter.getTime(), 1.0f);
+
+      //The reported time is where the segment enters the box
+      Vector3 entry = start + direction * rayIter.getTime();
+      EXPECT_TRUE(box.expandBy(0.01f).isInside(entry));
+    }
+
+    //Math::lineBoxIntersection accepts hits slightly outside of the box, so
+    //only compare against boxes that are clearly hit
+    uint32 elemIdx = 0;
+    for (auto& entry : octreeData.elements) {
+      if (Math::lineBoxIntersection(entry.box.expandBy(-0.1f), start, end, direction)) {
+        auto iterFind = std::find(hits.begin(), hits.end(), elemIdx);
+        EXPECT_TRUE(iterFind != hits.end());
+      }
+      elemIdx++;
+    }
+  }
+
+  DebugOctree::RayIntersectIterator outsideIter(octree,
+                                                Vector3(800.0f, 0.0f, 0.0f),
+                                                Vector3(1000.0f, 0.0f, 0.0f));
+  bool foundOutside = false;
+  while (outsideIter.moveNext()) {
+    foundOutside |= outsideIter.getElement() == octreeData.elements.size() - 1;
+  }
+  EXPECT_TRUE(foundOutside);
+}
+
+TEST(geOctree, Closest_Hit) {
+  DebugOctreeData octreeData;
+  DebugOctree octree(Vector3::ZERO, 800.0f, &octreeData);
+  populateOctree(octree, octreeData, 20000);
+
+  uint32 numHits = 0;
+  for (auto& segment : makeSegments(256, 300.0f)) {
+    const Vector3& start = segment.first;
+    const Vector3& end = segment.second;
+
+    //Closest hit by brute force over every element
+    float expectedTime = 2.0f;
+    for (auto& elem : octreeData.elements) {
+      const float time = segmentEntryTime(elem.box, start, end);
+      if (time >= 0.0f) {
+        expectedTime = Math::min(expectedTime, time);
+      }
+    }
+
+    uint32 hitElem = 0;
+    float hitTime = 0.0f;
+    if (octree.findClosestHit(start, end, hitElem, hitTime)) {
+      EXPECT_NEAR(hitTime, expectedTime, 1e-4f);
+      EXPECT_TRUE(Math::lineBoxIntersection(octreeData.elements[hitElem].box,
+                                            start,
+                                            end,
+                                            end - start));
+      ++numHits;
+    }
+    else {
+      EXPECT_EQ(expectedTime, 2.0f);
+    }
+  }
+  EXPECT_GT(numHits, 0U);
+
+  uint32 hitElem = 0;
+  float hitTime = 0.0f;
+  EXPECT_FALSE(octree.findClosestHit(Vector3(2000.0f, 0.0f, 0.0f),
+                                     Vector3(3000.0f, 0.0f, 0.0f),
+                                     hitElem,
+                                     hitTime));
+}
+
+TEST(geOctree, Benchmark_Ray_Intersect) {
+  DebugOctreeData octreeData;
+  DebugOctree octree(Vector3::ZERO, 800.0f, &octreeData);
+  populateOctree(octree, octreeData, 200000);
+
+  auto segments = makeSegments(16384, 200.0f);
+
+  //Query a box around the segment and filter the results by hand
+  uint32 boxHits = 0;
+  Timer timer;
+  for (auto& segment : segments) {
+    const Vector3& start = segment.first;
+    const Vector3& end = segment.second;
+    const Vector3 direction = end - start;
+
+    float closestTime = 2.0f;
+    AABox segmentBounds(start.componentMin(end), start.componentMax(end));
+    DebugOctree::BoxIntersectIterator boxIter(octree, segmentBounds);
+    while (boxIter.moveNext()) {
+      const AABox& box = octreeData.elements[boxIter.getElement()].box;
+      if (Math::lineBoxIntersection(box, start, end, direction)) {
+        closestTime = 1.0f;
+      }
+    }
+    boxHits += closestTime <= 1.0f ? 1 : 0;
+  }
+  uint64 boxTime = timer.getMicroseconds();
+
+  uint32 rayHits = 0;
+  timer.reset();
+  for (auto& segment : segments) {
+    DebugOctree::RayIntersectIterator rayIter(octree, segment.first, segment.second);
+    while (rayIter.moveNext()) {
+      ++rayHits;
+    }
+  }
+  uint64 rayTime = timer.getMicroseconds();
+
+  uint32 closestHits = 0;
+  timer.reset();
+  for (auto& segment : segments) {
+    uint32 hitElem;
+    float hitTime;
+    closestHits += octree.findClosestHit(segment.first,
+                                         segment.second,
+                                         hitElem,
+                                         hitTime) ? 1 : 0;
+  }
+  uint64 closestTime = timer.getMicroseconds();
+
+  std::cout << "Octree segment queries, box query + filter: " << boxTime << "us, "
+            << "RayIntersectIterator: " << rayTime << "us, "
+            << "findClosestHit: " << closestTime << "us" << std::endl;
+
+  EXPECT_GE(rayHits, closestHits);
+  EXPECT_GE(boxHits, closestHits);
+}
+
+TEST(geOctree, Volume_Query) {
+  DebugOctreeData octreeData;
+  DebugOctree octree(Vector3::ZERO, 800.0f, &octreeData);
+  populateOctree(octree, octreeData, 20000);
+
+  Vector<Vector<Plane>> volumes;
+  volumes.push_back(makeFrustum(1.0f, 600.0f));
+  volumes.push_back(makeFrustum(10.0f, 2000.0f));
+  volumes.push_back({ Plane(1.0f, 0.0f, 0.0f, 100.0f),
+                      Plane(-1.0f, 0.0f, 0.0f, 100.0f),
+                      Plane(0.0f, 1.0f, 0.0f, 50.0f),
+                      Plane(0.0f, -1.0f, 0.0f, 50.0f),
+                      Plane(0.0f, 0.0f, 1.0f, 400.0f),
+                      Plane(0.0f, 0.0f, -1.0f, -200.0f) });
+  volumes.push_back({});  //Everything is inside an empty plane set
+
+  Vector<uint32> visible(octreeData.elements.size());
+  for (auto& planes : volumes) {
+    DebugOctree::ConvexVolume volume(planes.data(), static_cast<uint32>(planes.size()));
+    SIZE_T count = octree.findInVolume(volume, visible.data(), visible.size());
+    ASSERT_LE(count, visible.size());
+
+    Vector<uint32> expected;
+    uint32 elemIdx = 0;
+    for (auto& entry : octreeData.elements) {
+      if (intersectsVolume(entry.box, planes)) {
+        expected.push_back(elemIdx);
+      }
+      elemIdx++;
+    }
+
+    Vector<uint32> found(visible.begin(), visible.begin() + count);
+    std::sort(found.begin(), found.end());
+    EXPECT_TRUE(found == expected);
+
+    //Output is clipped to the buffer capacity, but all elements are counted
+    SIZE_T capacity = count / 2;
+    EXPECT_EQ(octree.findInVolume(volume, visible.data(), capacity), count);
+  }
+}
+
+TEST(geOctree, Benchmark_Volume_Query) {
+  DebugOctreeData octreeData;
+  DebugOctree octree(Vector3::ZERO, 800.0f, &octreeData);
+  populateOctree(octree, octreeData, 200000);
+
+  Vector<Plane> planes = makeFrustum(1.0f, 600.0f);
+  DebugOctree::ConvexVolume volume(planes.data(), static_cast<uint32>(planes.size()));
+  //Per plane tests accept boxes near the frustum corners that go past its
+  //bounding box, pad it by the largest element size
+  AABox frustumBounds(Vector3(-64.0f, -664.0f, -664.0f), Vector3(664.0f, 664.0f, 664.0f));
+
+  const uint32 iterations = 16;
+  Vector<uint32> visible(octreeData.elements.size());
+
+  //Query the box around the frustum and test the planes by hand
+  SIZE_T boxCount = 0;
+  Timer timer;
+  for (uint32 i = 0; i < iterations; ++i) {
+    boxCount = 0;
+    DebugOctree::BoxIntersectIterator boxIter(octree, frustumBounds);
+    while (boxIter.moveNext()) {
+      uint32 element = boxIter.getElement();
+      if (intersectsVolume(octreeData.elements[element].box, planes)) {
+        visible[boxCount++] = element;
+      }
+    }
+  }
+  uint64 boxTime = timer.getMicroseconds();
+
+  SIZE_T volumeCount = 0;
+  timer.reset();
+  for (uint32 i = 0; i < iterations; ++i) {
+    volumeCount = octree.findInVolume(volume, visible.data(), visible.size());
+  }
+  uint64 volumeTime = timer.getMicroseconds();
+
+  std::cout << "Octree frustum culling (" << volumeCount << " visible), "
+            << "box query + filter: " << boxTime << "us, "
+            << "findInVolume: " << volumeTime << "us" << std::endl;
+
+  EXPECT_EQ(boxCount, volumeCount);
+}
+
+TEST(geOctree, Nearest_Query) {
+  DebugOctreeData octreeData;
+  DebugOctree octree(Vector3::ZERO, 800.0f, &octreeData);
+  populateOctree(octree, octreeData, 20000);
+
+  const SIZE_T k = 16;
+  DebugOctree::ElementDistance nearest[k];
+
+  Vector<float> distances(octreeData.elements.size());
+  for (uint32 i = 0; i < 64; ++i) {
+    //Also query points outside of the root node
+    Vector3 point(randomUnit() * 900.0f, randomUnit() * 900.0f, randomUnit() * 900.0f);
+
+    for (SIZE_T j = 0; j < octreeData.elements.size(); ++j) {
+      distances[j] = octreeData.elements[j].box.computeSquaredDistanceToPoint(point);
+    }
+    std::sort(distances.begin(), distances.end());
+
+    SIZE_T found = octree.findNearest(point, k, nearest);
+    ASSERT_EQ(found, k);
+    for (SIZE_T j = 0; j < k; ++j) {
+      EXPECT_NEAR(nearest[j].distSquared, distances[j], distances[j] * 1.e-4f + 1.e-3f);
+      EXPECT_NEAR(nearest[j].distSquared,
+                  octreeData.elements[nearest[j].element].box.computeSquaredDistanceToPoint(point),
+                  distances[j] * 1.e-4f + 1.e-3f);
+    }
+
+    //Only elements within the maximum distance are returned
+    float maxDistance = Math::sqrt(distances[k / 2]) + 0.01f;
+    found = octree.findNearest(point, k, nearest, maxDistance);
+    EXPECT_GE(found, k / 2 + 1);
+    for (SIZE_T j = 0; j < found; ++j) {
+      EXPECT_LE(nearest[j].distSquared, maxDistance * maxDistance);
+    }
+  }
+
+  EXPECT_EQ(octree.findNearest(Vector3::ZERO, 0, nearest), 0U);
+}
+
+TEST(geOctree, Radius_Query) {
+  DebugOctreeData octreeData;
+  DebugOctree octree(Vector3::ZERO, 800.0f, &octreeData);
+  populateOctree(octree, octreeData, 20000);
+
+  Vector<uint32> output(octreeData.elements.size());
+  for (uint32 i = 0; i < 64; ++i) {
+    Vector3 point(randomUnit() * 800.0f, randomUnit() * 800.0f, randomUnit() * 800.0f);
+    float radius = 10.0f + (randomUnit() * 0.5f + 0.5f) * 150.0f;
+
+    SIZE_T count = octree.findWithinRadius(point, radius, output.data(), output.size());
+    ASSERT_LE(count, output.size());
+
+    Vector<uint32> found(output.begin(), output.begin() + count);
+    std::sort(found.begin(), found.end());
+
+    uint32 elemIdx = 0;
+    for (auto& entry : octreeData.elements) {
+      float distance = Math::sqrt(entry.box.computeSquaredDistanceToPoint(point));
+      bool isFound = std::binary_search(found.begin(), found.end(), elemIdx);
+
+      //Ignore elements right on the edge of the radius
+      if (Math::abs(distance - radius) > 1.e-3f) {
+        EXPECT_EQ(isFound, distance < radius);
+      }
+      elemIdx++;
+    }
+  }
+}
+
+TEST(geOctree, Benchmark_Nearest_Query) {
+  DebugOctreeData octreeData;
+  DebugOctree octree(Vector3::ZERO, 800.0f, &octreeData);
+  populateOctree(octree, octreeData, 200000);
+
+  const uint32 numQueries = 16384;
+  const SIZE_T k = 8;
+  const float radius = 50.0f;
+
+  Vector<Vector3> points(numQueries);
+  for (auto& point : points) {
+    point = Vector3(randomUnit() * 700.0f, randomUnit() * 700.0f, randomUnit() * 700.0f);
+  }
+
+  //Query a box around the point and sort the results by distance
+  float boxSum = 0.0f;
+  Vector<std::pair<float, uint32>> candidates;
+  Timer timer;
+  for (auto& point : points) {
+    candidates.clear();
+    DebugOctree::BoxIntersectIterator boxIter(octree, AABox(point - radius, point + radius));
+    while (boxIter.moveNext()) {
+      uint32 element = boxIter.getElement();
+      float distSquared = octreeData.elements[element].box.computeSquaredDistanceToPoint(point);
+      if (distSquared <= radius * radius) {
+        candidates.emplace_back(distSquared, element);
+      }
+    }
+
+    SIZE_T count = Math::min(k, candidates.size());
+    std::partial_sort(candidates.begin(), candidates.begin() + count, candidates.end());
+    boxSum += count > 0 ? candidates[count - 1].first : 0.0f;
+  }
+  uint64 boxTime = timer.getMicroseconds();
+
+  float nearestSum = 0.0f;
+  DebugOctree::ElementDistance nearest[k];
+  timer.reset();
+  for (auto& point : points) {
+    SIZE_T count = octree.findNearest(point, k, nearest, radius);
+    nearestSum += count > 0 ? nearest[count - 1].distSquared : 0.0f;
+  }
+  uint64 nearestTime = timer.getMicroseconds();
+
+  SIZE_T radiusCount = 0;
+  Vector<uint32> output(octreeData.elements.size());
+  timer.reset();
+  for (auto& point : points) {
+    radiusCount += octree.findWithinRadius(point, radius, output.data(), output.size());
+  }
+  uint64 radiusTime = timer.getMicroseconds();
+
+  std::cout << "Octree " << k << " nearest, box query + sort: " << boxTime << "us, "
+            << "findNearest: " << nearestTime << "us; "
+            << "findWithinRadius: " << radiusTime << "us" << std::endl;
+
+  EXPECT_NEAR(boxSum, nearestSum, boxSum * 1.e-4f);
+  EXPECT_GT(radiusCount, 0U);
+}
+
+TEST(geOctree, Update_Elements) {
+  DebugOctreeData octreeData;
+  DebugOctree octree(Vector3::ZERO, 800.0f, &octreeData);
+  populateOctree(octree, octreeData, 20000);
+
+  const uint32 numElements = static_cast<uint32>(octreeData.elements.size());
+  for (uint32 frame = 0; frame < 4; ++frame) {
+    //Mostly small moves that stay in the same node, and a few teleports
+    Vector<OctreeElementId> ids;
+    for (uint32 i = 0; i < numElements; ++i) {
+      if ((rand() % 3) != 0) {
+        continue;
+      }
+
+      AABox& box = octreeData.elements[i].box;
+      Vector3 offset = (rand() % 20) == 0 ?
+        Vector3(randomUnit(), randomUnit(), randomUnit()) * 700.0f - box.getCenter() :
+        Vector3(randomUnit(), randomUnit(), randomUnit()) * 2.0f;
+      box = AABox(box.m_min + offset, box.m_max + offset);
+
+      if ((frame & 1) == 0) {
+        octree.updateElement(octreeData.elements[i].octreeId);
+      }
+      else {
+        ids.push_back(octreeData.elements[i].octreeId);
+      }
+    }
+
+    octree.updateElements(ids.data(), ids.size());
+    expectBoxQueriesMatch(octree, octreeData, 32);
+  }
+
+  //Removing most elements collapses the nodes, then move the rest around
+  for (uint32 i = 0; i < numElements - 100; ++i) {
+    octree.removeElement(octreeData.elements[i].octreeId);
+    octreeData.elements[i].box = AABox(Vector3(5000.0f, 5000.0f, 5000.0f),
+                                       Vector3(5001.0f, 5001.0f, 5001.0f));
+  }
+
+  Vector<OctreeElementId> ids;
+  for (uint32 i = numElements - 100; i < numElements; ++i) {
+    AABox& box = octreeData.elements[i].box;
+    Vector3 offset(randomUnit() * 100.0f, randomUnit() * 100.0f, randomUnit() * 100.0f);
+    box = AABox(box.m_min + offset, box.m_max + offset);
+    ids.push_back(octreeData.elements[i].octreeId);
+  }
+  octree.updateElements(ids.data(), ids.size());
+  expectBoxQueriesMatch(octree, octreeData, 32);
+
+  for (uint32 i = numElements - 100; i < numElements; ++i) {
+    octree.removeElement(octreeData.elements[i].octreeId);
+  }
+}
+
+TEST(geOctree, Benchmark_Update_Elements) {
+  const uint32 numMoved = 50000;
+  const uint32 numFrames = 8;
+
+  DebugOctreeData octreeData;
+  DebugOctree octree(Vector3::ZERO, 800.0f, &octreeData);
+  populateOctree(octree, octreeData, 200000);
+
+  //Precompute the movement so all approaches move the elements the same way
+  Vector<Vector3> offsets(numMoved);
+  for (auto& offset : offsets) {
+    offset = Vector3(randomUnit(), randomUnit(), randomUnit()) * 2.0f;
+  }
+
+  auto moveElements = [&](float direction) {
+    for (uint32 i = 0; i < numMoved; ++i) {
+      AABox& box = octreeData.elements[i * 4].box;
+      box = AABox(box.m_min + offsets[i] * direction, box.m_max + offsets[i] * direction);
+    }
+  };
+
+  Timer timer;
+  for (uint32 frame = 0; frame < numFrames; ++frame) {
+    moveElements((frame & 1) ? -1.0f : 1.0f);
+    for (uint32 i = 0; i < numMoved; ++i) {
+      octree.removeElement(octreeData.elements[i * 4].octreeId);
+      octree.addElement(i * 4);
+    }
+  }
+  uint64 reinsertTime = timer.getMicroseconds();
+
+  timer.reset();
+  for (uint32 frame = 0; frame < numFrames; ++frame) {
+    moveElements((frame & 1) ? -1.0f : 1.0f);
+    for (uint32 i = 0; i < numMoved; ++i) {
+      octree.updateElement(octreeData.elements[i * 4].octreeId);
+    }
+  }
+  uint64 updateTime = timer.getMicroseconds();
+
+  Vector<OctreeElementId> ids(numMoved);
+  timer.reset();
+  for (uint32 frame = 0; frame < numFrames; ++frame) {
+    moveElements((frame & 1) ? -1.0f : 1.0f);
+    for (uint32 i = 0; i < numMoved; ++i) {
+      ids[i] = octreeData.elements[i * 4].octreeId;
+    }
+    octree.updateElements(ids.data(), ids.size());
+  }
+  uint64 batchTime = timer.getMicroseconds();
+
+  std::cout << "Octree moving " << numMoved << " elements per frame, "
+            << "remove + add: " << reinsertTime / numFrames << "us, "
+            << "updateElement: " << updateTime / numFrames << "us, "
+            << "updateElements: " << batchTime / numFrames << "us" << std::endl;
+
+  expectBoxQueriesMatch(octree, octreeData, 8);
+}
+
+TEST(geOctree, Build_Octree) {
+  DebugOctreeData octreeData;
+  generateElements(octreeData, 30000);
+
+  //A few elements outside of the root bounds
+  for (uint32 i = 0; i < 8; ++i) {
+    DebugOctreeElem elem;
+    elem.box = AABox(Vector3(900.0f, 0.0f, i * 10.0f), Vector3(905.0f, 5.0f, i * 10.0f + 5.0f));
+    octreeData.elements.push_back(elem);
+  }
+
+  Vector<uint32> indices = getElementIndices(octreeData);
+
+  DebugOctreeData incrementalData = octreeData;
+  DebugOctree incremental(Vector3::ZERO, 800.0f, &incrementalData);
+  for (auto index : indices) {
+    incremental.addElement(index);
+  }
+
+  //Serial build first, since the task scheduler can't be stopped afterwards
+  for (uint32 pass = 0; pass < 2; ++pass) {
+    if (1 == pass) {
+      startTaskScheduler();
+    }
+
+    DebugOctree octree(Vector3::ZERO, 800.0f, &octreeData);
+    octree.build(indices.data(), indices.size());
+    expectBoxQueriesMatch(octree, octreeData, 32);
+
+    //Elements end up in the same nodes as when added one by one
+    EXPECT_TRUE(getNodeLayout(octree) == getNodeLayout(incremental));
+
+    //The reported IDs are valid
+    for (uint32 i = 0; i < indices.size(); i += 2) {
+      octree.removeElement(octreeData.elements[i].octreeId);
+    }
+    octree.addElement(0);
+    octree.updateElement(octreeData.elements[1].octreeId);
+  }
+}
+
+TEST(geOctree, Benchmark_Build_Octree) {
+  DebugOctreeData octreeData;
+  generateElements(octreeData, 1000000);
+  Vector<uint32> indices = getElementIndices(octreeData);
+
+  //Only the loading is timed, not the destruction of the octrees
+  DebugOctree incremental(Vector3::ZERO, 800.0f, &octreeData);
+  Timer timer;
+  for (auto index : indices) {
+    incremental.addElement(index);
+  }
+  uint64 incrementalTime = timer.getMicroseconds();
+
+  DebugOctree serial(Vector3::ZERO, 800.0f, &octreeData);
+  timer.reset();
+  serial.build(indices.data(), indices.size());
+  uint64 buildTime = timer.getMicroseconds();
+
+  startTaskScheduler();
+
+  DebugOctree octree(Vector3::ZERO, 800.0f, &octreeData);
+  timer.reset();
+  octree.build(indices.data(), indices.size());
+  uint64 parallelBuildTime = timer.getMicroseconds();
+
+  std::cout << "Octree loading " << indices.size() << " elements, "
+            << "addElement: " << incrementalTime << "us, "
+            << "build: " << buildTime << "us, "
+            << "build on " << TaskScheduler::instance().getNumWorkers()
+            << " workers: " << parallelBuildTime << "us" << std::endl;
+
+  expectBoxQueriesMatch(octree, octreeData, 4);
+}
+
+TEST(geOctree, Query_Batch) {
+  DebugOctreeData octreeData;
+  DebugOctree octree(Vector3::ZERO, 800.0f, &octreeData);
+  populateOctree(octree, octreeData, 20000);
+  octree.publishStagedWrites();
+
+  startTaskScheduler();
+
+  Vector<AABox> boxes;
+  for (uint32 i = 0; i < 500; ++i) {
+    Vector3 center(randomUnit() * 750.0f, randomUnit() * 750.0f, randomUnit() * 750.0f);
+    boxes.emplace_back(center - 40.0f, center + 40.0f);
+  }
+
+  //Each query only ever gets called back from one thread
+  Vector<Vector<uint32>> boxResults(boxes.size());
+  octree.queryBatch(boxes.data(), boxes.size(), [&](SIZE_T queryIdx, uint32 elem) {
+    boxResults[queryIdx].push_back(elem);
+  });
+
+  for (SIZE_T i = 0; i < boxes.size(); ++i) {
+    Vector<uint32> expected;
+    DebugOctree::BoxIntersectIterator interIter(octree, boxes[i]);
+    while (interIter.moveNext()) {
+      expected.push_back(interIter.getElement());
+    }
+    std::sort(expected.begin(), expected.end());
+    std::sort(boxResults[i].begin(), boxResults[i].end());
+    EXPECT_TRUE(boxResults[i] == expected);
+  }
+
+  Vector<Vector3> starts, ends;
+  for (auto& segment : makeSegments(500, 300.0f)) {
+    starts.push_back(segment.first);
+    ends.push_back(segment.second);
+  }
+
+  Vector<Vector<uint32>> rayResults(starts.size());
+  octree.queryBatch(starts.data(), ends.data(), starts.size(),
+                    [&](SIZE_T queryIdx, uint32 elem, float time) {
+    EXPECT_GE(time, 0.0f);
+    EXPECT_LE(time, 1.0f);
+    rayResults[queryIdx].push_back(elem);
+  });
+
+  for (SIZE_T i = 0; i < starts.size(); ++i) {
+    Vector<uint32> expected;
+    DebugOctree::RayIntersectIterator rayIter(octree, starts[i], ends[i]);
+    while (rayIter.moveNext()) {
+      expected.push_back(rayIter.getElement());
+    }
+    std::sort(expected.begin(), expected.end());
+    std::sort(rayResults[i].begin(), rayResults[i].end());
+    EXPECT_TRUE(rayResults[i] == expected);
+  }
+
+  Vector<Plane> planes = makeFrustum(1.0f, 600.0f);
+  Vector<DebugOctree::ConvexVolume> volumes;
+  for (uint32 i = 0; i < 64; ++i) {
+    //Same frustum, shifted along its view direction
+    Vector<Plane> shifted = planes;
+    for (auto& plane : shifted) {
+      plane.w += plane.x * (i * 10.0f - 300.0f);
+    }
+    volumes.emplace_back(shifted.data(), static_cast<uint32>(shifted.size()));
+  }
+
+  Vector<SIZE_T> volumeCounts(volumes.size(), 0);
+  octree.queryBatch(volumes.data(), volumes.size(), [&](SIZE_T queryIdx, uint32) {
+    ++volumeCounts[queryIdx];
+  });
+
+  for (SIZE_T i = 0; i < volumes.size(); ++i) {
+    EXPECT_EQ(volumeCounts[i], octree.findInVolume(volumes[i], nullptr, 0));
+  }
+}
+
+TEST(geOctree, Staged_Writes) {
+  DebugOctreeData octreeData;
+  DebugOctree octree(Vector3::ZERO, 800.0f, &octreeData);
+  populateOctree(octree, octreeData, 5000);
+  octree.publishStagedWrites();
+
+  startTaskScheduler();
+
+  Vector<AABox> boxes;
+  for (uint32 i = 0; i < 64; ++i) {
+    Vector3 center(randomUnit() * 750.0f, randomUnit() * 750.0f, randomUnit() * 750.0f);
+    boxes.emplace_back(center - 100.0f, center + 100.0f);
+  }
+
+  auto runQueries = [&]() {
+    Vector<Vector<uint32>> results(boxes.size());
+    octree.queryBatch(boxes.data(), boxes.size(), [&](SIZE_T queryIdx, uint32 elem) {
+      results[queryIdx].push_back(elem);
+    });
+
+    for (auto& result : results) {
+      std::sort(result.begin(), result.end());
+    }
+    return results;
+  };
+
+  Vector<Vector<uint32>> initialResults = runQueries();
+
+  //Elements to add, updated elements (some of them more than once or also
+  //removed) and removed elements
+  const uint32 firstAdded = static_cast<uint32>(octreeData.elements.size());
+  generateElements(octreeData, 500);
+
+  Vector<OctreeElementId> updateIds;
+  for (uint32 i = 0; i < 1000; ++i) {
+    AABox& box = octreeData.elements[i].box;
+    Vector3 offset = (i % 10) == 0 ?
+      Vector3(randomUnit(), randomUnit(), randomUnit()) * 700.0f - box.getCenter() :
+      Vector3(randomUnit(), randomUnit(), randomUnit()) * 3.0f;
+    box = AABox(box.m_min + offset, box.m_max + offset);
+    updateIds.push_back(octreeData.elements[i].octreeId);
+  }
+  for (uint32 i = 0; i < 100; ++i) {
+    updateIds.push_back(octreeData.elements[i].octreeId);
+  }
+
+  Vector<OctreeElementId> removeIds;
+  for (uint32 i = 900; i < 2000; ++i) {
+    removeIds.push_back(octreeData.elements[i].octreeId);
+    octreeData.elements[i].box = AABox(Vector3(5000.0f, 5000.0f, 5000.0f),
+                                       Vector3(5001.0f, 5001.0f, 5001.0f));
+  }
+
+  //Stage from several threads while the octree is being queried
+  Vector<SPtr<Task>> tasks;
+  for (uint32 t = 0; t < 4; ++t) {
+    tasks.push_back(Task::create("Staged_Writes", [&, t]() {
+      for (uint32 i = firstAdded + t; i < firstAdded + 500; i += 4) {
+        octree.stageAddElement(i);
+      }
+      for (SIZE_T i = t; i < updateIds.size(); i += 4) {
+        octree.stageUpdateElement(updateIds[i]);
+      }
+      for (SIZE_T i = t; i < removeIds.size(); i += 4) {
+        octree.stageRemoveElement(removeIds[i]);
+      }
+    }));
+    TaskScheduler::instance().addTask(tasks.back());
+  }
+
+  EXPECT_TRUE(runQueries() == initialResults);
+  for (auto& task : tasks) {
+    task->wait();
+  }
+
+  //Nothing changes until the writes are published
+  EXPECT_TRUE(runQueries() == initialResults);
+
+  octree.publishStagedWrites();
+  expectBoxQueriesMatch(octree, octreeData, 32);
+  EXPECT_TRUE(runQueries() == getSortedBoxResults(octree, boxes));
+
+  //Publishing again with nothing staged is a no-op
+  octree.publishStagedWrites();
+  expectBoxQueriesMatch(octree, octreeData, 8);
+}
+
+TEST(geOctree, Query_During_Publish) {
+  DebugOctreeData octreeData;
+  DebugOctree octree(Vector3::ZERO, 800.0f, &octreeData);
+  populateOctree(octree, octreeData, 20000);
+  octree.publishStagedWrites();
+
+  startTaskScheduler();
+
+  Vector<AABox> boxes;
+  for (uint32 i = 0; i < 64; ++i) {
+    Vector3 center(randomUnit() * 750.0f, randomUnit() * 750.0f, randomUnit() * 750.0f);
+    boxes.emplace_back(center - 100.0f, center + 100.0f);
+  }
+
+  auto runQueries = [&]() {
+    Vector<Vector<uint32>> results(boxes.size());
+    octree.queryBatch(boxes.data(), boxes.size(), [&](SIZE_T queryIdx, uint32 elem) {
+      results[queryIdx].push_back(elem);
+    });
+
+    for (auto& result : results) {
+      std::sort(result.begin(), result.end());
+    }
+    return results;
+  };
+
+  const Vector<Vector<uint32>> before = runQueries();
+
+  //Move a quarter of the elements somewhere else and remove some others
+  for (uint32 i = 0; i < 5000; ++i) {
+    AABox& box = octreeData.elements[i].box;
+    Vector3 offset = Vector3(randomUnit(), randomUnit(), randomUnit()) * 700.0f -
+                     box.getCenter();
+    box = AABox(box.m_min + offset, box.m_max + offset);
+    octree.stageUpdateElement(octreeData.elements[i].octreeId);
+  }
+  for (uint32 i = 5000; i < 6000; ++i) {
+    octree.stageRemoveElement(octreeData.elements[i].octreeId);
+  }
+
+  //Query on the workers for as long as the writes are being published
+  std::atomic<bool> querying(false);
+  std::atomic<bool> publishing(true);
+  Vector<Vector<Vector<uint32>>> during;
+  Thread querier([&]() {
+    querying = true;
+    do {
+      during.push_back(runQueries());
+    } while (publishing);
+  });
+
+  while (!querying) {
+    std::this_thread::yield();
+  }
+  octree.publishStagedWrites();
+  publishing = false;
+  querier.join();
+
+  const Vector<Vector<uint32>> after = getSortedBoxResults(octree, boxes);
+  EXPECT_TRUE(before != after);
+  EXPECT_TRUE(runQueries() == after);
+
+  //Each batch sees one snapshot, never a tree halfway through the writes
+  for (auto& results : during) {
+    EXPECT_TRUE(results == before || results == after);
+  }
+
+  std::cout << "Octree " << during.size()
+            << " query batches ran during publishStagedWrites()" << std::endl;
+}
+
+TEST(geOctree, Benchmark_Query_Batch) {
+  DebugOctreeData octreeData;
+  DebugOctree octree(Vector3::ZERO, 800.0f, &octreeData);
+  populateOctree(octree, octreeData, 200000);
+  octree.publishStagedWrites();
+
+  startTaskScheduler();
+
+  Vector<AABox> boxes;
+  for (uint32 i = 0; i < 16384; ++i) {
+    Vector3 center(randomUnit() * 750.0f, randomUnit() * 750.0f, randomUnit() * 750.0f);
+    boxes.emplace_back(center - 20.0f, center + 20.0f);
+  }
+
+  uint64 serialHits = 0;
+  Timer timer;
+  for (auto& box : boxes) {
+    DebugOctree::BoxIntersectIterator interIter(octree, box);
+    while (interIter.moveNext()) {
+      ++serialHits;
+    }
+  }
+  uint64 serialTime = timer.getMicroseconds();
+
+  std::atomic<uint64> batchHits(0);
+  timer.reset();
+  octree.queryBatch(boxes.data(), boxes.size(), [&](SIZE_T, uint32) {
+    batchHits.fetch_add(1, std::memory_order_relaxed);
+  });
+  uint64 batchTime = timer.getMicroseconds();
+
+  std::cout << "Octree " << boxes.size() << " box queries, "
+            << "BoxIntersectIterator loop: " << serialTime << "us, "
+            << "queryBatch on " << TaskScheduler::instance().getNumWorkers()
+            << " workers: " << batchTime << "us" << std::endl;
+
+  EXPECT_EQ(serialHits, batchHits.load());
+}
+
+TEST(geOctree, Baked_Octree) {
+  typedef BakedOctree<uint32, DebugOctreeOptions> DebugBakedOctree;
+
+  DebugOctreeData octreeData;
+  DebugOctree octree(Vector3::ZERO, 800.0f, &octreeData);
+  populateOctree(octree, octreeData, 20000);
+
+  //An element outside of the root bounds is still found
+  DebugOctreeElem outside;
+  outside.box = AABox(Vector3(900.0f, -5.0f, -5.0f), Vector3(910.0f, 5.0f, 5.0f));
+  octreeData.elements.push_back(outside);
+  octree.addElement(static_cast<uint32>(octreeData.elements.size() - 1));
+
+  DebugBakedOctree baked(octree);
+  EXPECT_EQ(baked.getNumElements(), octreeData.elements.size());
+
+  //A round trip through a stream, and a view of a copy of the raw block
+  auto stream = ge_shared_ptr_new<MemoryDataStream>(baked.getDataSize());
+  baked.save(stream);
+  stream->seek(0);
+
+  DebugBakedOctree loaded;
+  ASSERT_TRUE(loaded.load(stream));
+
+  auto block = reinterpret_cast<uint8*>(ge_alloc_aligned16(baked.getDataSize()));
+  memcpy(block, baked.getData(), baked.getDataSize());
+  DebugBakedOctree view;
+  ASSERT_TRUE(view.setData(block, baked.getDataSize()));
+
+  const DebugBakedOctree* bakedOctrees[] = { &baked, &loaded, &view };
+  for (auto bakedOctree : bakedOctrees) {
+    EXPECT_EQ(bakedOctree->getNumNodes(), baked.getNumNodes());
+
+    for (uint32 i = 0; i < 64; ++i) {
+      Vector3 center(randomUnit() * 750.0f, randomUnit() * 750.0f, randomUnit() * 750.0f);
+      AABox queryBounds(center - 60.0f, center + 60.0f);
+      if (0 == i) {
+        queryBounds = outside.box;
+      }
+
+      Vector<uint32> expected;
+      DebugOctree::BoxIntersectIterator interIter(octree, queryBounds);
+      while (interIter.moveNext()) {
+        expected.push_back(interIter.getElement());
+      }
+      std::sort(expected.begin(), expected.end());
+
+      Vector<uint32> found;
+      bakedOctree->forEachIntersecting(queryBounds, [&](uint32 elem) {
+        found.push_back(elem);
+      });
+      std::sort(found.begin(), found.end());
+
+      EXPECT_TRUE(found == expected);
+    }
+
+    for (auto& segment : makeSegments(64, 300.0f)) {
+      uint32 expectedElem = 0, hitElem = 0;
+      float expectedTime = 0.0f, hitTime = 0.0f;
+      const bool expectedHit = octree.findClosestHit(segment.first,
+                                                     segment.second,
+                                                     expectedElem,
+                                                     expectedTime);
+
+      EXPECT_EQ(bakedOctree->findClosestHit(segment.first,
+                                            segment.second,
+                                            hitElem,
+                                            hitTime),
+                expectedHit);
+      if (expectedHit) {
+        EXPECT_FLOAT_EQ(hitTime, expectedTime);
+      }
+    }
+
+    Vector<Plane> planes = makeFrustum(1.0f, 600.0f);
+    DebugOctree::ConvexVolume volume(planes.data(), static_cast<uint32>(planes.size()));
+    Vector<uint32> expected(octreeData.elements.size());
+    Vector<uint32> found(octreeData.elements.size());
+    SIZE_T expectedCount = octree.findInVolume(volume, expected.data(), expected.size());
+    SIZE_T count = bakedOctree->findInVolume(volume, found.data(), found.size());
+    ASSERT_EQ(count, expectedCount);
+
+    expected.resize(expectedCount);
+    found.resize(count);
+    std::sort(expected.begin(), expected.end());
+    std::sort(found.begin(), found.end());
+    EXPECT_TRUE(found == expected);
+  }
+
+  //Blocks that aren't a baked octree of this element type are rejected
+  DebugBakedOctree invalid;
+  EXPECT_FALSE(invalid.setData(block, 16));
+  EXPECT_FALSE(invalid.setData(block + 4, baked.getDataSize() - 16));
+  EXPECT_FALSE((BakedOctree<uint64, DebugOctreeOptions>().setData(block,
+                                                                 baked.getDataSize())));
+  memset(block, 0, sizeof(uint32));
+  EXPECT_FALSE(invalid.setData(block, baked.getDataSize()));
+  EXPECT_EQ(invalid.getNumElements(), 0U);
+  EXPECT_EQ(invalid.getData(), nullptr);
+  ge_free_aligned16(block);
+
+  //Files with a node pointing outside of the block don't load
+  auto loadWithRootField = [&](uint32 field, uint32 value) {
+    Vector<uint8> bytes(baked.getData(), baked.getData() + baked.getDataSize());
+    uint32 nodesOffset = 0;
+    memcpy(&nodesOffset, &bytes[6 * sizeof(uint32)], sizeof(uint32));
+    memcpy(&bytes[nodesOffset + field * sizeof(uint32)], &value, sizeof(uint32));
+
+    auto corruptStream = ge_shared_ptr_new<MemoryDataStream>(bytes.data(),
+                                                             bytes.size(),
+                                                             false);
+    DebugBakedOctree corrupted;
+    const bool loaded = corrupted.load(corruptStream);
+    EXPECT_EQ(corrupted.getData() != nullptr, loaded);
+    return loaded;
+  };
+
+  const uint32 firstChildField = 4;
+  const uint32 numChildrenField = 5;
+  const uint32 firstQuadField = 6;
+  EXPECT_TRUE(loadWithRootField(firstChildField, 1));
+  EXPECT_FALSE(loadWithRootField(firstChildField, baked.getNumNodes()));
+  EXPECT_FALSE(loadWithRootField(firstChildField, 0));
+  EXPECT_FALSE(loadWithRootField(numChildrenField, 9));
+  EXPECT_FALSE(loadWithRootField(firstQuadField, 0xFFFFFFFF));
+}
+
+TEST(geOctree, Benchmark_Baked_Octree) {
+  DebugOctreeData octreeData;
+  DebugOctree octree(Vector3::ZERO, 800.0f, &octreeData);
+  populateOctree(octree, octreeData, 200000);
+
+  Timer timer;
+  BakedOctree<uint32, DebugOctreeOptions> baked(octree);
+  uint64 bakeTime = timer.getMicroseconds();
+
+  Vector<AABox> boxes;
+  for (uint32 i = 0; i < 16384; ++i) {
+    Vector3 center(randomUnit() * 750.0f, randomUnit() * 750.0f, randomUnit() * 750.0f);
+    boxes.emplace_back(center - 20.0f, center + 20.0f);
+  }
+  auto segments = makeSegments(16384, 200.0f);
+
+  uint64 liveHits = 0;
+  timer.reset();
+  for (auto& box : boxes) {
+    DebugOctree::BoxIntersectIterator interIter(octree, box);
+    while (interIter.moveNext()) {
+      ++liveHits;
+    }
+  }
+  uint64 liveBoxTime = timer.getMicroseconds();
+
+  uint64 bakedHits = 0;
+  timer.reset();
+  for (auto& box : boxes) {
+    baked.forEachIntersecting(box, [&](uint32) {
+      ++bakedHits;
+    });
+  }
+  uint64 bakedBoxTime = timer.getMicroseconds();
+
+  uint32 hitElem = 0;
+  float hitTime = 0.0f;
+  uint32 liveRayHits = 0;
+  timer.reset();
+  for (auto& segment : segments) {
+    liveRayHits += octree.findClosestHit(segment.first, segment.second, hitElem, hitTime) ? 1 : 0;
+  }
+  uint64 liveRayTime = timer.getMicroseconds();
+
+  uint32 bakedRayHits = 0;
+  timer.reset();
+  for (auto& segment : segments) {
+    bakedRayHits += baked.findClosestHit(segment.first, segment.second, hitElem, hitTime) ? 1 : 0;
+  }
+  uint64 bakedRayTime = timer.getMicroseconds();
+
+  std::cout << "BakedOctree bake: " << bakeTime << "us (" << baked.getDataSize() << " bytes); "
+            << boxes.size() << " box queries, Octree: " << liveBoxTime << "us, "
+            << "BakedOctree: " << bakedBoxTime << "us; "
+            << segments.size() << " closest hits, Octree: " << liveRayTime << "us, "
+            << "BakedOctree: " << bakedRayTime << "us" << std::endl;
+
+  EXPECT_EQ(liveHits, bakedHits);
+  EXPECT_EQ(liveRayHits, bakedRayHits);
+}
+
+TEST(geOctree, Octree_Stats) {
+  DebugOctreeData octreeData;
+  DebugOctree octree(Vector3::ZERO, 800.0f, &octreeData);
+  populateOctree(octree, octreeData, 20000);
+
+  OctreeStats stats = octree.getStats();
+  EXPECT_EQ(stats.numElements, octreeData.elements.size());
+  EXPECT_LE(stats.numNonLeafElements, stats.numElements);
+  EXPECT_LT(stats.numLeafNodes, stats.numNodes);
+  EXPECT_LE(stats.nodesPerDepth.size(), static_cast<SIZE_T>(DebugOctreeOptions::maxDepth) + 1);
+  EXPECT_EQ(1U, stats.nodesPerDepth[0]);
+  EXPECT_GT(stats.nodeMemory, 0U);
+  EXPECT_GT(stats.elementMemory, 0U);
+  EXPECT_GT(stats.elementBoundsMemory, 0U);
+
+  uint32 nodesInDepths = 0;
+  uint32 elementsInDepths = 0;
+  for (SIZE_T i = 0; i < stats.nodesPerDepth.size(); ++i) {
+    nodesInDepths += stats.nodesPerDepth[i];
+    elementsInDepths += stats.elementsPerDepth[i];
+  }
+  EXPECT_EQ(stats.numNodes, nodesInDepths);
+  EXPECT_EQ(stats.numElements, elementsInDepths);
+
+  uint32 nodesInCounts = 0;
+  uint32 elementsInCounts = 0;
+  for (SIZE_T i = 0; i < stats.nodesPerElementCount.size(); ++i) {
+    nodesInCounts += stats.nodesPerElementCount[i];
+    elementsInCounts += stats.nodesPerElementCount[i] * static_cast<uint32>(i);
+  }
+  EXPECT_EQ(stats.numNodes, nodesInCounts);
+  EXPECT_EQ(stats.numElements, elementsInCounts);
+
+  //Every box query visits the root at least
+  octree.resetQueryStats();
+  const uint32 numQueries = 16;
+  expectBoxQueriesMatch(octree, octreeData, numQueries);
+
+  stats = octree.getStats();
+  if (stats.queryStatsEnabled) {
+    const OctreeQueryStats& boxStats = stats.queries[OCTREE_QUERY::kBox];
+    EXPECT_EQ(numQueries, boxStats.numQueries);
+    EXPECT_GE(boxStats.numNodesVisited, numQueries);
+    EXPECT_EQ(0U, stats.queries[OCTREE_QUERY::kRay].numQueries);
+
+    octree.resetQueryStats();
+    stats = octree.getStats();
+    EXPECT_EQ(0U, stats.queries[OCTREE_QUERY::kBox].numQueries);
+    EXPECT_EQ(0U, stats.queries[OCTREE_QUERY::kBox].numNodesVisited);
+  }
+
+  nlohmann::json parsed = nlohmann::json::parse(stats.toJSON().c_str());
+  EXPECT_EQ(stats.numNodes, parsed["numNodes"].get<uint32>());
+  EXPECT_EQ(stats.numElements, parsed["numElements"].get<uint32>());
+  EXPECT_EQ(stats.nodesPerDepth.size(), parsed["nodesPerDepth"].size());
+  EXPECT_EQ(stats.elementMemory, parsed["memory"]["elements"].get<SIZE_T>());
+  EXPECT_EQ(stats.queryStatsEnabled, parsed.count("queries") > 0);
+}
@@ -0,0 +1,322 @@
+#include <vld.h>
+
+#define GTEST_HAS_TR1_TUPLE 0
+#define GTEST_USE_OWN_TR1_TUPLE 0
+#include <gtest/gtest.h>
+
+#include <gePrerequisitesUtil.h>
+#include <gePerformanceReport.h>
+#include <geProfilerCPU.h>
+#include <geTaskScheduler.h>
+#include <geThreadPool.h>
+#include <geTime.h>
+#include <geTimer.h>
+
+using namespace geEngineSDK;
+
+namespace {
+  /**
+   * @brief Starts the modules a capture reads the first time a test needs
+   *        them. Modules can't be restarted, so they keep running until all
+   *        tests are done.
+   */
+  void
+  startModules() {
+    if (!ThreadPool::isStarted()) {
+      ThreadPool::startUp<TThreadPool<>>(4, 64);
+    }
+    if (!TaskScheduler::isStarted()) {
+      TaskScheduler::startUp();
+    }
+    if (!Time::isStarted()) {
+      Time::startUp();
+    }
+    if (!ProfilerCPU::isStarted()) {
+      ProfilerCPU::startUp();
+    }
+  }
+
+  class PerformanceReportEnvironment : public ::testing::Environment
+  {
+   public:
+    void
+    TearDown() override {
+      if (ProfilerCPU::isStarted()) {
+        ProfilerCPU::shutDown();
+      }
+      if (Time::isStarted()) {
+        Time::shutDown();
+      }
+      if (TaskScheduler::isStarted()) {
+        TaskScheduler::shutDown();
+      }
+      if (ThreadPool::isStarted()) {
+        ThreadPool::shutDown();
+      }
+    }
+  };
+
+  ::testing::Environment* const performanceReportEnvironment =
+    ::testing::AddGlobalTestEnvironment(new PerformanceReportEnvironment());
+
+  void
+  reportedWork(uint32& counter) {
+    GE_PROFILE_SCOPE("Reported<Work>");
+    for (uint32 i = 0; i < 1000; ++i) {
+      counter += i;
+    }
+  }
+
+  PerformanceZoneStats
+  makeZone(const char* name, uint64 avgTime, uint64 p99Time) {
+    PerformanceZoneStats zone;
+    zone.name = name;
+    zone.numCalls = 10;
+    zone.totalTime = avgTime * 10;
+    zone.minTime = avgTime / 2;
+    zone.avgTime = avgTime;
+    zone.maxTime = p99Time;
+    zone.p99Time = p99Time;
+    return zone;
+  }
+
+  /**
+   * @brief Returns the row of an HTML report that starts with @p firstCell.
+   */
+  String
+  findRow(const String& html, const String& firstCell) {
+    SIZE_T cellPos = html.find(R"(<div class="cell">)" + firstCell + "</div>");
+    if (String::npos == cellPos) {
+      return StringUtil::BLANK;
+    }
+
+    SIZE_T rowPos = html.rfind(R"(<div class="row)", cellPos);
+    SIZE_T rowEnd = html.find(R"(<div class="row)", cellPos);
+    return html.substr(rowPos, rowEnd - rowPos);
+  }
+}
+
+TEST(gePerformanceReport, Frame_Histogram) {
+  FrameTimeHistogram histogram;
+  for (uint32 i = 0; i < 98; ++i) {
+    histogram.addFrame(16000 + i);
+  }
+  FrameTimeHistogram earlier = histogram;
+  histogram.addFrame(33500);
+  histogram.addFrame(250000);
+
+  EXPECT_EQ(100U, histogram.numFrames);
+  EXPECT_EQ(98U, histogram.counts[16]);
+  EXPECT_EQ(1U, histogram.counts[33]);
+  EXPECT_EQ(1U, histogram.counts[FrameTimeHistogram::NUM_BUCKETS - 1]);
+
+  EXPECT_EQ(17000U, histogram.getPercentile(0.5f));
+  EXPECT_EQ(34000U, histogram.getPercentile(0.99f));
+  EXPECT_EQ(FrameTimeHistogram::NUM_BUCKETS * FrameTimeHistogram::BUCKET_WIDTH,
+            histogram.getPercentile(1.0f));
+
+  FrameTimeHistogram recent = histogram.since(earlier);
+  EXPECT_EQ(2U, recent.numFrames);
+  EXPECT_EQ(0U, recent.counts[16]);
+  EXPECT_EQ(33500U + 250000U, recent.totalTime);
+  EXPECT_EQ((33500U + 250000U) / 2, recent.getAverage());
+}
+
+TEST(gePerformanceReport, Capture) {
+  startModules();
+  ProfilerCPU& profiler = ProfilerCPU::instance();
+  profiler.endFrame();
+
+  const uint32 numFrames = 10;
+  const uint32 numTasks = 8;
+
+  PerformanceReport report;
+  report.beginCapture();
+
+  uint32 counter = 0;
+  for (uint32 frame = 0; frame < numFrames; ++frame) {
+    Vector<SPtr<Task>> tasks;
+    for (uint32 i = 0; i < numTasks; ++i) {
+      tasks.push_back(Task::create("Work", []() {
+        uint32 taskCounter = 0;
+        reportedWork(taskCounter);
+      }));
+      TaskScheduler::instance().addTask(tasks.back());
+    }
+
+    for (uint32 i = 0; i < 10; ++i) {
+      reportedWork(counter);
+    }
+
+    for (auto& task : tasks) {
+      task->wait();
+    }
+
+    uint8* memory = reinterpret_cast<uint8*>(ge_alloc(64));
+    ge_free(memory);
+
+    g_time()._update();
+    profiler.endFrame();
+  }
+
+  PerformanceCapture capture = report.endCapture("Capture test");
+  EXPECT_EQ("Capture test", capture.name);
+  EXPECT_GT(capture.duration, 0U);
+  EXPECT_EQ(numFrames, capture.frameTimes.numFrames);
+  EXPECT_GE(capture.numAllocs, numFrames);
+  EXPECT_GE(capture.numFrees, numFrames);
+
+  ASSERT_TRUE(capture.hasTaskScheduler);
+  EXPECT_EQ(numFrames * numTasks, capture.numTasksCompleted);
+  EXPECT_GE(capture.peakQueueDepth, 1U);
+  EXPECT_GT(capture.avgQueueDepth, 0.0f);
+  EXPECT_GT(capture.utilization, 0.0f);
+
+  //Work of the tasks and of this thread is reported together
+  const PerformanceZoneStats* workZone = nullptr;
+  for (auto& zone : capture.zones) {
+    if ("Reported<Work>" == zone.name) {
+      workZone = &zone;
+    }
+  }
+  ASSERT_NE(nullptr, workZone);
+  EXPECT_EQ(numFrames * (numTasks + 10), workZone->numCalls);
+  EXPECT_LE(workZone->minTime, workZone->avgTime);
+  EXPECT_LE(workZone->avgTime, workZone->maxTime);
+  EXPECT_LE(workZone->p99Time, workZone->maxTime);
+  EXPECT_GE(workZone->p99Time, workZone->minTime);
+
+  for (SIZE_T i = 1; i < capture.zones.size(); ++i) {
+    EXPECT_GE(capture.zones[i - 1].totalTime, capture.zones[i].totalTime);
+  }
+
+  String html = PerformanceReport::toHtml(capture);
+  EXPECT_NE(String::npos, html.find("../css/debug.css"));
+  EXPECT_NE(String::npos, html.find("Reported&lt;Work&gt;"));
+  EXPECT_EQ(String::npos, html.find("Reported<Work>"));
+  EXPECT_NE(String::npos, html.find("Task scheduler"));
+  EXPECT_NE(String::npos, html.find("Frame times"));
+}
+
+TEST(gePerformanceReport, Json_Round_Trip) {
+  PerformanceCapture capture;
+  capture.name = "Build \"A\"";
+  capture.duration = 123456;
+  capture.numAllocs = 42;
+  capture.numFrees = 40;
+  capture.zones.push_back(makeZone("Update", 2000, 4000));
+  capture.zones.push_back(makeZone("Render", 1000, 1500));
+  capture.hasTaskScheduler = true;
+  capture.numWorkers = 8;
+  capture.peakQueueDepth = 12;
+  capture.avgQueueDepth = 3.5f;
+  capture.numTasksCompleted = 300;
+  capture.utilization = 0.75f;
+  capture.frameTimes.addFrame(16000);
+  capture.frameTimes.addFrame(17000);
+
+  PerformanceCapture loaded;
+  ASSERT_TRUE(PerformanceReport::fromJson(PerformanceReport::toJson(capture), loaded));
+  EXPECT_EQ(capture.name, loaded.name);
+  EXPECT_EQ(capture.duration, loaded.duration);
+  EXPECT_EQ(capture.numAllocs, loaded.numAllocs);
+  EXPECT_EQ(capture.numFrees, loaded.numFrees);
+
+  ASSERT_EQ(2U, loaded.zones.size());
+  EXPECT_EQ("Render", loaded.zones[1].name);
+  EXPECT_EQ(capture.zones[1].totalTime, loaded.zones[1].totalTime);
+  EXPECT_EQ(capture.zones[1].p99Time, loaded.zones[1].p99Time);
+
+  EXPECT_TRUE(loaded.hasTaskScheduler);
+  EXPECT_EQ(capture.peakQueueDepth, loaded.peakQueueDepth);
+  EXPECT_FLOAT_EQ(capture.avgQueueDepth, loaded.avgQueueDepth);
+  EXPECT_FLOAT_EQ(capture.utilization, loaded.utilization);
+
+  EXPECT_EQ(2U, loaded.frameTimes.numFrames);
+  EXPECT_EQ(capture.frameTimes.totalTime, loaded.frameTimes.totalTime);
+  EXPECT_EQ(1U, loaded.frameTimes.counts[16]);
+  EXPECT_EQ(1U, loaded.frameTimes.counts[17]);
+
+  EXPECT_FALSE(PerformanceReport::fromJson("{ not json", loaded));
+  EXPECT_FALSE(PerformanceReport::fromJson("[1, 2, 3]", loaded));
+  EXPECT_FALSE(PerformanceReport::fromJson(R"({ "zones": 5, "frameTimes": {} })", loaded));
+}
+
+TEST(gePerformanceReport, Diff) {
+  PerformanceCapture baseline;
+  baseline.name = "Baseline";
+  baseline.zones.push_back(makeZone("Slower", 1000, 2000));
+  baseline.zones.push_back(makeZone("Faster", 1000, 2000));
+  baseline.zones.push_back(makeZone("Same", 1000, 2000));
+  baseline.zones.push_back(makeZone("Removed", 1000, 2000));
+  for (uint32 i = 0; i < 100; ++i) {
+    baseline.frameTimes.addFrame(16500);
+  }
+
+  PerformanceCapture current;
+  current.name = "Current";
+  current.zones.push_back(makeZone("Slower", 1050, 3000));
+  current.zones.push_back(makeZone("Faster", 500, 1000));
+  current.zones.push_back(makeZone("Same", 1020, 2020));
+  current.zones.push_back(makeZone("Added", 1000, 2000));
+  for (uint32 i = 0; i < 100; ++i) {
+    current.frameTimes.addFrame(16500);
+  }
+
+  String html = PerformanceReport::toHtmlDiff(baseline, current, 0.1f);
+  EXPECT_NE(String::npos, html.find("../css/debug.css"));
+
+  //Only the p99 of this zone regressed, which is enough to flag it
+  EXPECT_EQ(0U, findRow(html, "Slower").find(R"(<div class="row red">)"));
+  EXPECT_NE(String::npos, findRow(html, "Slower").find("+50.0%"));
+  EXPECT_EQ(0U, findRow(html, "Faster").find(R"(<div class="row green">)"));
+  EXPECT_EQ(0U, findRow(html, "Same").find(R"(<div class="row">)"));
+  EXPECT_EQ(0U, findRow(html, "Added").find(R"(<div class="row yellow">)"));
+  EXPECT_NE(String::npos, findRow(html, "Removed").find("Removed</div>"));
+  EXPECT_EQ(0U, findRow(html, "Average frame time").find(R"(<div class="row">)"));
+}
+
+TEST(gePerformanceReport, Benchmark_Capture) {
+  startModules();
+  ProfilerCPU& profiler = ProfilerCPU::instance();
+  profiler.endFrame();
+
+  const uint32 numFrames = 16;
+  const uint32 zonesPerFrame = 8 * 1024;
+
+  PerformanceReport report;
+  report.beginCapture();
+
+  uint32 counter = 0;
+  for (uint32 frame = 0; frame < numFrames; ++frame) {
+    for (uint32 i = 0; i < zonesPerFrame; ++i) {
+      GE_PROFILE_SCOPE("Benchmark");
+      ++counter;
+    }
+    g_time()._update();
+    profiler.endFrame();
+  }
+
+  Timer timer;
+  PerformanceCapture capture = report.endCapture("Benchmark");
+  uint64 captureTime = timer.getMicroseconds();
+
+  timer.reset();
+  String html = PerformanceReport::toHtml(capture);
+  String text = PerformanceReport::toJson(capture);
+  uint64 writeTime = timer.getMicroseconds();
+
+  std::cout << numFrames * zonesPerFrame << " zone calls, endCapture: " << captureTime
+            << "us, HTML and JSON: " << writeTime << "us (" << html.size() + text.size()
+            << " bytes)" << std::endl;
+
+  //Workers of earlier tests may still end a zone in the first frame
+  const PerformanceZoneStats* benchmarkZone = nullptr;
+  for (auto& zone : capture.zones) {
+    if ("Benchmark" == zone.name) {
+      benchmarkZone = &zone;
+    }
+  }
+  ASSERT_NE(nullptr, benchmarkZone);
+  EXPECT_EQ(numFrames * zonesPerFrame, benchmarkZone->numCalls);
+}
@@ -0,0 +1,347 @@
+#include <vld.h>
+
+#define GTEST_HAS_TR1_TUPLE 0
+#define GTEST_USE_OWN_TR1_TUPLE 0
+#include <gtest/gtest.h>
+
+#include <gePrerequisitesUtil.h>
+#include <geOctree.h>
+#include <geProfilerCPU.h>
+#include <geTimer.h>
+#include <json.hpp>
+
+using namespace geEngineSDK;
+
+namespace {
+  /**
+   * @brief Starts the profiler the first time a test needs it. Modules can't
+   *        be restarted, so it keeps running until all tests are done.
+   */
+  ProfilerCPU&
+  startProfiler() {
+    if (!ProfilerCPU::isStarted()) {
+      ProfilerCPU::startUp();
+    }
+
+    //Start every test from an empty frame
+    ProfilerCPU::instance().endFrame();
+    return ProfilerCPU::instance();
+  }
+
+  class ProfilerEnvironment : public ::testing::Environment
+  {
+   public:
+    void
+    TearDown() override {
+      if (ProfilerCPU::isStarted()) {
+        ProfilerCPU::shutDown();
+      }
+    }
+  };
+
+  ::testing::Environment* const profilerEnvironment =
+    ::testing::AddGlobalTestEnvironment(new ProfilerEnvironment());
+
+  void
+  innerWork(uint32& counter) {
+    GE_PROFILE_SCOPE("Inner");
+    for (uint32 i = 0; i < 1000; ++i) {
+      counter += i;
+    }
+  }
+
+  void
+  outerWork(uint32& counter) {
+    GE_PROFILE_SCOPE("Outer");
+    for (uint32 i = 0; i < 3; ++i) {
+      innerWork(counter);
+    }
+  }
+
+  /**
+   * @brief Returns the node of the zone with the given name, or nullptr.
+   */
+  const ProfilerNode*
+  findNode(const ProfilerThreadFrame& thread, const char* name) {
+    for (auto& node : thread.nodes) {
+      if (0 == strcmp(node.zone->name, name)) {
+        return &node;
+      }
+    }
+
+    return nullptr;
+  }
+
+  struct ProfiledOctreeOptions
+  {
+    enum { loosePadding = 16 };
+    enum { minElementsPerNode = 8 };
+    enum { maxElementsPerNode = 16 };
+    enum { maxDepth = 12 };
+
+    static simd::AABox
+    getBounds(uint32 elem, void*) {
+      Vector3 position(static_cast<float>(elem % 100), static_cast<float>(elem / 100), 0.0f);
+      return simd::AABox(AABox(position - Vector3::UNIT, position + Vector3::UNIT));
+    }
+
+    static void
+    setElementId(uint32, const OctreeElementId&, void*) {}
+  };
+}
+
+TEST(geProfilerCPU, Call_Tree) {
+  ProfilerCPU& profiler = startProfiler();
+
+  uint32 counter = 0;
+  outerWork(counter);
+  outerWork(counter);
+  profiler.endFrame();
+
+  ProfilerFrame frame = profiler.getLastFrame();
+  EXPECT_LE(frame.startTime, frame.endTime);
+  ASSERT_EQ(1U, frame.threads.size());
+
+  const ProfilerThreadFrame& thread = frame.threads[0];
+  ASSERT_EQ(2U, thread.nodes.size());
+
+  const ProfilerNode& outer = thread.nodes[0];
+  const ProfilerNode& inner = thread.nodes[1];
+  EXPECT_STREQ("Outer", outer.zone->name);
+  EXPECT_EQ(ProfilerNode::INVALID_IDX, outer.parent);
+  EXPECT_EQ(1U, outer.firstChild);
+  EXPECT_EQ(2U, outer.numCalls);
+
+  EXPECT_STREQ("Inner", inner.zone->name);
+  EXPECT_EQ(0U, inner.parent);
+  EXPECT_EQ(6U, inner.numCalls);
+
+  EXPECT_GE(outer.totalTime, inner.totalTime);
+  EXPECT_EQ(outer.totalTime - inner.totalTime, outer.selfTime);
+  EXPECT_EQ(inner.totalTime, inner.selfTime);
+  EXPECT_LE(inner.minTime, inner.maxTime);
+  EXPECT_LE(inner.maxTime, inner.totalTime);
+
+  //Nothing was recorded since
+  profiler.endFrame();
+  EXPECT_TRUE(profiler.getLastFrame().threads.empty());
+  EXPECT_EQ(0U, profiler.getNumDroppedEvents());
+}
+
+TEST(geProfilerCPU, Zone_Across_Frames) {
+  ProfilerCPU& profiler = startProfiler();
+
+  uint32 counter = 0;
+  {
+    GE_PROFILE_SCOPE("Long");
+    innerWork(counter);
+    profiler.endFrame();
+
+    ProfilerFrame firstFrame = profiler.getLastFrame();
+    ASSERT_EQ(1U, firstFrame.threads.size());
+    const ProfilerNode* longNode = findNode(firstFrame.threads[0], "Long");
+    ASSERT_NE(nullptr, longNode);
+    EXPECT_EQ(1U, longNode->numCalls);
+    EXPECT_EQ(0U, longNode->maxTime);
+    EXPECT_LE(longNode->totalTime, firstFrame.endTime - firstFrame.startTime);
+
+    innerWork(counter);
+  }
+  profiler.endFrame();
+
+  //The zone continues in the second frame without counting a new call
+  ProfilerFrame secondFrame = profiler.getLastFrame();
+  ASSERT_EQ(1U, secondFrame.threads.size());
+  const ProfilerThreadFrame& thread = secondFrame.threads[0];
+
+  const ProfilerNode* longNode = findNode(thread, "Long");
+  const ProfilerNode* innerNode = findNode(thread, "Inner");
+  ASSERT_NE(nullptr, longNode);
+  ASSERT_NE(nullptr, innerNode);
+  EXPECT_EQ(0U, longNode->numCalls);
+  EXPECT_EQ(1U, innerNode->numCalls);
+  EXPECT_EQ(&thread.nodes[innerNode->parent], longNode);
+  EXPECT_GT(longNode->maxTime, 0U);
+}
+
+TEST(geProfilerCPU, Threads) {
+  ProfilerCPU& profiler = startProfiler();
+
+  uint32 counter = 0;
+  outerWork(counter);
+
+  Thread worker([&profiler]() {
+    profiler.setThreadName("Worker");
+    uint32 workerCounter = 0;
+    innerWork(workerCounter);
+  });
+  worker.join();
+
+  profiler.endFrame();
+
+  ProfilerFrame frame = profiler.getLastFrame();
+  ASSERT_EQ(2U, frame.threads.size());
+
+  const ProfilerThreadFrame* workerThread = nullptr;
+  for (auto& thread : frame.threads) {
+    if ("Worker" == thread.threadName) {
+      workerThread = &thread;
+    }
+  }
+
+  ASSERT_NE(nullptr, workerThread);
+  ASSERT_EQ(1U, workerThread->nodes.size());
+  EXPECT_STREQ("Inner", workerThread->nodes[0].zone->name);
+  EXPECT_EQ(ProfilerNode::INVALID_IDX, workerThread->nodes[0].parent);
+}
+
+TEST(geProfilerCPU, Instrumented_Octree) {
+  ProfilerCPU& profiler = startProfiler();
+
+  Vector<uint32> elements(10000);
+  for (uint32 i = 0; i < elements.size(); ++i) {
+    elements[i] = i;
+  }
+
+  Octree<uint32, ProfiledOctreeOptions> octree(Vector3(50.0f, 50.0f, 0.0f), 100.0f);
+  octree.build(elements.data(), elements.size());
+  profiler.endFrame();
+
+  ProfilerFrame frame = profiler.getLastFrame();
+  ASSERT_FALSE(frame.threads.empty());
+  const ProfilerNode* buildNode = findNode(frame.threads[0], "Octree::build");
+  ASSERT_NE(nullptr, buildNode);
+  EXPECT_EQ(1U, buildNode->numCalls);
+}
+
+TEST(geProfilerCPU, Chrome_Trace) {
+  ProfilerCPU& profiler = startProfiler();
+
+  uint32 counter = 0;
+  outerWork(counter);
+  profiler.endFrame();
+
+  profiler.beginCapture();
+  for (uint32 i = 0; i < 3; ++i) {
+    outerWork(counter);
+    profiler.endFrame();
+  }
+  profiler.endCapture();
+
+  outerWork(counter);
+  profiler.endFrame();
+
+  Vector<ProfilerSpan> spans = profiler.getCapturedSpans();
+  ASSERT_EQ(12U, spans.size());
+  for (auto& span : spans) {
+    EXPECT_LE(span.startTime, span.endTime);
+  }
+
+  String text = profiler.getChromeTrace();
+  nlohmann::json trace = nlohmann::json::parse(text.c_str());
+  ASSERT_TRUE(trace["traceEvents"].is_array());
+
+  uint32 numOuter = 0;
+  uint32 numInner = 0;
+  uint32 numFrames = 0;
+  uint32 numThreadNames = 0;
+  for (auto& event : trace["traceEvents"]) {
+    const std::string phase = event["ph"];
+    const std::string name = event["name"];
+    if ("X" == phase) {
+      EXPECT_GE(event["dur"].get<double>(), 0.0);
+      numOuter += "Outer" == name ? 1 : 0;
+      numInner += "Inner" == name ? 1 : 0;
+    }
+    else if ("i" == phase) {
+      ++numFrames;
+    }
+    else if ("M" == phase) {
+      ++numThreadNames;
+    }
+  }
+
+  EXPECT_EQ(3U, numOuter);
+  EXPECT_EQ(9U, numInner);
+  EXPECT_EQ(4U, numFrames);
+  EXPECT_GE(numThreadNames, 1U);
+}
+
+TEST(geProfilerCPU, Benchmark_Zone) {
+  ProfilerCPU& profiler = startProfiler();
+
+  //Two events per zone, end frames before the thread buffer fills up
+  const uint32 zonesPerFrame = 16 * 1024;
+  const uint32 numZones = 16 * zonesPerFrame;
+
+  //Each zone reads the counter twice, which costs what the processor (or
+  //hypervisor) makes it cost. The rest of a zone must stay under 20 ns.
+  const double zoneBudget = 20.0;
+
+  auto runRound = [&](auto func) {
+    uint64 time = 0;
+    for (uint32 i = 0; i < numZones; i += zonesPerFrame) {
+      CycleTimer timer;
+      for (uint32 j = 0; j < zonesPerFrame; ++j) {
+        func();
+      }
+      time += timer.getNanoseconds();
+      profiler.endFrame();
+    }
+    return time / static_cast<double>(numZones);
+  };
+
+  //Best of a few rounds, so other processes don't make the test fail
+  auto measure = [&](auto func) {
+    double best = std::numeric_limits<double>::max();
+    for (uint32 round = 0; round < 5; ++round) {
+      best = std::min(best, runRound(func));
+    }
+    return best;
+  };
+
+  //The cost of the counter drifts, each round measures the counter reads
+  //right before the zones so both see the same cost
+  uint64 sum = 0;
+  double counterTime = 0.0;
+  double zoneTime = std::numeric_limits<double>::max();
+
+  //The flight records of the zones are bound by their own benchmark
+  FlightRecorder::setEnabled(false);
+  for (uint32 round = 0; round < 5; ++round) {
+    const double roundCounterTime = runRound([&]() {
+      sum += CycleTimer::now();
+      sum += CycleTimer::now();
+    });
+    const double roundZoneTime = runRound([]() {
+      GE_PROFILE_SCOPE("Benchmark");
+    });
+
+    if (roundZoneTime - roundCounterTime < zoneTime - counterTime) {
+      counterTime = roundCounterTime;
+      zoneTime = roundZoneTime;
+    }
+  }
+  FlightRecorder::setEnabled(true);
+  EXPECT_GT(sum, 0U);
+  EXPECT_LT(zoneTime - counterTime, zoneBudget);
+
+  const double recordedZoneTime = measure([]() {
+    GE_PROFILE_SCOPE("Benchmark");
+  });
+
+  profiler.setEnabled(false);
+  const double disabledTime = measure([]() {
+    GE_PROFILE_SCOPE("Benchmark");
+  });
+  profiler.setEnabled(true);
+
+  std::cout << "ns per zone, " << numZones << " zones: "
+            << "counter reads: " << counterTime << ", "
+            << "enabled: " << zoneTime << " (without the counter: "
+            << zoneTime - counterTime << "), "
+            << "with flight records: " << recordedZoneTime << ", "
+            << "disabled: " << disabledTime << std::endl;
+
+  EXPECT_EQ(0U, profiler.getNumDroppedEvents());
+}
@@ -0,0 +1,258 @@
+#include <vld.h>
+#include <DirectXMath.h>
+
+#define GTEST_HAS_TR1_TUPLE 0
+#define GTEST_USE_OWN_TR1_TUPLE 0
+#include <gtest/gtest.h>
+
+#include <gePrerequisitesUtil.h>
+#include <geOctree.h>
+#include <geQuadtree.h>
+#include <geTimer.h>
+
+#include "geSpatialTestUtil.h"
+
+using namespace geEngineSDK;
+using namespace geSpatialTest;
+
+struct DebugQuadtreeElem
+{
+  Box2D box;
+  mutable QuadtreeElementId quadtreeId;
+  mutable OctreeElementId octreeId;
+};
+
+struct DebugQuadtreeData
+{
+  Vector<DebugQuadtreeElem> elements;
+};
+
+struct DebugQuadtreeOptions
+{
+  enum { loosePadding = 16 };
+  enum { minElementsPerNode = 8 };
+  enum { maxElementsPerNode = 16 };
+  enum { maxDepth = 12 };
+
+  static simd::Box2D
+  getBounds(uint32 elem, void* context) {
+    DebugQuadtreeData* quadtreeData = reinterpret_cast<DebugQuadtreeData*>(context);
+    return simd::Box2D(quadtreeData->elements[elem].box);
+  }
+
+  static void
+  setElementId(uint32 elem, const QuadtreeElementId& id, void* context) {
+    DebugQuadtreeData* quadtreeData = reinterpret_cast<DebugQuadtreeData*>(context);
+    quadtreeData->elements[elem].quadtreeId = id;
+  }
+};
+
+/**
+ * @brief Stores the same elements in an Octree, flat on the Z axis, to
+ *        compare both trees on 2D workloads.
+ */
+struct FlatOctreeOptions
+{
+  enum { loosePadding = 16 };
+  enum { minElementsPerNode = 8 };
+  enum { maxElementsPerNode = 16 };
+  enum { maxDepth = 12 };
+
+  static simd::AABox
+  getBounds(uint32 elem, void* context) {
+    DebugQuadtreeData* quadtreeData = reinterpret_cast<DebugQuadtreeData*>(context);
+    const Box2D& box = quadtreeData->elements[elem].box;
+    return simd::AABox(AABox(Vector3(box.m_min.x, box.m_min.y, 0.0f),
+                             Vector3(box.m_max.x, box.m_max.y, 0.0f)));
+  }
+
+  static void
+  setElementId(uint32 elem, const OctreeElementId& id, void* context) {
+    DebugQuadtreeData* quadtreeData = reinterpret_cast<DebugQuadtreeData*>(context);
+    quadtreeData->elements[elem].octreeId = id;
+  }
+};
+
+typedef Quadtree<uint32, DebugQuadtreeOptions> DebugQuadtree;
+
+namespace {
+  /**
+   * @brief Fills the quadtree with randomly placed boxes of mixed sizes.
+   */
+  void
+  populateQuadtree(DebugQuadtree& quadtree, DebugQuadtreeData& quadtreeData, uint32 count) {
+    uint32 firstIdx = static_cast<uint32>(quadtreeData.elements.size());
+    generateElements(quadtreeData, count);
+
+    for (uint32 i = firstIdx; i < firstIdx + count; ++i) {
+      quadtree.addElement(i);
+    }
+  }
+
+  /**
+   * @brief Checks that box queries on the quadtree match a brute force
+   *        search over the elements in @p inQuadtree.
+   */
+  void
+  expectBoxQueriesMatch(const DebugQuadtree& quadtree,
+                        const DebugQuadtreeData& quadtreeData,
+                        const Vector<bool>& inQuadtree,
+                        uint32 numQueries) {
+    expectQueryResultsMatch(quadtreeData, inQuadtree, numQueries,
+                            [&](const Box2D& queryBounds, Vector<uint32>& found) {
+      DebugQuadtree::BoxIntersectIterator interIter(quadtree, queryBounds);
+      while (interIter.moveNext()) {
+        found.push_back(interIter.getElement());
+      }
+    });
+  }
+}
+
+TEST(geQuadtree, Construct_Quadtree) {
+  DebugQuadtreeData quadtreeData;
+  DebugQuadtree quadtree(Vector2::ZERO, 800.0f, &quadtreeData);
+  populateQuadtree(quadtree, quadtreeData, 20000);
+
+  DebugQuadtreeElem manualElems[3];
+  manualElems[0].box = Box2D(Vector2(100.0f, 100.0f), Vector2(110.0f, 115.0f));
+  manualElems[1].box = Box2D(Vector2(200.0f, 100.0f), Vector2(250.0f, 150.0f));
+  manualElems[2].box = Box2D(Vector2(90.0f, 90.0f), Vector2(105.0f, 105.0f));
+
+  for (uint32 i = 0; i < 3; ++i) {
+    uint32 elemIdx = static_cast<uint32>(quadtreeData.elements.size());
+    quadtreeData.elements.push_back(manualElems[i]);
+    quadtree.addElement(elemIdx);
+  }
+
+  //Elements outside of the root bounds stay in the root
+  DebugQuadtreeElem outsideElem;
+  outsideElem.box = Box2D(Vector2(900.0f, -950.0f), Vector2(910.0f, -940.0f));
+  quadtreeData.elements.push_back(outsideElem);
+  quadtree.addElement(static_cast<uint32>(quadtreeData.elements.size() - 1));
+
+  Vector<bool> inQuadtree(quadtreeData.elements.size(), true);
+  expectBoxQueriesMatch(quadtree, quadtreeData, inQuadtree, 64);
+
+  Vector<uint32> found;
+  DebugQuadtree::BoxIntersectIterator interIter(quadtree, manualElems[0].box);
+  while (interIter.moveNext()) {
+    found.push_back(interIter.getElement());
+  }
+  EXPECT_NE(std::find(found.begin(), found.end(), 20000U), found.end());
+  EXPECT_NE(std::find(found.begin(), found.end(), 20002U), found.end());
+  EXPECT_EQ(std::find(found.begin(), found.end(), 20001U), found.end());
+
+  DebugQuadtree::BoxIntersectIterator outsideIter(quadtree, outsideElem.box);
+  ASSERT_TRUE(outsideIter.moveNext());
+  EXPECT_EQ(20003U, outsideIter.getElement());
+
+  //Ensure nothing goes wrong during element removal
+  for (auto& entry : quadtreeData.elements) {
+    quadtree.removeElement(entry.quadtreeId);
+  }
+
+  DebugQuadtree::BoxIntersectIterator emptyIter(quadtree, Box2D(Vector2(-800.0f, -800.0f),
+                                                                Vector2(800.0f, 800.0f)));
+  EXPECT_FALSE(emptyIter.moveNext());
+}
+
+TEST(geQuadtree, Point_Query) {
+  DebugQuadtreeData quadtreeData;
+  DebugQuadtree quadtree(Vector2::ZERO, 800.0f, &quadtreeData);
+  populateQuadtree(quadtree, quadtreeData, 20000);
+
+  for (uint32 i = 0; i < 256; ++i) {
+    Vector2 point(randomUnit() * 800.0f, randomUnit() * 800.0f);
+
+    Vector<uint32> found;
+    DebugQuadtree::PointIntersectIterator pointIter(quadtree, point);
+    while (pointIter.moveNext()) {
+      found.push_back(pointIter.getElement());
+    }
+    std::sort(found.begin(), found.end());
+
+    Vector<uint32> expected;
+    for (uint32 j = 0; j < quadtreeData.elements.size(); ++j) {
+      if (quadtreeData.elements[j].box.intersect(Box2D(point, point))) {
+        expected.push_back(j);
+      }
+    }
+
+    EXPECT_TRUE(found == expected);
+  }
+}
+
+TEST(geQuadtree, Remove_Elements) {
+  DebugQuadtreeData quadtreeData;
+  DebugQuadtree quadtree(Vector2::ZERO, 800.0f, &quadtreeData);
+  populateQuadtree(quadtree, quadtreeData, 20000);
+
+  //Remove most elements so nodes get collapsed, then add some back
+  Vector<bool> inQuadtree(quadtreeData.elements.size(), true);
+  for (uint32 i = 0; i < quadtreeData.elements.size(); ++i) {
+    if (i % 8 != 0) {
+      quadtree.removeElement(quadtreeData.elements[i].quadtreeId);
+      inQuadtree[i] = false;
+    }
+  }
+  expectBoxQueriesMatch(quadtree, quadtreeData, inQuadtree, 64);
+
+  for (uint32 i = 0; i < quadtreeData.elements.size(); i += 3) {
+    if (!inQuadtree[i]) {
+      quadtree.addElement(i);
+      inQuadtree[i] = true;
+    }
+  }
+  expectBoxQueriesMatch(quadtree, quadtreeData, inQuadtree, 64);
+}
+
+TEST(geQuadtree, Benchmark_Box_Query) {
+  DebugQuadtreeData quadtreeData;
+  DebugQuadtree quadtree(Vector2::ZERO, 800.0f, &quadtreeData);
+
+  Timer timer;
+  populateQuadtree(quadtree, quadtreeData, 200000);
+  uint64 quadtreeAddTime = timer.getMicroseconds();
+
+  Octree<uint32, FlatOctreeOptions> octree(Vector3::ZERO, 800.0f, &quadtreeData);
+  timer.reset();
+  for (uint32 i = 0; i < quadtreeData.elements.size(); ++i) {
+    octree.addElement(i);
+  }
+  uint64 octreeAddTime = timer.getMicroseconds();
+
+  Vector<Box2D> boxes;
+  for (uint32 i = 0; i < 16384; ++i) {
+    Vector2 center(randomUnit() * 750.0f, randomUnit() * 750.0f);
+    boxes.emplace_back(center - Vector2(20.0f, 20.0f), center + Vector2(20.0f, 20.0f));
+  }
+
+  uint64 quadtreeHits = 0;
+  timer.reset();
+  for (auto& box : boxes) {
+    DebugQuadtree::BoxIntersectIterator interIter(quadtree, box);
+    while (interIter.moveNext()) {
+      ++quadtreeHits;
+    }
+  }
+  uint64 quadtreeTime = timer.getMicroseconds();
+
+  uint64 octreeHits = 0;
+  timer.reset();
+  for (auto& box : boxes) {
+    AABox box3D(Vector3(box.m_min.x, box.m_min.y, -1.0f),
+                Vector3(box.m_max.x, box.m_max.y, 1.0f));
+    Octree<uint32, FlatOctreeOptions>::BoxIntersectIterator interIter(octree, box3D);
+    while (interIter.moveNext()) {
+      ++octreeHits;
+    }
+  }
+  uint64 octreeTime = timer.getMicroseconds();
+
+  std::cout << quadtreeData.elements.size() << " elements added, Quadtree: "
+            << quadtreeAddTime << "us, Octree: " << octreeAddTime << "us; "
+            << boxes.size() << " box queries, Quadtree: " << quadtreeTime << "us, "
+            << "Octree: " << octreeTime << "us" << std::endl;
+
+  EXPECT_EQ(quadtreeHits, octreeHits);
+}
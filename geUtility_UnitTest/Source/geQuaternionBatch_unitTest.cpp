@@ -0,0 +1,141 @@
+#include <vld.h>
+#include <DirectXMath.h>
+
+#define GTEST_HAS_TR1_TUPLE 0
+#define GTEST_USE_OWN_TR1_TUPLE 0
+#include <gtest/gtest.h>
+
+#include <gePrerequisitesUtil.h>
+#include <geQuaternionBatch.h>
+#include <geTimer.h>
+
+using namespace geEngineSDK;
+
+namespace {
+  float
+  randomUnit() {
+    return (rand() / static_cast<float>(RAND_MAX)) * 2.0f - 1.0f;
+  }
+
+  Quaternion
+  randomRotation() {
+    Vector3 axis(randomUnit(), randomUnit(), randomUnit());
+    axis.normalize();
+    return Quaternion(axis, randomUnit() * Math::PI);
+  }
+
+  void
+  expectQuatNear(const Quaternion& a, const Quaternion& b, float tolerance) {
+    EXPECT_TRUE(a.equals(b, tolerance));
+  }
+}
+
+TEST(geQuaternionBatch, Multiply_Normalize) {
+  //Use a count that is not a multiple of four to exercise the tail
+  const uint32 count = 103;
+  Vector<Quaternion> a(count), b(count), result(count);
+  for (uint32 i = 0; i < count; ++i) {
+    a[i] = randomRotation();
+    b[i] = randomRotation();
+  }
+
+  QuaternionBatch::multiply(a.data(), b.data(), result.data(), count);
+  for (uint32 i = 0; i < count; ++i) {
+    expectQuatNear(result[i], a[i] * b[i], Math::KINDA_SMALL_NUMBER);
+  }
+
+  for (uint32 i = 0; i < count; ++i) {
+    a[i] = a[i] * (0.1f + (i % 7));
+  }
+  a[5] = Quaternion(0.0f, 0.0f, 0.0f, 0.0f);
+
+  QuaternionBatch::normalize(a.data(), result.data(), count);
+  for (uint32 i = 0; i < count; ++i) {
+    expectQuatNear(result[i], a[i].getNormalized(), Math::KINDA_SMALL_NUMBER);
+  }
+  EXPECT_TRUE(result[5] == Quaternion::IDENTITY);
+}
+
+TEST(geQuaternionBatch, Interpolation) {
+  const uint32 count = 257;
+  Vector<Quaternion> a(count), b(count), result(count);
+  Vector<float> alpha(count);
+  for (uint32 i = 0; i < count; ++i) {
+    a[i] = randomRotation();
+    b[i] = randomRotation();
+    alpha[i] = (randomUnit() + 1.0f) * 0.5f;
+  }
+
+  //Nearly identical rotations go through the linear path on the scalar side
+  b[3] = a[3];
+  alpha[7] = 0.0f;
+  alpha[8] = 1.0f;
+
+  QuaternionBatch::slerp(a.data(), b.data(), alpha.data(), result.data(), count);
+  for (uint32 i = 0; i < count; ++i) {
+    expectQuatNear(result[i], Quaternion::slerp(a[i], b[i], alpha[i]), 1.e-4f);
+  }
+
+  QuaternionBatch::nlerp(a.data(), b.data(), alpha.data(), result.data(), count);
+  for (uint32 i = 0; i < count; ++i) {
+    Quaternion expected = Quaternion::fastLerp(a[i], b[i], alpha[i]).getNormalized();
+    expectQuatNear(result[i], expected, Math::KINDA_SMALL_NUMBER);
+  }
+}
+
+TEST(geQuaternionBatch, Rotate_Vectors) {
+  const uint32 count = 66;
+  Vector<Quaternion> rotations(count);
+  Vector<Vector3> input(count), output(count);
+  for (uint32 i = 0; i < count; ++i) {
+    rotations[i] = randomRotation();
+    input[i] = Vector3(randomUnit(), randomUnit(), randomUnit()) * 100.0f;
+  }
+
+  QuaternionBatch::rotateVectors(rotations[0], input.data(), output.data(), count);
+  for (uint32 i = 0; i < count; ++i) {
+    EXPECT_TRUE(output[i].equals(rotations[0].rotateVector(input[i]), 1.e-3f));
+  }
+
+  QuaternionBatch::rotateVectors(rotations.data(), input.data(), output.data(), count);
+  for (uint32 i = 0; i < count; ++i) {
+    EXPECT_TRUE(output[i].equals(rotations[i].rotateVector(input[i]), 1.e-3f));
+  }
+}
+
+TEST(geQuaternionBatch, Benchmark_Slerp) {
+  const uint32 count = 1024 * 64;
+  const uint32 iterations = 16;
+
+  Vector<Quaternion> a(count), b(count), result(count);
+  Vector<float> alpha(count);
+  for (uint32 i = 0; i < count; ++i) {
+    a[i] = randomRotation();
+    b[i] = randomRotation();
+    alpha[i] = (randomUnit() + 1.0f) * 0.5f;
+  }
+
+  Timer timer;
+  for (uint32 j = 0; j < iterations; ++j) {
+    for (uint32 i = 0; i < count; ++i) {
+      result[i] = Quaternion::slerp(a[i], b[i], alpha[i]);
+    }
+  }
+  uint64 scalarTime = timer.getMicroseconds();
+
+  timer.reset();
+  for (uint32 j = 0; j < iterations; ++j) {
+    QuaternionBatch::slerp(a.data(), b.data(), alpha.data(), result.data(), count);
+  }
+  uint64 batchTime = timer.getMicroseconds();
+
+  timer.reset();
+  for (uint32 j = 0; j < iterations; ++j) {
+    QuaternionBatch::nlerp(a.data(), b.data(), alpha.data(), result.data(), count);
+  }
+  uint64 nlerpTime = timer.getMicroseconds();
+
+  std::cout << "Quaternion::slerp loop: " << scalarTime << "us, "
+            << "QuaternionBatch::slerp: " << batchTime << "us, "
+            << "QuaternionBatch::nlerp: " << nlerpTime << "us" << std::endl;
+}
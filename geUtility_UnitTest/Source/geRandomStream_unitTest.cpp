@@ -0,0 +1,168 @@
+#include <vld.h>
+#include <DirectXMath.h>
+
+#define GTEST_HAS_TR1_TUPLE 0
+#define GTEST_USE_OWN_TR1_TUPLE 0
+#include <gtest/gtest.h>
+
+#include <gePrerequisitesUtil.h>
+#include <geRandomStream.h>
+#include <geRandom.h>
+#include <geTimer.h>
+
+using namespace geEngineSDK;
+
+TEST(geRandomStream, Philox_Known_Answers) {
+  //Known answer vectors from the reference Philox4x32-10 implementation
+  {
+    const uint32 key[2] = { 0, 0 };
+    const uint32 counter[4] = { 0, 0, 0, 0 };
+    uint32 output[4];
+    RandomStream::philox(key, counter, output);
+    EXPECT_EQ(output[0], 0x6627e8d5U);
+    EXPECT_EQ(output[1], 0xe169c58dU);
+    EXPECT_EQ(output[2], 0xbc57ac4cU);
+    EXPECT_EQ(output[3], 0x9b00dbd8U);
+  }
+  {
+    const uint32 key[2] = { 0xffffffff, 0xffffffff };
+    const uint32 counter[4] = { 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff };
+    uint32 output[4];
+    RandomStream::philox(key, counter, output);
+    EXPECT_EQ(output[0], 0x408f276dU);
+    EXPECT_EQ(output[1], 0x41c83b0eU);
+    EXPECT_EQ(output[2], 0xa20bc7c6U);
+    EXPECT_EQ(output[3], 0x6d5451fdU);
+  }
+  {
+    const uint32 key[2] = { 0xa4093822, 0x299f31d0 };
+    const uint32 counter[4] = { 0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344 };
+    uint32 output[4];
+    RandomStream::philox(key, counter, output);
+    EXPECT_EQ(output[0], 0xd16cfe09U);
+    EXPECT_EQ(output[1], 0x94fdccebU);
+    EXPECT_EQ(output[2], 0x5001e420U);
+    EXPECT_EQ(output[3], 0x24126ea1U);
+  }
+}
+
+TEST(geRandomStream, Streams_And_Jump) {
+  const SIZE_T count = 1031;
+
+  RandomStream a(1234, 7);
+  Vector<uint32> sequence(count);
+  for (auto& value : sequence) {
+    value = a.get();
+  }
+  EXPECT_EQ(a.getPosition(), count);
+
+  //Same seed and stream reproduce the sequence, batch or not
+  RandomStream b(1234, 7);
+  Vector<uint32> batch(count);
+  b.get();
+  b.get();
+  b.get();
+  b.fill(batch.data(), count - 3);
+  for (SIZE_T i = 3; i < count; ++i) {
+    EXPECT_EQ(batch[i - 3], sequence[i]);
+  }
+
+  //Jumping ahead lands in the same place
+  RandomStream c(1234, 7);
+  c.jump(517);
+  EXPECT_EQ(c.get(), sequence[517]);
+  c.setPosition(3);
+  EXPECT_EQ(c.get(), sequence[3]);
+
+  //A different stream index gives a different sequence
+  RandomStream d(1234, 8);
+  uint32 matches = 0;
+  for (SIZE_T i = 0; i < count; ++i) {
+    matches += d.get() == sequence[i] ? 1 : 0;
+  }
+  EXPECT_LT(matches, 3U);
+}
+
+TEST(geRandomStream, Distributions) {
+  const SIZE_T count = 4099;
+  RandomStream stream(42);
+
+  Vector<float> values(count);
+  stream.fill(values.data(), count);
+  float sum = 0.0f;
+  for (auto value : values) {
+    EXPECT_GE(value, 0.0f);
+    EXPECT_LT(value, 1.0f);
+    sum += value;
+  }
+  EXPECT_NEAR(sum / count, 0.5f, 0.02f);
+
+  for (uint32 i = 0; i < 1000; ++i) {
+    int32 value = stream.getRange(-3, 5);
+    EXPECT_GE(value, -3);
+    EXPECT_LE(value, 5);
+  }
+
+  RandomStream scalar(42, 1);
+  RandomStream batch(42, 1);
+
+  Vector<Vector3> vectors(count);
+  batch.fillUnitVectors(vectors.data(), count);
+  Vector3 average(0.0f, 0.0f, 0.0f);
+  for (auto& v : vectors) {
+    EXPECT_TRUE(v.isNormalized());
+    EXPECT_TRUE(v.equals(scalar.getUnitVector(), 1.e-4f));
+    average += v;
+  }
+  EXPECT_LT((average / static_cast<float>(count)).size(), 0.05f);
+  EXPECT_EQ(scalar.getPosition(), batch.getPosition());
+
+  batch.fillInSphere(vectors.data(), count);
+  for (auto& v : vectors) {
+    EXPECT_LE(v.sizeSquared(), 1.0f + 1.e-5f);
+    EXPECT_TRUE(v.equals(scalar.getPointInSphere(), 1.e-4f));
+  }
+  EXPECT_EQ(scalar.getPosition(), batch.getPosition());
+}
+
+TEST(geRandomStream, Benchmark_Fill) {
+  const SIZE_T count = 1024 * 1024;
+
+  Vector<float> values(count);
+  Vector<Vector3> vectors(count);
+  float sum = 0.0f;
+
+  Random random(1);
+  Timer timer;
+  for (SIZE_T i = 0; i < count; ++i) {
+    values[i] = random.getUNorm();
+  }
+  uint64 randomTime = timer.getMicroseconds();
+  sum += values[count / 2];
+
+  RandomStream stream(1);
+  timer.reset();
+  stream.fill(values.data(), count);
+  uint64 fillTime = timer.getMicroseconds();
+  sum += values[count / 2];
+
+  timer.reset();
+  for (SIZE_T i = 0; i < count; ++i) {
+    vectors[i] = random.getUnitVector();
+  }
+  uint64 randomVectorTime = timer.getMicroseconds();
+  sum += vectors[count / 2].x;
+
+  timer.reset();
+  stream.fillUnitVectors(vectors.data(), count);
+  uint64 fillVectorTime = timer.getMicroseconds();
+  sum += vectors[count / 2].x;
+
+  std::cout << "Random::getUNorm loop: " << randomTime << "us, "
+            << "RandomStream::fill: " << fillTime << "us; "
+            << "Random::getUnitVector loop: " << randomVectorTime << "us, "
+            << "RandomStream::fillUnitVectors: " << fillVectorTime << "us"
+            << std::endl;
+
+  EXPECT_FALSE(Math::isNaN(sum));
+}
@@ -0,0 +1,362 @@
+#include <vld.h>
+#include <DirectXMath.h>
+
+#define GTEST_HAS_TR1_TUPLE 0
+#define GTEST_USE_OWN_TR1_TUPLE 0
+#include <gtest/gtest.h>
+
+#include <gePrerequisitesUtil.h>
+#include <geOctree.h>
+#include <geSpatialHashGrid.h>
+#include <geTaskScheduler.h>
+#include <geThreadPool.h>
+#include <geTimer.h>
+
+#include "geSpatialTestUtil.h"
+
+using namespace geEngineSDK;
+using namespace geSpatialTest;
+
+struct DebugGridElem
+{
+  AABox box;
+  mutable OctreeElementId octreeId;
+  mutable SpatialHashGridElementId gridId;
+};
+
+struct DebugGridData
+{
+  Vector<DebugGridElem> elements;
+};
+
+/**
+ * @brief Options shared by the grid and the octree, so both can be loaded
+ *        with the same elements.
+ */
+struct DebugGridOptions
+{
+  enum { loosePadding = 16 };
+  enum { minElementsPerNode = 8 };
+  enum { maxElementsPerNode = 16 };
+  enum { maxDepth = 12 };
+
+  static simd::AABox
+  getBounds(uint32 elem, void* context) {
+    DebugGridData* gridData = reinterpret_cast<DebugGridData*>(context);
+    return simd::AABox(gridData->elements[elem].box);
+  }
+
+  static void
+  setElementId(uint32 elem, const OctreeElementId& id, void* context) {
+    DebugGridData* gridData = reinterpret_cast<DebugGridData*>(context);
+    gridData->elements[elem].octreeId = id;
+  }
+
+  static void
+  setElementId(uint32 elem, const SpatialHashGridElementId& id, void* context) {
+    DebugGridData* gridData = reinterpret_cast<DebugGridData*>(context);
+    gridData->elements[elem].gridId = id;
+  }
+};
+
+typedef SpatialHashGrid<uint32, DebugGridOptions> DebugGrid;
+typedef Octree<uint32, DebugGridOptions> DebugGridOctree;
+
+namespace {
+  const float GRID_CELL_SIZE = 32.0f;
+
+  /**
+   * @brief Checks that box queries on the grid match a brute force search of
+   *        the elements in @p inGrid.
+   */
+  void
+  expectBoxQueriesMatch(const DebugGrid& grid,
+                        const DebugGridData& gridData,
+                        const Vector<bool>& inGrid,
+                        uint32 numQueries) {
+    expectQueryResultsMatch(gridData, inGrid, numQueries,
+                            [&](const AABox& queryBounds, Vector<uint32>& found) {
+      grid.forEachIntersecting(queryBounds, [&](uint32 elem) {
+        found.push_back(elem);
+      });
+    });
+  }
+}
+
+TEST(geSpatialHashGrid, Add_Update_Remove) {
+  DebugGridData gridData;
+  generateElements(gridData, 20000);
+
+  //Elements far away are clamped to the outermost cells, but still found
+  DebugGridElem far;
+  far.box = AABox(Vector3(1.e8f, 0.0f, 0.0f), Vector3(1.e8f + 5.0f, 5.0f, 5.0f));
+  gridData.elements.push_back(far);
+
+  DebugGrid grid(GRID_CELL_SIZE, &gridData);
+  for (uint32 i = 0; i < gridData.elements.size(); ++i) {
+    grid.addElement(i);
+  }
+  EXPECT_EQ(grid.getNumElements(), gridData.elements.size());
+
+  Vector<bool> inGrid(gridData.elements.size(), true);
+  expectBoxQueriesMatch(grid, gridData, inGrid, 32);
+
+  uint32 numFar = 0;
+  grid.forEachIntersecting(far.box, [&](uint32 elem) {
+    numFar += elem == gridData.elements.size() - 1 ? 1 : 0;
+  });
+  EXPECT_EQ(numFar, 1U);
+
+  //Move elements by less and more than a cell
+  for (uint32 i = 0; i < gridData.elements.size(); i += 3) {
+    AABox& box = gridData.elements[i].box;
+    Vector3 offset = Vector3(randomUnit(), randomUnit(), randomUnit()) *
+                     ((i % 2) ? 2.0f : 40.0f);
+    box = AABox(box.m_min + offset, box.m_max + offset);
+    grid.updateElement(gridData.elements[i].gridId);
+  }
+  expectBoxQueriesMatch(grid, gridData, inGrid, 32);
+
+  //Removing moves other elements, their reported IDs must stay valid
+  for (uint32 i = 0; i < gridData.elements.size(); i += 2) {
+    grid.removeElement(gridData.elements[i].gridId);
+    inGrid[i] = false;
+  }
+  EXPECT_EQ(grid.getNumElements(), gridData.elements.size() / 2);
+  expectBoxQueriesMatch(grid, gridData, inGrid, 32);
+
+  for (uint32 i = 1; i < gridData.elements.size(); i += 4) {
+    AABox& box = gridData.elements[i].box;
+    box = AABox(box.m_min + 20.0f, box.m_max + 20.0f);
+    grid.updateElement(gridData.elements[i].gridId);
+  }
+  expectBoxQueriesMatch(grid, gridData, inGrid, 32);
+
+  for (uint32 i = 1; i < gridData.elements.size(); i += 2) {
+    grid.removeElement(gridData.elements[i].gridId);
+  }
+  EXPECT_EQ(grid.getNumElements(), 0U);
+  EXPECT_EQ(grid.getNumCells(), 0U);
+}
+
+TEST(geSpatialHashGrid, Radius_Query) {
+  DebugGridData gridData;
+  generateElements(gridData, 20000);
+
+  DebugGrid grid(GRID_CELL_SIZE, &gridData);
+  for (uint32 i = 0; i < gridData.elements.size(); ++i) {
+    grid.addElement(i);
+  }
+
+  Vector<uint32> output(gridData.elements.size());
+  for (uint32 i = 0; i < 64; ++i) {
+    Vector3 point(randomUnit() * 800.0f, randomUnit() * 800.0f, randomUnit() * 800.0f);
+    float radius = 10.0f + (randomUnit() * 0.5f + 0.5f) * 150.0f;
+
+    SIZE_T count = grid.findWithinRadius(point, radius, output.data(), output.size());
+    ASSERT_LE(count, output.size());
+
+    Vector<uint32> found(output.begin(), output.begin() + count);
+    std::sort(found.begin(), found.end());
+    EXPECT_TRUE(std::unique(found.begin(), found.end()) == found.end());
+
+    uint32 elemIdx = 0;
+    for (auto& entry : gridData.elements) {
+      float distance = Math::sqrt(entry.box.computeSquaredDistanceToPoint(point));
+      bool isFound = std::binary_search(found.begin(), found.end(), elemIdx);
+
+      //Ignore elements right on the edge of the radius
+      if (Math::abs(distance - radius) > 1.e-3f) {
+        EXPECT_EQ(isFound, distance < radius);
+      }
+      elemIdx++;
+    }
+
+    //Output is clipped to the buffer capacity, but all elements are counted
+    EXPECT_EQ(grid.findWithinRadius(point, radius, output.data(), count / 2), count);
+  }
+}
+
+TEST(geSpatialHashGrid, Build_Grid) {
+  DebugGridData gridData;
+  generateElements(gridData, 30000);
+  Vector<uint32> indices = getElementIndices(gridData);
+  Vector<bool> inGrid(indices.size(), true);
+
+  //Serial build first, since the task scheduler can't be stopped afterwards
+  for (uint32 pass = 0; pass < 2; ++pass) {
+    if (1 == pass) {
+      startTaskScheduler();
+    }
+
+    DebugGrid grid(GRID_CELL_SIZE, &gridData);
+    grid.addElement(0);
+    grid.build(indices.data(), indices.size());
+    EXPECT_EQ(grid.getNumElements(), indices.size());
+    expectBoxQueriesMatch(grid, gridData, inGrid, 32);
+
+    //The reported IDs are valid
+    for (uint32 i = 0; i < indices.size(); i += 2) {
+      grid.removeElement(gridData.elements[i].gridId);
+    }
+    grid.addElement(0);
+    grid.updateElement(gridData.elements[1].gridId);
+  }
+}
+
+TEST(geSpatialHashGrid, Benchmark_Box_Query) {
+  DebugGridData gridData;
+  generateElements(gridData, 200000);
+  Vector<uint32> indices = getElementIndices(gridData);
+
+  DebugGridOctree octree(Vector3::ZERO, 800.0f, &gridData);
+  octree.build(indices.data(), indices.size());
+
+  DebugGrid grid(GRID_CELL_SIZE, &gridData);
+  grid.build(indices.data(), indices.size());
+
+  Vector<AABox> boxes;
+  for (uint32 i = 0; i < 16384; ++i) {
+    Vector3 center(randomUnit() * 750.0f, randomUnit() * 750.0f, randomUnit() * 750.0f);
+    boxes.emplace_back(center - 20.0f, center + 20.0f);
+  }
+
+  uint64 octreeHits = 0;
+  Timer timer;
+  for (auto& box : boxes) {
+    DebugGridOctree::BoxIntersectIterator interIter(octree, box);
+    while (interIter.moveNext()) {
+      ++octreeHits;
+    }
+  }
+  uint64 octreeTime = timer.getMicroseconds();
+
+  uint64 gridHits = 0;
+  timer.reset();
+  for (auto& box : boxes) {
+    grid.forEachIntersecting(box, [&](uint32) {
+      ++gridHits;
+    });
+  }
+  uint64 gridTime = timer.getMicroseconds();
+
+  Vector<uint32> output(gridData.elements.size());
+  uint64 octreeRadiusHits = 0;
+  timer.reset();
+  for (auto& box : boxes) {
+    octreeRadiusHits += octree.findWithinRadius(box.getCenter(), 20.0f,
+                                                output.data(), output.size());
+  }
+  uint64 octreeRadiusTime = timer.getMicroseconds();
+
+  uint64 gridRadiusHits = 0;
+  timer.reset();
+  for (auto& box : boxes) {
+    gridRadiusHits += grid.findWithinRadius(box.getCenter(), 20.0f,
+                                            output.data(), output.size());
+  }
+  uint64 gridRadiusTime = timer.getMicroseconds();
+
+  std::cout << boxes.size() << " box queries, Octree: " << octreeTime << "us, "
+            << "SpatialHashGrid: " << gridTime << "us; "
+            << boxes.size() << " radius queries, Octree: " << octreeRadiusTime << "us, "
+            << "SpatialHashGrid: " << gridRadiusTime << "us" << std::endl;
+
+  EXPECT_EQ(octreeHits, gridHits);
+  EXPECT_EQ(octreeRadiusHits, gridRadiusHits);
+}
+
+TEST(geSpatialHashGrid, Benchmark_Update_Elements) {
+  const uint32 numMoved = 50000;
+  const uint32 numFrames = 8;
+
+  DebugGridData gridData;
+  generateElements(gridData, 200000);
+  Vector<uint32> indices = getElementIndices(gridData);
+
+  DebugGridOctree octree(Vector3::ZERO, 800.0f, &gridData);
+  octree.build(indices.data(), indices.size());
+
+  DebugGrid grid(GRID_CELL_SIZE, &gridData);
+  grid.build(indices.data(), indices.size());
+
+  //Precompute the movement so both structures move the elements the same way
+  Vector<Vector3> offsets(numMoved);
+  for (auto& offset : offsets) {
+    offset = Vector3(randomUnit(), randomUnit(), randomUnit()) * 2.0f;
+  }
+
+  auto moveElements = [&](float direction) {
+    for (uint32 i = 0; i < numMoved; ++i) {
+      AABox& box = gridData.elements[i * 4].box;
+      box = AABox(box.m_min + offsets[i] * direction, box.m_max + offsets[i] * direction);
+    }
+  };
+
+  Timer timer;
+  for (uint32 frame = 0; frame < numFrames; ++frame) {
+    moveElements((frame & 1) ? -1.0f : 1.0f);
+    for (uint32 i = 0; i < numMoved; ++i) {
+      octree.updateElement(gridData.elements[i * 4].octreeId);
+    }
+  }
+  uint64 octreeTime = timer.getMicroseconds();
+
+  timer.reset();
+  for (uint32 frame = 0; frame < numFrames; ++frame) {
+    moveElements((frame & 1) ? -1.0f : 1.0f);
+    for (uint32 i = 0; i < numMoved; ++i) {
+      grid.updateElement(gridData.elements[i * 4].gridId);
+    }
+  }
+  uint64 gridTime = timer.getMicroseconds();
+
+  std::cout << "Moving " << numMoved << " elements per frame, "
+            << "Octree::updateElement: " << octreeTime / numFrames << "us, "
+            << "SpatialHashGrid::updateElement: " << gridTime / numFrames << "us"
+            << std::endl;
+
+  Vector<bool> inGrid(gridData.elements.size(), true);
+  expectBoxQueriesMatch(grid, gridData, inGrid, 4);
+}
+
+TEST(geSpatialHashGrid, Benchmark_Build_Grid) {
+  DebugGridData gridData;
+  generateElements(gridData, 1000000);
+  Vector<uint32> indices = getElementIndices(gridData);
+
+  //Only the loading is timed, not the destruction
+  DebugGridOctree octree(Vector3::ZERO, 800.0f, &gridData);
+  Timer timer;
+  octree.build(indices.data(), indices.size());
+  uint64 octreeTime = timer.getMicroseconds();
+
+  DebugGrid incremental(GRID_CELL_SIZE, &gridData);
+  timer.reset();
+  for (auto index : indices) {
+    incremental.addElement(index);
+  }
+  uint64 incrementalTime = timer.getMicroseconds();
+
+  DebugGrid serial(GRID_CELL_SIZE, &gridData);
+  timer.reset();
+  serial.build(indices.data(), indices.size());
+  uint64 buildTime = timer.getMicroseconds();
+
+  startTaskScheduler();
+
+  DebugGrid grid(GRID_CELL_SIZE, &gridData);
+  timer.reset();
+  grid.build(indices.data(), indices.size());
+  uint64 parallelBuildTime = timer.getMicroseconds();
+
+  std::cout << "Loading " << indices.size() << " elements, "
+            << "Octree::build: " << octreeTime << "us, "
+            << "SpatialHashGrid::addElement: " << incrementalTime << "us, "
+            << "build: " << buildTime << "us, "
+            << "build on " << TaskScheduler::instance().getNumWorkers()
+            << " workers: " << parallelBuildTime << "us" << std::endl;
+
+  Vector<bool> inGrid(gridData.elements.size(), true);
+  expectBoxQueriesMatch(grid, gridData, inGrid, 2);
+}
@@ -0,0 +1,176 @@
+#pragma once
+
+#include <gtest/gtest.h>
+
+#include <gePrerequisitesUtil.h>
+#include <geBox.h>
+#include <geBox2D.h>
+#include <geTaskScheduler.h>
+#include <geThreadPool.h>
+
+/**
+ * @brief Helpers shared by the tests of the spatial structures (Octree,
+ *        SpatialHashGrid and Quadtree), which are all filled with the same
+ *        kind of random boxes and checked against brute force searches.
+ */
+namespace geSpatialTest {
+  using namespace geEngineSDK;
+
+  inline float
+  randomUnit() {
+    return (rand() / static_cast<float>(RAND_MAX)) * 2.0f - 1.0f;
+  }
+
+  /**
+   * @brief Returns a randomly placed box, mostly small with a large one
+   *        every 50 elements.
+   */
+  template<class BoxType>
+  BoxType
+  randomElementBox(uint32 index);
+
+  template<>
+  inline AABox
+  randomElementBox<AABox>(uint32 index) {
+    const float placementExtents = 750.0f;
+    Vector3 position(randomUnit() * placementExtents,
+                     randomUnit() * placementExtents,
+                     randomUnit() * placementExtents);
+
+    float size = (index % 50) == 0 ? 30.0f : 3.0f;
+    Vector3 extents(0.1f + (randomUnit() * 0.5f + 0.5f) * size,
+                    0.1f + (randomUnit() * 0.5f + 0.5f) * size,
+                    0.1f + (randomUnit() * 0.5f + 0.5f) * size);
+
+    return AABox(position - extents, position + extents);
+  }
+
+  template<>
+  inline Box2D
+  randomElementBox<Box2D>(uint32 index) {
+    const float placementExtents = 750.0f;
+    Vector2 position(randomUnit() * placementExtents, randomUnit() * placementExtents);
+
+    float size = (index % 50) == 0 ? 30.0f : 3.0f;
+    Vector2 extents(0.1f + (randomUnit() * 0.5f + 0.5f) * size,
+                    0.1f + (randomUnit() * 0.5f + 0.5f) * size);
+
+    return Box2D(position - extents, position + extents);
+  }
+
+  /**
+   * @brief Returns a randomly placed query box of the given half size.
+   */
+  template<class BoxType>
+  BoxType
+  randomQueryBox(float extent);
+
+  template<>
+  inline AABox
+  randomQueryBox<AABox>(float extent) {
+    Vector3 center(randomUnit() * 750.0f, randomUnit() * 750.0f, randomUnit() * 750.0f);
+    return AABox(center - extent, center + extent);
+  }
+
+  template<>
+  inline Box2D
+  randomQueryBox<Box2D>(float extent) {
+    Vector2 center(randomUnit() * 750.0f, randomUnit() * 750.0f);
+    return Box2D(center - Vector2(extent, extent), center + Vector2(extent, extent));
+  }
+
+  /**
+   * @brief Appends randomly placed boxes of mixed sizes to the elements of
+   *        a test structure, without adding them to it.
+   */
+  template<class ElemData>
+  void
+  generateElements(ElemData& data, uint32 count) {
+    typedef typename decltype(ElemData::elements)::value_type ElemType;
+    typedef decltype(ElemType::box) BoxType;
+
+    for (uint32 i = 0; i < count; ++i) {
+      ElemType elem;
+      elem.box = randomElementBox<BoxType>(i);
+      data.elements.push_back(elem);
+    }
+  }
+
+  /**
+   * @brief Returns the indices of all the elements, in order.
+   */
+  template<class ElemData>
+  Vector<uint32>
+  getElementIndices(const ElemData& data) {
+    Vector<uint32> indices(data.elements.size());
+    for (uint32 i = 0; i < indices.size(); ++i) {
+      indices[i] = i;
+    }
+    return indices;
+  }
+
+  /**
+   * @brief Checks that random box queries report the same elements as a
+   *        brute force search over the elements marked in @p included. One
+   *        query in eight covers a large part of the placement area.
+   * @param[in] query Called with the query box and a vector to append the
+   *            elements found to.
+   */
+  template<class ElemData, class QueryFunc>
+  void
+  expectQueryResultsMatch(const ElemData& data,
+                          const Vector<bool>& included,
+                          uint32 numQueries,
+                          QueryFunc query) {
+    typedef typename decltype(ElemData::elements)::value_type ElemType;
+    typedef decltype(ElemType::box) BoxType;
+
+    for (uint32 i = 0; i < numQueries; ++i) {
+      const float extent = (i % 8) == 0 ? 600.0f : 60.0f;
+      const BoxType queryBounds = randomQueryBox<BoxType>(extent);
+
+      Vector<uint32> found;
+      query(queryBounds, found);
+      std::sort(found.begin(), found.end());
+
+      Vector<uint32> expected;
+      for (uint32 j = 0; j < data.elements.size(); ++j) {
+        if (included[j] && data.elements[j].box.intersect(queryBounds)) {
+          expected.push_back(j);
+        }
+      }
+
+      EXPECT_TRUE(found == expected);
+    }
+  }
+
+  /**
+   * @brief Starts the task scheduler the first time a test needs it. Modules
+   *        can't be restarted, so it keeps running until all tests are done.
+   */
+  inline void
+  startTaskScheduler() {
+    if (!TaskScheduler::isStarted()) {
+      ThreadPool::startUp<TThreadPool<>>(4, 64);
+      TaskScheduler::startUp();
+    }
+  }
+
+  class TaskSchedulerEnvironment : public ::testing::Environment
+  {
+   public:
+    void
+    TearDown() override {
+      if (TaskScheduler::isStarted()) {
+        TaskScheduler::shutDown();
+        ThreadPool::shutDown();
+      }
+    }
+  };
+
+  /**
+   * @brief Registered once for all the test files including this header.
+   */
+  inline ::testing::Environment* const taskSchedulerEnvironment =
+    ::testing::AddGlobalTestEnvironment(new TaskSchedulerEnvironment());
+}
@@ -0,0 +1,158 @@
+#include <vld.h>
+
+#define GTEST_HAS_TR1_TUPLE 0
+#define GTEST_USE_OWN_TR1_TUPLE 0
+#include <gtest/gtest.h>
+
+#include <gePrerequisitesUtil.h>
+#include <geTimer.h>
+
+using namespace geEngineSDK;
+
+namespace {
+  enum TestEnum
+  {
+    kFirst = 3,
+    kSecond = -7
+  };
+
+  //Parsed by the compiler
+  constexpr auto COMPILED = compileFormat("a{0}b\\{1}{1}");
+  static_assert(5 == COMPILED.m_numSegments, "Format string not parsed at compile time.");
+}
+
+TEST(geStringFormat, Identifiers) {
+  EXPECT_EQ("Value 5 and text", StringFormat::format("Value {0} and {1}", 5, String("text")));
+  EXPECT_EQ("b a b", StringFormat::format("{1} {0} {1}", "a", "b"));
+  EXPECT_EQ("no params", StringFormat::format("no params"));
+  EXPECT_EQ("", StringFormat::format(""));
+
+  //Missing parameters are left empty
+  EXPECT_EQ("x  y", StringFormat::format("x {3} y", 1));
+
+  //Escaped brackets and things that aren't identifiers are kept
+  EXPECT_EQ("{0} 1", StringFormat::format("\\{0} {0}", 1));
+  EXPECT_EQ("back\\slash", StringFormat::format("back\\\\slash"));
+  EXPECT_EQ("{a} {} {123} {20} {{0}", StringFormat::format("{a} {} {123} {20} {{0}", 1));
+  EXPECT_EQ("19", StringFormat::format("{19}", 0, 1, 2, 3, 4, 5, 6, 7, 8, 9,
+                                        10, 11, 12, 13, 14, 15, 16, 17, 18, 19));
+
+  //Through StringUtil as well
+  EXPECT_EQ("7-8", StringUtil::format(String("{0}-{1}"), 7, 8));
+}
+
+TEST(geStringFormat, Parameters) {
+  EXPECT_EQ(std::to_string(3.5f), StringFormat::format("{0}", 3.5f).c_str());
+  EXPECT_EQ(std::to_string(-2.25), StringFormat::format("{0}", -2.25).c_str());
+  EXPECT_EQ(std::to_string(1e300), StringFormat::format("{0}", 1e300).c_str());
+  EXPECT_EQ("-9223372036854775808",
+            StringFormat::format("{0}", std::numeric_limits<int64>::min()));
+  EXPECT_EQ("18446744073709551615",
+            StringFormat::format("{0}", std::numeric_limits<uint64>::max()));
+  EXPECT_EQ("0 -1 255", StringFormat::format("{0} {1} {2}", 0, int8(-1), uint8(255)));
+  EXPECT_EQ("1 0", StringFormat::format("{0} {1}", true, false));
+  EXPECT_EQ("65", StringFormat::format("{0}", 'A'));
+  EXPECT_EQ("3 -7", StringFormat::format("{0} {1}", kFirst, kSecond));
+
+  const char* nullText = nullptr;
+  char mutableText[] = "mutable";
+  EXPECT_EQ("[] mutable std", StringFormat::format("[{0}] {1} {2}",
+                                                    nullText,
+                                                    mutableText,
+                                                    std::string("std")));
+
+  EXPECT_EQ(L"wide 42 text", StringFormat::format(L"{0} {1} {2}",
+                                                  L"wide", 42, WString(L"text")));
+  EXPECT_EQ(L"{0}", StringFormat::format(GE_FORMAT_STRING(L"\\{0}"), 1));
+
+  //Outputs longer than the stack buffer
+  const String longText(1000, 'x');
+  const String longOutput = StringFormat::format("<{0}>", longText);
+  EXPECT_EQ(1002U, longOutput.size());
+  EXPECT_EQ("<" + longText + ">", longOutput);
+}
+
+TEST(geStringFormat, Compiled) {
+  EXPECT_EQ("a1b{1}2", StringFormat::format(COMPILED, 1, 2));
+  EXPECT_EQ(StringFormat::format("a{0}b\\{1}{1}", 1, 2), StringFormat::format(COMPILED, 1, 2));
+
+  const String name("player");
+  EXPECT_EQ("player took 12 damage, 0.500000 left",
+            StringFormat::format(GE_FORMAT_STRING("{0} took {1} damage, {2} left"),
+                                 name, 12, 0.5f));
+  EXPECT_EQ("{a} {123} {{0}", StringFormat::format(GE_FORMAT_STRING("{a} {123} {{0}"), 1));
+  EXPECT_EQ("7-8", StringUtil::format(GE_FORMAT_STRING("{0}-{1}"), 7, 8));
+}
+
+TEST(geStringFormat, Buffers) {
+  char buffer[16];
+  EXPECT_EQ(7U, StringFormat::formatTo(buffer, sizeof(buffer), "{0} + {1}", 10, 20));
+  EXPECT_STREQ("10 + 20", buffer);
+
+  //Cut to fit, but the whole length is returned
+  EXPECT_EQ(17U, StringFormat::formatTo(buffer, 8, GE_FORMAT_STRING("{0} is long"), "this text"));
+  EXPECT_STREQ("this te", buffer);
+  EXPECT_EQ(17U, StringFormat::formatTo<char>(nullptr, 0, "{0} is long", "this text"));
+
+  //Written without allocating
+  const String name("player");
+  const uint64 startAllocs = MemoryCounter::getNumAllocs();
+  for (uint32 i = 0; i < 100; ++i) {
+    StringFormat::formatTo(buffer, sizeof(buffer), "{0}: {1}", name, i);
+    StringFormat::formatTo(buffer, sizeof(buffer), GE_FORMAT_STRING("{0}: {1}"), name, 1.5);
+  }
+  EXPECT_EQ(startAllocs, MemoryCounter::getNumAllocs());
+  EXPECT_STREQ("player: 1.50000", buffer);
+
+  g_frameAlloc().markFrame();
+  char* frameText = StringFormat::formatFrame(GE_FORMAT_STRING("frame {0}"), 3);
+  EXPECT_STREQ("frame 3", frameText);
+  const String longText(500, 'y');
+  char* longFrameText = StringFormat::formatFrame("[{0}]", longText);
+  EXPECT_EQ(502U, strlen(longFrameText));
+  ge_frame_free(longFrameText);
+  ge_frame_free(frameText);
+  g_frameAlloc().clear();
+}
+
+TEST(geStringFormat, Benchmark_Format) {
+  const uint32 numFormats = 200000;
+  const String name("player");
+
+  char buffer[128];
+  uint64 totalLength = 0;
+
+  Timer timer;
+  for (uint32 i = 0; i < numFormats; ++i) {
+    totalLength += StringFormat::format("{0} took {1} damage on frame {2}", name, i, i / 2).size();
+  }
+  const double stringTime = timer.getMicroseconds() * 1000.0 / numFormats;
+
+  timer.reset();
+  for (uint32 i = 0; i < numFormats; ++i) {
+    totalLength += StringFormat::formatTo(buffer, sizeof(buffer),
+                                          "{0} took {1} damage on frame {2}", name, i, i / 2);
+  }
+  const double bufferTime = timer.getMicroseconds() * 1000.0 / numFormats;
+
+  timer.reset();
+  for (uint32 i = 0; i < numFormats; ++i) {
+    totalLength += StringFormat::formatTo(buffer, sizeof(buffer),
+                                          GE_FORMAT_STRING("{0} took {1} damage on frame {2}"),
+                                          name, i, i / 2);
+  }
+  const double compiledTime = timer.getMicroseconds() * 1000.0 / numFormats;
+
+  timer.reset();
+  for (uint32 i = 0; i < numFormats; ++i) {
+    totalLength += snprintf(buffer, sizeof(buffer), "%s took %u damage on frame %u",
+                            name.c_str(), i, i / 2);
+  }
+  const double snprintfTime = timer.getMicroseconds() * 1000.0 / numFormats;
+  EXPECT_GT(totalLength, 0U);
+
+  std::cout << "ns per format: to String: " << stringTime
+            << ", to buffer: " << bufferTime
+            << ", compiled to buffer: " << compiledTime
+            << ", snprintf: " << snprintfTime << std::endl;
+}
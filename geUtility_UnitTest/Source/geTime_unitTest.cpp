@@ -0,0 +1,223 @@
+#include <vld.h>
+
+#define GTEST_HAS_TR1_TUPLE 0
+#define GTEST_USE_OWN_TR1_TUPLE 0
+#include <gtest/gtest.h>
+
+#include <gePrerequisitesUtil.h>
+#include <geTime.h>
+#include <geTimer.h>
+
+using namespace geEngineSDK;
+
+namespace {
+  /**
+   * @brief Starts Time the first time a test needs it. Modules can't be
+   *        restarted, so it keeps running until all tests are done.
+   */
+  Time&
+  startTime() {
+    if (!Time::isStarted()) {
+      Time::startUp();
+    }
+
+    return Time::instance();
+  }
+
+  class TimeEnvironment : public ::testing::Environment
+  {
+   public:
+    void
+    TearDown() override {
+      if (Time::isStarted()) {
+        Time::shutDown();
+      }
+    }
+  };
+
+  ::testing::Environment* const timeEnvironment =
+    ::testing::AddGlobalTestEnvironment(new TimeEnvironment());
+
+  void
+  sleepFor(uint64 microseconds) {
+    std::this_thread::sleep_for(std::chrono::microseconds(microseconds));
+  }
+
+  /**
+   * @brief Time step as it used to be kept, in float seconds.
+   */
+  struct FloatClock
+  {
+    void
+    advance(uint64 delta) {
+      time += static_cast<float>(delta * Time::MICROSEC_TO_SEC);
+    }
+
+    float time = 0.0f;
+  };
+}
+
+TEST(geTime, Update) {
+  Time& time = startTime();
+
+  const uint64 startFrame = time.getFrameIdx();
+  sleepFor(2000);
+  time._update();
+  sleepFor(2000);
+  time._update();
+
+  EXPECT_EQ(startFrame + 2, time.getFrameIdx());
+  EXPECT_GE(time.getFrameDeltaUs(), 2000U);
+  EXPECT_NEAR(time.getFrameDeltaUs() * Time::MICROSEC_TO_SEC, time.getFrameDelta(), 1e-6);
+  EXPECT_EQ(time.getTimeUs() / 1000, time.getTimeMs());
+  EXPECT_LE(time.getTimeUs(), time.getTimePrecise());
+  EXPECT_GE(time.getFrameTimeStats().getNumFrames(), 2U);
+
+  //Created clocks follow the frames until released
+  SPtr<Clock> clock = time.createClock();
+  clock->setScale(2.0);
+  sleepFor(1000);
+  time._update();
+  EXPECT_EQ(time.getFrameDeltaUs() * 2, clock->getFrameDeltaUs());
+  EXPECT_EQ(clock->getTimeUs(), clock->getFrameDeltaUs());
+
+  std::weak_ptr<Clock> released = clock;
+  clock = nullptr;
+  time._update();
+  EXPECT_TRUE(released.expired());
+
+  time.getGameClock().setPaused(true);
+  const uint64 gameTime = time.getGameClock().getTimeUs();
+  sleepFor(1000);
+  time._update();
+  EXPECT_EQ(gameTime, time.getGameClock().getTimeUs());
+  time.getGameClock().setPaused(false);
+}
+
+TEST(geTime, Clock) {
+  Clock clock;
+  clock.advance(1000);
+  EXPECT_EQ(1000U, clock.getTimeUs());
+  EXPECT_EQ(1000U, clock.getFrameDeltaUs());
+
+  clock.setPaused(true);
+  clock.advance(1000);
+  EXPECT_EQ(1000U, clock.getTimeUs());
+  EXPECT_EQ(0U, clock.getFrameDeltaUs());
+  EXPECT_EQ(0.0f, clock.getFrameDelta());
+
+  //Scaled time keeps the fractions of a microsecond
+  clock.setPaused(false);
+  clock.setScale(1.0 / 3.0);
+  for (uint32 i = 0; i < 3000; ++i) {
+    clock.advance(1);
+  }
+  EXPECT_NEAR(2000.0, static_cast<double>(clock.getTimeUs()), 1.0);
+
+  //Three weeks in, a microsecond still counts
+  Clock uptime;
+  FloatClock floatClock;
+  const uint64 threeWeeks = 21ULL * 24 * 60 * 60 * 1000000;
+  uptime.advance(threeWeeks);
+  floatClock.advance(threeWeeks);
+
+  const double before = uptime.getTime();
+  const float floatBefore = floatClock.time;
+  for (uint32 i = 0; i < 1000; ++i) {
+    uptime.advance(16);
+    floatClock.advance(16);
+  }
+  EXPECT_NEAR(0.016, uptime.getTime() - before, 1e-9);
+  EXPECT_EQ(floatBefore, floatClock.time);
+}
+
+TEST(geTime, Fixed_Steps) {
+  Clock clock;
+  clock.setFixedStep(10000);
+
+  //Frames of varying length end up with the same steps
+  const uint64 frameTimes[] = { 3000, 16000, 7000, 1000, 24000, 9000 };
+  uint32 numSteps = 0;
+  for (uint64 frameTime : frameTimes) {
+    clock.advance(frameTime);
+    numSteps += clock.consumeFixedSteps();
+    EXPECT_GE(clock.getFixedStepAlpha(), 0.0f);
+    EXPECT_LT(clock.getFixedStepAlpha(), 1.0f);
+  }
+  EXPECT_EQ(6U, numSteps);
+  EXPECT_FLOAT_EQ(0.0f, clock.getFixedStepAlpha());
+
+  clock.advance(2500);
+  EXPECT_EQ(0U, clock.consumeFixedSteps());
+  EXPECT_FLOAT_EQ(0.25f, clock.getFixedStepAlpha());
+  EXPECT_FLOAT_EQ(0.01f, clock.getFixedStepDelta());
+
+  //A long hitch is capped instead of piling up steps
+  clock.setMaxFixedSteps(4);
+  clock.advance(1000000);
+  EXPECT_EQ(4U, clock.consumeFixedSteps());
+  EXPECT_EQ(0U, clock.consumeFixedSteps());
+  EXPECT_FLOAT_EQ(0.25f, clock.getFixedStepAlpha());
+
+  //A paused clock accumulates nothing
+  clock.setPaused(true);
+  clock.advance(50000);
+  EXPECT_EQ(0U, clock.consumeFixedSteps());
+}
+
+TEST(geTime, Frame_Stats) {
+  FrameTimeStats stats;
+  EXPECT_EQ(0U, stats.getNumFrames());
+  EXPECT_EQ(0U, stats.getPercentile(0.99f));
+
+  for (uint64 i = 1; i <= 100; ++i) {
+    stats.addFrame(i * 100);
+  }
+  EXPECT_EQ(100U, stats.getNumFrames());
+  EXPECT_EQ(100U, stats.getMin());
+  EXPECT_EQ(10000U, stats.getMax());
+  EXPECT_EQ(5050U, stats.getAverage());
+  EXPECT_EQ(5000U, stats.getPercentile(0.5f));
+  EXPECT_EQ(9500U, stats.getPercentile(0.95f));
+  EXPECT_EQ(9900U, stats.getPercentile(0.99f));
+
+  //Only the most recent frames are kept
+  for (uint32 i = 0; i < FrameTimeStats::CAPACITY; ++i) {
+    stats.addFrame(16000);
+  }
+  EXPECT_EQ(FrameTimeStats::CAPACITY, stats.getNumFrames());
+  EXPECT_EQ(16000U, stats.getMin());
+  EXPECT_EQ(16000U, stats.getPercentile(0.99f));
+}
+
+TEST(geTime, Benchmark_Update) {
+  const uint32 numFrames = 1000000;
+
+  Clock clock;
+  clock.setScale(0.5);
+  FrameTimeStats stats;
+
+  Timer timer;
+  uint32 numSteps = 0;
+  for (uint32 i = 0; i < numFrames; ++i) {
+    const uint64 frameTime = 16000 + (i % 7) * 100;
+    clock.advance(frameTime);
+    numSteps += clock.consumeFixedSteps();
+    stats.addFrame(frameTime);
+  }
+  const double updateTime = timer.getMicroseconds() * 1000.0 / numFrames;
+  EXPECT_GT(numSteps, 0U);
+
+  const uint32 numQueries = 10000;
+  timer.reset();
+  uint64 total = 0;
+  for (uint32 i = 0; i < numQueries; ++i) {
+    total += stats.getPercentile(0.99f);
+  }
+  const double percentileTime = timer.getMicroseconds() * 1000.0 / numQueries;
+  EXPECT_GT(total, 0U);
+
+  std::cout << "ns per frame: clock and stats update: " << updateTime
+            << ", ns per p99 query over " << FrameTimeStats::CAPACITY
+            << " frames: " << percentileTime << std::endl;
+}
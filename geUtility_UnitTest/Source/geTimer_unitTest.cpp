@@ -0,0 +1,120 @@
+#include <vld.h>
+
+#define GTEST_HAS_TR1_TUPLE 0
+#define GTEST_USE_OWN_TR1_TUPLE 0
+#include <gtest/gtest.h>
+
+#include <gePrerequisitesUtil.h>
+#include <geTimer.h>
+
+using namespace geEngineSDK;
+
+TEST(geTimer, Cycle_Calibrate_Concurrent) {
+  //Every caller returns once the rate is measured, and they all agree on it
+  double nsPerCycle[4] = {};
+  Vector<Thread> threads;
+  for (uint32 i = 0; i < 4; ++i) {
+    threads.emplace_back([&nsPerCycle, i]() {
+      CycleTimer::calibrate();
+      nsPerCycle[i] = CycleTimer::getNanosecondsPerCycle();
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  for (uint32 i = 1; i < 4; ++i) {
+    EXPECT_EQ(nsPerCycle[0], nsPerCycle[i]);
+  }
+  if (CycleTimer::isUsingTsc()) {
+    EXPECT_NE(1.0, nsPerCycle[0]);
+  }
+}
+
+TEST(geTimer, Cycle_Timer) {
+  CycleTimer::calibrate();
+  EXPECT_GT(CycleTimer::getNanosecondsPerCycle(), 0.0);
+
+  //Agrees with the system clock
+  Timer timer;
+  CycleTimer cycleTimer;
+  std::this_thread::sleep_for(std::chrono::milliseconds(20));
+  const uint64 cycleTime = cycleTimer.getMicroseconds();
+  const uint64 time = timer.getMicroseconds();
+  EXPECT_GE(cycleTime, 20000U);
+  EXPECT_NEAR(static_cast<double>(time), static_cast<double>(cycleTime), time * 0.05);
+
+  //Never goes back
+  uint64 last = CycleTimer::now();
+  for (uint32 i = 0; i < 10000; ++i) {
+    const uint64 current = CycleTimer::now();
+    EXPECT_LE(last, current);
+    last = current;
+  }
+
+  cycleTimer.reset();
+  EXPECT_LT(cycleTimer.getMicroseconds(), 20000U);
+}
+
+TEST(geTimer, Cycle_Conversion) {
+  CycleTimer::calibrate();
+  const double nsPerCycle = CycleTimer::getNanosecondsPerCycle();
+
+  EXPECT_EQ(0U, CycleTimer::toNanoseconds(0));
+
+  //Weeks of counts convert without overflowing
+  const uint64 threeWeeksNs = 21ULL * 24 * 60 * 60 * 1000000000;
+  const uint64 durations[] = { 1000, 1000000007, threeWeeksNs };
+  for (uint64 ns : durations) {
+    const auto cycles = static_cast<uint64>(ns / nsPerCycle);
+    const double expected = cycles * nsPerCycle;
+    EXPECT_NEAR(expected, static_cast<double>(CycleTimer::toNanoseconds(cycles)),
+                expected * 1e-9 + 1.0);
+  }
+
+  uint64 last = 0;
+  for (uint64 cycles = 0; cycles < 100000; cycles += 7) {
+    const uint64 ns = CycleTimer::toNanoseconds(cycles);
+    EXPECT_LE(last, ns);
+    last = ns;
+  }
+}
+
+TEST(geTimer, Benchmark_Read) {
+  CycleTimer::calibrate();
+  const uint32 numReads = 10000000;
+
+  uint64 sum = 0;
+  CycleTimer total;
+  for (uint32 i = 0; i < numReads; ++i) {
+    sum += CycleTimer::now();
+  }
+  const double nowTime = total.getNanoseconds() / static_cast<double>(numReads);
+
+  CycleTimer cycleTimer;
+  total.reset();
+  for (uint32 i = 0; i < numReads; ++i) {
+    sum += cycleTimer.getNanoseconds();
+  }
+  const double nanosecondsTime = total.getNanoseconds() / static_cast<double>(numReads);
+
+  Timer timer;
+  total.reset();
+  for (uint32 i = 0; i < numReads; ++i) {
+    sum += timer.getMicroseconds();
+  }
+  const double timerTime = total.getNanoseconds() / static_cast<double>(numReads);
+  EXPECT_GT(sum, 0U);
+
+  //Reading the counter costs what the processor (or hypervisor) makes it
+  //cost, converting it to nanoseconds must stay well under 10 ns on top
+  const double conversionTime = nanosecondsTime - nowTime;
+  EXPECT_LT(conversionTime, 10.0);
+
+  std::cout << "ns per call (" << (CycleTimer::isUsingTsc() ? "TSC" : "monotonic clock")
+            << ", " << CycleTimer::getNanosecondsPerCycle() << " ns per count): "
+            << "CycleTimer::now: " << nowTime << ", "
+            << "CycleTimer::getNanoseconds: " << nanosecondsTime
+            << " (conversion: " << conversionTime << "), "
+            << "Timer::getMicroseconds: " << timerTime << std::endl;
+}
@@ -0,0 +1,224 @@
+#include <vld.h>
+#include <DirectXMath.h>
+
+#define GTEST_HAS_TR1_TUPLE 0
+#define GTEST_USE_OWN_TR1_TUPLE 0
+#include <gtest/gtest.h>
+
+#include <gePrerequisitesUtil.h>
+#include <geVector3Stream.h>
+#include <geBox.h>
+#include <geSphere.h>
+#include <geBoxSphereBounds.h>
+#include <geMatrix4.h>
+#include <geTimer.h>
+
+using namespace geEngineSDK;
+
+namespace {
+  float
+  randomUnit() {
+    return (rand() / static_cast<float>(RAND_MAX)) * 2.0f - 1.0f;
+  }
+
+  Vector<Vector3>
+  makePointCloud(SIZE_T count) {
+    Vector<Vector3> points(count);
+    for (auto& point : points) {
+      point = Vector3(randomUnit() * 100.0f + 20.0f,
+                      randomUnit() * 50.0f - 10.0f,
+                      randomUnit() * 10.0f);
+    }
+    return points;
+  }
+
+  AABox
+  scalarBounds(const Vector<Vector3>& points) {
+    AABox box(FORCE_INIT::kForceInit);
+    for (auto& point : points) {
+      box += point;
+    }
+    return box;
+  }
+
+  Sphere
+  scalarSphere(const Vector<Vector3>& points) {
+    AABox box = scalarBounds(points);
+    Vector3 center = (box.m_min + box.m_max) / 2;
+    float radius = 0.0f;
+    for (auto& point : points) {
+      radius = Math::max(radius, Vector3::distSquared(point, center));
+    }
+    return Sphere(center, Math::sqrt(radius) * 1.001f);
+  }
+}
+
+TEST(geVector3Stream, Conversion) {
+  //Use a count that is not a multiple of four to exercise the tail
+  Vector<Vector3> points = makePointCloud(103);
+  Vector3Stream stream(points);
+  ASSERT_EQ(stream.size(), points.size());
+
+  for (SIZE_T i = 0; i < points.size(); ++i) {
+    EXPECT_TRUE(stream.get(i) == points[i]);
+  }
+
+  Vector<Vector3> output(points.size());
+  stream.copyTo(output.data());
+  EXPECT_TRUE(output == points);
+
+  stream.add(Vector3(1.0f, 2.0f, 3.0f));
+  EXPECT_EQ(stream.size(), points.size() + 1);
+  EXPECT_TRUE(stream.get(points.size()) == Vector3(1.0f, 2.0f, 3.0f));
+}
+
+TEST(geVector3Stream, Bounds) {
+  EXPECT_EQ(Vector3Stream().getBounds().m_isValid, 0);
+  EXPECT_EQ(AABox(nullptr, 0).m_isValid, 0);
+
+  for (SIZE_T count : { 1, 3, 4, 7, 64, 1001 }) {
+    Vector<Vector3> points = makePointCloud(count);
+    AABox expected = scalarBounds(points);
+
+    AABox fromArray(points.data(), points.size());
+    AABox fromStream{ Vector3Stream(points) };
+    EXPECT_TRUE(fromArray == expected);
+    EXPECT_TRUE(fromStream == expected);
+    EXPECT_EQ(fromArray.m_isValid, 1);
+    EXPECT_EQ(fromStream.m_isValid, 1);
+
+    Sphere expectedSphere = scalarSphere(points);
+    Sphere sphere(points.data(), points.size());
+    Sphere streamSphere{ Vector3Stream(points) };
+    EXPECT_TRUE(sphere.m_center == expectedSphere.m_center);
+    EXPECT_FLOAT_EQ(sphere.m_radius, expectedSphere.m_radius);
+    EXPECT_TRUE(streamSphere.m_center == expectedSphere.m_center);
+    EXPECT_FLOAT_EQ(streamSphere.m_radius, expectedSphere.m_radius);
+
+    BoxSphereBounds bounds(points.data(), points.size());
+    EXPECT_TRUE(bounds.getBox().m_min.equals(expected.m_min, Math::KINDA_SMALL_NUMBER));
+    EXPECT_TRUE(bounds.getBox().m_max.equals(expected.m_max, Math::KINDA_SMALL_NUMBER));
+    EXPECT_FLOAT_EQ(bounds.m_sphereRadius,
+                    Math::sqrt(Vector3Stream::getMaxDistSquared(points.data(),
+                                                                points.size(),
+                                                                bounds.m_origin)));
+  }
+}
+
+TEST(geVector3Stream, Reductions) {
+  Vector<Vector3> points = makePointCloud(1027);
+  Vector3Stream stream(points);
+
+  Vector3 sum(0.0f, 0.0f, 0.0f);
+  for (auto& point : points) {
+    sum += point;
+  }
+
+  EXPECT_TRUE(stream.getSum().equals(sum, 0.1f));
+  EXPECT_TRUE(stream.getCentroid().equals(sum / static_cast<float>(points.size()),
+                                          Math::KINDA_SMALL_NUMBER));
+  EXPECT_TRUE(Vector3Stream().getCentroid() == Vector3(0.0f, 0.0f, 0.0f));
+}
+
+TEST(geVector3Stream, Per_Element) {
+  Vector<Vector3> points = makePointCloud(66);
+  points[5] = Vector3(0.0f, 0.0f, 0.0f);
+  points[65] = Vector3(0.0f, 0.0f, 0.0f);
+
+  Vector3Stream stream(points);
+  const Vector3 v(0.3f, -2.0f, 1.5f);
+
+  Vector<float> dots(points.size());
+  stream.dot(v, dots.data());
+  for (SIZE_T i = 0; i < points.size(); ++i) {
+    EXPECT_FLOAT_EQ(dots[i], points[i] | v);
+  }
+
+  Vector3Stream crosses;
+  stream.cross(v, crosses);
+  ASSERT_EQ(crosses.size(), points.size());
+  for (SIZE_T i = 0; i < points.size(); ++i) {
+    EXPECT_TRUE(crosses.get(i).equals(points[i] ^ v, Math::KINDA_SMALL_NUMBER));
+  }
+
+  Matrix4 m = RotationTranslationMatrix(Rotator(30.0f, 45.0f, 10.0f),
+                                        Vector3(10.0f, -5.0f, 2.0f));
+  Vector3Stream transformed;
+  stream.transformPosition(m, transformed);
+  for (SIZE_T i = 0; i < points.size(); ++i) {
+    Vector3 expected(m.transformPosition(points[i]));
+    EXPECT_TRUE(transformed.get(i).equals(expected, 1.e-3f));
+  }
+
+  stream.transformVector(m, transformed);
+  for (SIZE_T i = 0; i < points.size(); ++i) {
+    EXPECT_TRUE(transformed.get(i).equals(m.transformVector(points[i]), 1.e-3f));
+  }
+
+  stream.normalize();
+  for (SIZE_T i = 0; i < points.size(); ++i) {
+    Vector3 expected = points[i];
+    expected.normalize();
+    EXPECT_TRUE(stream.get(i).equals(expected, Math::KINDA_SMALL_NUMBER));
+  }
+  EXPECT_TRUE(stream.get(5) == Vector3(0.0f, 0.0f, 0.0f));
+  EXPECT_TRUE(stream.get(65) == Vector3(0.0f, 0.0f, 0.0f));
+}
+
+TEST(geVector3Stream, Benchmark_Bounds) {
+  const SIZE_T count = 1024 * 1024;
+  const uint32 iterations = 8;
+
+  Vector<Vector3> points = makePointCloud(count);
+  Vector3Stream stream(points);
+
+  //Accumulate the results so the loops can't be optimized away
+  AABox boxes(FORCE_INIT::kForceInit);
+  float radius = 0.0f;
+
+  Timer timer;
+  for (uint32 j = 0; j < iterations; ++j) {
+    boxes += scalarBounds(points);
+  }
+  uint64 scalarBoxTime = timer.getMicroseconds();
+
+  timer.reset();
+  for (uint32 j = 0; j < iterations; ++j) {
+    boxes += AABox(points.data(), points.size());
+  }
+  uint64 arrayBoxTime = timer.getMicroseconds();
+
+  timer.reset();
+  for (uint32 j = 0; j < iterations; ++j) {
+    boxes += stream.getBounds();
+  }
+  uint64 streamBoxTime = timer.getMicroseconds();
+
+  timer.reset();
+  for (uint32 j = 0; j < iterations; ++j) {
+    radius += scalarSphere(points).m_radius;
+  }
+  uint64 scalarSphereTime = timer.getMicroseconds();
+
+  timer.reset();
+  for (uint32 j = 0; j < iterations; ++j) {
+    radius += Sphere(points.data(), points.size()).m_radius;
+  }
+  uint64 arraySphereTime = timer.getMicroseconds();
+
+  timer.reset();
+  for (uint32 j = 0; j < iterations; ++j) {
+    radius += Sphere(stream).m_radius;
+  }
+  uint64 streamSphereTime = timer.getMicroseconds();
+
+  std::cout << "AABox scalar: " << scalarBoxTime << "us, "
+            << "array: " << arrayBoxTime << "us, "
+            << "stream: " << streamBoxTime << "us; "
+            << "Sphere scalar: " << scalarSphereTime << "us, "
+            << "array: " << arraySphereTime << "us, "
+            << "stream: " << streamSphereTime << "us" << std::endl;
+
+  EXPECT_TRUE(boxes == scalarBounds(points));
+  EXPECT_GT(radius, 0.0f);
+}